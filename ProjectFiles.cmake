@@ -48,6 +48,10 @@ list(APPEND SOURCE_FILES
   ${CMAKE_CURRENT_SOURCE_DIR}/src/algo/CallbackManager.hpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/algo/DispatchQueue.cpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/algo/DispatchQueue.hpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/algo/FairDispatchQueue.cpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/algo/FairDispatchQueue.hpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/algo/JsonMessage.cpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/algo/JsonMessage.hpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/algo/NetworkOperation.cpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/algo/NetworkOperation.hpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/algo/StringUtils.cpp
@@ -58,15 +62,26 @@ list(APPEND SOURCE_FILES
   ${CMAKE_CURRENT_SOURCE_DIR}/src/config/ServerConfig.cpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/config/ServerConfig.hpp
   #
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/log/EventLog.cpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/log/EventLog.hpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/log/Logger.cpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/log/Logger.hpp
   #
   ${CMAKE_CURRENT_SOURCE_DIR}/src/lua/LuaScript.cpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/lua/LuaScript.hpp
   #
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/metrics/MessageTrace.cpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/metrics/MessageTrace.hpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/metrics/Metrics.cpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/metrics/Metrics.hpp
+  #
   ${CMAKE_CURRENT_SOURCE_DIR}/src/storage/path.cpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/storage/path.hpp
   #
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/net/MessageCodec.cpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/net/MessageCodec.hpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/net/schema/Messages.idl
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/net/schema/SchemaSupport.hpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/net/NetworkManagerBase.cpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/net/NetworkManagerBase.hpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/net/SessionBase.cpp
@@ -77,6 +92,10 @@ list(APPEND SOURCE_FILES
   ${CMAKE_CURRENT_SOURCE_DIR}/src/net/ConnectionManagerBase.hpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/net/SessionPair.cpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/net/SessionPair.hpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/net/RateLimiter.cpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/net/RateLimiter.hpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/net/TrafficCapture.cpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/net/TrafficCapture.hpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/net/core.hpp
   #
   ${CMAKE_CURRENT_SOURCE_DIR}/src/net/wrtc/SessionManager.cpp
@@ -85,6 +104,12 @@ list(APPEND SOURCE_FILES
   ${CMAKE_CURRENT_SOURCE_DIR}/src/net/wrtc/Observers.hpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/net/wrtc/PeerConnectivityChecker.cpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/net/wrtc/PeerConnectivityChecker.hpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/net/wrtc/PeerFactoryContext.cpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/net/wrtc/PeerFactoryContext.hpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/net/wrtc/SdpTemplateCache.cpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/net/wrtc/SdpTemplateCache.hpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/net/wrtc/SessionSetupStats.cpp
+  ${CMAKE_CURRENT_SOURCE_DIR}/src/net/wrtc/SessionSetupStats.hpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/net/wrtc/Timer.cpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/net/wrtc/Timer.hpp
   ${CMAKE_CURRENT_SOURCE_DIR}/src/net/wrtc/WRTCServer.cpp
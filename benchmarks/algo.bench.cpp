@@ -0,0 +1,126 @@
+#include "algo/CallbackManager.hpp"
+#include "algo/DispatchQueue.hpp"
+#include "algo/NetworkOperation.hpp"
+#include "algo/StringUtils.hpp"
+#include "net/ws/WsNetworkOperation.hpp"
+#include "net/ws/server/ServerInputCallbacks.hpp"
+#include <atomic>
+#include <folly/Benchmark.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchCommon.h"
+
+using namespace gloer;
+
+namespace {
+
+// NOTE: dispatch() to full queue drops all queued callbacks, so queue is drained earlier
+static constexpr size_t kDrainThreshold = algo::maxQueueElems / 2;
+
+} // namespace
+
+BENCHMARK(DispatchQueue_dispatchAndDrain, iters) {
+  folly::BenchmarkSuspender braces;
+  algo::DispatchQueue queue("bench", 0);
+  size_t executed = 0;
+  braces.dismiss();
+
+  for (size_t i = 0; i < iters; i++) {
+    queue.dispatch([&executed]() { executed++; });
+    if (queue.sizeGuess() >= kDrainThreshold) {
+      queue.DispatchQueued();
+    }
+  }
+  queue.DispatchQueued();
+  folly::doNotOptimizeAway(executed);
+}
+
+/**
+ * DispatchQueue is single-producer single-consumer, so each producer thread
+ * writes into own queue (queue per connection) and one consumer drains all of them.
+ **/
+void DispatchQueue_producers(unsigned iters, size_t producers) {
+  folly::BenchmarkSuspender braces;
+  std::vector<std::unique_ptr<algo::DispatchQueue>> queues;
+  for (size_t i = 0; i < producers; i++) {
+    queues.push_back(std::make_unique<algo::DispatchQueue>("bench", 0));
+  }
+  const size_t perProducer = iters / producers + 1;
+  size_t executed = 0;
+  std::atomic<bool> started{false};
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < producers; i++) {
+    threads.emplace_back([&queues, &executed, &started, perProducer, i]() {
+      while (!started.load()) {
+        std::this_thread::yield();
+      }
+      algo::DispatchQueue& queue = *queues[i];
+      for (size_t j = 0; j < perProducer; j++) {
+        while (queue.isFull()) {
+          std::this_thread::yield();
+        }
+        queue.dispatch([&executed]() { executed++; });
+      }
+    });
+  }
+  braces.dismiss();
+
+  started = true;
+  const size_t total = perProducer * producers;
+  while (executed < total) {
+    for (const auto& queue : queues) {
+      queue->DispatchQueued();
+    }
+  }
+
+  braces.rehire();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+BENCHMARK_PARAM(DispatchQueue_producers, 1)
+BENCHMARK_PARAM(DispatchQueue_producers, 2)
+BENCHMARK_PARAM(DispatchQueue_producers, 4)
+BENCHMARK_PARAM(DispatchQueue_producers, 8)
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(StringUtils_genGuid, iters) {
+  for (size_t i = 0; i < iters; i++) {
+    folly::doNotOptimizeAway(algo::genGuid());
+  }
+}
+
+BENCHMARK(Opcodes_wsOpcodeFromStr, iters) {
+  folly::BenchmarkSuspender braces;
+  // known opcodes and unknown one
+  const std::vector<std::string> opcodes = {"0", "1", "2", "3", "4", "999"};
+  braces.dismiss();
+
+  for (size_t i = 0; i < iters; i++) {
+    folly::doNotOptimizeAway(algo::Opcodes::wsOpcodeFromStr(opcodes[i % opcodes.size()]));
+  }
+}
+
+BENCHMARK(CallbackManager_findCallback, iters) {
+  folly::BenchmarkSuspender braces;
+  net::ws::ServerInputCallbacks callbacks;
+  // every second opcode has callback, so both found and missing lookups are measured
+  for (const algo::WS_OPCODE opcode : algo::WS_OPCODE::_values()) {
+    if (opcode._to_integral() % 2 == 0) {
+      callbacks.addCallback(net::ws::WsNetworkOperation(opcode),
+                            [](std::shared_ptr<net::SessionPair>, net::WSServerNetworkManager*,
+                               std::shared_ptr<const algo::JsonMessage>) {});
+    }
+  }
+  const uint32_t opcodesCount = static_cast<uint32_t>(algo::WS_OPCODE::_size());
+  braces.dismiss();
+
+  for (uint32_t i = 0; i < iters; i++) {
+    folly::doNotOptimizeAway(callbacks.findCallback(i % opcodesCount));
+  }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace gloer {
+namespace bench {
+
+/**
+ * Runs |func| in a loop on |threads| background threads until destroyed,
+ * used to measure operations under contention.
+ * NOTE: create inside folly::BenchmarkSuspender scope, thread start is not measured
+ **/
+class BackgroundLoad {
+public:
+  BackgroundLoad(size_t threads, std::function<void(size_t threadIndex)> func) {
+    for (size_t i = 0; i < threads; i++) {
+      threads_.emplace_back([this, func, i]() {
+        while (!stop_.load(std::memory_order_relaxed)) {
+          func(i);
+        }
+      });
+    }
+  }
+
+  ~BackgroundLoad() {
+    stop_ = true;
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  BackgroundLoad(const BackgroundLoad&) = delete;
+  BackgroundLoad& operator=(const BackgroundLoad&) = delete;
+
+private:
+  std::atomic<bool> stop_{false};
+
+  std::vector<std::thread> threads_;
+};
+
+} // namespace bench
+} // namespace gloer
@@ -0,0 +1,60 @@
+#include "algo/JsonMessage.hpp"
+#include "net/schema/Messages.generated.hpp"
+#include <folly/Benchmark.h>
+#include <string>
+
+using namespace gloer;
+
+namespace {
+
+// data channel offer of browser client
+static const std::string kOfferMessage =
+    R"({"type":"2","payload":{"type":"offer","sdp":"v=0\r\n)"
+    R"(o=- 4611731400430051336 2 IN IP4 127.0.0.1\r\ns=-\r\nt=0 0\r\n)"
+    R"(a=group:BUNDLE 0\r\na=msid-semantic: WMS\r\n)"
+    R"(m=application 9 UDP/DTLS/SCTP webrtc-datachannel\r\nc=IN IP4 0.0.0.0\r\n)"
+    R"(a=ice-ufrag:3eZa\r\na=ice-pwd:bF7pYbnqnuxSX1dRDeGkP+3S\r\na=ice-options:trickle\r\n)"
+    R"(a=fingerprint:sha-256 4E:1C:50:6A:0B:D8:7E:33:6D:29:CE:2A:4A:2E:D4:76:)"
+    R"(E2:38:3D:8F:02:06:66:9E:2A:0A:AC:2D:2C:0F:C4:3E\r\n)"
+    R"(a=setup:actpass\r\na=mid:0\r\na=sctp-port:5000\r\na=max-message-size:262144\r\n"}})";
+
+static const std::string kCandidateMessage =
+    R"({"type":"1","payload":{"candidate":"candidate:842163049 1 udp 1677729535 )"
+    R"(192.168.1.10 54321 typ srflx raddr 0.0.0.0 rport 0 generation 0 ufrag 3eZa )"
+    R"(network-cost 999","sdpMid":"0","sdpMLineIndex":0}})";
+
+// game message sent every tick by clients
+static const std::string kGameMessage =
+    R"({"type":"7","payload":{"seq":1042,"x":12.5,"y":-3.25,"angle":1.57,"keys":[1,0,0,1]}})";
+
+} // namespace
+
+BENCHMARK(JsonMessage_parseOffer, iters) {
+  for (size_t i = 0; i < iters; i++) {
+    algo::JsonMessage message(kOfferMessage);
+    net::schema::SessionDescription payload;
+    if (message.parse()) {
+      net::schema::fromJsonPayload(message.document(), payload);
+    }
+    folly::doNotOptimizeAway(payload.sdp.size());
+  }
+}
+
+BENCHMARK(JsonMessage_parseCandidate, iters) {
+  for (size_t i = 0; i < iters; i++) {
+    algo::JsonMessage message(kCandidateMessage);
+    net::schema::IceCandidate payload;
+    if (message.parse()) {
+      net::schema::fromJsonPayload(message.document(), payload);
+    }
+    folly::doNotOptimizeAway(payload.sdpMLineIndex);
+  }
+}
+
+BENCHMARK(JsonMessage_parseGame, iters) {
+  for (size_t i = 0; i < iters; i++) {
+    algo::JsonMessage message(kGameMessage);
+    const char* type = message.parse() ? message.getString("type") : nullptr;
+    folly::doNotOptimizeAway(type);
+  }
+}
@@ -0,0 +1,25 @@
+/**
+ * Microbenchmarks of hot paths, based on folly/Benchmark.h
+ *
+ * Usage:
+ *   gloer-benchmarks                        # table with time per iteration
+ *   gloer-benchmarks --bm_regex=Session     # only matching benchmarks
+ *   gloer-benchmarks --json > new.json      # machine-readable results
+ *   scripts/compare_benchmarks.py old.json new.json
+ **/
+
+#include "log/Logger.hpp"
+#include <folly/Benchmark.h>
+#include <gflags/gflags.h>
+
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  // NOTE: no sinks, log output must not disturb measurements
+  gloer::log::Logger lg(/* console */ false, /* file */ false);
+
+  folly::runBenchmarks();
+
+  lg.shutDownLogging();
+  return 0;
+}
@@ -0,0 +1,140 @@
+#include "algo/StringUtils.hpp"
+#include "net/SessionManagerBase.hpp"
+#include "net/ws/SessionGUID.hpp"
+#include <folly/Benchmark.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "benchCommon.h"
+
+using namespace gloer;
+
+namespace {
+
+struct BenchSession {};
+
+class BenchSessionManager : public net::SessionManagerBase<BenchSession, net::ws::SessionGUID> {
+public:
+  void unregisterSession(const net::ws::SessionGUID& id) override { removeSessById(id); }
+};
+
+struct SessionsFixture {
+  BenchSessionManager manager;
+  std::vector<net::ws::SessionGUID> ids;
+  // not registered, used by add/remove benchmarks
+  std::vector<net::ws::SessionGUID> extraIds;
+};
+
+// threads reading sessions while benchmark thread works
+static constexpr size_t kContendingThreads = 3;
+
+/**
+ * Manager with |sessions| registered sessions.
+ * NOTE: created once per size, filling 100k sessions would dominate short runs
+ **/
+static SessionsFixture& sessionsFixture(size_t sessions) {
+  static std::map<size_t, std::unique_ptr<SessionsFixture>> fixtures;
+  auto& fixture = fixtures[sessions];
+  if (!fixture) {
+    fixture = std::make_unique<SessionsFixture>();
+    fixture->ids.reserve(sessions);
+    for (size_t i = 0; i < sessions; i++) {
+      fixture->ids.emplace_back(algo::genGuid());
+      fixture->manager.addSession(fixture->ids.back(), std::make_shared<BenchSession>());
+    }
+    for (size_t i = 0; i < 1024; i++) {
+      fixture->extraIds.emplace_back(algo::genGuid());
+    }
+  }
+  return *fixture;
+}
+
+static void getSessById(unsigned iters, size_t sessions, size_t contendingThreads) {
+  folly::BenchmarkSuspender braces;
+  SessionsFixture& fixture = sessionsFixture(sessions);
+  bench::BackgroundLoad load(contendingThreads, [&fixture](size_t threadIndex) {
+    folly::doNotOptimizeAway(
+        fixture.manager.getSessById(fixture.ids[threadIndex % fixture.ids.size()]));
+  });
+  braces.dismiss();
+
+  for (size_t i = 0; i < iters; i++) {
+    folly::doNotOptimizeAway(fixture.manager.getSessById(fixture.ids[i % fixture.ids.size()]));
+  }
+
+  braces.rehire();
+}
+
+static void addRemoveSession(unsigned iters, size_t sessions, size_t contendingThreads) {
+  folly::BenchmarkSuspender braces;
+  SessionsFixture& fixture = sessionsFixture(sessions);
+  auto session = std::make_shared<BenchSession>();
+  bench::BackgroundLoad load(contendingThreads, [&fixture](size_t threadIndex) {
+    folly::doNotOptimizeAway(
+        fixture.manager.getSessById(fixture.ids[threadIndex % fixture.ids.size()]));
+  });
+  braces.dismiss();
+
+  for (size_t i = 0; i < iters; i++) {
+    const net::ws::SessionGUID& id = fixture.extraIds[i % fixture.extraIds.size()];
+    fixture.manager.addSession(id, session);
+    fixture.manager.unregisterSession(id);
+  }
+
+  braces.rehire();
+}
+
+} // namespace
+
+void SessionManager_getSessById(unsigned iters, size_t sessions) {
+  getSessById(iters, sessions, 0);
+}
+
+void SessionManager_getSessByIdContended(unsigned iters, size_t sessions) {
+  getSessById(iters, sessions, kContendingThreads);
+}
+
+void SessionManager_addRemove(unsigned iters, size_t sessions) {
+  addRemoveSession(iters, sessions, 0);
+}
+
+void SessionManager_addRemoveContended(unsigned iters, size_t sessions) {
+  addRemoveSession(iters, sessions, kContendingThreads);
+}
+
+// time of one pass over all sessions
+void SessionManager_doToAllSessions(unsigned iters, size_t sessions) {
+  folly::BenchmarkSuspender braces;
+  SessionsFixture& fixture = sessionsFixture(sessions);
+  size_t visited = 0;
+  braces.dismiss();
+
+  for (size_t i = 0; i < iters; i++) {
+    fixture.manager.doToAllSessions(
+        [&visited](const net::ws::SessionGUID&, std::shared_ptr<BenchSession>) { visited++; });
+  }
+  folly::doNotOptimizeAway(visited);
+}
+
+BENCHMARK_PARAM(SessionManager_getSessById, 1000)
+BENCHMARK_PARAM(SessionManager_getSessById, 10000)
+BENCHMARK_PARAM(SessionManager_getSessById, 100000)
+BENCHMARK_PARAM(SessionManager_getSessByIdContended, 1000)
+BENCHMARK_PARAM(SessionManager_getSessByIdContended, 10000)
+BENCHMARK_PARAM(SessionManager_getSessByIdContended, 100000)
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_PARAM(SessionManager_addRemove, 1000)
+BENCHMARK_PARAM(SessionManager_addRemove, 10000)
+BENCHMARK_PARAM(SessionManager_addRemove, 100000)
+BENCHMARK_PARAM(SessionManager_addRemoveContended, 1000)
+BENCHMARK_PARAM(SessionManager_addRemoveContended, 10000)
+BENCHMARK_PARAM(SessionManager_addRemoveContended, 100000)
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_PARAM(SessionManager_doToAllSessions, 1000)
+BENCHMARK_PARAM(SessionManager_doToAllSessions, 10000)
+BENCHMARK_PARAM(SessionManager_doToAllSessions, 100000)
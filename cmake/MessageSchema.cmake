@@ -0,0 +1,20 @@
+# Generates C++ message structs from IDL, see scripts/generate_messages.py
+#
+# add_message_schema(<target> <idl_file>)
+# Output: ${CMAKE_CURRENT_BINARY_DIR}/net/schema/<idl name>.generated.hpp,
+# CMAKE_CURRENT_BINARY_DIR is already in THIRDPARTY_FILES include dirs (see ProjectFiles.cmake).
+
+findPackageCrossPlatform( PythonInterp 3 REQUIRED )
+
+function(add_message_schema target idl_file)
+  get_filename_component(idl_name ${idl_file} NAME_WE)
+  set(output_header ${CMAKE_CURRENT_BINARY_DIR}/net/schema/${idl_name}.generated.hpp)
+  add_custom_command(
+    OUTPUT ${output_header}
+    COMMAND ${PYTHON_EXECUTABLE} ${ROOT_PROJECT_DIR}/scripts/generate_messages.py
+            ${idl_file} ${output_header}
+    DEPENDS ${idl_file} ${ROOT_PROJECT_DIR}/scripts/generate_messages.py
+    COMMENT "Generating message structs from ${idl_file}"
+    VERBATIM )
+  add_custom_target( ${target} DEPENDS ${output_header} )
+endfunction()
@@ -176,7 +176,9 @@ bool WRTCServerManager::handleIncomingJSON(const gloer::net::wrtc::SessionGUID&
   rapidjson::ParseResult result = message_object.Parse(message.c_str());
   // LOG(INFO) << "incomingStr: " << message->c_str();
   if (!result || !message_object.IsObject() || !message_object.HasMember("type")) {
-    LOG(WARNING) << "WRTCSession::on_read: ignored invalid message without type " << message;
+    GLOG_EVERY_MS(GAME, WARNING, 1000)
+        << "WRTCSession::on_read: ignored invalid message without type";
+    GLOG_PAYLOAD(GAME) << "invalid message = " << message;
     return false;
   }
   // Probably should do some error checking on the JSON object.
@@ -185,14 +187,13 @@ bool WRTCServerManager::handleIncomingJSON(const gloer::net::wrtc::SessionGUID&
     LOG(WARNING) << "WRTCSession::handleIncomingJSON: ignored invalid message with invalid "
                     "type field";
   }
-  const auto& callbacks = game_.lock()->wrtc_nm->operationCallbacks().getCallbacks();
+  const auto& callbacks = game_.lock()->wrtc_nm->operationCallbacks();
 
-  const WRTCNetworkOperation wrtcNetworkOperation{
-      static_cast<WRTC_OPCODE>(Opcodes::wrtcOpcodeFromStr(typeStr))};
-  const auto itFound = callbacks.find(wrtcNetworkOperation);
+  uint32_t opcode = 0;
+  const WRTCNetworkOperationCallback* callback =
+      Opcodes::parseOpcode(typeStr.c_str(), opcode) ? callbacks.findCallback(opcode) : nullptr;
   // if a callback is registered for event, add it to queue
-  if (itFound != callbacks.end()) {
-    WRTCNetworkOperationCallback callback = itFound->second;
+  if (callback) {
     auto sessPtr = game_.lock()->wrtc_nm->sessionManager().getSessById(sessId);
     if (!sessPtr || !sessPtr.get()) {
       LOG(WARNING) << "WRTCSession::handleIncomingJSON: ignored invalid session";
@@ -200,7 +201,7 @@ bool WRTCServerManager::handleIncomingJSON(const gloer::net::wrtc::SessionGUID&
     }
     // WRTCSession* sess = sessPtr.get();
     DispatchQueue::dispatch_callback callbackBind = std::bind(
-        callback, sessPtr, game_.lock()->wrtc_nm.get(), std::make_shared<std::string>(message));
+        *callback, sessPtr, game_.lock()->wrtc_nm.get(), std::make_shared<std::string>(message));
     receivedMessagesQueue_->dispatch(callbackBind);
     // callbackBind();
 
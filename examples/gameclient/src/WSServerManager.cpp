@@ -112,13 +112,12 @@ bool WSServerManager::handleIncomingJSON(const gloer::net::ws::SessionGUID& sess
   }
 
   /// TODO: nm <<<<
-  const auto& callbacks = game_.lock()->ws_nm->operationCallbacks().getCallbacks();
-  const gloer::net::ws::WsNetworkOperation NetworkOperation{
-      static_cast<WS_OPCODE>(Opcodes::wsOpcodeFromStr(typeStr))};
-  const auto itFound = callbacks.find(NetworkOperation);
+  const auto& callbacks = game_.lock()->ws_nm->operationCallbacks();
+  uint32_t opcode = 0;
+  const gloer::net::ws::ClientNetworkOperationCallback* callback =
+      Opcodes::parseOpcode(typeStr.c_str(), opcode) ? callbacks.findCallback(opcode) : nullptr;
   // if a callback is registered for event, add it to queue
-  if (itFound != callbacks.end()) {
-    gloer::net::ws::ClientNetworkOperationCallback callback = itFound->second;
+  if (callback) {
     auto sessPtr = game_.lock()->ws_nm->sessionManager().getSessById(sessId);
     if (!sessPtr || !sessPtr.get()) {
       LOG(WARNING) << "WsSession::handleIncomingJSON: ignored invalid session";
@@ -126,7 +125,7 @@ bool WSServerManager::handleIncomingJSON(const gloer::net::ws::SessionGUID& sess
     }
     // WsSession* sess = sessPtr.get();
     DispatchQueue::dispatch_callback callbackBind = std::bind(
-        callback, sessPtr, game_.lock()->ws_nm.get(), std::make_shared<std::string>(message));
+        *callback, sessPtr, game_.lock()->ws_nm.get(), std::make_shared<std::string>(message));
     receivedMessagesQueue_->dispatch(callbackBind);
 
     /*LOG(WARNING) << "WsSession::handleIncomingJSON: receivedMessagesQueue_->sizeGuess() "
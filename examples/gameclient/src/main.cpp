@@ -537,6 +537,12 @@ int main(int argc, char* argv[]) {
       algo::WS_OPCODE::CANDIDATE, algo::Opcodes::opcodeToStr(algo::WS_OPCODE::CANDIDATE));
   gameInstance->ws_nm->getRunner()->addCallback(CANDIDATE_OPERATION, &candidateCallback);
 
+  // NOTE: same callback, payload of CANDIDATE_BATCH is array of candidates
+  const ws::WsNetworkOperation CANDIDATE_BATCH_OPERATION =
+      ws::WsNetworkOperation(algo::WS_OPCODE::CANDIDATE_BATCH,
+                             algo::Opcodes::opcodeToStr(algo::WS_OPCODE::CANDIDATE_BATCH));
+  gameInstance->ws_nm->getRunner()->addCallback(CANDIDATE_BATCH_OPERATION, &candidateCallback);
+
   const ws::WsNetworkOperation OFFER_OPERATION = ws::WsNetworkOperation(
       algo::WS_OPCODE::OFFER, algo::Opcodes::opcodeToStr(algo::WS_OPCODE::OFFER));
   gameInstance->ws_nm->getRunner()->addCallback(OFFER_OPERATION, &offerCallback);
@@ -41,9 +41,10 @@ std::shared_ptr<
   gloer::net::WRTCNetworkManager
 > GameServer::wrtc_nm = nullptr;
 
-void GameServer::init(std::weak_ptr<GameServer> game) {
-  wsGameManager = std::make_shared<WSServerManager>(game);
-  wrtcGameManager = std::make_shared<WRTCServerManager>(game);
+void GameServer::init(std::weak_ptr<GameServer> game,
+                      const ::gloer::config::ServerConfig& config) {
+  wsGameManager = std::make_shared<WSServerManager>(game, config);
+  wrtcGameManager = std::make_shared<WRTCServerManager>(game, config);
 }
 
 void GameServer::handleIncomingMessages() {
@@ -59,4 +60,9 @@ void GameServer::handleIncomingMessages() {
   wrtcGameManager->processIncomingMessages();
 }
 
+void GameServer::handleUrgentMessages() {
+  wsGameManager->processUrgentMessages();
+  wrtcGameManager->processUrgentMessages();
+}
+
 } // namespace gameserver
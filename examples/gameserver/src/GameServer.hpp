@@ -82,10 +82,13 @@ public:
     ::gloer::net::WRTCNetworkManager
   > wrtc_nm;
 
-  void init(std::weak_ptr<GameServer> game);
+  void init(std::weak_ptr<GameServer> game, const ::gloer::config::ServerConfig& config);
 
   void handleIncomingMessages();
 
+  // latency-critical messages queued since last wakeup, see ServerManagerBase::setWakeupHandler
+  void handleUrgentMessages();
+
 public:
   std::shared_ptr<WSServerManager> wsGameManager{nullptr};
   std::shared_ptr<WRTCServerManager> wrtcGameManager{nullptr};
@@ -22,8 +22,10 @@
 #  endif
 #endif
 
+#include <chrono>
 #include <string>
 #include <thread>
+#include <utility>
 
 namespace gameserver {
 
@@ -35,9 +37,152 @@ bool ServerManagerBase::hasReceivedMessages() const {
   return receivedMessagesQueue_->isEmpty();
 }
 
-std::shared_ptr<DispatchQueue> ServerManagerBase::getReceivedMessages() const {
+std::shared_ptr<FairDispatchQueue> ServerManagerBase::getReceivedMessages() const {
   // NOTE: Returned smart pointer by value to increment reference count
   return receivedMessagesQueue_;
 }
 
+uint64_t ServerManagerBase::droppedMessages(const std::string& sessId) const {
+  return receivedMessagesQueue_->sessionDropped(sessId) +
+         urgentMessagesQueue_->sessionDropped(sessId);
+}
+
+size_t ServerManagerBase::processReceivedMessages() {
+  if (!receivedMessagesQueue_ || !receivedMessagesQueue_.get()) {
+    LOG(WARNING) << "ServerManagerBase::processReceivedMessages invalid receivedMessagesQueue_";
+    return 0;
+  }
+  const auto processStart = std::chrono::steady_clock::now();
+  const size_t processedCount = receivedMessagesQueue_->DispatchQueued();
+  tickMessagesMetric_.record(processedCount);
+  tickProcessTimeMetric_.record(static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                            processStart)
+          .count()));
+  reportDroppingSessions();
+  return processedCount;
+}
+
+void ServerManagerBase::reportDroppingSessions() {
+  const auto now = std::chrono::steady_clock::now();
+  if (now - lastDropReport_ < kDropReportInterval) {
+    return;
+  }
+  lastDropReport_ = now;
+
+  // NOTE: per-session metric series would grow with number of clients, so only log them
+  std::vector<std::pair<std::string, uint64_t>> dropping =
+      receivedMessagesQueue_->droppingSessions();
+  for (const auto& sessionkv : urgentMessagesQueue_->droppingSessions()) {
+    dropping.push_back(sessionkv);
+  }
+  if (dropping.empty()) {
+    return;
+  }
+
+  const size_t reported = std::min(dropping.size(), kDropReportSessions);
+  std::partial_sort(dropping.begin(), dropping.begin() + reported, dropping.end(),
+                    [](const auto& lhs, const auto& rhs) { return lhs.second > rhs.second; });
+  std::string sessions;
+  for (size_t i = 0; i < reported; i++) {
+    sessions += " " + dropping[i].first + "=" + std::to_string(dropping[i].second);
+  }
+  GLOG(GAME, WARNING) << "ServerManagerBase: " << dropping.size()
+                      << " session queues dropped messages, top:" << sessions;
+}
+
+void ServerManagerBase::setWakeupHandler(std::function<void()> wakeupHandler) {
+  wakeupHandler_ = std::move(wakeupHandler);
+}
+
+void ServerManagerBase::processUrgentMessages() {
+  if (!urgentMessagesQueue_ || !urgentMessagesQueue_.get()) {
+    LOG(WARNING) << "ServerManagerBase::processUrgentMessages invalid urgentMessagesQueue_";
+    return;
+  }
+  urgentMessagesQueue_->DispatchQueued();
+  if (!urgentMessagesQueue_->isEmpty() && wakeupHandler_) {
+    // rest of messages did not fit into tick budget
+    wakeupHandler_();
+  }
+}
+
+bool ServerManagerBase::dispatch(const std::string& sessId,
+                                 const FairDispatchQueue::dispatch_callback& callback,
+                                 bool isLatencyCritical) {
+  if (!isLatencyCritical || !wakeupHandler_) {
+    return receivedMessagesQueue_->dispatch(sessId, callback);
+  }
+  if (!urgentMessagesQueue_->dispatch(sessId, callback)) {
+    return false;
+  }
+  wakeupHandler_();
+  return true;
+}
+
+void ServerManagerBase::addSessionQueues(const std::string& sessId) {
+  receivedMessagesQueue_->addSession(sessId);
+  urgentMessagesQueue_->addSession(sessId);
+}
+
+void ServerManagerBase::removeSessionQueues(const std::string& sessId) {
+  receivedMessagesQueue_->removeSession(sessId);
+  urgentMessagesQueue_->removeSession(sessId);
+
+  std::scoped_lock lock(pausedSessionsMutex_);
+  if (pausedSessions_.erase(sessId)) {
+    pausedSessionsMetric_.add(-1);
+  }
+}
+
+size_t ServerManagerBase::sessionQueued(const std::string& sessId) const {
+  return receivedMessagesQueue_->sessionSize(sessId) + urgentMessagesQueue_->sessionSize(sessId);
+}
+
+size_t ServerManagerBase::totalQueued() const {
+  return receivedMessagesQueue_->sizeGuess() + urgentMessagesQueue_->sizeGuess();
+}
+
+bool ServerManagerBase::pauseReadIfSaturated(const std::string& sessId) {
+  const bool isSessionSaturated = pauseWatermark_ && sessionQueued(sessId) >= pauseWatermark_;
+  const bool isGameSaturated = globalPauseWatermark_ && totalQueued() >= globalPauseWatermark_;
+  if (!isSessionSaturated && !isGameSaturated) {
+    return false;
+  }
+
+  // NOTE: session is registered before it stops reading, so next tick can resume it
+  std::scoped_lock lock(pausedSessionsMutex_);
+  if (pausedSessions_.insert(sessId).second) {
+    pausedSessionsMetric_.add(1);
+  }
+  readPausesMetric_.inc();
+  return true;
+}
+
+void ServerManagerBase::resumePausedReads(
+    const std::function<void(const std::string&)>& resumeRead) {
+  std::vector<std::string> resumed;
+  {
+    std::scoped_lock lock(pausedSessionsMutex_);
+    if (pausedSessions_.empty() ||
+        (globalPauseWatermark_ && totalQueued() > globalResumeWatermark_)) {
+      return;
+    }
+    for (auto it = pausedSessions_.begin(); it != pausedSessions_.end();) {
+      if (sessionQueued(*it) <= resumeWatermark_) {
+        resumed.push_back(*it);
+        it = pausedSessions_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  pausedSessionsMetric_.add(-static_cast<int64_t>(resumed.size()));
+
+  // NOTE: resumeRead only posts to session, so it is called without lock
+  for (const std::string& sessId : resumed) {
+    resumeRead(sessId);
+  }
+}
+
 } // namespace gameserver
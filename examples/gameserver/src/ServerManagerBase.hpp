@@ -2,9 +2,11 @@
 
 #include "ServerManagerBase.hpp"
 #include "algo/DispatchQueue.hpp"
+#include "algo/FairDispatchQueue.hpp"
 #include "algo/TickManager.hpp"
 #include "config/ServerConfig.hpp"
 #include "log/Logger.hpp"
+#include "metrics/Metrics.hpp"
 #include "net/wrtc/WRTCServer.hpp"
 #include "net/wrtc/WRTCSession.hpp"
 #include "storage/path.hpp"
@@ -41,6 +43,7 @@
 #include <functional>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <net/core.hpp>
 #include <new>
 #include <rapidjson/document.h>
@@ -49,6 +52,7 @@
 #include <string>
 #include <thread>
 #include <type_traits>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -60,20 +64,130 @@ class GameServer;
 
 class ServerManagerBase {
 public:
-  ServerManagerBase(std::weak_ptr<GameServer> game) : game_(game) {
-    receivedMessagesQueue_ =
-        std::make_shared<DispatchQueue>(std::string{" Server Dispatch Queue"}, 0);
+  /**
+   * |transport| labels queues and metrics of manager, e.g. "ws".
+   * Each session gets own inbound queue of |config.inboundSessionQueueSize_| messages,
+   * sessions take turns of |config.inboundQuantum_| messages, see FairDispatchQueue.
+   * Reading of sessions pauses and resumes on |config.inbound*Watermark_|
+   **/
+  ServerManagerBase(std::weak_ptr<GameServer> game, const std::string& transport,
+                    const ::gloer::config::ServerConfig& config)
+      : game_(game),
+        pauseWatermark_(std::min(config.inboundPauseWatermark_, config.inboundSessionQueueSize_)),
+        resumeWatermark_(config.inboundResumeWatermark_),
+        globalPauseWatermark_(config.inboundGlobalPauseWatermark_),
+        globalResumeWatermark_(config.inboundGlobalResumeWatermark_),
+        tickMessagesMetric_(::gloer::metrics::MetricsRegistry::instance().histogram(
+            "gloer_game_tick_messages", "Queued messages processed by game per tick",
+            "transport=\"" + transport + "\"")),
+        tickProcessTimeMetric_(::gloer::metrics::MetricsRegistry::instance().histogram(
+            "gloer_game_tick_process_us", "Time game spent on queued messages per tick",
+            "transport=\"" + transport + "\"")),
+        readPausesMetric_(::gloer::metrics::MetricsRegistry::instance().counter(
+            "gloer_inbound_read_pauses_total", "Reads of sessions paused by full inbound queues",
+            "transport=\"" + transport + "\"")),
+        pausedSessionsMetric_(::gloer::metrics::MetricsRegistry::instance().gauge(
+            "gloer_inbound_paused_sessions", "Sessions waiting for inbound queues to drain",
+            "transport=\"" + transport + "\"")) {
+    receivedMessagesQueue_ = std::make_shared<FairDispatchQueue>(
+        transport + " inbound", config.inboundSessionQueueSize_, config.inboundQuantum_,
+        config.inboundTickBudget_);
+    urgentMessagesQueue_ = std::make_shared<FairDispatchQueue>(
+        transport + " urgent inbound", config.inboundSessionQueueSize_, config.inboundQuantum_,
+        config.inboundTickBudget_);
   }
 
   ~ServerManagerBase() {}
 
-  std::shared_ptr<DispatchQueue> getReceivedMessages() const;
+  std::shared_ptr<FairDispatchQueue> getReceivedMessages() const;
 
   bool hasReceivedMessages() const;
 
+  // messages of session dropped because its inbound queue was full
+  uint64_t droppedMessages(const std::string& sessId) const;
+
+  /**
+   * Enables immediate processing of latency-critical messages (signaling, ping):
+   * they are queued separately and |wakeupHandler| is called to wake game loop,
+   * see TickManager::wakeup. Other messages stay tick-aligned.
+   * NOTE: set before sessions are accepted, empty handler disables mode
+   **/
+  void setWakeupHandler(std::function<void()> wakeupHandler);
+
+  // runs queued latency-critical messages, called by game loop on wakeup
+  void processUrgentMessages();
+
+  /**
+   * Pauses reading of session when its inbound queues or inbound queues of all sessions
+   * reach pause watermark, so peer is slowed down instead of messages being dropped.
+   * Returns true if session is paused, see SessionPair::SetOnReadPauseHandler
+   **/
+  bool pauseReadIfSaturated(const std::string& sessId);
+
 protected:
-  std::shared_ptr<DispatchQueue> receivedMessagesQueue_;
+  /**
+   * Runs messages queued since previous tick within tick budget, once per tick.
+   * NOTE: cost depends on number of messages, not on number of sessions
+   **/
+  size_t processReceivedMessages();
+
+  /**
+   * Queues message callback into inbound queue of session,
+   * latency-critical one wakes game loop if mode is enabled.
+   * Returns false if queue of session is full
+   **/
+  bool dispatch(const std::string& sessId, const FairDispatchQueue::dispatch_callback& callback,
+                bool isLatencyCritical);
+
+  // creates inbound queues of opened session, messages of unknown sessions are dropped
+  void addSessionQueues(const std::string& sessId);
+
+  // forgets inbound queues of closed session, already queued messages are still handled
+  void removeSessionQueues(const std::string& sessId);
+
+  /**
+   * Calls |resumeRead| for paused sessions whose queues fell to resume watermarks.
+   * NOTE: called by game loop after queued messages are processed
+   **/
+  void resumePausedReads(const std::function<void(const std::string&)>& resumeRead);
+
+  std::shared_ptr<FairDispatchQueue> receivedMessagesQueue_;
+  std::shared_ptr<FairDispatchQueue> urgentMessagesQueue_;
+  std::function<void()> wakeupHandler_;
   std::weak_ptr<GameServer> game_;
+
+private:
+  static constexpr std::chrono::seconds kDropReportInterval{10};
+
+  // max. sessions listed by one report
+  static constexpr size_t kDropReportSessions = 10;
+
+  // periodically logs sessions that dropped messages because their inbound queues were full
+  void reportDroppingSessions();
+
+  // messages queued by session in both inbound queues
+  size_t sessionQueued(const std::string& sessId) const;
+
+  // messages queued by all sessions in both inbound queues
+  size_t totalQueued() const;
+
+  const size_t pauseWatermark_;
+  const size_t resumeWatermark_;
+  const size_t globalPauseWatermark_;
+  const size_t globalResumeWatermark_;
+
+  std::mutex pausedSessionsMutex_;
+
+  // sessions that stopped reading, resumed by resumePausedReads
+  std::unordered_set<std::string> pausedSessions_;
+
+  // NOTE: used only by game loop, see processReceivedMessages
+  std::chrono::steady_clock::time_point lastDropReport_;
+
+  ::gloer::metrics::Histogram& tickMessagesMetric_;
+  ::gloer::metrics::Histogram& tickProcessTimeMetric_;
+  ::gloer::metrics::Counter& readPausesMetric_;
+  ::gloer::metrics::Gauge& pausedSessionsMetric_;
 };
 
 } // namespace gameserver
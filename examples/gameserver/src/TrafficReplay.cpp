@@ -0,0 +1,190 @@
+#include "TrafficReplay.hpp" // IWYU pragma: associated
+
+#include "GameServer.hpp"
+#include "WRTCServerManager.hpp"
+#include "WSServerManager.hpp"
+#include "algo/JsonMessage.hpp"
+#include "algo/NetworkOperation.hpp"
+#include "log/Logger.hpp"
+#include "net/MessageCodec.hpp"
+#include "net/NetworkManagerBase.hpp"
+#include "net/TrafficCapture.hpp"
+#include "net/wrtc/SessionGUID.hpp"
+#include "net/wrtc/SessionManager.hpp"
+#include "net/wrtc/WRTCServer.hpp"
+#include "net/wrtc/WRTCSession.hpp"
+#include "net/ws/SessionGUID.hpp"
+#include "net/ws/server/ServerSessionManager.hpp"
+#include <algorithm>
+#include <thread>
+
+namespace gameserver {
+
+using namespace ::gloer::algo;
+using namespace ::gloer::net;
+
+void ReplayWsSession::send(const std::string& message) {
+  sentBytes_.fetch_add(message.size(), std::memory_order_relaxed);
+}
+
+void ReplayWsSession::pairToWRTCSession(std::shared_ptr<wrtc::WRTCSession> WRTCSession) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  wrtcSession_ = WRTCSession;
+}
+
+bool ReplayWsSession::hasPairedWRTCSession() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return wrtcSession_.lock().get() != nullptr;
+}
+
+std::weak_ptr<wrtc::WRTCSession> ReplayWsSession::getWRTCSession() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return wrtcSession_;
+}
+
+TrafficReplay::TrafficReplay(std::shared_ptr<GameServer> game, double speed,
+                             std::chrono::milliseconds tickPeriod)
+    : game_(game), speed_(std::max(speed, 0.0)),
+      tickNs_(static_cast<uint64_t>(
+          std::max(std::chrono::nanoseconds(tickPeriod).count(), static_cast<int64_t>(1)))) {}
+
+bool TrafficReplay::run(const std::string& path) {
+  TrafficCaptureReader reader;
+  if (!reader.open(path)) {
+    return false;
+  }
+
+  stats_ = Stats{};
+  wallStart_ = std::chrono::steady_clock::now();
+
+  uint64_t nextTickNs = tickNs_;
+  CaptureRecord record;
+  while (reader.next(record)) {
+    while (record.timeNs >= nextTickNs) {
+      waitUntil(nextTickNs);
+      dispatch();
+      // NOTE: skips ticks without messages, i.e. idle periods of capture
+      nextTickNs = std::max(nextTickNs + tickNs_, record.timeNs / tickNs_ * tickNs_);
+    }
+    waitUntil(record.timeNs);
+    feed(record);
+  }
+  dispatch();
+
+  stats_.seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart_).count();
+
+  if (reader.failed()) {
+    LOG(WARNING) << "TrafficReplay: capture " << path << " ends with invalid record";
+  }
+  LOG(INFO) << "TrafficReplay: replayed " << stats_.messages << " messages and " << stats_.closes
+            << " closes, skipped " << stats_.skipped << " in " << stats_.seconds << " s";
+  return true;
+}
+
+void TrafficReplay::feed(const CaptureRecord& record) {
+  if (record.sessId.empty()) {
+    stats_.skipped++;
+    return;
+  }
+  if (record.transport == CaptureTransport::WS) {
+    feedWs(record);
+  } else {
+    feedWrtc(record);
+  }
+}
+
+void TrafficReplay::feedWs(const CaptureRecord& record) {
+  const ws::SessionGUID sessId(record.sessId);
+  auto& sessionManager = game_->ws_nm->sessionManager();
+
+  if (record.kind == CaptureRecordKind::CLOSE) {
+    game_->wsGameManager->handleClose(sessId);
+    sessionManager.removeSessById(sessId);
+    stats_.closes++;
+    return;
+  }
+
+  if (isSignaling(record.payload, record.isBinary)) {
+    stats_.skipped++;
+    return;
+  }
+
+  if (!sessionManager.getSessById(sessId)) {
+    sessionManager.addSession(sessId, std::make_shared<ReplayWsSession>(sessId));
+    game_->wsGameManager->handleOpen(sessId);
+  }
+
+  // JSON messages go to handleIncomingJSON, session codec is selected by first message
+  if (game_->wsGameManager->handleIncomingMessage(sessId, record.payload, record.isBinary)) {
+    stats_.messages++;
+  } else {
+    stats_.skipped++;
+  }
+}
+
+void TrafficReplay::feedWrtc(const CaptureRecord& record) {
+  const wrtc::SessionGUID sessId(record.sessId);
+  WRTCNetworkManager* nm = game_->wrtc_nm.get();
+  auto& sessionManager = nm->sessionManager();
+
+  if (record.kind == CaptureRecordKind::CLOSE) {
+    game_->wrtcGameManager->handleClose(sessId);
+    sessionManager.removeSessById(sessId);
+    stats_.closes++;
+    return;
+  }
+
+  // NOTE: session may also be unregistered by processIncomingMessages after timer expired
+  if (!sessionManager.getSessById(sessId)) {
+    // NOTE: WRTCSession requires WebSocket session only at creation time
+    const ws::SessionGUID wsId("replay-" + record.sessId);
+    auto wsSession = std::make_shared<ReplayWsSession>(wsId);
+    auto session = std::make_shared<wrtc::WRTCSession>(
+        nm, nm->getRunner()->choosePeerFactory(), wsSession, sessId, wsId);
+    sessionManager.addSession(sessId, session);
+    game_->wrtcGameManager->handleOpen(sessId);
+  }
+
+  if (game_->wrtcGameManager->handleIncomingMessage(sessId, record.payload, record.isBinary)) {
+    stats_.messages++;
+  } else {
+    stats_.skipped++;
+  }
+}
+
+void TrafficReplay::dispatch() {
+  game_->wsGameManager->processIncomingMessages();
+  game_->wrtcGameManager->processIncomingMessages();
+}
+
+void TrafficReplay::waitUntil(uint64_t captureNs) const {
+  if (speed_ <= 0.0) {
+    return; // max speed
+  }
+  const auto due = wallStart_ + std::chrono::nanoseconds(static_cast<int64_t>(
+                                    static_cast<double>(captureNs) / speed_));
+  std::this_thread::sleep_until(due);
+}
+
+// OFFER, ANSWER and candidates would create PeerConnection
+bool TrafficReplay::isSignaling(const std::string& message, bool isBinary) {
+  uint32_t opcode = 0;
+  if (MessageCodec::detect(message, isBinary) == MessageCodecType::JSON) {
+    JsonMessage parsed(message);
+    const char* type = parsed.parse() ? parsed.getString("type") : nullptr;
+    if (!type || !Opcodes::parseOpcode(type, opcode)) {
+      return false; // rejected by WSServerManager
+    }
+  } else {
+    DecodedMessage decoded;
+    if (!BinaryCodec().decode(message, decoded)) {
+      return false; // rejected by WSServerManager
+    }
+    opcode = decoded.opcode;
+  }
+  return opcode == WS_OPCODE::OFFER || opcode == WS_OPCODE::ANSWER ||
+         opcode == WS_OPCODE::CANDIDATE || opcode == WS_OPCODE::CANDIDATE_BATCH;
+}
+
+} // namespace gameserver
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "net/SessionPair.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace gloer {
+namespace net {
+struct CaptureRecord;
+namespace wrtc {
+class WRTCSession;
+} // namespace wrtc
+} // namespace net
+} // namespace gloer
+
+namespace gameserver {
+
+class GameServer;
+
+/**
+ * Stands in for WebSocket session of captured client, messages sent to it are dropped.
+ **/
+class ReplayWsSession : public ::gloer::net::SessionPair {
+public:
+  explicit ReplayWsSession(const ::gloer::net::ws::SessionGUID& id) : SessionPair(id) {}
+
+  ~ReplayWsSession() override {}
+
+  void send(const std::string& message) override;
+
+  bool isOpen() const override { return isOpen_.load(); }
+
+  void close() override { isOpen_ = false; }
+
+  bool isExpired() const override { return false; }
+
+  void pairToWRTCSession(std::shared_ptr<::gloer::net::wrtc::WRTCSession> WRTCSession) override;
+
+  bool hasPairedWRTCSession() override;
+
+  std::weak_ptr<::gloer::net::wrtc::WRTCSession> getWRTCSession() const override;
+
+  uint64_t sentBytes() const { return sentBytes_.load(); }
+
+private:
+  std::atomic<bool> isOpen_{true};
+
+  std::atomic<uint64_t> sentBytes_{0};
+
+  mutable std::mutex mutex_;
+
+  std::weak_ptr<::gloer::net::wrtc::WRTCSession> wrtcSession_;
+};
+
+/**
+ * Feeds capture of TrafficCapture into WSServerManager and WRTCServerManager, no sockets used.
+ * Queued messages are dispatched each |tickPeriod| of capture time, like game loop does,
+ * so dispatch batches do not depend on replay speed.
+ * NOTE: signaling (OFFER, ANSWER, candidates) is skipped, WRTC sessions are replaced by
+ * WRTCSession without PeerConnection, so data channel responses are dropped
+ **/
+class TrafficReplay {
+public:
+  struct Stats {
+    uint64_t messages = 0;
+    uint64_t closes = 0;
+    // signaling and messages rejected by server managers
+    uint64_t skipped = 0;
+    double seconds = 0.0;
+  };
+
+  /**
+   * |speed| is 1.0 for real time, 2.0 for twice faster, 0 for max speed.
+   * NOTE: requires running wrtc_nm, WRTC sessions use its PeerConnectionFactory threads
+   **/
+  TrafficReplay(std::shared_ptr<GameServer> game, double speed,
+                std::chrono::milliseconds tickPeriod);
+
+  // returns false if capture can`t be read
+  bool run(const std::string& path);
+
+  const Stats& stats() const { return stats_; }
+
+private:
+  void feed(const ::gloer::net::CaptureRecord& record);
+
+  void feedWs(const ::gloer::net::CaptureRecord& record);
+
+  void feedWrtc(const ::gloer::net::CaptureRecord& record);
+
+  // dispatches queued messages like game loop tick
+  void dispatch();
+
+  // sleeps until |captureNs| of capture time is due
+  void waitUntil(uint64_t captureNs) const;
+
+  static bool isSignaling(const std::string& message, bool isBinary);
+
+  std::shared_ptr<GameServer> game_;
+
+  const double speed_;
+
+  const uint64_t tickNs_;
+
+  std::chrono::steady_clock::time_point wallStart_;
+
+  Stats stats_;
+};
+
+} // namespace gameserver
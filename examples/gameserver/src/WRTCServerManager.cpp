@@ -6,6 +6,7 @@
 #include "algo/TickManager.hpp"
 #include "config/ServerConfig.hpp"
 #include "log/Logger.hpp"
+#include "net/MessageCodec.hpp"
 #include "net/ws/server/ServerSessionManager.hpp"
 #include "net/wrtc/SessionManager.hpp"
 #include "net/NetworkManagerBase.hpp"
@@ -76,7 +77,9 @@ namespace gameserver {
  **/
 constexpr unsigned long UINT32_FIELD_MAX_LEN = 10;
 
-WRTCServerManager::WRTCServerManager(std::weak_ptr<GameServer> game) : ServerManagerBase(game) {
+WRTCServerManager::WRTCServerManager(std::weak_ptr<GameServer> game,
+                                 const gloer::config::ServerConfig& config)
+    : ServerManagerBase(game, "wrtc", config) {
   LOG(WARNING) << "WRTCServerManager::WRTCServerManager";
   if (!receivedMessagesQueue_ || !receivedMessagesQueue_.get()) {
     LOG(WARNING) << "WRTCServerManager::WRTCServerManager: invalid receivedMessagesQueue_";
@@ -86,67 +89,67 @@ WRTCServerManager::WRTCServerManager(std::weak_ptr<GameServer> game) : ServerMan
 }
 
 void WRTCServerManager::processIncomingMessages() {
-  if (game_.lock()->wrtc_nm->sessionManager().getSessionsCount()) {
-    LOG(INFO) << "WRTCServerManager::handleIncomingMessages getSessionsCount "
-              << game_.lock()->wrtc_nm->sessionManager().getSessionsCount();
-    const std::unordered_map<gloer::net::wrtc::SessionGUID, std::shared_ptr<WRTCSession>>& sessions =
-        game_.lock()->wrtc_nm->sessionManager().getSessions();
-    /*std::string msg = "WRTC SESSIONS:[";
-    for (auto& it : sessions) {
-      std::shared_ptr<WRTCSession> wrtcs = it.second;
-      msg += it.first;
-      msg += "=";
-      if (!wrtcs || !wrtcs.get()) {
-        msg += "EMPTY";
-      } else {
-        msg += wrtcs->getId();
-      }
-    }
-    msg += "]SESSIONS";
-    LOG(INFO) << msg;*/
-  }
-  game_.lock()->wrtc_nm->sessionManager().doToAllSessions([&](const gloer::net::wrtc::SessionGUID& sessId,
-                                                   std::shared_ptr<WRTCSession> session) {
-    if (!session || !session.get()) {
-      LOG(WARNING) << "WRTCServerManager::handleAllPlayerMessages: trying to "
-                      "use non-existing session";
-      // NOTE: unregisterSession must be automatic!
-      game_.lock()->wrtc_nm->sessionManager().unregisterSession(sessId);
-      return;
-    }
+  // NOTE: drains per-session queues round-robin, at most inboundTickBudget_ messages per tick
+  processReceivedMessages();
+
+  // session timers are seconds long, checking all sessions each tick is not needed
+  const auto now = std::chrono::steady_clock::now();
+  if (now - lastSessionsCheck_ < kSessionsCheckPeriod) {
+    return;
+  }
+  lastSessionsCheck_ = now;
+  unregisterStaleSessions();
+}
 
+void WRTCServerManager::unregisterStaleSessions() {
+  auto& sessionManager = game_.lock()->wrtc_nm->sessionManager();
+  // NOTE: checks run without lock of session manager, they may wait for signaling thread
+  sessionManager.collectSessions(sessionsToCheck_);
+
+  for (const std::shared_ptr<WRTCSession>& session : sessionsToCheck_) {
     auto wrtcSessId = session->getId(); // remember id before session deletion
 
     if (session->fullyCreated() && !session->isDataChannelOpen()) {
-      LOG(WARNING) << "WRTCServerManager::handleAllPlayerMessages: !session->isOpen()";
+      LOG(WARNING) << "WRTCServerManager::unregisterStaleSessions: !session->isOpen()";
       // NOTE: unregisterSession must be automatic!
-      game_.lock()->wrtc_nm->sessionManager().unregisterSession(wrtcSessId);
-      return;
+      sessionManager.unregisterSession(wrtcSessId);
+      continue;
     }
     // TODO: check timer expiry independantly from handleIncomingMessages
 
     if (session->isExpired()) {
-      LOG(WARNING) << "WRTCServerManager::handleAllPlayerMessages: session timer expired";
-      game_.lock()->wrtc_nm->sessionManager().unregisterSession(wrtcSessId);
-      return;
+      LOG(WARNING) << "WRTCServerManager::unregisterStaleSessions: session timer expired";
+      sessionManager.unregisterSession(wrtcSessId);
     }
+  }
+  sessionsToCheck_.clear();
+}
 
-    if (!receivedMessagesQueue_ || !receivedMessagesQueue_.get()) {
-      LOG(WARNING)
-          << "WRTCServerManager::handleAllPlayerMessages: invalid session->getReceivedMessages()";
-      return;
-    }
-    // LOG(INFO) << "doToAllSessions for " << session->getId();
+bool WRTCServerManager::handleIncomingMessage(const gloer::net::wrtc::SessionGUID& sessId,
+                                              const std::string& message, bool isBinary) {
+  if (message.empty()) {
+    LOG(WARNING) << "WRTCSession::handleIncomingMessage: invalid message";
+    return false;
+  }
 
-    /*auto nm = game_.lock()->wrtc_nm;
-    if (nm->getRunner()->workerThread_.get()) {
-      auto q = receivedMessagesQueue_;
-      auto handle = OnceFunctor([q]() { q->DispatchQueued(); });
-      nm->getRunner()->workerThread_->Post(RTC_FROM_HERE, handle);
-    }*/
+  auto sessPtr = game_.lock()->wrtc_nm->sessionManager().getSessById(sessId);
+  if (!sessPtr || !sessPtr.get()) {
+    LOG(WARNING) << "WRTCSession::handleIncomingMessage: ignored invalid session";
+    return false;
+  }
 
-    receivedMessagesQueue_->DispatchQueued();
-  });
+  const gloer::net::MessageCodecType codecType =
+      gloer::net::MessageCodec::detect(message, isBinary);
+  if (!sessPtr->negotiateCodec(codecType)) {
+    LOG(WARNING) << "WRTCSession::handleIncomingMessage: ignored message with codec "
+                    "different from negotiated one";
+    return false;
+  }
+
+  if (codecType == gloer::net::MessageCodecType::JSON) {
+    return handleIncomingJSON(sessId, message);
+  }
+  return handleIncomingBinary(sessId, message);
 }
 
 /**
@@ -169,7 +172,9 @@ bool WRTCServerManager::handleIncomingJSON(const gloer::net::wrtc::SessionGUID&
   rapidjson::ParseResult result = message_object.Parse(message.c_str());
   // LOG(INFO) << "incomingStr: " << message->c_str();
   if (!result || !message_object.IsObject() || !message_object.HasMember("type")) {
-    LOG(WARNING) << "WRTCSession::on_read: ignored invalid message without type " << message;
+    GLOG_EVERY_MS(GAME, WARNING, 1000)
+        << "WRTCSession::on_read: ignored invalid message without type";
+    GLOG_PAYLOAD(GAME) << "invalid message = " << message;
     return false;
   }
   // Probably should do some error checking on the JSON object.
@@ -177,15 +182,15 @@ bool WRTCServerManager::handleIncomingJSON(const gloer::net::wrtc::SessionGUID&
   if (typeStr.empty() || typeStr.length() > UINT32_FIELD_MAX_LEN) {
     LOG(WARNING) << "WRTCSession::handleIncomingJSON: ignored invalid message with invalid "
                     "type field";
+    return false;
   }
-  const auto& callbacks = game_.lock()->wrtc_nm->operationCallbacks().getCallbacks();
+  const auto& callbacks = game_.lock()->wrtc_nm->operationCallbacks();
 
-  const WRTCNetworkOperation wrtcNetworkOperation{
-      static_cast<WRTC_OPCODE>(Opcodes::wrtcOpcodeFromStr(typeStr))};
-  const auto itFound = callbacks.find(wrtcNetworkOperation);
+  uint32_t opcode = 0;
+  const WRTCNetworkOperationCallback* callback =
+      Opcodes::parseOpcode(typeStr.c_str(), opcode) ? callbacks.findCallback(opcode) : nullptr;
   // if a callback is registered for event, add it to queue
-  if (itFound != callbacks.end()) {
-    WRTCNetworkOperationCallback callback = itFound->second;
+  if (callback) {
     auto sessPtr = game_.lock()->wrtc_nm->sessionManager().getSessById(sessId);
     if (!sessPtr || !sessPtr.get()) {
       LOG(WARNING) << "WRTCSession::handleIncomingJSON: ignored invalid session";
@@ -193,8 +198,10 @@ bool WRTCServerManager::handleIncomingJSON(const gloer::net::wrtc::SessionGUID&
     }
     // WRTCSession* sess = sessPtr.get();
     DispatchQueue::dispatch_callback callbackBind = std::bind(
-        callback, sessPtr, game_.lock()->wrtc_nm.get(), std::make_shared<std::string>(message));
-    receivedMessagesQueue_->dispatch(callbackBind);
+        *callback, sessPtr, game_.lock()->wrtc_nm.get(), std::make_shared<std::string>(message));
+    if (!dispatch(static_cast<std::string>(sessId), callbackBind, isLatencyCritical(opcode))) {
+      return false;
+    }
     // callbackBind();
 
     /*LOG(WARNING) << "WRTCSession::handleIncomingJSON: receivedMessagesQueue_->sizeGuess() "
@@ -208,6 +215,54 @@ bool WRTCServerManager::handleIncomingJSON(const gloer::net::wrtc::SessionGUID&
   return true;
 }
 
-void WRTCServerManager::handleClose(const gloer::net::wrtc::SessionGUID& sessId) {}
+/**
+ * Add binary framed message to queue for further processing
+ * NOTE: callback receives own copy of whole frame (it runs later from queue),
+ * payload is not required to be JSON
+ **/
+bool WRTCServerManager::handleIncomingBinary(const gloer::net::wrtc::SessionGUID& sessId,
+                                             const std::string& message) {
+  if (!receivedMessagesQueue_ || !receivedMessagesQueue_.get()) {
+    LOG(WARNING) << "WRTCSession::handleIncomingBinary: invalid receivedMessagesQueue_ ";
+    return false;
+  }
+
+  gloer::net::DecodedMessage decoded;
+  if (!gloer::net::BinaryCodec().decode(message, decoded)) {
+    LOG(WARNING) << "WRTCSession::handleIncomingBinary: ignored malformed binary message";
+    return false;
+  }
+
+  const auto& callbacks = game_.lock()->wrtc_nm->operationCallbacks();
+  const WRTCNetworkOperationCallback* callback = callbacks.findCallback(decoded.opcode);
+  if (!callback) {
+    LOG(WARNING) << "WRTCSession::handleIncomingBinary: ignored invalid message with type "
+                 << decoded.opcode;
+    return false;
+  }
+
+  auto sessPtr = game_.lock()->wrtc_nm->sessionManager().getSessById(sessId);
+  if (!sessPtr || !sessPtr.get()) {
+    LOG(WARNING) << "WRTCSession::handleIncomingBinary: ignored invalid session";
+    return false;
+  }
+
+  DispatchQueue::dispatch_callback callbackBind = std::bind(
+      *callback, sessPtr, game_.lock()->wrtc_nm.get(), std::make_shared<std::string>(message));
+  return dispatch(static_cast<std::string>(sessId), callbackBind,
+                  isLatencyCritical(decoded.opcode));
+}
+
+void WRTCServerManager::handleOpen(const gloer::net::wrtc::SessionGUID& sessId) {
+  addSessionQueues(static_cast<std::string>(sessId));
+}
+
+void WRTCServerManager::handleClose(const gloer::net::wrtc::SessionGUID& sessId) {
+  removeSessionQueues(static_cast<std::string>(sessId));
+}
+
+bool WRTCServerManager::isLatencyCritical(uint32_t opcode) {
+  return opcode == WRTC_OPCODE::PING || opcode == WRTC_OPCODE::KEEPALIVE;
+}
 
 } // namespace gameserver
@@ -73,13 +73,37 @@ using namespace ::gloer::algo;
 
 class WRTCServerManager : public ServerManagerBase {
 public:
-  WRTCServerManager(std::weak_ptr<GameServer> game);
+  WRTCServerManager(std::weak_ptr<GameServer> game, const gloer::config::ServerConfig& config);
 
   void processIncomingMessages();
 
+  // selects session codec by first message, then routes to JSON or binary handler
+  bool handleIncomingMessage(const gloer::net::wrtc::SessionGUID& sessId,
+                             const std::string& message, bool isBinary);
+
   bool handleIncomingJSON(const gloer::net::wrtc::SessionGUID& sessId, const std::string& message);
 
+  bool handleIncomingBinary(const gloer::net::wrtc::SessionGUID& sessId,
+                            const std::string& message);
+
+  // creates inbound queues of session, call before session can receive messages
+  void handleOpen(const gloer::net::wrtc::SessionGUID& sessId);
+
   void handleClose(const gloer::net::wrtc::SessionGUID& sessId);
+
+  // opcodes processed on wakeup of game loop instead of next tick, see setWakeupHandler
+  static bool isLatencyCritical(uint32_t opcode);
+
+private:
+  static constexpr std::chrono::milliseconds kSessionsCheckPeriod{1000};
+
+  // unregisters sessions with closed data channel or expired timer
+  void unregisterStaleSessions();
+
+  // reused by unregisterStaleSessions
+  std::vector<std::shared_ptr<::gloer::net::wrtc::WRTCSession>> sessionsToCheck_;
+
+  std::chrono::steady_clock::time_point lastSessionsCheck_{};
 };
 
 } // namespace gameserver
@@ -3,9 +3,11 @@
 #include "GameServer.hpp"
 #include "WSServerManager.hpp"
 #include "algo/DispatchQueue.hpp"
+#include "algo/JsonMessage.hpp"
 #include "algo/TickManager.hpp"
 #include "config/ServerConfig.hpp"
 #include "log/Logger.hpp"
+#include "net/MessageCodec.hpp"
 #include "net/NetworkManagerBase.hpp"
 #include "net/ws/server/ServerSessionManager.hpp"
 #include "net/wrtc/SessionManager.hpp"
@@ -72,7 +74,9 @@ namespace gameserver {
  **/
 constexpr unsigned long UINT32_FIELD_MAX_LEN = 10;
 
-WSServerManager::WSServerManager(std::weak_ptr<GameServer> game) : ServerManagerBase(game) {
+WSServerManager::WSServerManager(std::weak_ptr<GameServer> game,
+                                 const gloer::config::ServerConfig& config)
+    : ServerManagerBase(game, "ws", config) {
   LOG(WARNING) << "WSServerManager::WSServerManager";
   if (!receivedMessagesQueue_ || !receivedMessagesQueue_.get()) {
     LOG(WARNING) << "WSServerManager::WSServerManager: invalid receivedMessagesQueue_";
@@ -81,6 +85,33 @@ WSServerManager::WSServerManager(std::weak_ptr<GameServer> game) : ServerManager
       std::make_shared<DispatchQueue>(std::string{"WebSockets Server Dispatch Queue"}, 0);*/
 }
 
+bool WSServerManager::handleIncomingMessage(const gloer::net::ws::SessionGUID& sessId,
+                                            const std::string& message, bool isBinary) {
+  if (message.empty()) {
+    LOG(WARNING) << "WS::handleIncomingMessage: invalid message";
+    return false;
+  }
+
+  auto sessPtr = game_.lock()->ws_nm->sessionManager().getSessById(sessId);
+  if (!sessPtr || !sessPtr.get()) {
+    LOG(WARNING) << "WsSession::handleIncomingMessage: ignored invalid session";
+    return false;
+  }
+
+  const gloer::net::MessageCodecType codecType =
+      gloer::net::MessageCodec::detect(message, isBinary);
+  if (!sessPtr->negotiateCodec(codecType)) {
+    LOG(WARNING) << "WsSession::handleIncomingMessage: ignored message with codec "
+                    "different from negotiated one";
+    return false;
+  }
+
+  if (codecType == gloer::net::MessageCodecType::JSON) {
+    return handleIncomingJSON(sessId, message);
+  }
+  return handleIncomingBinary(sessId, message);
+}
+
 /**
  * Add message to queue for further processing
  * Returs true if message can be processed
@@ -96,40 +127,43 @@ bool WSServerManager::handleIncomingJSON(const gloer::net::ws::SessionGUID& sess
     return false;
   }
 
-  // parse incoming message
-  rapidjson::Document message_object;
-  rapidjson::ParseResult result = message_object.Parse(message.c_str());
+  // parse incoming message only once, parsed document passed to callback
+  auto parsedMessage = std::make_shared<JsonMessage>(message);
+  const char* type = parsedMessage->parse() ? parsedMessage->getString("type") : nullptr;
   // LOG(INFO) << "incomingStr: " << message->c_str();
-  if (!result || !message_object.IsObject() || !message_object.HasMember("type")) {
-    LOG(WARNING) << "WsSession::handleIncomingJSON: ignored invalid message without type "
-                 << message;
+  if (!type) {
+    GLOG_EVERY_MS(GAME, WARNING, 1000)
+        << "WsSession::handleIncomingJSON: ignored invalid message without type";
+    GLOG_PAYLOAD(GAME) << "invalid message = " << message;
     return false;
   }
-  // Probably should do some error checking on the JSON object.
-  std::string typeStr = message_object["type"].GetString();
+  const std::string typeStr = type;
   if (typeStr.empty() || typeStr.length() > UINT32_FIELD_MAX_LEN) {
     LOG(WARNING) << "WsSession::handleIncomingJSON: ignored invalid message with invalid "
                     "type field";
+    return false;
   }
 
   /// TODO: nm <<<<
-  const auto& callbacks = game_.lock()->ws_nm->operationCallbacks().getCallbacks();
+  const auto& callbacks = game_.lock()->ws_nm->operationCallbacks();
 
-  const gloer::net::ws::WsNetworkOperation NetworkOperation{
-      static_cast<WS_OPCODE>(Opcodes::wsOpcodeFromStr(typeStr))};
-  const auto itFound = callbacks.find(NetworkOperation);
+  uint32_t opcode = 0;
+  const gloer::net::ws::ServerNetworkOperationCallback* callback =
+      Opcodes::parseOpcode(type, opcode) ? callbacks.findCallback(opcode) : nullptr;
   // if a callback is registered for event, add it to queue
-  if (itFound != callbacks.end()) {
-    gloer::net::ws::ServerNetworkOperationCallback callback = itFound->second;
+  if (callback) {
     auto sessPtr = game_.lock()->ws_nm->sessionManager().getSessById(sessId);
     if (!sessPtr || !sessPtr.get()) {
       LOG(WARNING) << "WsSession::handleIncomingJSON: ignored invalid session";
       return false;
     }
     // WsSession* sess = sessPtr.get();
-    DispatchQueue::dispatch_callback callbackBind = std::bind(
-        callback, sessPtr, game_.lock()->ws_nm.get(), std::make_shared<std::string>(message));
-    receivedMessagesQueue_->dispatch(callbackBind);
+    DispatchQueue::dispatch_callback callbackBind =
+        std::bind(*callback, sessPtr, game_.lock()->ws_nm.get(),
+                  std::shared_ptr<const JsonMessage>(std::move(parsedMessage)));
+    if (!dispatch(static_cast<std::string>(sessId), callbackBind, isLatencyCritical(opcode))) {
+      return false;
+    }
 
     /*LOG(WARNING) << "WsSession::handleIncomingJSON: receivedMessagesQueue_->sizeGuess() "
                  << receivedMessagesQueue_->sizeGuess();*/
@@ -141,62 +175,82 @@ bool WSServerManager::handleIncomingJSON(const gloer::net::ws::SessionGUID& sess
   return true;
 }
 
-void WSServerManager::handleClose(const gloer::net::ws::SessionGUID& sessId) {}
+/**
+ * Add binary framed message to queue for further processing
+ * NOTE: signaling bodies (sdp, candidates) stay JSON inside binary frame,
+ * opcode is taken from frame header instead of "type" field
+ **/
+bool WSServerManager::handleIncomingBinary(const gloer::net::ws::SessionGUID& sessId,
+                                           const std::string& message) {
+  if (!receivedMessagesQueue_ || !receivedMessagesQueue_.get()) {
+    LOG(WARNING) << "WS::handleIncomingBinary: invalid receivedMessagesQueue_ ";
+    return false;
+  }
 
-void WSServerManager::processIncomingMessages() {
-  if (game_.lock()->ws_nm->sessionManager().getSessionsCount()) {
-    LOG(INFO) << "WSServer::handleIncomingMessages getSessionsCount "
-              << game_.lock()->ws_nm->sessionManager().getSessionsCount();
-    const std::unordered_map<gloer::net::ws::SessionGUID, std::shared_ptr<gloer::net::SessionPair>>& sessions =
-        game_.lock()->ws_nm->sessionManager().getSessions();
-    /*std::string msg = "WS SESSIONS:[";
-    for (auto& it : sessions) {
-      std::shared_ptr<ws::ServerSession> wss = it.second;
-
-    auto wsSessId = session->getId(); // remember id before session deletion
-
-      msg += it.first;
-      msg += "=";
-      if (!wss || !wss.get()) {
-        msg += "EMPTY";
-      } else {
-        msg += wss->getId();
-      }
-    }
-    msg += "]SESSIONS";
-    LOG(INFO) << msg;*/
+  gloer::net::DecodedMessage decoded;
+  if (!gloer::net::BinaryCodec().decode(message, decoded)) {
+    LOG(WARNING) << "WsSession::handleIncomingBinary: ignored malformed binary message";
+    return false;
+  }
+
+  const auto& callbacks = game_.lock()->ws_nm->operationCallbacks();
+  const gloer::net::ws::ServerNetworkOperationCallback* callback =
+      callbacks.findCallback(decoded.opcode);
+  if (!callback) {
+    LOG(WARNING) << "WsSession::handleIncomingBinary: ignored invalid message with type "
+                 << decoded.opcode;
+    return false;
+  }
+
+  // NOTE: callback runs later from queue, so message owns copy of payload
+  auto parsedMessage = std::make_shared<JsonMessage>(decoded.payload, decoded.payloadSize);
+  if (!parsedMessage->parse()) {
+    LOG(WARNING) << "WsSession::handleIncomingBinary: ignored message with invalid payload";
+    return false;
+  }
+
+  auto sessPtr = game_.lock()->ws_nm->sessionManager().getSessById(sessId);
+  if (!sessPtr || !sessPtr.get()) {
+    LOG(WARNING) << "WsSession::handleIncomingBinary: ignored invalid session";
+    return false;
   }
-  game_.lock()->ws_nm->sessionManager().doToAllSessions([&](const gloer::net::ws::SessionGUID& sessId,
-                                                 std::shared_ptr<gloer::net::SessionPair> session) {
-    /*if (!session || !session.get()) {
-      LOG(WARNING) << "WsServer::handleAllPlayerMessages: trying to "
-                      "use non-existing session";
-      // NOTE: unregisterSession must be automatic!
-      game_.lock()->ws_nm->getRunner()->unregisterSession(sessId);
-      return;
-    }*/
-
-    auto wsSessId = session->getId(); // remember id before session deletion
-
-    /*if (!session->isOpen() && session->fullyCreated()) {
-      LOG(WARNING) << "WsServer::handleAllPlayerMessages: !session->isOpen()";
-      // NOTE: unregisterSession must be automatic!
-      unregisterSession(session->getId());
-      return;
-    }*/
-
-    /*if (session->isExpired()) {
-      LOG(WARNING) << "WsServer::handleAllPlayerMessages: session timer expired";
-      game_.lock()->ws_nm->getRunner()->unregisterSession(session->getId());
-      return;
-    }*/
-
-    // LOG(INFO) << "doToAllSessions for " << session->getId();
-    if (!receivedMessagesQueue_ || !receivedMessagesQueue_.get()) {
-      LOG(WARNING) << "WsServer::handleAllPlayerMessages: invalid session->getReceivedMessages()";
-      return;
+
+  DispatchQueue::dispatch_callback callbackBind =
+      std::bind(*callback, sessPtr, game_.lock()->ws_nm.get(),
+                std::shared_ptr<const JsonMessage>(std::move(parsedMessage)));
+  return dispatch(static_cast<std::string>(sessId), callbackBind,
+                  isLatencyCritical(decoded.opcode));
+}
+
+void WSServerManager::handleOpen(const gloer::net::ws::SessionGUID& sessId) {
+  addSessionQueues(static_cast<std::string>(sessId));
+}
+
+void WSServerManager::handleClose(const gloer::net::ws::SessionGUID& sessId) {
+  removeSessionQueues(static_cast<std::string>(sessId));
+}
+
+bool WSServerManager::handleReadPause(const gloer::net::ws::SessionGUID& sessId) {
+  return pauseReadIfSaturated(static_cast<std::string>(sessId));
+}
+
+bool WSServerManager::isLatencyCritical(uint32_t opcode) {
+  return opcode == WS_OPCODE::PING || opcode == WS_OPCODE::OFFER ||
+         opcode == WS_OPCODE::ANSWER || opcode == WS_OPCODE::CANDIDATE ||
+         opcode == WS_OPCODE::CANDIDATE_BATCH;
+}
+
+void WSServerManager::processIncomingMessages() {
+  // NOTE: drains per-session queues round-robin, at most inboundTickBudget_ messages per tick
+  processReceivedMessages();
+
+  // sessions paused by saturated queues continue reading
+  resumePausedReads([this](const std::string& sessId) {
+    auto sessPtr =
+        game_.lock()->ws_nm->sessionManager().getSessById(gloer::net::ws::SessionGUID(sessId));
+    if (sessPtr) {
+      sessPtr->resumeRead();
     }
-    receivedMessagesQueue_->DispatchQueued();
   });
 }
 
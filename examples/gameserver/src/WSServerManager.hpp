@@ -66,13 +66,28 @@ namespace gameserver {
 
 class WSServerManager : public ServerManagerBase {
 public:
-  WSServerManager(std::weak_ptr<GameServer> game);
+  WSServerManager(std::weak_ptr<GameServer> game, const gloer::config::ServerConfig& config);
 
   void processIncomingMessages();
 
+  // selects session codec by first message, then routes to JSON or binary handler
+  bool handleIncomingMessage(const gloer::net::ws::SessionGUID& sessId,
+                             const std::string& message, bool isBinary);
+
   bool handleIncomingJSON(const gloer::net::ws::SessionGUID& sessId, const std::string& message);
 
+  bool handleIncomingBinary(const gloer::net::ws::SessionGUID& sessId, const std::string& message);
+
+  // creates inbound queues of session, call before session can receive messages
+  void handleOpen(const gloer::net::ws::SessionGUID& sessId);
+
   void handleClose(const gloer::net::ws::SessionGUID& sessId);
+
+  // pauses reading of session while inbound queues are saturated, see pauseReadIfSaturated
+  bool handleReadPause(const gloer::net::ws::SessionGUID& sessId);
+
+  // opcodes processed on wakeup of game loop instead of next tick, see setWakeupHandler
+  static bool isLatencyCritical(uint32_t opcode);
 };
 
 } // namespace gameserver
@@ -9,9 +9,11 @@
  */
 
 #include "GameServer.hpp"
+#include "TrafficReplay.hpp"
 #include "WRTCServerManager.hpp"
 #include "WSServerManager.hpp"
 #include "algo/DispatchQueue.hpp"
+#include "algo/JsonMessage.hpp"
 #include "algo/NetworkOperation.hpp"
 #include "algo/TickManager.hpp"
 #include "config/ServerConfig.hpp"
@@ -20,6 +22,7 @@
 #include "net/ws/server/ServerConnectionManager.hpp"
 #include "log/Logger.hpp"
 #include "net/NetworkManagerBase.hpp"
+#include "net/TrafficCapture.hpp"
 #include "net/wrtc/WRTCServer.hpp"
 #include "net/wrtc/WRTCSession.hpp"
 #include "net/SessionPair.hpp"
@@ -98,9 +101,9 @@ using namespace ::gloer::net::wrtc;
 using namespace ::gloer::net::ws;
 
 static void pingCallback(std::shared_ptr<SessionPair> clientSession, ::gloer::net::WSServerNetworkManager* nm,
-                         std::shared_ptr<std::string> messageBuffer) {
-  if (!messageBuffer || !messageBuffer.get() || messageBuffer->empty()) {
-    LOG(WARNING) << "WsServer: Invalid messageBuffer";
+                         std::shared_ptr<const ::gloer::algo::JsonMessage> message) {
+  if (!message || !message.get() || !message->isValid()) {
+    LOG(WARNING) << "WsServer: Invalid message";
     return;
   }
 
@@ -114,24 +117,22 @@ static void pingCallback(std::shared_ptr<SessionPair> clientSession, ::gloer::ne
     return;
   }
 
-  std::string dataCopy = *messageBuffer.get();
-
-  // const std::string incomingStr = beast::buffers_to_string(messageBuffer->data());
-  LOG(INFO) << std::this_thread::get_id() << ":"
-            << "pingCallback incomingMsg=" << messageBuffer->c_str();
+  GLOG_EVERY_MS(GAME, INFO, 1000) << std::this_thread::get_id() << ":"
+                                  << "pingCallback";
+  GLOG_PAYLOAD(GAME) << "pingCallback incomingMsg=" << message->str();
 
   // send same message back (ping-pong)
+  // NOTE: |message| holds payload only, binary codec needs frame header again
   if (clientSession && clientSession.get() && clientSession->isOpen() &&
       !clientSession->isExpired())
-    clientSession->send(dataCopy);
+    clientSession->sendOperation((+::gloer::algo::WS_OPCODE::PING)._to_integral(),
+                                 message->str());
 }
 
 static void candidateCallback(std::shared_ptr<SessionPair> clientSession, ::gloer::net::WSServerNetworkManager* nm,
-                              std::shared_ptr<std::string> messageBuffer) {
-  // const std::string incomingStr = beast::buffers_to_string(messageBuffer->data());
-
-  if (!messageBuffer || !messageBuffer.get() || messageBuffer->empty()) {
-    LOG(WARNING) << "WsServer: Invalid messageBuffer";
+                              std::shared_ptr<const ::gloer::algo::JsonMessage> message) {
+  if (!message || !message.get() || !message->isValid()) {
+    LOG(WARNING) << "WsServer: Invalid message";
     return;
   }
 
@@ -145,40 +146,20 @@ static void candidateCallback(std::shared_ptr<SessionPair> clientSession, ::gloe
     return;
   }
 
-  std::string dataCopy = *messageBuffer.get();
-
-  LOG(INFO) << std::this_thread::get_id() << ":"
-            << "candidateCallback incomingMsg=" << dataCopy;
-
-  // todo: pass parsed
-  rapidjson::Document message_object;
-  message_object.Parse(dataCopy.c_str());
+  GLOG_EVERY_MS(GAME, INFO, 1000) << std::this_thread::get_id() << ":"
+                                  << "candidateCallback";
+  GLOG_PAYLOAD(GAME) << "candidateCallback incomingMsg=" << message->str();
 
   // Server receives Client’s ICE candidates, then finds its own ICE
   // candidates & sends them to Client
   LOG(INFO) << "type == candidate";
 
-  LOG(INFO) << std::this_thread::get_id() << ":"
-            << "m_WS->WSQueue.dispatch type == candidate";
-  rapidjson::Document message_object1;     // TODO
-  message_object1.Parse(dataCopy.c_str()); // TODO
-
   auto spt =
       clientSession->getWRTCSession().lock(); // Has to be copied into a shared_ptr before usage
 
-  /*auto handle = OnceFunctor([clientSession, spt, nm, &message_object1]() {
-    if (spt) {
-      spt->createAndAddIceCandidate(message_object1);
-    } else {
-      LOG(WARNING) << "wrtcSess_ expired";
-      return;
-    }
-  });
-
-  nm->getRunner()->workerThread_->Post(RTC_FROM_HERE, handle);*/
-
   if (spt) {
-    spt->createAndAddIceCandidateFromJson(message_object1);
+    // NOTE: message already parsed by WSServerManager::handleIncomingJSON
+    spt->createAndAddIceCandidateFromJson(message->document());
   } else {
     LOG(WARNING) << "wrtcSess_ expired";
     return;
@@ -189,12 +170,12 @@ static std::shared_ptr<gameserver::GameServer> gameInstance;
 
 // client send offer to server
 static void offerCallback(std::shared_ptr<SessionPair> clientSession, ::gloer::net::WSServerNetworkManager* nm,
-                          std::shared_ptr<std::string> messageBuffer) {
+                          std::shared_ptr<const ::gloer::algo::JsonMessage> message) {
   LOG(INFO) << std::this_thread::get_id() << ":"
             << "WS: type == offer";
 
-  if (!messageBuffer || !messageBuffer.get() || messageBuffer->empty()) {
-    LOG(WARNING) << "WsServer: Invalid messageBuffer";
+  if (!message || !message.get() || !message->isValid()) {
+    LOG(WARNING) << "WsServer: Invalid message";
     return;
   }
 
@@ -208,27 +189,15 @@ static void offerCallback(std::shared_ptr<SessionPair> clientSession, ::gloer::n
     return;
   }
 
-  std::string dataCopy = *messageBuffer.get();
-
-  LOG(INFO) << std::this_thread::get_id() << ":"
-            << "offerCallback incomingMsg=" << dataCopy.c_str();
-
-  // todo: pass parsed
-  rapidjson::Document message_object;
-  message_object.Parse(dataCopy.c_str());
+  GLOG(GAME, INFO) << std::this_thread::get_id() << ":"
+                   << "offerCallback";
+  GLOG_PAYLOAD(GAME) << "offerCallback incomingMsg=" << message->str();
 
   // TODO: don`t create datachennel for same client twice?
   LOG(INFO) << "type == offer";
 
-  rapidjson::Document message_obj;     // TODO
-  message_obj.Parse(dataCopy.c_str()); // TODO
-
-  const auto sdp = WRTCServer::sessionDescriptionStrFromJson(message_obj);
-
-  /*auto handle = OnceFunctor([clientSession, nm, sdp]() {
-    WRTCServer::setRemoteDescriptionAndCreateAnswer(clientSession, nm, sdp);
-  });
-  nm->getRunner()->signaling_thread()->Post(RTC_FROM_HERE, handle);*/
+  // NOTE: message already parsed by WSServerManager::handleIncomingJSON
+  const auto sdp = WRTCServer::sessionDescriptionStrFromJson(message->document());
 
   RTC_DCHECK(gameInstance);
   WRTCServer::setRemoteDescriptionAndCreateAnswer(clientSession, gameInstance->wrtc_nm.get(), sdp);
@@ -237,7 +206,7 @@ static void offerCallback(std::shared_ptr<SessionPair> clientSession, ::gloer::n
 }
 
 static void answerCallback(std::shared_ptr<SessionPair> clientSession, ::gloer::net::WSServerNetworkManager* nm,
-                           std::shared_ptr<std::string> messageBuffer) {
+                           std::shared_ptr<const ::gloer::algo::JsonMessage> message) {
   LOG(WARNING) << "no answerCallback on server";
 }
 
@@ -278,15 +247,14 @@ int main(int argc, char* argv[]) {
   size_t WSTickFreq = 200; // 1/Freq
   size_t WSTickNum = 0;
 
-  gloer::log::Logger lg; // inits Logger
+  // binary event log next to text log if GLOER_EVENT_LOG is set, see GLOG_EVENT
+  gloer::log::Logger lg(/* enableConsoleSink */ true, /* enableFileSink */ true,
+                        /* enableEventLog */ std::getenv("GLOER_EVENT_LOG") != nullptr);
   LOG(INFO) << "created Logger...";
 
   // std::weak_ptr<GameServer> gameInstance = folly::Singleton<GameServer>::try_get();
   // gameInstance->init(gameInstance);
 
-  gameInstance = std::make_shared<GameServer>();
-  gameInstance->init(gameInstance);
-
   printNumOfCores();
 
   const ::fs::path workdir = gloer::storage::getThisBinaryDirectoryPath();
@@ -298,6 +266,14 @@ int main(int argc, char* argv[]) {
                  gloer::config::CONFIG_NAME*/},
       workdir);
 
+  if (!serverConfig.validate()) {
+    LOG(WARNING) << "Invalid server config, see log above";
+    return EXIT_FAILURE;
+  }
+
+  gameInstance = std::make_shared<GameServer>();
+  gameInstance->init(gameInstance, serverConfig);
+
   LOG(INFO) << "make_shared NetworkManager...";
   gameInstance->ws_nm = std::make_shared<
       ::gloer::net::WSServerNetworkManager
@@ -324,6 +300,12 @@ int main(int argc, char* argv[]) {
       algo::WS_OPCODE::CANDIDATE, algo::Opcodes::opcodeToStr(algo::WS_OPCODE::CANDIDATE));
   gameInstance->ws_nm->getRunner()->addCallback(CANDIDATE_OPERATION, &candidateCallback);
 
+  // NOTE: same callback, payload of CANDIDATE_BATCH is array of candidates
+  const ws::WsNetworkOperation CANDIDATE_BATCH_OPERATION =
+      ws::WsNetworkOperation(algo::WS_OPCODE::CANDIDATE_BATCH,
+                             algo::Opcodes::opcodeToStr(algo::WS_OPCODE::CANDIDATE_BATCH));
+  gameInstance->ws_nm->getRunner()->addCallback(CANDIDATE_BATCH_OPERATION, &candidateCallback);
+
   const ws::WsNetworkOperation OFFER_OPERATION = ws::WsNetworkOperation(
       algo::WS_OPCODE::OFFER, algo::Opcodes::opcodeToStr(algo::WS_OPCODE::OFFER));
   gameInstance->ws_nm->getRunner()->addCallback(OFFER_OPERATION, &offerCallback);
@@ -336,28 +318,59 @@ int main(int argc, char* argv[]) {
 
   gameInstance->ws_nm->sessionManager().SetOnNewSessionHandler(
       [/*&gameInstance*/](std::shared_ptr<SessionPair> sess) {
-        sess->SetOnMessageHandler(std::bind(&WSServerManager::handleIncomingJSON,
-                                            gameInstance->wsGameManager, std::placeholders::_1,
-                                            std::placeholders::_2));
+        gameInstance->wsGameManager->handleOpen(sess->getId());
+        // JSON or binary codec is selected by first message of session
+        sess->SetOnBinaryMessageHandler(std::bind(&WSServerManager::handleIncomingMessage,
+                                                  gameInstance->wsGameManager, std::placeholders::_1,
+                                                  std::placeholders::_2, std::placeholders::_3));
         sess->SetOnCloseHandler(std::bind(&WSServerManager::handleClose,
                                           gameInstance->wsGameManager, std::placeholders::_1));
+        // reading pauses instead of dropping messages when game falls behind
+        sess->SetOnReadPauseHandler(std::bind(&WSServerManager::handleReadPause,
+                                              gameInstance->wsGameManager, std::placeholders::_1));
       });
 
   LOG(INFO) << "Set getRunner()->SetOnNewSessionHandler...";
 
   gameInstance->wrtc_nm->sessionManager().SetOnNewSessionHandler(
       [/*&gameInstance*/](std::shared_ptr<WRTCSession> sess) {
-        sess->SetOnMessageHandler(std::bind(&WRTCServerManager::handleIncomingJSON,
-                                            gameInstance->wrtcGameManager, std::placeholders::_1,
-                                            std::placeholders::_2));
+        gameInstance->wrtcGameManager->handleOpen(sess->getId());
+        // JSON or binary codec is selected by first message of session
+        sess->SetOnBinaryMessageHandler(std::bind(&WRTCServerManager::handleIncomingMessage,
+                                                  gameInstance->wrtcGameManager, std::placeholders::_1,
+                                                  std::placeholders::_2, std::placeholders::_3));
         sess->SetOnCloseHandler(std::bind(&WRTCServerManager::handleClose,
                                           gameInstance->wrtcGameManager, std::placeholders::_1));
       });
 
   LOG(INFO) << "Starting server loop for event queue";
 
+  const std::chrono::milliseconds tickPeriod = 50ms;
+
+  // replay capture of GLOER_TRAFFIC_REPLAY instead of serving clients, no sockets used.
+  // GLOER_REPLAY_SPEED: 1 for real time (default), 2 for twice faster, 0 for max speed
+  if (const char* replayPath = std::getenv("GLOER_TRAFFIC_REPLAY")) {
+    const char* speed = std::getenv("GLOER_REPLAY_SPEED");
+    // NOTE: only PeerConnectionFactory threads are started, WS listener is not
+    gameInstance->wrtc_nm->run(serverConfig);
+
+    TrafficReplay replay(gameInstance, speed ? std::atof(speed) : 1.0, tickPeriod);
+    const bool replayed = replay.run(replayPath);
+
+    gameInstance->wrtc_nm->finish();
+    gameInstance.reset();
+    lg.shutDownLogging();
+    return replayed ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  // capture incoming traffic of all sessions to GLOER_TRAFFIC_CAPTURE, see TrafficReplay
+  gloer::net::TrafficCapture trafficCapture;
+  if (const char* capturePath = std::getenv("GLOER_TRAFFIC_CAPTURE")) {
+    trafficCapture.start(capturePath);
+  }
+
   // processRecievedMsgs
-  TickManager<std::chrono::milliseconds> tm(50ms);
+  TickManager<std::chrono::milliseconds> tm(tickPeriod);
 
   tm.addTickHandler(TickHandler("handleAllPlayerMessages", [/*&gameInstance*/]() {
     // TODO: merge responses for same Player (NOTE: packet size limited!)
@@ -368,6 +381,17 @@ int main(int argc, char* argv[]) {
     gameInstance->handleIncomingMessages();
   }));
 
+  // signaling and ping wake game loop instead of waiting up to tick period
+  // if GLOER_URGENT_WAKEUP is set, simulation messages stay tick-aligned
+  if (std::getenv("GLOER_URGENT_WAKEUP")) {
+    auto wakeupHandler = [&tm]() { tm.wakeup(); };
+    gameInstance->wsGameManager->setWakeupHandler(wakeupHandler);
+    gameInstance->wrtcGameManager->setWakeupHandler(wakeupHandler);
+    tm.addWakeupHandler(TickHandler("handleUrgentPlayerMessages", [/*&gameInstance*/]() {
+      gameInstance->handleUrgentMessages();
+    }));
+  }
+
   {
     tm.addTickHandler(TickHandler("WSTick", [/*&gameInstance,*/ &WSTickFreq, &WSTickNum]() {
       WSTickNum++;
@@ -399,7 +423,6 @@ int main(int argc, char* argv[]) {
       }
       msg += "]SESSIONS";
 
-      gameInstance->ws_nm->getRunner()->sendToAll(msg);
       gameInstance->ws_nm->sessionManager().doToAllSessions(
           [&](const gloer::net::ws::SessionGUID& sessId, std::shared_ptr<gloer::net::SessionPair> session) {
             if (!session || !session.get()) {
@@ -407,8 +430,14 @@ int main(int argc, char* argv[]) {
               return;
             }
 
+            // NOTE: debug text has no opcode, binary codec clients get framed operations only
+            if (session->codecType() == gloer::net::MessageCodecType::BINARY) {
+              return;
+            }
+
             auto wsSessId = session->getId(); // remember id before session deletion
 
+            session->send(msg);
             session->send("Your WS id: " + static_cast<std::string>(wsSessId));
           });
     }));
@@ -445,7 +474,6 @@ int main(int argc, char* argv[]) {
       }
       msg += "]SESSIONS";
 
-      gameInstance->wrtc_nm->getRunner()->sendToAll(msg);
       gameInstance->wrtc_nm->sessionManager().doToAllSessions(
           [&](const gloer::net::wrtc::SessionGUID& sessId, std::shared_ptr<WRTCSession> session) {
             if (!session || !session.get()) {
@@ -453,8 +481,14 @@ int main(int argc, char* argv[]) {
               return;
             }
 
+            // NOTE: debug text has no opcode, binary codec clients get framed operations only
+            if (session->codecType() == gloer::net::MessageCodecType::BINARY) {
+              return;
+            }
+
             auto wrtcSessId = session->getId(); // remember id before session deletion
 
+            session->send(msg);
             session->send("Your WRTC id: " + static_cast<std::string>(wrtcSessId));
           });
     }));
@@ -475,6 +509,8 @@ int main(int argc, char* argv[]) {
   gameInstance->ws_nm->finish();
   gameInstance->wrtc_nm->finish();
 
+  trafficCapture.stop();
+
   // folly::SingletonVault::singleton()->destroyInstances();
   gameInstance.reset();
 
@@ -0,0 +1,115 @@
+#include "EchoServer.hpp" // IWYU pragma: associated
+#include "algo/DispatchQueue.hpp"
+#include "algo/JsonMessage.hpp"
+#include "algo/NetworkOperation.hpp"
+#include "config/ServerConfig.hpp"
+#include "log/Logger.hpp"
+#include "net/SessionPair.hpp"
+#include "net/ws/SessionGUID.hpp"
+#include "net/ws/WsNetworkOperation.hpp"
+#include "net/ws/server/ServerConnectionManager.hpp"
+#include "net/ws/server/ServerInputCallbacks.hpp"
+#include "net/ws/server/ServerSessionManager.hpp"
+#include <functional>
+#include <webrtc/rtc_base/checks.h>
+
+namespace loadgen {
+
+namespace {
+
+using namespace ::gloer::algo;
+using namespace ::gloer::net;
+
+static void pingCallback(std::shared_ptr<SessionPair> clientSession, WSServerNetworkManager* nm,
+                         std::shared_ptr<const JsonMessage> message) {
+  if (clientSession && clientSession->isOpen() && !clientSession->isExpired()) {
+    clientSession->sendOperation((+WS_OPCODE::PING)._to_integral(), message->str());
+  }
+}
+
+// NOTE: load test measures dispatch of other opcodes, not their game logic
+static void dropCallback(std::shared_ptr<SessionPair> clientSession, WSServerNetworkManager* nm,
+                         std::shared_ptr<const JsonMessage> message) {}
+
+} // namespace
+
+EchoServer::EchoServer(const ::gloer::config::ServerConfig& serverConfig,
+                       std::chrono::milliseconds tickPeriod)
+    : serverConfig_(serverConfig),
+      receivedMessagesQueue_(
+          std::make_shared<DispatchQueue>(std::string{"Load Generator Echo Queue"}, 0)),
+      tm_(tickPeriod) {
+  RTC_DCHECK_EQ(serverConfig_.threads_, 1);
+}
+
+EchoServer::~EchoServer() { stop(); }
+
+void EchoServer::start() {
+  nm_ = std::make_shared<WSServerNetworkManager>(serverConfig_);
+  nm_->prepare(serverConfig_);
+
+  for (const WS_OPCODE& opcode : WS_OPCODE::_values()) {
+    if (opcode == +WS_OPCODE::TOTAL) {
+      continue;
+    }
+    const ws::WsNetworkOperation operation(opcode, Opcodes::opcodeToStr(opcode));
+    nm_->getRunner()->addCallback(operation,
+                                  opcode == +WS_OPCODE::PING ? &pingCallback : &dropCallback);
+  }
+
+  nm_->sessionManager().SetOnNewSessionHandler([this](std::shared_ptr<SessionPair> sess) {
+    sess->SetOnMessageHandler(std::bind(&EchoServer::handleIncomingJSON, this,
+                                        std::placeholders::_1, std::placeholders::_2));
+  });
+
+  tm_.addTickHandler(TickHandler("handleAllPlayerMessages",
+                                 [this]() { receivedMessagesQueue_->DispatchQueued(); }));
+
+  nm_->run(serverConfig_);
+  tickThread_ = std::thread([this]() {
+    while (!stopRequested_.load()) {
+      tm_.tick();
+    }
+  });
+
+  LOG(INFO) << "loadgen: echo server listens on " << serverConfig_.address_.to_string() << ":"
+            << serverConfig_.wsPort_;
+}
+
+void EchoServer::stop() {
+  if (!nm_) {
+    return;
+  }
+  stopRequested_ = true;
+  if (tickThread_.joinable()) {
+    tickThread_.join();
+  }
+  nm_->getRunner()->getIOC().stop();
+  nm_->finish();
+}
+
+// same as gameserver WSServerManager::handleIncomingJSON
+void EchoServer::handleIncomingJSON(const ws::SessionGUID& sessId, const std::string& message) {
+  auto parsedMessage = std::make_shared<JsonMessage>(message);
+  const char* type = parsedMessage->parse() ? parsedMessage->getString("type") : nullptr;
+  uint32_t opcode = 0;
+  const ws::ServerNetworkOperationCallback* callback =
+      type && Opcodes::parseOpcode(type, opcode)
+          ? nm_->operationCallbacks().findCallback(opcode)
+          : nullptr;
+  if (!callback) {
+    GLOG_EVERY_MS(WS, WARNING, 1000) << "EchoServer: ignored message without known type";
+    return;
+  }
+
+  auto sessPtr = nm_->sessionManager().getSessById(sessId);
+  if (!sessPtr) {
+    return;
+  }
+
+  receivedMessagesQueue_->dispatch(std::bind(*callback, sessPtr, nm_.get(),
+                                             std::shared_ptr<const JsonMessage>(
+                                                 std::move(parsedMessage))));
+}
+
+} // namespace loadgen
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "algo/TickManager.hpp"
+#include "net/NetworkManagerBase.hpp"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace gloer {
+namespace algo {
+class DispatchQueue;
+} // namespace algo
+namespace config {
+struct ServerConfig;
+} // namespace config
+namespace net {
+namespace ws {
+class SessionGUID;
+} // namespace ws
+} // namespace net
+} // namespace gloer
+
+namespace loadgen {
+
+/**
+ * In-process WS server for LoadGenerator.
+ * Messages take same path as in gameserver: parsed on io thread, callback dispatched to queue,
+ * queue drained by game thread once per tick. PING is sent back as is, other opcodes are
+ * dropped by their callbacks.
+ * NOTE: one io thread, DispatchQueue allows one producer only
+ **/
+class EchoServer {
+public:
+  EchoServer(const ::gloer::config::ServerConfig& serverConfig,
+             std::chrono::milliseconds tickPeriod);
+
+  ~EchoServer();
+
+  void start();
+
+  void stop();
+
+private:
+  void handleIncomingJSON(const ::gloer::net::ws::SessionGUID& sessId, const std::string& message);
+
+  const ::gloer::config::ServerConfig& serverConfig_;
+
+  std::shared_ptr<::gloer::net::WSServerNetworkManager> nm_;
+
+  std::shared_ptr<::gloer::algo::DispatchQueue> receivedMessagesQueue_;
+
+  ::gloer::algo::TickManager<std::chrono::milliseconds> tm_;
+
+  std::atomic<bool> stopRequested_{false};
+
+  std::thread tickThread_;
+};
+
+} // namespace loadgen
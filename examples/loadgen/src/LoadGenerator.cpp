@@ -0,0 +1,331 @@
+#include "LoadGenerator.hpp" // IWYU pragma: associated
+#include "algo/StringUtils.hpp"
+#include "config/ServerConfig.hpp"
+#include "log/Logger.hpp"
+#include "net/ws/SessionGUID.hpp"
+#include "net/ws/client/ClientConnectionManager.hpp"
+#include "net/ws/client/ClientSession.hpp"
+#include "net/ws/client/ClientSessionManager.hpp"
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+#include <webrtc/rtc_base/checks.h>
+
+namespace loadgen {
+
+namespace {
+
+using namespace ::gloer::algo;
+using namespace ::gloer::net;
+
+// time to wait for handshakes after last connect and for pings sent before end of run
+static constexpr auto kSettleTime = std::chrono::seconds(5);
+
+static constexpr char kTimestampField[] = "\"ts\":";
+
+static uint64_t steadyNowNs() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now().time_since_epoch())
+                                   .count());
+}
+
+// calls |func| for each "key:weight" item of comma separated |str|
+template <typename Func> static bool parseWeighted(const std::string& str, Func&& func) {
+  std::stringstream items(str);
+  std::string item;
+  bool parsedAny = false;
+  while (std::getline(items, item, ',')) {
+    const size_t colon = item.find(':');
+    const std::string key = item.substr(0, colon);
+    char* end = nullptr;
+    const unsigned long weight =
+        colon == std::string::npos ? 1 : std::strtoul(item.c_str() + colon + 1, &end, 10);
+    if (key.empty() || (end && *end != '\0') || !weight || !func(key, weight)) {
+      LOG(WARNING) << "loadgen: invalid weighted item " << item;
+      return false;
+    }
+    parsedAny = true;
+  }
+  return parsedAny;
+}
+
+template <typename T>
+static std::discrete_distribution<size_t> distributionOf(const std::vector<T>& items) {
+  std::vector<double> weights;
+  for (const T& item : items) {
+    weights.push_back(item.weight);
+  }
+  return std::discrete_distribution<size_t>(weights.begin(), weights.end());
+}
+
+static double toMs(uint64_t us) { return static_cast<double>(us) / 1000.0; }
+
+} // namespace
+
+bool parseOpcodeMix(const std::string& str, std::vector<WeightedOpcode>& result) {
+  result.clear();
+  return parseWeighted(str, [&result](const std::string& key, unsigned long weight) {
+    const auto opcode = WS_OPCODE::_from_string_nothrow(key.c_str());
+    if (!opcode || *opcode == +WS_OPCODE::TOTAL) {
+      return false;
+    }
+    result.push_back(WeightedOpcode{*opcode, static_cast<uint32_t>(weight)});
+    return true;
+  });
+}
+
+bool parseSizeMix(const std::string& str, std::vector<WeightedSize>& result) {
+  result.clear();
+  return parseWeighted(str, [&result](const std::string& key, unsigned long weight) {
+    char* end = nullptr;
+    const unsigned long size = std::strtoul(key.c_str(), &end, 10);
+    if (*end != '\0' || !size) {
+      return false;
+    }
+    result.push_back(WeightedSize{size, static_cast<uint32_t>(weight)});
+    return true;
+  });
+}
+
+LoadGenerator::LoadGenerator(const LoadConfig& config,
+                             const ::gloer::config::ServerConfig& serverConfig)
+    : config_(config), opcodeDistribution_(distributionOf(config.mix)),
+      sizeDistribution_(distributionOf(config.sizes)) {
+  RTC_DCHECK(!config_.mix.empty());
+  RTC_DCHECK(!config_.sizes.empty());
+
+  for (const WeightedOpcode& item : config_.mix) {
+    opcodeStrs_.push_back(Opcodes::opcodeToStr(item.opcode));
+  }
+
+  nm_ = std::make_shared<WSClientNetworkManager>(serverConfig);
+  nm_->prepare(serverConfig);
+
+  // NOTE: io threads exit when io_context has no work, sessions are connected after run()
+  workGuard_ = std::make_unique<WorkGuard>(nm_->getRunner()->getIOC().get_executor());
+  nm_->run(serverConfig);
+}
+
+LoadGenerator::~LoadGenerator() {
+  {
+    std::lock_guard<std::mutex> lock(sessionsMutex_);
+    for (const auto& session : sessions_) {
+      session->close();
+    }
+  }
+
+  // NOTE: io threads exit after last operation of closed sessions completes
+  workGuard_.reset();
+  nm_->finish();
+
+  // NOTE: sessions unregister themselves on destruction, destroy them while nm_ is alive
+  sessions_.clear();
+  const auto sessionsCopy = nm_->sessionManager().getSessions();
+  for (const auto& it : sessionsCopy) {
+    nm_->sessionManager().unregisterSession(it.first);
+  }
+}
+
+bool LoadGenerator::run() {
+  if (!connectAll()) {
+    LOG(WARNING) << "loadgen: no session connected to " << config_.host << ":" << config_.port;
+    return false;
+  }
+
+  LOG(INFO) << "loadgen: warmup for " << config_.warmup.count() << " s";
+  sendUntil(std::chrono::steady_clock::now() + config_.warmup);
+
+  LOG(INFO) << "loadgen: measuring for " << config_.duration.count() << " s";
+  measureStartNs_ = steadyNowNs();
+  measuring_ = true;
+  const auto start = std::chrono::steady_clock::now();
+  sendUntil(start + config_.duration);
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+
+  // wait for replies to pings in flight
+  const auto settleEnd = std::chrono::steady_clock::now() + kSettleTime;
+  while (stats_.receivedPings.load() < stats_.sentPings.load() &&
+         std::chrono::steady_clock::now() < settleEnd) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  report(elapsed);
+  return true;
+}
+
+size_t LoadGenerator::connectAll() {
+  const auto connectInterval =
+      std::chrono::microseconds(1000000 / std::max<size_t>(1, config_.connectRate));
+  auto nextConnect = std::chrono::steady_clock::now();
+
+  for (size_t i = 0; i < config_.sessions; i++) {
+    std::this_thread::sleep_until(nextConnect);
+    nextConnect += connectInterval;
+
+    const ws::SessionGUID sessId("loadgen-" + std::to_string(i) + "-" + genGuid());
+    std::shared_ptr<ws::ClientSession> session = nm_->getRunner()->addClientSession(sessId);
+    session->SetOnMessageHandler([this](const ws::SessionGUID& sessId, const std::string& message) {
+      onMessage(sessId, message);
+    });
+    session->SetOnCloseHandler([this](const ws::SessionGUID&) { closedSessions_++; });
+
+    const auto connectStart = std::chrono::steady_clock::now();
+    std::weak_ptr<ws::ClientSession> weakSession = session;
+    session->setCreatedCb([this, weakSession, connectStart](const std::string& state) {
+      if (state != "handshake") {
+        return;
+      }
+      if (auto connected = weakSession.lock()) {
+        onConnected(connected, connectStart);
+      }
+    });
+    session->connectAsClient(config_.host, config_.port);
+  }
+
+  const auto settleEnd = std::chrono::steady_clock::now() + kSettleTime;
+  while (std::chrono::steady_clock::now() < settleEnd) {
+    {
+      std::lock_guard<std::mutex> lock(sessionsMutex_);
+      if (sessions_.size() == config_.sessions) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  std::lock_guard<std::mutex> lock(sessionsMutex_);
+  LOG(INFO) << "loadgen: connected " << sessions_.size() << " of " << config_.sessions
+            << " sessions";
+  return sessions_.size();
+}
+
+void LoadGenerator::onConnected(const std::shared_ptr<ws::ClientSession>& session,
+                                std::chrono::steady_clock::time_point connectStart) {
+  connectTimeUs_.record(static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                            connectStart)
+          .count()));
+  session->start_read();
+
+  std::lock_guard<std::mutex> lock(sessionsMutex_);
+  sessions_.push_back(session);
+}
+
+void LoadGenerator::onMessage(const ws::SessionGUID& sessId, const std::string& message) {
+  // NOTE: only echoed PING has timestamp, other server messages are ignored
+  const size_t pos = message.find(kTimestampField);
+  if (pos == std::string::npos) {
+    return;
+  }
+  const uint64_t sentAtNs =
+      std::strtoull(message.c_str() + pos + sizeof(kTimestampField) - 1, nullptr, 10);
+  const uint64_t nowNs = steadyNowNs();
+  // pings sent during warmup are not reported
+  if (!measuring_.load(std::memory_order_relaxed) || sentAtNs < measureStartNs_.load() ||
+      sentAtNs > nowNs) {
+    return;
+  }
+  stats_.receivedPings.fetch_add(1, std::memory_order_relaxed);
+  stats_.receivedBytes.fetch_add(message.size(), std::memory_order_relaxed);
+  rttUs_.record((nowNs - sentAtNs) / 1000);
+}
+
+void LoadGenerator::sendUntil(std::chrono::steady_clock::time_point end) {
+  std::vector<std::shared_ptr<ws::ClientSession>> sessions;
+  {
+    std::lock_guard<std::mutex> lock(sessionsMutex_);
+    sessions = sessions_;
+  }
+
+  const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(1.0 / std::max(config_.messageRate, 0.001)));
+
+  // NOTE: random phase spreads sends of sessions over interval
+  std::vector<std::chrono::steady_clock::time_point> nextSend(sessions.size());
+  std::uniform_int_distribution<int64_t> phase(0, interval.count());
+  const auto start = std::chrono::steady_clock::now();
+  for (auto& next : nextSend) {
+    next = start + std::chrono::steady_clock::duration(phase(random_));
+  }
+
+  uint64_t seq = 0;
+  for (auto now = start; now < end; now = std::chrono::steady_clock::now()) {
+    for (size_t i = 0; i < sessions.size(); i++) {
+      // NOTE: session behind schedule sends one message per pass, report shows real rate
+      if (nextSend[i] > now) {
+        continue;
+      }
+      nextSend[i] += interval;
+      if (!sessions[i]->isOpen()) {
+        continue;
+      }
+      const size_t opcodeIndex = opcodeDistribution_(random_);
+      const std::string message = makeMessage(opcodeIndex, seq++);
+      sessions[i]->send(message);
+      if (measuring_.load(std::memory_order_relaxed)) {
+        stats_.sentMessages.fetch_add(1, std::memory_order_relaxed);
+        stats_.sentBytes.fetch_add(message.size(), std::memory_order_relaxed);
+        if (config_.mix[opcodeIndex].opcode == +WS_OPCODE::PING) {
+          stats_.sentPings.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+std::string LoadGenerator::makeMessage(size_t opcodeIndex, uint64_t seq) {
+  const size_t size = config_.sizes[sizeDistribution_(random_)].size;
+
+  std::string message;
+  message.reserve(size + 64);
+  message += "{\"type\":\"";
+  message += opcodeStrs_[opcodeIndex];
+  message += "\",\"seq\":";
+  message += std::to_string(seq);
+  message += ",";
+  message += kTimestampField;
+  message += std::to_string(steadyNowNs());
+  message += ",\"pad\":\"";
+  // NOTE: message is longer than |size| if |size| is below size of other fields
+  const size_t tail = 2;
+  if (message.size() + tail < size) {
+    message.append(size - message.size() - tail, 'x');
+  }
+  message += "\"}";
+  return message;
+}
+
+void LoadGenerator::report(std::chrono::steady_clock::duration elapsed) const {
+  const double seconds = std::chrono::duration<double>(elapsed).count();
+  const auto connectTime = connectTimeUs_.snapshot();
+  const auto rtt = rttUs_.snapshot();
+  const uint64_t sentPings = stats_.sentPings.load();
+  const uint64_t receivedPings = stats_.receivedPings.load();
+  size_t connectedSessions = 0;
+  {
+    std::lock_guard<std::mutex> lock(sessionsMutex_);
+    connectedSessions = sessions_.size();
+  }
+
+  std::printf("sessions:   %zu connected of %zu, %zu closed\n", connectedSessions,
+              config_.sessions, closedSessions_.load());
+  std::printf("connect ms: p50 %.2f p99 %.2f max %.2f\n", toMs(connectTime.percentile(0.5)),
+              toMs(connectTime.percentile(0.99)), toMs(connectTime.percentile(1.0)));
+  std::printf("sent:       %" PRIu64 " messages, %.1f msg/s, %.2f MiB/s\n",
+              stats_.sentMessages.load(), stats_.sentMessages.load() / seconds,
+              stats_.sentBytes.load() / seconds / (1024.0 * 1024.0));
+  std::printf("echoed:     %.1f msg/s, %.2f MiB/s\n", receivedPings / seconds,
+              stats_.receivedBytes.load() / seconds / (1024.0 * 1024.0));
+  std::printf("pings:      %" PRIu64 " sent, %" PRIu64 " received, %" PRIu64 " lost\n",
+              sentPings, receivedPings, sentPings > receivedPings ? sentPings - receivedPings : 0);
+  std::printf("rtt ms:     p50 %.2f p99 %.2f p999 %.2f max %.2f\n", toMs(rtt.percentile(0.5)),
+              toMs(rtt.percentile(0.99)), toMs(rtt.percentile(0.999)),
+              toMs(rtt.percentile(1.0)));
+}
+
+} // namespace loadgen
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "algo/NetworkOperation.hpp"
+#include "metrics/Metrics.hpp"
+#include "net/NetworkManagerBase.hpp"
+#include <atomic>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace gloer {
+namespace config {
+struct ServerConfig;
+} // namespace config
+namespace net {
+namespace ws {
+class ClientSession;
+class SessionGUID;
+} // namespace ws
+} // namespace net
+} // namespace gloer
+
+namespace loadgen {
+
+struct WeightedOpcode {
+  ::gloer::algo::WS_OPCODE opcode;
+  uint32_t weight;
+};
+
+struct WeightedSize {
+  size_t size;
+  uint32_t weight;
+};
+
+struct LoadConfig {
+  std::string host = "127.0.0.1";
+
+  std::string port = "8085";
+
+  size_t sessions = 1000;
+
+  // new connections per second, keeps listen backlog from overflowing
+  size_t connectRate = 500;
+
+  // messages per second sent by each session
+  double messageRate = 10.0;
+
+  // results of warmup are not reported
+  std::chrono::seconds warmup{5};
+
+  std::chrono::seconds duration{30};
+
+  // opcode of each message, only PING is echoed by server and timed
+  std::vector<WeightedOpcode> mix;
+
+  // total size of each message in bytes, message is padded up to size
+  std::vector<WeightedSize> sizes;
+};
+
+/**
+ * Parses weighted list like "PING:90,CANDIDATE:10" or "64:50,1024:50".
+ * Returns false on invalid input.
+ **/
+bool parseOpcodeMix(const std::string& str, std::vector<WeightedOpcode>& result);
+
+bool parseSizeMix(const std::string& str, std::vector<WeightedSize>& result);
+
+/**
+ * Opens many ClientSession-s to one WS server and sends messages at fixed rate.
+ * Round-trip time is measured with PING messages, server sends them back as is.
+ * NOTE: message carries send time, so only client and server on same host are supported
+ * NOTE: histograms are large, allocate LoadGenerator on heap
+ **/
+class LoadGenerator {
+public:
+  LoadGenerator(const LoadConfig& config, const ::gloer::config::ServerConfig& serverConfig);
+
+  ~LoadGenerator();
+
+  // connects sessions, sends messages for warmup + duration, prints report
+  bool run();
+
+private:
+  struct Stats {
+    std::atomic<uint64_t> sentMessages{0};
+    std::atomic<uint64_t> sentBytes{0};
+    std::atomic<uint64_t> sentPings{0};
+    std::atomic<uint64_t> receivedPings{0};
+    std::atomic<uint64_t> receivedBytes{0};
+  };
+
+  // returns number of connected sessions
+  size_t connectAll();
+
+  void onConnected(const std::shared_ptr<::gloer::net::ws::ClientSession>& session,
+                   std::chrono::steady_clock::time_point connectStart);
+
+  void onMessage(const ::gloer::net::ws::SessionGUID& sessId, const std::string& message);
+
+  // sends messages of all sessions until |end|
+  void sendUntil(std::chrono::steady_clock::time_point end);
+
+  std::string makeMessage(size_t opcodeIndex, uint64_t seq);
+
+  void report(std::chrono::steady_clock::duration elapsed) const;
+
+  typedef boost::asio::executor_work_guard<boost::asio::io_context::executor_type> WorkGuard;
+
+  const LoadConfig config_;
+
+  std::shared_ptr<::gloer::net::WSClientNetworkManager> nm_;
+
+  std::unique_ptr<WorkGuard> workGuard_;
+
+  mutable std::mutex sessionsMutex_;
+
+  // sessions with finished handshake
+  std::vector<std::shared_ptr<::gloer::net::ws::ClientSession>> sessions_;
+
+  std::atomic<size_t> closedSessions_{0};
+
+  // stats are collected after warmup
+  std::atomic<bool> measuring_{false};
+
+  // pings sent before this steady clock time are not reported
+  std::atomic<uint64_t> measureStartNs_{0};
+
+  Stats stats_;
+
+  ::gloer::metrics::Histogram connectTimeUs_;
+
+  ::gloer::metrics::Histogram rttUs_;
+
+  std::mt19937 random_{std::random_device{}()};
+
+  std::discrete_distribution<size_t> opcodeDistribution_;
+
+  std::discrete_distribution<size_t> sizeDistribution_;
+
+  // type field of each opcode in mix
+  std::vector<std::string> opcodeStrs_;
+
+  // padding of each size in mix
+  std::vector<std::string> paddings_;
+};
+
+} // namespace loadgen
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2018 Denis Trofimov (den.a.trofimov@yandex.ru)
+ * Distributed under the MIT License.
+ * See accompanying file LICENSE.md or copy at http://opensource.org/licenses/MIT
+ */
+
+/** @file
+ * @brief Headless WS load generator start point
+ *
+ * Opens many ClientSession-s to WS server on loopback, sends messages with configured
+ * opcode mix, sizes and rate, reports throughput and PING round-trip time percentiles.
+ *
+ * Usage:
+ *   load_generator --sessions=5000 --rate=20 --duration_s=60
+ *   load_generator --mix=PING:80,CANDIDATE:20 --sizes=64:50,1024:40,8192:10
+ *   load_generator --embedded_server=false --port=8085  # load running server_example
+ * NOTE: each session uses one fd (two with embedded server), raise `ulimit -n`
+ **/
+
+#include "EchoServer.hpp"
+#include "LoadGenerator.hpp"
+#include "config/ServerConfig.hpp"
+#include "log/Logger.hpp"
+#include "storage/path.hpp"
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <gflags/gflags.h>
+#include <locale>
+#include <memory>
+
+#ifndef __has_include
+  static_assert(false, "__has_include not supported");
+#else
+#  if __has_include(<filesystem>)
+#    include <filesystem>
+     namespace fs = std::filesystem;
+#  elif __has_include(<experimental/filesystem>)
+#    include <experimental/filesystem>
+     namespace fs = std::experimental::filesystem;
+#  elif __has_include(<boost/filesystem.hpp>)
+#    include <boost/filesystem.hpp>
+     namespace fs = boost::filesystem;
+#  endif
+#endif
+
+DEFINE_string(host, "127.0.0.1", "WS server address");
+DEFINE_int32(port, 8085, "WS server port");
+DEFINE_bool(embedded_server, true,
+            "start echo server in this process, false to load already running server");
+DEFINE_int32(server_tick_ms, 50, "tick period of embedded server, as in gameserver");
+DEFINE_uint64(sessions, 1000, "number of client sessions");
+DEFINE_uint64(connect_rate, 500, "new sessions per second");
+DEFINE_int32(threads, 2, "io threads of client sessions");
+DEFINE_double(rate, 10.0, "messages per second sent by each session");
+DEFINE_int32(warmup_s, 5, "seconds of load before measurement");
+DEFINE_int32(duration_s, 30, "seconds of measured load");
+DEFINE_string(mix, "PING:100", "opcode weights, only PING is echoed and timed");
+DEFINE_string(sizes, "128:70,1024:25,8192:5", "message size weights in bytes");
+
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  std::locale::global(std::locale::classic()); // https://stackoverflow.com/a/18981514/10904212
+
+  // NOTE: console is kept for report, log goes to file
+  gloer::log::Logger lg(/* enableConsoleSink */ false, /* enableFileSink */ true);
+
+  loadgen::LoadConfig config;
+  config.host = FLAGS_host;
+  config.port = std::to_string(FLAGS_port);
+  config.sessions = FLAGS_sessions;
+  config.connectRate = FLAGS_connect_rate;
+  config.messageRate = FLAGS_rate;
+  config.warmup = std::chrono::seconds(FLAGS_warmup_s);
+  config.duration = std::chrono::seconds(FLAGS_duration_s);
+  if (!loadgen::parseOpcodeMix(FLAGS_mix, config.mix) ||
+      !loadgen::parseSizeMix(FLAGS_sizes, config.sizes)) {
+    std::fprintf(stderr, "invalid --mix or --sizes, see --help\n");
+    return EXIT_FAILURE;
+  }
+
+  const ::fs::path workdir = gloer::storage::getThisBinaryDirectoryPath();
+
+  std::unique_ptr<loadgen::EchoServer> echoServer;
+  gloer::config::ServerConfig serverConfig(::fs::path{}, workdir);
+  if (FLAGS_embedded_server) {
+    serverConfig.address_ = boost::asio::ip::make_address(FLAGS_host);
+    serverConfig.wsPort_ = static_cast<unsigned short>(FLAGS_port);
+    serverConfig.threads_ = 1;
+    echoServer = std::make_unique<loadgen::EchoServer>(
+        serverConfig, std::chrono::milliseconds(FLAGS_server_tick_ms));
+    echoServer->start();
+  }
+
+  gloer::config::ServerConfig clientConfig(::fs::path{}, workdir);
+  clientConfig.threads_ = FLAGS_threads;
+
+  bool ok = false;
+  {
+    // NOTE: histograms of LoadGenerator are too large for stack
+    auto loadGenerator = std::make_unique<loadgen::LoadGenerator>(config, clientConfig);
+    ok = loadGenerator->run();
+  }
+
+  if (echoServer) {
+    echoServer->stop();
+  }
+
+  lg.shutDownLogging();
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -29,6 +29,12 @@ const WS_PING_OPCODE = "0";
 const WS_CANDIDATE_OPCODE = "1";
 const WS_OFFER_OPCODE = "2";
 const WS_ANSWER_OPCODE = "3";
+const WS_CANDIDATE_BATCH_OPCODE = "4";
+
+// local ICE candidates are sent in one message per batch window
+const CANDIDATE_BATCH_MS = 20;
+let pendingCandidates = [];
+let candidateBatchTimer = null;
 
 const WRTC_PING_OPCODE = "0";
 const WRTC_SERVER_TIME_OPCODE = "1";
@@ -37,6 +43,11 @@ const WRTC_KEEPALIVE_OPCODE = "2";
 // Callback for when we receive a message on the data channel.
 function onDataChannelMessage(event) {
   console.log("onDataChannelMessage")
+  if (event.data instanceof ArrayBuffer) {
+    // binary messages (packed game data) sent by server with binary flag
+    onDataChannelBinaryMessage(new DataView(event.data));
+    return;
+  }
   let messageObject = "";
   try {
       messageObject = JSON.parse(event.data);
@@ -54,6 +65,11 @@ function onDataChannelMessage(event) {
   }
 }
 
+// Callback for when we receive a binary message on the data channel.
+function onDataChannelBinaryMessage(dataView) {
+  console.log("onDataChannelBinaryMessage byteLength =", dataView.byteLength)
+}
+
 // Callback for when the data channel was successfully opened.
 function keepWebRTCAlive() {
     var intervalID = setInterval(function(){
@@ -76,10 +92,29 @@ function onDataChannelOpen() {
 function onIceCandidate(event) {
   if (event && event.candidate) {
     console.log("onIceCandidate ", event.candidate)
-    webSocketConnection.send(JSON.stringify({type: WS_CANDIDATE_OPCODE, payload: event.candidate}));
+    pendingCandidates.push(event.candidate);
+    if (candidateBatchTimer === null) {
+      candidateBatchTimer = setTimeout(flushCandidates, CANDIDATE_BATCH_MS);
+    }
+  } else {
+    // null candidate means gathering complete
+    flushCandidates();
   }
 }
 
+function flushCandidates() {
+  if (candidateBatchTimer !== null) {
+    clearTimeout(candidateBatchTimer);
+    candidateBatchTimer = null;
+  }
+  if (pendingCandidates.length === 1) {
+    webSocketConnection.send(JSON.stringify({type: WS_CANDIDATE_OPCODE, payload: pendingCandidates[0]}));
+  } else if (pendingCandidates.length > 1) {
+    webSocketConnection.send(JSON.stringify({type: WS_CANDIDATE_BATCH_OPCODE, payload: pendingCandidates}));
+  }
+  pendingCandidates = [];
+}
+
 /*
  * Callback for when the SDP offer was successfully created.
  * Used to create an offer to connect and send it to the server
@@ -139,6 +174,8 @@ function connectWRTC() {
   };
   // NOTE: create dataChannel before createOffer stackoverflow.com/a/38872920/10904212
   dataChannel = rtcPeerConnection.createDataChannel('dc1', dataChannelConfig);
+  // receive binary messages as ArrayBuffer, not Blob
+  dataChannel.binaryType = 'arraybuffer';
   dataChannel.onmessage = onDataChannelMessage;
   dataChannel.onopen = onDataChannelOpen;
   const sdpConstraints = {
@@ -175,6 +212,10 @@ function onWebSocketMessage(event) {
     rtcPeerConnection.setRemoteDescription(new RTCSessionDescription(messageObject.payload));
   } else if (messageObject.type === WS_CANDIDATE_OPCODE) {
     rtcPeerConnection.addIceCandidate(new RTCIceCandidate(messageObject.payload));
+  } else if (messageObject.type === WS_CANDIDATE_BATCH_OPCODE) {
+    for (const candidate of messageObject.payload) {
+      rtcPeerConnection.addIceCandidate(new RTCIceCandidate(candidate));
+    }
   } else {
     console.log('Unrecognized WebSocket message type.', messageObject);
   }
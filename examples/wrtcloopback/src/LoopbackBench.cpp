@@ -0,0 +1,328 @@
+#include "LoopbackBench.hpp" // IWYU pragma: associated
+#include "LoopbackSignaling.hpp"
+#include "config/ServerConfig.hpp"
+#include "log/Logger.hpp"
+#include "net/wrtc/SessionGUID.hpp"
+#include "net/wrtc/SessionManager.hpp"
+#include "net/wrtc/WRTCServer.hpp"
+#include "net/wrtc/WRTCSession.hpp"
+#include "net/ws/SessionGUID.hpp"
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <webrtc/rtc_base/checks.h>
+
+namespace wrtcloopback {
+
+namespace {
+
+using namespace ::gloer::net;
+
+// message starts with steady clock send time
+static constexpr size_t kStampBytes = sizeof(uint64_t);
+
+static constexpr auto kConnectPollPeriod = std::chrono::milliseconds(1);
+
+// time to wait for messages sent before end of run
+static constexpr auto kSettleTime = std::chrono::seconds(2);
+
+static uint64_t steadyNowNs() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now().time_since_epoch())
+                                   .count());
+}
+
+static uint64_t cpuNowNs(clockid_t clock) {
+  timespec ts{};
+  clock_gettime(clock, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static double toMs(uint64_t us) { return static_cast<double>(us) / 1000.0; }
+
+static double perItemUs(uint64_t totalNs, uint64_t items) {
+  return items ? static_cast<double>(totalNs) / items / 1000.0 : 0.0;
+}
+
+} // namespace
+
+LoopbackBench::LoopbackBench(const BenchConfig& config,
+                             const ::gloer::config::ServerConfig& serverConfig)
+    : config_(config), serverConfig_(serverConfig),
+      wireGuard_(std::make_unique<WorkGuard>(wire_.get_executor())),
+      wireThread_([this]() { wire_.run(); }),
+      connectTimeUs_(std::make_unique<::gloer::metrics::Histogram>()) {}
+
+LoopbackBench::~LoopbackBench() {
+  // NOTE: no signaling after this point, sessions are closed below
+  wireGuard_.reset();
+  wire_.stop();
+  if (wireThread_.joinable()) {
+    wireThread_.join();
+  }
+
+  if (nm_) {
+    closePairs();
+    nm_->finish();
+  }
+}
+
+bool LoopbackBench::run() {
+  nm_ = std::make_shared<WRTCNetworkManager>(serverConfig_);
+  nm_->sessionManager().SetOnNewSessionHandler([this](std::shared_ptr<wrtc::WRTCSession> sess) {
+    sess->SetOnBinaryMessageHandler(std::bind(&LoopbackBench::onMessage, this,
+                                              std::placeholders::_1, std::placeholders::_2,
+                                              std::placeholders::_3));
+  });
+  nm_->prepare(serverConfig_);
+  nm_->run(serverConfig_);
+
+  bool ok = true;
+  for (const bool reliable : {true, false}) {
+    if (reliable ? !config_.reliable : !config_.unreliable) {
+      continue;
+    }
+
+    if (!connectPairs(reliable)) {
+      ok = false;
+      closePairs();
+      continue;
+    }
+
+    std::vector<SizeResult> results;
+    for (const size_t size : config_.sizes) {
+      SizeResult result;
+      result.size = size;
+      measureLatency(size, result);
+      measureThroughput(size, result);
+      results.push_back(std::move(result));
+    }
+
+    report(reliable, results);
+    closePairs();
+  }
+
+  return ok;
+}
+
+bool LoopbackBench::connectPairs(bool reliable) {
+  RTC_DCHECK(pairs_.empty());
+
+  // NOTE: data channel is created by offering (client) session with this config
+  webrtc::DataChannelInit& dataChannelConf = nm_->getRunner()->dataChannelConf_;
+  dataChannelConf = webrtc::DataChannelInit();
+  if (!reliable) {
+    dataChannelConf.ordered = false;
+    dataChannelConf.maxRetransmits = 0;
+  }
+
+  connectTimeUs_ = std::make_unique<::gloer::metrics::Histogram>();
+
+  std::vector<std::chrono::steady_clock::time_point> connectStarts;
+  for (size_t i = 0; i < config_.pairs; i++) {
+    const std::string id = "loopback_" + std::to_string(nextPairId_++);
+    Pair pair;
+    pair.clientWs =
+        std::make_shared<LoopbackWsSession>(ws::SessionGUID(id + "_client"), nm_.get(), wire_);
+    pair.serverWs =
+        std::make_shared<LoopbackWsSession>(ws::SessionGUID(id + "_server"), nm_.get(), wire_);
+    pair.clientWs->setPeer(pair.serverWs);
+    pair.serverWs->setPeer(pair.clientWs);
+
+    connectStarts.push_back(std::chrono::steady_clock::now());
+    pair.client = wrtc::WRTCServer::setRemoteDescriptionAndCreateOffer(pair.clientWs, nm_.get());
+    pairs_.push_back(pair);
+    if (!pair.client) {
+      LOG(WARNING) << "LoopbackBench: can`t create client session";
+      return false;
+    }
+  }
+
+  std::vector<bool> connected(pairs_.size(), false);
+  size_t connectedCount = 0;
+  const auto deadline = std::chrono::steady_clock::now() + config_.connectTimeout;
+  while (connectedCount < pairs_.size() && std::chrono::steady_clock::now() < deadline) {
+    for (size_t i = 0; i < pairs_.size(); i++) {
+      Pair& pair = pairs_[i];
+      if (connected[i]) {
+        continue;
+      }
+      if (!pair.server) {
+        pair.server = pair.serverWs->getWRTCSession().lock();
+      }
+      if (pair.server && pair.client->isDataChannelOpen() && pair.server->isDataChannelOpen()) {
+        connected[i] = true;
+        connectedCount++;
+        connectTimeUs_->record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - connectStarts[i])
+                .count()));
+      }
+    }
+    std::this_thread::sleep_for(kConnectPollPeriod);
+  }
+
+  if (connectedCount < pairs_.size()) {
+    std::fprintf(stderr, "%s data channel: %zu of %zu pairs connected in %lld ms\n",
+                 reliable ? "reliable" : "unreliable", connectedCount, pairs_.size(),
+                 static_cast<long long>(config_.connectTimeout.count()));
+    return false;
+  }
+
+  return true;
+}
+
+void LoopbackBench::closePairs() {
+  for (Pair& pair : pairs_) {
+    pair.clientWs->close();
+    pair.serverWs->close();
+    if (pair.client) {
+      nm_->sessionManager().unregisterSession(pair.client->getId());
+    }
+    if (!pair.server) {
+      pair.server = pair.serverWs->getWRTCSession().lock();
+    }
+    if (pair.server) {
+      nm_->sessionManager().unregisterSession(pair.server->getId());
+    }
+  }
+  // NOTE: WRTCSession is closed by destructor on its signaling thread
+  pairs_.clear();
+}
+
+// all pairs send one message each period
+void LoopbackBench::measureLatency(size_t size, SizeResult& result) {
+  latencyHistograms_.push_back(std::make_unique<::gloer::metrics::Histogram>());
+  latencyUs_ = latencyHistograms_.back().get();
+
+  const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(1.0 / config_.latencyRate));
+  std::string message = makeMessage(size);
+  SizeResult unused;
+  auto nextSend = std::chrono::steady_clock::now();
+  const auto end = nextSend + config_.latencyDuration;
+  while (nextSend < end) {
+    for (const Pair& pair : pairs_) {
+      stampMessage(message);
+      sendTimed(pair, message, unused);
+    }
+    nextSend += period;
+    std::this_thread::sleep_until(nextSend);
+  }
+
+  settle();
+  latencyUs_ = nullptr;
+  result.latencyUs = latencyHistograms_.back()->snapshot();
+}
+
+// sends as fast as data channel buffers allow
+void LoopbackBench::measureThroughput(size_t size, SizeResult& result) {
+  std::string message = makeMessage(size);
+  const uint64_t receivedBefore = receivedMessages_.load();
+  const uint64_t processCpuStart = cpuNowNs(CLOCK_PROCESS_CPUTIME_ID);
+  const uint64_t startNs = steadyNowNs();
+  const auto end = std::chrono::steady_clock::now() + config_.throughputDuration;
+  while (std::chrono::steady_clock::now() < end) {
+    bool sentAny = false;
+    for (const Pair& pair : pairs_) {
+      // NOTE: data channel closes abruptly if its buffer overflows
+      if (pair.client->dataChannelI_->buffered_amount() >= config_.maxBufferedBytes) {
+        continue;
+      }
+      stampMessage(message);
+      sentAny = sendTimed(pair, message, result) || sentAny;
+    }
+    if (!sentAny) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+
+  settle();
+  result.processCpuNs = cpuNowNs(CLOCK_PROCESS_CPUTIME_ID) - processCpuStart;
+  result.received = receivedMessages_.load() - receivedBefore;
+  const uint64_t lastReceivedNs = lastReceivedNs_.load();
+  result.seconds =
+      lastReceivedNs > startNs ? static_cast<double>(lastReceivedNs - startNs) / 1e9 : 0.0;
+}
+
+bool LoopbackBench::sendTimed(const Pair& pair, const std::string& message, SizeResult& result) {
+  const uint64_t cpuStart = cpuNowNs(CLOCK_THREAD_CPUTIME_ID);
+  const uint64_t wallStart = steadyNowNs();
+  const bool isSent =
+      wrtc::WRTCSession::send(nm_.get(), pair.client, message, /* isBinary */ true);
+  result.sendWallNs += steadyNowNs() - wallStart;
+  result.sendCpuNs += cpuNowNs(CLOCK_THREAD_CPUTIME_ID) - cpuStart;
+  if (isSent) {
+    result.sent++;
+  }
+  return isSent;
+}
+
+void LoopbackBench::settle() {
+  const auto deadline = std::chrono::steady_clock::now() + kSettleTime;
+  uint64_t received = receivedMessages_.load();
+  while (std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const uint64_t nowReceived = receivedMessages_.load();
+    if (nowReceived == received) {
+      return;
+    }
+    received = nowReceived;
+  }
+}
+
+// called on signaling threads of server sessions
+void LoopbackBench::onMessage(const wrtc::SessionGUID& sessId, const std::string& message,
+                              bool isBinary) {
+  const uint64_t nowNs = steadyNowNs();
+  receivedMessages_.fetch_add(1, std::memory_order_relaxed);
+  receivedBytes_.fetch_add(message.size(), std::memory_order_relaxed);
+  lastReceivedNs_.store(nowNs, std::memory_order_relaxed);
+
+  ::gloer::metrics::Histogram* latencyUs = latencyUs_.load();
+  if (latencyUs && message.size() >= kStampBytes) {
+    uint64_t sentNs = 0;
+    std::memcpy(&sentNs, message.data(), kStampBytes);
+    latencyUs->record(nowNs > sentNs ? (nowNs - sentNs) / 1000 : 0);
+  }
+}
+
+std::string LoopbackBench::makeMessage(size_t size) {
+  return std::string(std::max(size, kStampBytes), 'x');
+}
+
+void LoopbackBench::stampMessage(std::string& message) {
+  const uint64_t nowNs = steadyNowNs();
+  std::memcpy(&message[0], &nowNs, kStampBytes);
+}
+
+void LoopbackBench::report(bool reliable, const std::vector<SizeResult>& results) const {
+  const auto connectTime = connectTimeUs_->snapshot();
+
+  std::printf("%s data channel, %zu pairs\n", reliable ? "reliable" : "unreliable",
+              pairs_.size());
+  std::printf("connect ms: p50 %.2f p99 %.2f max %.2f\n", toMs(connectTime.percentile(0.5)),
+              toMs(connectTime.percentile(0.99)), toMs(connectTime.percentile(1.0)));
+  std::printf("%8s %10s %9s %7s %11s %11s %11s %9s %9s %9s\n", "size", "msg/s", "MiB/s",
+              "lost %", "lat p50 ms", "lat p99 ms", "lat max ms", "send us", "send cpu",
+              "cpu/msg");
+  for (const SizeResult& result : results) {
+    const double seconds = result.seconds > 0.0 ? result.seconds : 1.0;
+    const uint64_t lost = result.sent > result.received ? result.sent - result.received : 0;
+    std::printf("%8zu %10.0f %9.2f %7.2f %11.3f %11.3f %11.3f %9.2f %9.2f %9.2f\n", result.size,
+                result.received / seconds,
+                result.received * static_cast<double>(result.size) / seconds / (1024.0 * 1024.0),
+                result.sent ? 100.0 * lost / result.sent : 0.0,
+                toMs(result.latencyUs.percentile(0.5)), toMs(result.latencyUs.percentile(0.99)),
+                toMs(result.latencyUs.percentile(1.0)), perItemUs(result.sendWallNs, result.sent),
+                perItemUs(result.sendCpuNs, result.sent),
+                perItemUs(result.processCpuNs, result.received));
+  }
+  std::printf("\n");
+}
+
+} // namespace wrtcloopback
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "metrics/Metrics.hpp"
+#include "net/NetworkManagerBase.hpp"
+#include <atomic>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace gloer {
+namespace config {
+struct ServerConfig;
+} // namespace config
+namespace net {
+namespace wrtc {
+class SessionGUID;
+class WRTCSession;
+} // namespace wrtc
+} // namespace net
+} // namespace gloer
+
+namespace wrtcloopback {
+
+class LoopbackWsSession;
+
+struct BenchConfig {
+  // client/server PeerConnection pairs
+  size_t pairs = 8;
+
+  // message sizes in bytes, each size is measured separately
+  std::vector<size_t> sizes{64, 1024, 16 * 1024, 64 * 1024};
+
+  bool reliable = true;
+
+  // ordered = false, maxRetransmits = 0, as configured by WRTCServer for game data
+  bool unreliable = true;
+
+  std::chrono::milliseconds connectTimeout{10000};
+
+  // messages per second sent by each pair while one-way latency is measured
+  double latencyRate = 100.0;
+
+  std::chrono::milliseconds latencyDuration{2000};
+
+  std::chrono::milliseconds throughputDuration{3000};
+
+  // throughput run sends only while data channel buffers less than this
+  uint64_t maxBufferedBytes = 256 * 1024;
+};
+
+/**
+ * Connects pairs of WRTCSession-s in one process and measures data channel path:
+ * connect time, one-way latency, throughput and CPU cost of WRTCSession::send.
+ * Client sessions send, server sessions receive. Signaling goes through LoopbackWsSession,
+ * media goes through UDP sockets of local interfaces, so traffic never leaves host.
+ **/
+class LoopbackBench {
+public:
+  LoopbackBench(const BenchConfig& config, const ::gloer::config::ServerConfig& serverConfig);
+
+  ~LoopbackBench();
+
+  // measures all configured channel types and sizes, prints report
+  bool run();
+
+private:
+  struct Pair {
+    std::shared_ptr<LoopbackWsSession> clientWs;
+    std::shared_ptr<LoopbackWsSession> serverWs;
+    std::shared_ptr<::gloer::net::wrtc::WRTCSession> client;
+    std::shared_ptr<::gloer::net::wrtc::WRTCSession> server;
+  };
+
+  struct SizeResult {
+    size_t size = 0;
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    double seconds = 0.0;
+    // wall and CPU time of WRTCSession::send on caller thread
+    uint64_t sendWallNs = 0;
+    uint64_t sendCpuNs = 0;
+    // CPU time of whole process: both peers, SCTP, DTLS, UDP
+    uint64_t processCpuNs = 0;
+    ::gloer::metrics::Histogram::Snapshot latencyUs;
+  };
+
+  // creates pairs and waits until all data channels open
+  bool connectPairs(bool reliable);
+
+  void closePairs();
+
+  void measureLatency(size_t size, SizeResult& result);
+
+  void measureThroughput(size_t size, SizeResult& result);
+
+  // sends one message from |pair| client, accounts time spent in send
+  bool sendTimed(const Pair& pair, const std::string& message, SizeResult& result);
+
+  // waits until received count stops growing
+  void settle();
+
+  void onMessage(const ::gloer::net::wrtc::SessionGUID& sessId, const std::string& message,
+                 bool isBinary);
+
+  static std::string makeMessage(size_t size);
+
+  static void stampMessage(std::string& message);
+
+  void report(bool reliable, const std::vector<SizeResult>& results) const;
+
+  typedef boost::asio::executor_work_guard<boost::asio::io_context::executor_type> WorkGuard;
+
+  const BenchConfig config_;
+
+  const ::gloer::config::ServerConfig& serverConfig_;
+
+  std::shared_ptr<::gloer::net::WRTCNetworkManager> nm_;
+
+  // delivers signaling messages, see LoopbackWsSession
+  boost::asio::io_context wire_;
+
+  std::unique_ptr<WorkGuard> wireGuard_;
+
+  std::thread wireThread_;
+
+  std::vector<Pair> pairs_;
+
+  uint64_t nextPairId_ = 0;
+
+  std::atomic<uint64_t> receivedMessages_{0};
+
+  std::atomic<uint64_t> receivedBytes_{0};
+
+  // steady clock time of last received message
+  std::atomic<uint64_t> lastReceivedNs_{0};
+
+  // one-way latency is recorded only while set
+  std::atomic<::gloer::metrics::Histogram*> latencyUs_{nullptr};
+
+  // NOTE: kept until destruction, late message may still record into histogram
+  std::vector<std::unique_ptr<::gloer::metrics::Histogram>> latencyHistograms_;
+
+  std::unique_ptr<::gloer::metrics::Histogram> connectTimeUs_;
+};
+
+} // namespace wrtcloopback
@@ -0,0 +1,104 @@
+#include "LoopbackSignaling.hpp" // IWYU pragma: associated
+#include "algo/NetworkOperation.hpp"
+#include "log/Logger.hpp"
+#include "net/wrtc/WRTCServer.hpp"
+#include "net/wrtc/WRTCSession.hpp"
+#include "net/wrtc/wrtc.hpp"
+#include <boost/asio.hpp>
+#include <rapidjson/document.h>
+#include <utility>
+
+namespace wrtcloopback {
+
+using namespace ::gloer::algo;
+using namespace ::gloer::net;
+
+LoopbackWsSession::LoopbackWsSession(const ws::SessionGUID& id, WRTCNetworkManager* nm,
+                                     boost::asio::io_context& wire)
+    : SessionPair(id), nm_(nm), wire_(wire) {}
+
+void LoopbackWsSession::send(const std::string& message) {
+  auto peer = peer_.lock();
+  if (!peer || !isOpen()) {
+    LOG(WARNING) << "LoopbackWsSession::send: peer closed";
+    return;
+  }
+  // NOTE: never call into peer WRTCSession on caller (signaling) thread
+  boost::asio::post(wire_, [peer, message]() { peer->deliver(message); });
+}
+
+void LoopbackWsSession::pairToWRTCSession(std::shared_ptr<wrtc::WRTCSession> WRTCSession) {
+  if (!WRTCSession) {
+    LOG(WARNING) << "LoopbackWsSession::pairToWRTCSession: Invalid WRTCSession";
+    return;
+  }
+
+  std::vector<std::string> pending;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wrtcSession_ = WRTCSession;
+    pending.swap(pending_);
+  }
+
+  // NOTE: called on signaling thread before remote description is set,
+  // so pending candidates are applied later on wire thread
+  auto self = shared_from_this();
+  for (std::string& message : pending) {
+    boost::asio::post(wire_, [self, message = std::move(message)]() { self->deliver(message); });
+  }
+}
+
+bool LoopbackWsSession::hasPairedWRTCSession() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return wrtcSession_.lock().get() != nullptr;
+}
+
+std::weak_ptr<wrtc::WRTCSession> LoopbackWsSession::getWRTCSession() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return wrtcSession_;
+}
+
+// same as OFFER, ANSWER and CANDIDATE callbacks of gameserver and gameclient
+void LoopbackWsSession::deliver(const std::string& message) {
+  rapidjson::Document messageObject;
+  messageObject.Parse(message.c_str());
+  if (messageObject.HasParseError() || !messageObject.IsObject() ||
+      !messageObject.HasMember("type") || !messageObject["type"].IsString()) {
+    LOG(WARNING) << "LoopbackWsSession: ignored invalid message";
+    return;
+  }
+  const WS_OPCODE opcode = Opcodes::wsOpcodeFromStr(messageObject["type"].GetString());
+
+  if (opcode == +WS_OPCODE::OFFER) {
+    const std::string sdp = wrtc::WRTCServer::sessionDescriptionStrFromJson(messageObject);
+    wrtc::WRTCServer::setRemoteDescriptionAndCreateAnswer(shared_from_this(), nm_, sdp);
+    return;
+  }
+
+  std::shared_ptr<wrtc::WRTCSession> wrtcSess;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wrtcSess = wrtcSession_.lock();
+    if (!wrtcSess) {
+      pending_.push_back(message);
+      return;
+    }
+  }
+
+  if (opcode == +WS_OPCODE::ANSWER) {
+    const std::string sdp = wrtc::WRTCServer::sessionDescriptionStrFromJson(messageObject);
+    auto sessionDescription = wrtcSess->createSessionDescription(wrtc::kAnswer, sdp);
+    if (!sessionDescription) {
+      LOG(WARNING) << "LoopbackWsSession: empty answer";
+      return;
+    }
+    wrtcSess->setRemoteDescription(sessionDescription);
+  } else if (opcode == +WS_OPCODE::CANDIDATE || opcode == +WS_OPCODE::CANDIDATE_BATCH) {
+    wrtcSess->createAndAddIceCandidatesFromJson(messageObject);
+  } else {
+    LOG(WARNING) << "LoopbackWsSession: ignored message with type "
+                 << messageObject["type"].GetString();
+  }
+}
+
+} // namespace wrtcloopback
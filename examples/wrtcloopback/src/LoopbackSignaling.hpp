@@ -0,0 +1,73 @@
+#pragma once
+
+#include "net/NetworkManagerBase.hpp"
+#include "net/SessionPair.hpp"
+#include <atomic>
+#include <boost/asio/io_context.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace gloer {
+namespace net {
+namespace wrtc {
+class WRTCSession;
+} // namespace wrtc
+} // namespace net
+} // namespace gloer
+
+namespace wrtcloopback {
+
+/**
+ * Stands in for WebSocket session that WRTCSession uses for signaling.
+ * Message sent by session is delivered to its peer on |wire| thread, like WS message is
+ * delivered by io thread: OFFER creates server WRTCSession, ANSWER and candidates are
+ * applied to paired WRTCSession of peer.
+ * NOTE: messages that arrive before WRTCSession is paired wait until pairToWRTCSession
+ **/
+class LoopbackWsSession : public ::gloer::net::SessionPair,
+                          public std::enable_shared_from_this<LoopbackWsSession> {
+public:
+  LoopbackWsSession(const ::gloer::net::ws::SessionGUID& id, ::gloer::net::WRTCNetworkManager* nm,
+                    boost::asio::io_context& wire);
+
+  ~LoopbackWsSession() override {}
+
+  void setPeer(std::weak_ptr<LoopbackWsSession> peer) { peer_ = peer; }
+
+  void send(const std::string& message) override;
+
+  bool isOpen() const override { return isOpen_.load(); }
+
+  void close() override { isOpen_ = false; }
+
+  bool isExpired() const override { return false; }
+
+  void pairToWRTCSession(std::shared_ptr<::gloer::net::wrtc::WRTCSession> WRTCSession) override;
+
+  bool hasPairedWRTCSession() override;
+
+  std::weak_ptr<::gloer::net::wrtc::WRTCSession> getWRTCSession() const override;
+
+private:
+  // called on wire thread with message sent by peer
+  void deliver(const std::string& message);
+
+  ::gloer::net::WRTCNetworkManager* nm_;
+
+  boost::asio::io_context& wire_;
+
+  std::weak_ptr<LoopbackWsSession> peer_;
+
+  std::atomic<bool> isOpen_{true};
+
+  mutable std::mutex mutex_;
+
+  std::weak_ptr<::gloer::net::wrtc::WRTCSession> wrtcSession_;
+
+  // ANSWER and candidates received before WRTCSession paired
+  std::vector<std::string> pending_;
+};
+
+} // namespace wrtcloopback
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2018 Denis Trofimov (den.a.trofimov@yandex.ru)
+ * Distributed under the MIT License.
+ * See accompanying file LICENSE.md or copy at http://opensource.org/licenses/MIT
+ */
+
+/** @file
+ * @brief In-process WebRTC data channel benchmark start point
+ *
+ * Connects client/server WRTCSession pairs in one process, signaling is done in-process
+ * (see LoopbackWsSession). Reports connect time and, for each message size, throughput,
+ * loss, one-way latency and per-message cost of WRTCSession::send / sendQueued
+ * for reliable and unreliable data channels.
+ *
+ * Usage:
+ *   wrtc_loopback_bench --pairs=16 --sizes=64,1024,65536
+ *   wrtc_loopback_bench --channels=unreliable --factories=4
+ * NOTE: loopback interface is ignored by WebRTC, host needs one network interface with address
+ **/
+
+#include "LoopbackBench.hpp"
+#include "config/ServerConfig.hpp"
+#include "log/Logger.hpp"
+#include "storage/path.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <gflags/gflags.h>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef __has_include
+  static_assert(false, "__has_include not supported");
+#else
+#  if __has_include(<filesystem>)
+#    include <filesystem>
+     namespace fs = std::filesystem;
+#  elif __has_include(<experimental/filesystem>)
+#    include <experimental/filesystem>
+     namespace fs = std::experimental::filesystem;
+#  elif __has_include(<boost/filesystem.hpp>)
+#    include <boost/filesystem.hpp>
+     namespace fs = boost::filesystem;
+#  endif
+#endif
+
+DEFINE_uint64(pairs, 8, "number of client/server PeerConnection pairs");
+DEFINE_string(sizes, "64,1024,16384,65536", "message sizes in bytes");
+DEFINE_string(channels, "reliable,unreliable", "data channel types to measure");
+DEFINE_uint32(factories, 2, "PeerConnectionFactory instances, each with own threads");
+DEFINE_bool(host_candidates_only, true, "host candidates only, no STUN requests");
+DEFINE_double(latency_rate, 100.0, "messages per second sent by each pair in latency run");
+DEFINE_int32(latency_ms, 2000, "duration of latency run of each size");
+DEFINE_int32(throughput_ms, 3000, "duration of throughput run of each size");
+DEFINE_uint64(max_buffered_kb, 256, "throughput run keeps data channel buffer below this");
+DEFINE_int32(connect_timeout_ms, 10000, "time to wait for data channels of all pairs");
+
+namespace {
+
+static bool parseSizes(const std::string& str, std::vector<size_t>& result) {
+  result.clear();
+  std::stringstream items(str);
+  std::string item;
+  while (std::getline(items, item, ',')) {
+    char* end = nullptr;
+    const unsigned long size = std::strtoul(item.c_str(), &end, 10);
+    if (item.empty() || *end != '\0' || !size) {
+      return false;
+    }
+    result.push_back(size);
+  }
+  return !result.empty();
+}
+
+static bool parseChannels(const std::string& str, wrtcloopback::BenchConfig& config) {
+  config.reliable = false;
+  config.unreliable = false;
+  std::stringstream items(str);
+  std::string item;
+  while (std::getline(items, item, ',')) {
+    if (item == "reliable") {
+      config.reliable = true;
+    } else if (item == "unreliable") {
+      config.unreliable = true;
+    } else {
+      return false;
+    }
+  }
+  return config.reliable || config.unreliable;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  std::locale::global(std::locale::classic()); // https://stackoverflow.com/a/18981514/10904212
+
+  // NOTE: console is kept for report, log goes to file
+  gloer::log::Logger lg(/* enableConsoleSink */ false, /* enableFileSink */ true);
+
+  wrtcloopback::BenchConfig config;
+  config.pairs = FLAGS_pairs;
+  config.latencyRate = FLAGS_latency_rate;
+  config.latencyDuration = std::chrono::milliseconds(FLAGS_latency_ms);
+  config.throughputDuration = std::chrono::milliseconds(FLAGS_throughput_ms);
+  config.maxBufferedBytes = FLAGS_max_buffered_kb * 1024;
+  config.connectTimeout = std::chrono::milliseconds(FLAGS_connect_timeout_ms);
+  if (!parseSizes(FLAGS_sizes, config.sizes) || !parseChannels(FLAGS_channels, config) ||
+      !config.pairs || config.latencyRate <= 0.0) {
+    std::fprintf(stderr, "invalid --sizes, --channels, --pairs or --latency_rate, see --help\n");
+    return EXIT_FAILURE;
+  }
+
+  const ::fs::path workdir = gloer::storage::getThisBinaryDirectoryPath();
+
+  gloer::config::ServerConfig serverConfig(::fs::path{}, workdir);
+  serverConfig.wrtcFactories_ = std::max(FLAGS_factories, 1u);
+  serverConfig.wrtcHostCandidatesOnly_ = FLAGS_host_candidates_only;
+  // NOTE: default limit (16 KB) would drop larger messages
+  serverConfig.wrtcMaxMessageBytes_ = std::max(
+      serverConfig.wrtcMaxMessageBytes_,
+      static_cast<uint32_t>(*std::max_element(config.sizes.begin(), config.sizes.end())));
+
+  bool ok = false;
+  {
+    wrtcloopback::LoopbackBench bench(config, serverConfig);
+    ok = bench.run();
+  }
+
+  lg.shutDownLogging();
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+
+# Copyright (c) 2018 Denis Trofimov (den.a.trofimov@yandex.ru)
+# Distributed under the MIT License.
+# See accompanying file LICENSE.md or copy at http://opensource.org/licenses/MIT
+
+"""Compares two result files of gloer-benchmarks --json
+
+usage: compare_benchmarks.py <old.json> <new.json> [--threshold <percent>]
+
+Prints time per iteration of each benchmark in both runs and relative change,
+benchmarks slower by more than threshold (default 10%) are marked REGRESSION.
+Exit code is 1 if any benchmark regressed.
+Accepts both --json (object name -> time) and --bm_json_verbose (list of
+[file, name, time]) formats of folly/Benchmark.h.
+"""
+
+import json
+import sys
+
+
+def load(path):
+    with open(path) as result_file:
+        data = json.load(result_file)
+    if isinstance(data, dict):
+        return {name: float(value) for name, value in data.items()}
+    return {entry[1]: float(entry[2]) for entry in data if not entry[1].startswith("-")}
+
+
+def main(argv):
+    threshold = 10.0
+    args = argv[1:]
+    if "--threshold" in args:
+        index = args.index("--threshold")
+        if index + 1 >= len(args):
+            sys.stderr.write(__doc__)
+            return 2
+        threshold = float(args[index + 1])
+        del args[index:index + 2]
+    if len(args) != 2:
+        sys.stderr.write(__doc__)
+        return 2
+
+    old, new = load(args[0]), load(args[1])
+    regressed = False
+    width = max([len(name) for name in list(old) + list(new)] + [9])
+    print("%-*s %14s %14s %9s" % (width, "benchmark", "old", "new", "change"))
+    for name in sorted(set(old) | set(new)):
+        if name not in old or name not in new:
+            only = "new" if name in new else "old"
+            value = new.get(name, old.get(name))
+            print("%-*s %14.2f (only in %s run)" % (width, name, value, only))
+            continue
+        change = (new[name] - old[name]) / old[name] * 100.0 if old[name] else 0.0
+        mark = ""
+        if change > threshold:
+            mark = " REGRESSION"
+            regressed = True
+        print("%-*s %14.2f %14.2f %+8.1f%%%s" % (width, name, old[name], new[name], change, mark))
+    return 1 if regressed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+
+# Copyright (c) 2018 Denis Trofimov (den.a.trofimov@yandex.ru)
+# Distributed under the MIT License.
+# See accompanying file LICENSE.md or copy at http://opensource.org/licenses/MIT
+
+"""Renders binary event log written by gloer::log::EventLog as text
+
+usage: decode_event_log.py <file.evlog> [--sort]
+
+One line per event:
+  <UTC time> <LEVEL> [thread <index>] <file>:<line> <format with args>
+Events are printed in file order (per-thread order is preserved),
+--sort orders all events by timestamp.
+File format is described in src/log/EventLog.hpp
+"""
+
+import datetime
+import struct
+import sys
+
+FILE_MAGIC = b"GLEVLOG1"
+FILE_VERSION = 1
+
+KIND_SITE = 1
+KIND_EVENT = 2
+
+LEVELS = {0: "DEBUG", 1: "INFO", 2: "WARNING", 3: "FATAL"}
+
+ARG_INT = 1
+ARG_UINT = 2
+ARG_DOUBLE = 3
+ARG_STRING = 4
+ARG_BOOL = 5
+
+
+class DecodeError(Exception):
+    pass
+
+
+def read_string(data, pos):
+    (size,) = struct.unpack_from("<H", data, pos)
+    pos += 2
+    return data[pos:pos + size].decode("utf-8", "replace"), pos + size
+
+
+def read_args(data, pos, end, count):
+    args = []
+    for _ in range(count):
+        if pos >= end:
+            raise DecodeError("truncated event args")
+        arg_type = data[pos]
+        pos += 1
+        if arg_type == ARG_INT:
+            (value,) = struct.unpack_from("<q", data, pos)
+            pos += 8
+        elif arg_type == ARG_UINT:
+            (value,) = struct.unpack_from("<Q", data, pos)
+            pos += 8
+        elif arg_type == ARG_DOUBLE:
+            (value,) = struct.unpack_from("<d", data, pos)
+            pos += 8
+        elif arg_type == ARG_BOOL:
+            value = "true" if data[pos] else "false"
+            pos += 1
+        elif arg_type == ARG_STRING:
+            value, pos = read_string(data, pos)
+        else:
+            raise DecodeError("unknown arg type %d" % arg_type)
+        args.append(value)
+    return args
+
+
+def render(format_str, args):
+    parts = format_str.split("{}")
+    out = [parts[0]]
+    for i, part in enumerate(parts[1:]):
+        out.append(str(args[i]) if i < len(args) else "{}")
+        out.append(part)
+    # args without placeholders are appended to keep all values visible
+    extra = args[len(parts) - 1:]
+    if extra:
+        out.append(" " + " ".join(str(arg) for arg in extra))
+    return "".join(out)
+
+
+def decode(data):
+    if data[:len(FILE_MAGIC)] != FILE_MAGIC:
+        raise DecodeError("not an event log")
+    (version,) = struct.unpack_from("<I", data, len(FILE_MAGIC))
+    if version != FILE_VERSION:
+        raise DecodeError("unsupported version %d" % version)
+
+    sites = {}
+    events = []
+    pos = len(FILE_MAGIC) + 4
+    while pos + 3 <= len(data):
+        (size,) = struct.unpack_from("<H", data, pos)
+        kind = data[pos + 2]
+        end = pos + size
+        if size < 3 or end > len(data):
+            # NOTE: file of crashed process may end with partial record
+            break
+        body = pos + 3
+        if kind == KIND_SITE:
+            site_id, level, line = struct.unpack_from("<HBI", data, body)
+            file_name, next_pos = read_string(data, body + 7)
+            format_str, _ = read_string(data, next_pos)
+            sites[site_id] = (LEVELS.get(level, str(level)), file_name, line, format_str)
+        elif kind == KIND_EVENT:
+            thread, timestamp, site_id, arg_count = struct.unpack_from("<IQHB", data, body)
+            args = read_args(data, body + 15, end, arg_count)
+            events.append((timestamp, thread, site_id, args))
+        else:
+            raise DecodeError("unknown record kind %d at %d" % (kind, pos))
+        pos = end
+    # NOTE: sites are resolved after whole file is read, site may follow its first event
+    return sites, events
+
+
+def format_event(sites, event):
+    timestamp, thread, site_id, args = event
+    level, file_name, line, format_str = sites.get(site_id, ("?", "?", 0, "unknown site"))
+    time = datetime.datetime.utcfromtimestamp(timestamp // 1000000000)
+    return "%s.%09d %s [thread %d] %s:%d %s" % (
+        time.strftime("%Y-%m-%d %H:%M:%S"), timestamp % 1000000000, level, thread,
+        file_name, line, render(format_str, args))
+
+
+def main(argv):
+    if len(argv) not in (2, 3) or (len(argv) == 3 and argv[2] != "--sort"):
+        sys.stderr.write(__doc__)
+        return 1
+    with open(argv[1], "rb") as log_file:
+        data = log_file.read()
+    try:
+        sites, events = decode(data)
+    except (DecodeError, struct.error) as error:
+        sys.stderr.write("%s: %s\n" % (argv[1], error))
+        return 1
+    if len(argv) == 3:
+        events.sort(key=lambda event: event[0])
+    for event in events:
+        print(format_event(sites, event))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
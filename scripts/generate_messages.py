@@ -0,0 +1,376 @@
+#!/usr/bin/env python3
+
+# Copyright (c) 2018 Denis Trofimov (den.a.trofimov@yandex.ru)
+# Distributed under the MIT License.
+# See accompanying file LICENSE.md or copy at http://opensource.org/licenses/MIT
+
+"""Generates C++ message structs from src/net/schema/Messages.idl
+
+usage: generate_messages.py <input.idl> <output.hpp>
+
+Each message becomes a struct with std::string_view fields (no copies on read)
+and free functions:
+  fromJson(const rapidjson::Value&, T&)  - single pass over object members
+  toJson(const T&, Writer&)              - streams into rapidjson::Writer, no DOM
+  fromBinary(const char*, size_t, T&)    - fields in declaration order
+  toBinary(const T&, std::string&)       - appends to caller-owned buffer
+  binarySize(const T&)                   - exact size for reserve()
+"""
+
+import os
+import re
+import sys
+
+FIELD_TYPES = {
+    # idl type: (C++ type, default value, rapidjson type check)
+    "string": ("std::string_view", None, "IsString"),
+    "int32": ("int32_t", "0", "IsInt"),
+    "uint32": ("uint32_t", "0", "IsUint"),
+    "bool": ("bool", "false", "IsBool"),
+}
+
+MAX_FIELDS = 32  # presence of fields is tracked in uint32_t bitmask
+
+MESSAGE_RE = re.compile(r"^message\s+([A-Za-z_][A-Za-z0-9_]*)\s*\{$")
+FIELD_RE = re.compile(r"^(optional\s+)?([a-z0-9]+)\s+([A-Za-z_][A-Za-z0-9_]*)\s*;$")
+
+
+class SchemaError(Exception):
+    pass
+
+
+class Field:
+    def __init__(self, name, type_name, optional):
+        self.name = name
+        self.type_name = type_name
+        self.optional = optional
+
+
+class Message:
+    def __init__(self, name, comment):
+        self.name = name
+        self.comment = comment
+        self.fields = []
+
+    def has_optional(self):
+        return any(field.optional for field in self.fields)
+
+    def required_mask(self):
+        mask = 0
+        for index, field in enumerate(self.fields):
+            if not field.optional:
+                mask |= 1 << index
+        return mask
+
+
+def parse(text):
+    messages = []
+    current = None
+    comment = []
+    for line_no, raw_line in enumerate(text.splitlines(), 1):
+        line = raw_line.strip()
+        if not line:
+            comment = []
+            continue
+        if line.startswith("#"):
+            comment.append(line[1:].strip())
+            continue
+        if current is None:
+            match = MESSAGE_RE.match(line)
+            if not match:
+                raise SchemaError("line %d: expected 'message <Name> {'" % line_no)
+            if any(message.name == match.group(1) for message in messages):
+                raise SchemaError("line %d: duplicate message %s" % (line_no, match.group(1)))
+            current = Message(match.group(1), comment)
+            comment = []
+            continue
+        if line == "}":
+            if not current.fields:
+                raise SchemaError("line %d: message %s has no fields" % (line_no, current.name))
+            messages.append(current)
+            current = None
+            continue
+        match = FIELD_RE.match(line)
+        if not match:
+            raise SchemaError("line %d: expected '[optional] <type> <name>;'" % line_no)
+        optional, type_name, name = bool(match.group(1)), match.group(2), match.group(3)
+        if type_name not in FIELD_TYPES:
+            raise SchemaError("line %d: unknown type %s" % (line_no, type_name))
+        if any(field.name == name for field in current.fields):
+            raise SchemaError("line %d: duplicate field %s" % (line_no, name))
+        if len(current.fields) == MAX_FIELDS:
+            raise SchemaError("line %d: more than %d fields" % (line_no, MAX_FIELDS))
+        current.fields.append(Field(name, type_name, optional))
+    if current is not None:
+        raise SchemaError("unterminated message %s" % current.name)
+    return messages
+
+
+PREAMBLE = """#pragma once
+
+/** @file
+ * @brief Message structs generated from {idl}
+ *
+ * NOTE: generated by scripts/generate_messages.py, do not edit
+ */
+
+#include "net/schema/SchemaSupport.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <rapidjson/document.h>
+#include <string>
+#include <string_view>
+
+namespace gloer {{
+namespace net {{
+namespace schema {{
+"""
+
+EPILOGUE = """
+} // namespace schema
+} // namespace net
+} // namespace gloer
+"""
+
+
+def generate_struct(message):
+    out = []
+    if message.comment:
+        out.append("/**")
+        out.extend((" * " + line).rstrip() for line in message.comment)
+        out.append(" **/")
+    out.append("struct %s {" % message.name)
+    for field in message.fields:
+        cpp_type, default, _ = FIELD_TYPES[field.type_name]
+        if default is None:
+            out.append("  %s %s;" % (cpp_type, field.name))
+        else:
+            out.append("  %s %s = %s;" % (cpp_type, field.name, default))
+    if message.has_optional():
+        out.append("")
+        out.append("  // bit N is set if optional field N is present")
+        out.append("  uint32_t presentFields = 0;")
+        for index, field in enumerate(message.fields):
+            if field.optional:
+                out.append("")
+                out.append("  bool has_%s() const { return presentFields & (1u << %d); }"
+                           % (field.name, index))
+    out.append("};")
+    return out
+
+
+def generate_from_json(message):
+    name = message.name
+    out = [
+        "// rejects non-object, mistyped, duplicate or missing required fields; ignores unknown",
+        "inline bool fromJson(const rapidjson::Value& value, %s& message) {" % name,
+        "  if (!value.IsObject()) {",
+        "    return false;",
+        "  }",
+        "  uint32_t seen = 0;",
+        "  for (auto it = value.MemberBegin(); it != value.MemberEnd(); ++it) {",
+        "    const std::string_view fieldName = detail::jsonString(it->name);",
+        "    const rapidjson::Value& field = it->value;",
+        "    uint32_t bit = 0;",
+    ]
+    for index, field in enumerate(message.fields):
+        _, _, check = FIELD_TYPES[field.type_name]
+        keyword = "if" if index == 0 else "} else if"
+        out.append("    %s (fieldName == \"%s\") {" % (keyword, field.name))
+        out.append("      if (!field.%s()) {" % check)
+        out.append("        return false;")
+        out.append("      }")
+        if field.type_name == "string":
+            out.append("      message.%s = detail::jsonString(field);" % field.name)
+        elif field.type_name == "int32":
+            out.append("      message.%s = field.GetInt();" % field.name)
+        elif field.type_name == "uint32":
+            out.append("      message.%s = field.GetUint();" % field.name)
+        elif field.type_name == "bool":
+            out.append("      message.%s = field.GetBool();" % field.name)
+        out.append("      bit = 1u << %d;" % index)
+    out.extend([
+        "    } else {",
+        "      continue;",
+        "    }",
+        "    if (seen & bit) {",
+        "      return false;",
+        "    }",
+        "    seen |= bit;",
+        "  }",
+    ])
+    if message.has_optional():
+        out.append("  message.presentFields = seen;")
+    out.append("  return (seen & 0x%Xu) == 0x%Xu;" % (message.required_mask(), message.required_mask()))
+    out.append("}")
+    return out
+
+
+def generate_to_json(message):
+    out = [
+        "template <typename Writer> bool toJson(const %s& message, Writer& writer) {" % message.name,
+        "  if (!writer.StartObject()) {",
+        "    return false;",
+        "  }",
+    ]
+    for index, field in enumerate(message.fields):
+        if field.type_name == "string":
+            write = "detail::writeJsonString(writer, message.%s)" % field.name
+        elif field.type_name == "int32":
+            write = "writer.Int(message.%s)" % field.name
+        elif field.type_name == "uint32":
+            write = "writer.Uint(message.%s)" % field.name
+        else:
+            write = "writer.Bool(message.%s)" % field.name
+        indent = "  "
+        if field.optional:
+            out.append("  if (message.has_%s()) {" % field.name)
+            indent = "    "
+        out.append("%sif (!detail::writeJsonKey(writer, \"%s\") || !%s) {" % (indent, field.name, write))
+        out.append("%s  return false;" % indent)
+        out.append("%s}" % indent)
+        if field.optional:
+            out.append("  }")
+    out.append("  return writer.EndObject();")
+    out.append("}")
+    return out
+
+
+def generate_binary_size(message):
+    out = ["inline size_t binarySize(const %s& message) {" % message.name]
+    out.append("  size_t size = 0;")
+    if message.has_optional():
+        out.append("  size += BinaryWriter::varintSize(message.presentFields);")
+    for field in message.fields:
+        if field.type_name == "string":
+            expr = "detail::binaryStringSize(message.%s)" % field.name
+        elif field.type_name == "int32":
+            expr = "BinaryWriter::varintSize(detail::zigzagEncode(message.%s))" % field.name
+        elif field.type_name == "uint32":
+            expr = "BinaryWriter::varintSize(message.%s)" % field.name
+        else:
+            expr = "1"
+        if field.optional:
+            out.append("  size += message.has_%s() ? %s : 0;" % (field.name, expr))
+        else:
+            out.append("  size += %s;" % expr)
+    out.append("  return size;")
+    out.append("}")
+    return out
+
+
+def generate_to_binary(message):
+    out = [
+        "// appends fields in declaration order, see binarySize",
+        "inline void toBinary(const %s& message, std::string& out) {" % message.name,
+        "  BinaryWriter writer(out);",
+    ]
+    if message.has_optional():
+        out.append("  writer.writeVarint(message.presentFields);")
+    for field in message.fields:
+        if field.type_name == "string":
+            write = "detail::writeBinaryString(writer, message.%s);" % field.name
+        elif field.type_name == "int32":
+            write = "writer.writeVarint(detail::zigzagEncode(message.%s));" % field.name
+        elif field.type_name == "uint32":
+            write = "writer.writeVarint(message.%s);" % field.name
+        else:
+            write = "writer.writeU8(message.%s ? 1 : 0);" % field.name
+        if field.optional:
+            out.append("  if (message.has_%s()) {" % field.name)
+            out.append("    " + write)
+            out.append("  }")
+        else:
+            out.append("  " + write)
+    out.append("}")
+    return out
+
+
+def generate_from_binary(message):
+    out = [
+        "// rejects truncated input and trailing bytes",
+        "inline bool fromBinary(const char* data, size_t size, %s& message) {" % message.name,
+        "  BinaryReader reader(data, size);",
+    ]
+    if message.has_optional():
+        out.append("  if (!reader.readVarint(message.presentFields)) {")
+        out.append("    return false;")
+        out.append("  }")
+    needs_u8 = any(field.type_name == "bool" for field in message.fields)
+    needs_varint = any(field.type_name == "int32" for field in message.fields)
+    if needs_u8:
+        out.append("  uint8_t byte = 0;")
+    if needs_varint:
+        out.append("  uint32_t varint = 0;")
+    for field in message.fields:
+        if field.type_name == "string":
+            read = ["if (!detail::readBinaryString(reader, message.%s)) {" % field.name,
+                    "  return false;",
+                    "}"]
+        elif field.type_name == "int32":
+            read = ["if (!reader.readVarint(varint)) {",
+                    "  return false;",
+                    "}",
+                    "message.%s = detail::zigzagDecode(varint);" % field.name]
+        elif field.type_name == "uint32":
+            read = ["if (!reader.readVarint(message.%s)) {" % field.name,
+                    "  return false;",
+                    "}"]
+        else:
+            read = ["if (!reader.readU8(byte) || byte > 1) {",
+                    "  return false;",
+                    "}",
+                    "message.%s = byte == 1;" % field.name]
+        if field.optional:
+            out.append("  if (message.has_%s()) {" % field.name)
+            out.extend("    " + line for line in read)
+            out.append("  }")
+        else:
+            out.extend("  " + line for line in read)
+    out.append("  return reader.remaining() == 0;")
+    out.append("}")
+    return out
+
+
+def generate(messages, idl_name):
+    out = [PREAMBLE.format(idl=idl_name)]
+    for message in messages:
+        lines = []
+        lines.extend(generate_struct(message))
+        lines.append("")
+        lines.extend(generate_from_json(message))
+        lines.append("")
+        lines.extend(generate_to_json(message))
+        lines.append("")
+        lines.extend(generate_binary_size(message))
+        lines.append("")
+        lines.extend(generate_to_binary(message))
+        lines.append("")
+        lines.extend(generate_from_binary(message))
+        out.append("\n".join(lines) + "\n")
+    out.append(EPILOGUE)
+    return "\n".join(out)
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.stderr.write("usage: generate_messages.py <input.idl> <output.hpp>\n")
+        return 1
+    input_path, output_path = argv[1], argv[2]
+    with open(input_path) as idl:
+        try:
+            messages = parse(idl.read())
+        except SchemaError as error:
+            sys.stderr.write("%s: %s\n" % (input_path, error))
+            return 1
+    idl_name = "net/schema/" + input_path.replace("\\", "/").split("/")[-1]
+    output_dir = os.path.dirname(output_path)
+    if output_dir and not os.path.isdir(output_dir):
+        os.makedirs(output_dir)
+    with open(output_path, "w") as output:
+        output.write(generate(messages, idl_name))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -1,22 +1,43 @@
 #pragma once
 
-#include <map>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 
 namespace gloer {
 namespace algo {
 
+/**
+ * Dispatch table indexed by opcode.
+ * NOTE: opcodes are dense BETTER_ENUM values (0..TOTAL), so lookup is array access
+ **/
 template <typename opType, typename cbType> class CallbackManager {
 public:
+  using opcode_type = typename opType::opcode_type;
+
+  static constexpr size_t kMaxOpcodes = opcode_type::_size();
+
+  using callbacks_table = std::array<cbType, kMaxOpcodes>;
+
   CallbackManager() {}
 
   virtual ~CallbackManager(){};
 
-  virtual std::map<opType, cbType> getCallbacks() const = 0;
+  // read-only view, empty callbacks are not registered
+  const callbacks_table& getCallbacks() const { return operationCallbacks_; }
+
+  // returns nullptr if opcode is out of range or has no callback
+  const cbType* findCallback(uint32_t opcode) const {
+    if (opcode >= kMaxOpcodes || !operationCallbacks_[opcode]) {
+      return nullptr;
+    }
+    return &operationCallbacks_[opcode];
+  }
 
   virtual void addCallback(const opType& op, const cbType& cb) = 0;
 
 protected:
-  std::map<opType, cbType> operationCallbacks_;
+  callbacks_table operationCallbacks_;
 };
 
 } // namespace algo
@@ -1,12 +1,31 @@
 #include "algo/DispatchQueue.hpp" // IWYU pragma: associated
 #include "log/Logger.hpp"
+#include "metrics/MessageTrace.hpp"
+#include "metrics/Metrics.hpp"
 #include <algorithm>
 #include <iostream>
 
 namespace gloer {
 namespace algo {
 
-DispatchQueue::DispatchQueue(const std::string& name, const size_t thread_cnt) : name_(name) {
+namespace {
+
+static std::string queueLabel(const std::string& name) {
+  return "queue=\"" + name + "\"";
+}
+
+} // namespace
+
+DispatchQueue::DispatchQueue(const std::string& name, const size_t thread_cnt)
+    : name_(name),
+      depthMetric_(metrics::MetricsRegistry::instance().gauge(
+          "gloer_dispatch_queue_depth", "Callbacks waiting in dispatch queue", queueLabel(name))),
+      waitTimeMetric_(metrics::MetricsRegistry::instance().histogram(
+          "gloer_dispatch_queue_wait_us", "Time callback waited in dispatch queue",
+          queueLabel(name))),
+      droppedMetric_(metrics::MetricsRegistry::instance().counter(
+          "gloer_dispatch_queue_dropped_total", "Callbacks dropped by full dispatch queue",
+          queueLabel(name))) {
   LOG(INFO) << name_ << "Creating dispatch queue: " << name.c_str();
   LOG(INFO) << name_ << "Dispatch threads: " << thread_cnt;
 }
@@ -21,21 +40,31 @@ void DispatchQueue::clear() {
   LOG(WARNING) << name_ << "Forced clearing of queue...";
   while (!callbacksQueue_.isEmpty()) {
     callbacksQueue_.popFront();
+    depthMetric_.add(-1);
+    droppedMetric_.inc();
   }
 }
 
 void DispatchQueue::dispatch(dispatch_callback op) {
   if (callbacksQueue_.isFull()) {
     LOG(WARNING) << name_ << " DispatchQueue::dispatch: full queue: " << name_;
+    droppedMetric_.inc();
     clear();
     return;
   }
 
   // Emplace a value at the end of the queue, returns false if the queue was full.
-  if (!callbacksQueue_.write(op)) {
+  // NOTE: message handler of session dispatches on thread that read message
+  const uint64_t traceId = metrics::MessageTracer::current();
+  if (!callbacksQueue_.write(QueuedCallback{op, std::chrono::steady_clock::now(), traceId})) {
     LOG(WARNING) << name_ << "DispatchQueue::dispatch: full queue: " << name_;
+    droppedMetric_.inc();
     return;
   }
+  depthMetric_.add(1);
+  if (traceId) {
+    metrics::MessageTracer::instance().record(traceId, metrics::TraceStage::DISPATCH_ENQUEUE);
+  }
 }
 
 /*void DispatchQueue::dispatch(dispatch_callback&& op) {
@@ -47,7 +76,9 @@ void DispatchQueue::dispatch(dispatch_callback op) {
   callbacksQueue_.write(std::move(op));
 }*/
 
-void DispatchQueue::DispatchQueued(void) {
+size_t DispatchQueue::DispatchQueued(void) {
+  size_t dispatchedCount = 0;
+
   if (!callbacksQueue_.isEmpty()) {
     /*
 Returns the number of entries in the queue. Because of the way we coordinate threads, this guess
@@ -59,7 +90,7 @@ inaccurate if called from any other threads. Hence, only call from producer/cons
 
   do {
     if (!quit_ && !callbacksQueue_.isEmpty()) {
-      dispatch_callback* dispatchCallback;
+      QueuedCallback* dispatchCallback;
 
       dispatchCallback = callbacksQueue_.frontPtr();
 
@@ -69,11 +100,30 @@ inaccurate if called from any other threads. Hence, only call from producer/cons
         continue;
       }
 
-      (*dispatchCallback)();
+      waitTimeMetric_.record(static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - dispatchCallback->enqueuedAt)
+              .count()));
+
+      const uint64_t traceId = dispatchCallback->traceId;
+      if (traceId) {
+        metrics::MessageTracer& tracer = metrics::MessageTracer::instance();
+        tracer.record(traceId, metrics::TraceStage::DISPATCH_DEQUEUE);
+        // sends of callback belong to same trace
+        metrics::MessageTracer::Scope traceScope(traceId);
+        dispatchCallback->callback();
+        tracer.record(traceId, metrics::TraceStage::HANDLER_END);
+      } else {
+        dispatchCallback->callback();
+      }
 
       callbacksQueue_.popFront();
+      depthMetric_.add(-1);
+      dispatchedCount++;
     }
   } while (!callbacksQueue_.isEmpty() && !quit_);
+
+  return dispatchedCount;
 }
 
 } // namespace algo
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <cstdio>
 #include <folly/ProducerConsumerQueue.h>
 #include <functional>
@@ -10,6 +12,14 @@
 #include <thread>
 #include <vector>
 
+namespace gloer {
+namespace metrics {
+class Counter;
+class Gauge;
+class Histogram;
+} // namespace metrics
+} // namespace gloer
+
 namespace gloer {
 namespace algo {
 
@@ -41,7 +51,8 @@ public:
   DispatchQueue(DispatchQueue&& rhs) = delete;
   DispatchQueue& operator=(DispatchQueue&& rhs) = delete;
 
-  virtual void DispatchQueued(void);
+  // runs queued callbacks, returns number of callbacks run
+  virtual size_t DispatchQueued(void);
 
   virtual bool isEmpty() const { return callbacksQueue_.isEmpty(); }
 
@@ -52,16 +63,31 @@ public:
   void clear();
 
 private:
+  struct QueuedCallback {
+    dispatch_callback callback;
+    // for wait time metric
+    std::chrono::steady_clock::time_point enqueuedAt;
+    // sampled message trace, see MessageTracer
+    uint64_t traceId;
+  };
+
   std::string name_;
 
   /*
    * ProducerConsumerQueue is a one producer and one consumer queue
    * without locks.
    */
-  folly::ProducerConsumerQueue<dispatch_callback> callbacksQueue_{maxQueueElems};
+  folly::ProducerConsumerQueue<QueuedCallback> callbacksQueue_{maxQueueElems};
   //std::vector<dispatch_callback> callbacksQueue_;
 
   bool quit_ = false;
+
+  // NOTE: shared by queues with same name
+  metrics::Gauge& depthMetric_;
+
+  metrics::Histogram& waitTimeMetric_;
+
+  metrics::Counter& droppedMetric_;
 };
 
 } // namespace algo
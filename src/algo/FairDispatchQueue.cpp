@@ -0,0 +1,191 @@
+#include "algo/FairDispatchQueue.hpp" // IWYU pragma: associated
+#include "log/Logger.hpp"
+#include "metrics/MessageTrace.hpp"
+#include "metrics/Metrics.hpp"
+#include <algorithm>
+
+namespace gloer {
+namespace algo {
+
+namespace {
+
+static std::string queueLabel(const std::string& name) {
+  return "queue=\"" + name + "\"";
+}
+
+} // namespace
+
+FairDispatchQueue::FairDispatchQueue(const std::string& name, size_t sessionCapacity,
+                                     size_t quantum, size_t tickBudget)
+    : name_(name), sessionCapacity_(std::max<size_t>(sessionCapacity, 1)),
+      quantum_(std::max<size_t>(quantum, 1)), tickBudget_(std::max<size_t>(tickBudget, 1)),
+      depthMetric_(metrics::MetricsRegistry::instance().gauge(
+          "gloer_dispatch_queue_depth", "Callbacks waiting in dispatch queue", queueLabel(name))),
+      waitTimeMetric_(metrics::MetricsRegistry::instance().histogram(
+          "gloer_dispatch_queue_wait_us", "Time callback waited in dispatch queue",
+          queueLabel(name))),
+      droppedMetric_(metrics::MetricsRegistry::instance().counter(
+          "gloer_dispatch_queue_dropped_total", "Callbacks dropped by full dispatch queue",
+          queueLabel(name))) {
+  LOG(INFO) << name_ << " Creating fair dispatch queue, per session: " << sessionCapacity_
+            << ", quantum: " << quantum_ << ", tick budget: " << tickBudget_;
+}
+
+void FairDispatchQueue::addSession(const std::string& sessId) {
+  std::scoped_lock lock(sessionsMutex_);
+  std::shared_ptr<SessionQueue>& found = sessions_[sessId];
+  if (!found) {
+    found = std::make_shared<SessionQueue>(sessId, sessionCapacity_);
+  }
+}
+
+bool FairDispatchQueue::dispatch(const std::string& sessId, dispatch_callback op) {
+  std::shared_ptr<SessionQueue> queue = findSession(sessId);
+  if (!queue) {
+    GLOG_EVERY_MS(CORE, WARNING, 1000)
+        << name_ << " FairDispatchQueue::dispatch: ignored message of unknown session " << sessId;
+    return false;
+  }
+
+  // NOTE: message handler of session dispatches on thread that read message
+  const uint64_t traceId = metrics::MessageTracer::current();
+  bool needSchedule = false;
+  {
+    std::scoped_lock lock(queue->mutex);
+    if (queue->size == queue->ring.size()) {
+      queue->dropped.fetch_add(1, std::memory_order_relaxed);
+      droppedMetric_.inc();
+      GLOG_EVERY_MS(CORE, WARNING, 1000)
+          << name_ << " FairDispatchQueue::dispatch: full queue of session " << sessId;
+      return false;
+    }
+    const size_t tail = (queue->head + queue->size) % queue->ring.size();
+    queue->ring[tail] = QueuedCallback{std::move(op), std::chrono::steady_clock::now(), traceId};
+    queue->size++;
+    if (!queue->isScheduled) {
+      queue->isScheduled = true;
+      needSchedule = true;
+    }
+  }
+
+  queuedCount_.fetch_add(1, std::memory_order_relaxed);
+  depthMetric_.add(1);
+  if (traceId) {
+    metrics::MessageTracer::instance().record(traceId, metrics::TraceStage::DISPATCH_ENQUEUE);
+  }
+
+  if (needSchedule) {
+    std::scoped_lock lock(readyMutex_);
+    ready_.push_back(std::move(queue));
+  }
+  return true;
+}
+
+size_t FairDispatchQueue::DispatchQueued() {
+  size_t dispatchedCount = 0;
+
+  while (dispatchedCount < tickBudget_) {
+    std::shared_ptr<SessionQueue> queue;
+    {
+      std::scoped_lock lock(readyMutex_);
+      if (ready_.empty()) {
+        break;
+      }
+      queue = std::move(ready_.front());
+      ready_.pop_front();
+    }
+
+    // turn of session, callbacks run without lock so session may dispatch meanwhile
+    const size_t turnLimit = std::min(quantum_, tickBudget_ - dispatchedCount);
+    for (size_t turnCount = 0; turnCount < turnLimit; turnCount++) {
+      QueuedCallback queued;
+      {
+        std::scoped_lock lock(queue->mutex);
+        if (!queue->size) {
+          break;
+        }
+        queued = std::move(queue->ring[queue->head]);
+        queue->ring[queue->head] = QueuedCallback{};
+        queue->head = (queue->head + 1) % queue->ring.size();
+        queue->size--;
+      }
+      queuedCount_.fetch_sub(1, std::memory_order_relaxed);
+      depthMetric_.add(-1);
+      run(queued);
+      dispatchedCount++;
+    }
+
+    bool needSchedule = false;
+    {
+      std::scoped_lock lock(queue->mutex);
+      needSchedule = queue->size != 0;
+      queue->isScheduled = needSchedule;
+    }
+    if (needSchedule) {
+      std::scoped_lock lock(readyMutex_);
+      ready_.push_back(std::move(queue));
+    }
+  }
+
+  return dispatchedCount;
+}
+
+void FairDispatchQueue::run(QueuedCallback& queued) {
+  waitTimeMetric_.record(static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                            queued.enqueuedAt)
+          .count()));
+
+  const uint64_t traceId = queued.traceId;
+  if (traceId) {
+    metrics::MessageTracer& tracer = metrics::MessageTracer::instance();
+    tracer.record(traceId, metrics::TraceStage::DISPATCH_DEQUEUE);
+    // sends of callback belong to same trace
+    metrics::MessageTracer::Scope traceScope(traceId);
+    queued.callback();
+    tracer.record(traceId, metrics::TraceStage::HANDLER_END);
+  } else {
+    queued.callback();
+  }
+}
+
+void FairDispatchQueue::removeSession(const std::string& sessId) {
+  std::scoped_lock lock(sessionsMutex_);
+  sessions_.erase(sessId);
+}
+
+std::shared_ptr<FairDispatchQueue::SessionQueue>
+FairDispatchQueue::findSession(const std::string& sessId) const {
+  std::scoped_lock lock(sessionsMutex_);
+  auto it = sessions_.find(sessId);
+  return it != sessions_.end() ? it->second : nullptr;
+}
+
+size_t FairDispatchQueue::sessionSize(const std::string& sessId) const {
+  std::shared_ptr<SessionQueue> queue = findSession(sessId);
+  if (!queue) {
+    return 0;
+  }
+  std::scoped_lock lock(queue->mutex);
+  return queue->size;
+}
+
+uint64_t FairDispatchQueue::sessionDropped(const std::string& sessId) const {
+  std::shared_ptr<SessionQueue> queue = findSession(sessId);
+  return queue ? queue->dropped.load(std::memory_order_relaxed) : 0;
+}
+
+std::vector<std::pair<std::string, uint64_t>> FairDispatchQueue::droppingSessions() const {
+  std::vector<std::pair<std::string, uint64_t>> result;
+  std::scoped_lock lock(sessionsMutex_);
+  for (const auto& sessionkv : sessions_) {
+    const uint64_t dropped = sessionkv.second->dropped.load(std::memory_order_relaxed);
+    if (dropped) {
+      result.emplace_back(sessionkv.first, dropped);
+    }
+  }
+  return result;
+}
+
+} // namespace algo
+} // namespace gloer
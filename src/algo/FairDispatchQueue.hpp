@@ -0,0 +1,140 @@
+#pragma once
+
+#include "algo/DispatchQueue.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace gloer {
+namespace metrics {
+class Counter;
+class Gauge;
+class Histogram;
+} // namespace metrics
+} // namespace gloer
+
+namespace gloer {
+namespace algo {
+
+/**
+ * Dispatch queue with bounded queue per session and round-robin scheduling between sessions.
+ * Full session queue drops only new messages of that session, other sessions are not affected.
+ * DispatchQueued() runs up to |quantum| callbacks of session before switching to next one
+ * and up to |tickBudget| callbacks in total, rest waits for next call.
+ * NOTE: callbacks of one session run in order of dispatch, any thread may dispatch,
+ * one thread runs DispatchQueued()
+ **/
+class FairDispatchQueue {
+public:
+  typedef DispatchQueue::dispatch_callback dispatch_callback;
+
+  FairDispatchQueue(const std::string& name, size_t sessionCapacity, size_t quantum,
+                    size_t tickBudget);
+
+  // Deleted operations
+  FairDispatchQueue(const FairDispatchQueue& rhs) = delete;
+  FairDispatchQueue& operator=(const FairDispatchQueue& rhs) = delete;
+
+  /**
+   * Creates queue of session, call when session opens.
+   * NOTE: queue is created only here, so late messages of removed session can`t recreate it
+   **/
+  void addSession(const std::string& sessId);
+
+  // returns false if session is unknown (not added or removed) or its queue is full,
+  // callback is dropped
+  bool dispatch(const std::string& sessId, dispatch_callback op);
+
+  // runs queued callbacks within tick budget, returns number of callbacks run
+  size_t DispatchQueued();
+
+  /**
+   * Forgets queue of closed session.
+   * NOTE: callbacks already queued by session still run
+   **/
+  void removeSession(const std::string& sessId);
+
+  bool isEmpty() const { return sizeGuess() == 0; }
+
+  // callbacks waiting in all session queues
+  size_t sizeGuess() const { return queuedCount_.load(std::memory_order_relaxed); }
+
+  // callbacks waiting in queue of session
+  size_t sessionSize(const std::string& sessId) const;
+
+  // callbacks dropped because queue of session was full
+  uint64_t sessionDropped(const std::string& sessId) const;
+
+  // sessions that dropped callbacks, with number of dropped callbacks
+  std::vector<std::pair<std::string, uint64_t>> droppingSessions() const;
+
+  size_t sessionCapacity() const { return sessionCapacity_; }
+
+private:
+  struct QueuedCallback {
+    dispatch_callback callback;
+    // for wait time metric
+    std::chrono::steady_clock::time_point enqueuedAt;
+    // sampled message trace, see MessageTracer
+    uint64_t traceId = 0;
+  };
+
+  struct SessionQueue {
+    SessionQueue(const std::string& id, size_t capacity) : sessId(id), ring(capacity) {}
+
+    const std::string sessId;
+
+    std::mutex mutex;
+
+    std::vector<QueuedCallback> ring;
+
+    size_t head = 0;
+
+    size_t size = 0;
+
+    // queue is in |ready_| list of scheduler
+    bool isScheduled = false;
+
+    std::atomic<uint64_t> dropped{0};
+  };
+
+  std::shared_ptr<SessionQueue> findSession(const std::string& sessId) const;
+
+  void run(QueuedCallback& queued);
+
+  const std::string name_;
+
+  const size_t sessionCapacity_;
+
+  const size_t quantum_;
+
+  const size_t tickBudget_;
+
+  mutable std::mutex sessionsMutex_;
+
+  std::unordered_map<std::string, std::shared_ptr<SessionQueue>> sessions_;
+
+  std::mutex readyMutex_;
+
+  // sessions with queued callbacks, in order of next turn
+  std::deque<std::shared_ptr<SessionQueue>> ready_;
+
+  std::atomic<size_t> queuedCount_{0};
+
+  // NOTE: shared with DispatchQueue of same name
+  metrics::Gauge& depthMetric_;
+
+  metrics::Histogram& waitTimeMetric_;
+
+  metrics::Counter& droppedMetric_;
+};
+
+} // namespace algo
+} // namespace gloer
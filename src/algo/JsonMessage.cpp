@@ -0,0 +1,46 @@
+#include "algo/JsonMessage.hpp" // IWYU pragma: associated
+#include <rapidjson/error/error.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+namespace gloer {
+namespace algo {
+
+JsonMessage::JsonMessage(const std::string& message)
+    : insituBuffer_(message), allocator_(allocatorBuffer_, kAllocatorBufferSize),
+      document_(&allocator_) {}
+
+JsonMessage::JsonMessage(const char* data, size_t size)
+    : insituBuffer_(data, size), allocator_(allocatorBuffer_, kAllocatorBufferSize),
+      document_(&allocator_) {}
+
+bool JsonMessage::parse() {
+  // NOTE: std::string buffer is null-terminated
+  rapidjson::ParseResult result = document_.ParseInsitu(&insituBuffer_[0]);
+  isValid_ = result && document_.IsObject();
+  return isValid_;
+}
+
+std::string JsonMessage::str() const {
+  if (!isValid_) {
+    return std::string{};
+  }
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  document_.Accept(writer);
+  return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+const char* JsonMessage::getString(const char* name) const {
+  if (!isValid_) {
+    return nullptr;
+  }
+  const auto it = document_.FindMember(name);
+  if (it == document_.MemberEnd() || !it->value.IsString()) {
+    return nullptr;
+  }
+  return it->value.GetString();
+}
+
+} // namespace algo
+} // namespace gloer
@@ -0,0 +1,67 @@
+#pragma once
+
+/** @file
+ * @brief Class @ref gloer::algo::JsonMessage
+ */
+
+#include <cstddef>
+#include <rapidjson/document.h>
+#include <string>
+
+namespace gloer {
+namespace algo {
+
+/**
+ * @brief Incoming JSON message parsed once and passed to operation callbacks.
+ *
+ * Owns one copy of the text and the parsed document. Parsing is done in-situ
+ * (strings of the document point into that buffer, no per-string allocations),
+ * and the first chunk of the document allocator is embedded into the message,
+ * so small signaling messages are parsed without heap allocations for values.
+ * NOTE: original text is not kept, ParseInsitu overwrites the buffer
+ *
+ * NOTE: non-copyable, share with std::shared_ptr<const JsonMessage>
+ **/
+class JsonMessage {
+public:
+  explicit JsonMessage(const std::string& message);
+
+  // copies |size| bytes of |data|, e.g. payload of binary frame
+  JsonMessage(const char* data, size_t size);
+
+  JsonMessage(const JsonMessage&) = delete;
+  JsonMessage& operator=(const JsonMessage&) = delete;
+
+  // parses message, returns true if message is valid JSON object
+  bool parse();
+
+  bool isValid() const { return isValid_; }
+
+  const rapidjson::Document& document() const { return document_; }
+
+  // compact JSON text of parsed document, empty if message is invalid
+  // NOTE: serializes on each call, meant for rare callers (ping echo, payload logs)
+  std::string str() const;
+
+  // value of |name| if message is object with string member |name|, else nullptr
+  const char* getString(const char* name) const;
+
+private:
+  // enough for value nodes of offer or candidate message (16 bytes per value),
+  // larger documents like candidate batches take heap chunks
+  static constexpr size_t kAllocatorBufferSize = 256;
+
+  // modified by ParseInsitu, referenced by strings of document_
+  std::string insituBuffer_;
+
+  char allocatorBuffer_[kAllocatorBufferSize];
+
+  rapidjson::MemoryPoolAllocator<> allocator_;
+
+  rapidjson::Document document_;
+
+  bool isValid_ = false;
+};
+
+} // namespace algo
+} // namespace gloer
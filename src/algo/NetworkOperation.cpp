@@ -11,11 +11,32 @@ std::string Opcodes::opcodeToStr(const WS_OPCODE& code) {
   return std::to_string(static_cast<uint32_t>(code));
 }
 
+bool Opcodes::parseOpcode(const char* str, uint32_t& result) {
+  if (!str || *str == '\0') {
+    return false;
+  }
+
+  uint64_t value = 0;
+  for (; *str != '\0'; ++str) {
+    const uint32_t digit = static_cast<uint32_t>(*str - '0');
+    if (digit > 9) {
+      return false;
+    }
+    value = value * 10 + digit;
+    if (value > UINT32_MAX) {
+      return false;
+    }
+  }
+
+  result = static_cast<uint32_t>(value);
+  return true;
+}
+
 WS_OPCODE Opcodes::wsOpcodeFromStr(const std::string& str) {
-  // TODO str -> uint32_t: to separate UTILS file
-  // @see stackoverflow.com/a/5745454/10904212
-  uint32_t type; // NOTE: on change: don`t forget about UINT32_FIELD_MAX_LEN
-  sscanf(str.c_str(), "%" SCNu32, &type);
+  uint32_t type = 0;
+  if (!parseOpcode(str.c_str(), type) || type >= WS_OPCODE::_size()) {
+    return WS_OPCODE::TOTAL;
+  }
   return WS_OPCODE::_from_integral(type);
 }
 
@@ -30,10 +51,10 @@ std::string Opcodes::opcodeToStr(const WRTC_OPCODE& code) {
 }
 
 WRTC_OPCODE Opcodes::wrtcOpcodeFromStr(const std::string& str) {
-  // TODO str -> uint32_t: to separate UTILS file
-  // @see stackoverflow.com/a/5745454/10904212
-  uint32_t type; // NOTE: on change: don`t forget about UINT32_FIELD_MAX_LEN
-  sscanf(str.c_str(), "%" SCNu32, &type);
+  uint32_t type = 0;
+  if (!parseOpcode(str.c_str(), type) || type >= WRTC_OPCODE::_size()) {
+    return WRTC_OPCODE::TOTAL;
+  }
   return WRTC_OPCODE::_from_integral(type);
 }
 
@@ -7,7 +7,8 @@
 namespace gloer {
 namespace algo {
 
-BETTER_ENUM(WS_OPCODE_ENUM, uint32_t, PING, CANDIDATE, OFFER, ANSWER, TOTAL)
+// NOTE: CANDIDATE_BATCH payload is array of CANDIDATE payloads
+BETTER_ENUM(WS_OPCODE_ENUM, uint32_t, PING, CANDIDATE, OFFER, ANSWER, CANDIDATE_BATCH, TOTAL)
 BETTER_ENUM(WRTC_OPCODE_ENUM, uint32_t, PING, SERVER_TIME, KEEPALIVE, TOTAL)
 
 class Opcodes {
@@ -19,6 +20,13 @@ public:
 
   static std::string opcodeToStr(const WS_OPCODE& code);
 
+  /**
+   * Hand-rolled decimal parser for opcode field, faster than sscanf.
+   * Returns false for empty, non-digit or out of uint32_t range input.
+   **/
+  static bool parseOpcode(const char* str, uint32_t& result);
+
+  // NOTE: returns TOTAL for invalid input
   static WS_OPCODE wsOpcodeFromStr(const std::string& str);
 
   static WS_OPCODE wsOpcodeFromDescrStr(const std::string& str);
@@ -27,6 +35,7 @@ public:
 
   static std::string opcodeToStr(const WRTC_OPCODE& code);
 
+  // NOTE: returns TOTAL for invalid input
   static WRTC_OPCODE wrtcOpcodeFromStr(const std::string& str);
 
   static WRTC_OPCODE wrtcOpcodeFromDescrStr(const std::string& str);
@@ -36,6 +45,8 @@ using WS_OPCODE = Opcodes::WS_OPCODE;
 using WRTC_OPCODE = Opcodes::WRTC_OPCODE;
 
 template <typename T> struct NetworkOperation {
+  using opcode_type = T;
+
   explicit NetworkOperation(const T& operationCode, const std::string& operationName)
       : operationCode_(operationCode), operationCodeStr_(Opcodes::opcodeToStr(operationCode)),
         operationName_(operationName) {}
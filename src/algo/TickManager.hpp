@@ -1,6 +1,11 @@
 #pragma once
 
+#include "metrics/Metrics.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <functional>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
@@ -17,17 +22,74 @@ public:
   const std::function<void()> fn_;
 };
 
+/**
+ * Runs tick handlers once per period, at fixed rate.
+ * Wakeup handlers run as soon as wakeup() is called from any thread,
+ * so latency-critical work does not wait for next tick.
+ **/
 template <typename PeriodType> class TickManager {
 public:
   explicit TickManager(const PeriodType& serverNetworkUpdatePeriod)
-      : serverNetworkUpdatePeriod_(serverNetworkUpdatePeriod) {}
+      : serverNetworkUpdatePeriod_(serverNetworkUpdatePeriod),
+        nextTickAt_(std::chrono::steady_clock::now() + serverNetworkUpdatePeriod),
+        tickDurationMetric_(metrics::MetricsRegistry::instance().histogram(
+            "gloer_tick_duration_us", "Time spent in tick handlers")),
+        tickOverrunMetric_(metrics::MetricsRegistry::instance().counter(
+            "gloer_tick_overruns_total", "Ticks with handlers running longer than tick period")),
+        wakeupMetric_(metrics::MetricsRegistry::instance().counter(
+            "gloer_tick_wakeups_total", "Wakeups of game loop between ticks")) {}
 
+  /**
+   * Sleeps until next tick deadline or wakeup, whichever comes first.
+   * NOTE: returns after wakeup without running tick handlers if deadline is not reached
+   **/
   void tick() {
-    std::this_thread::sleep_for(serverNetworkUpdatePeriod_);
+    bool isWakeup = false;
+    {
+      std::unique_lock<std::mutex> lock(wakeupMutex_);
+      wakeupCondition_.wait_until(lock, nextTickAt_, [this]() { return wakeupRequested_; });
+      isWakeup = wakeupRequested_;
+      wakeupRequested_ = false;
+    }
+
+    if (isWakeup) {
+      wakeupMetric_.inc();
+      for (const TickHandler& it : wakeupHandlers_) {
+        it.fn_();
+      }
+    }
+
+    const auto tickStart = std::chrono::steady_clock::now();
+    if (tickStart < nextTickAt_) {
+      return;
+    }
+
     for (const TickHandler& it : tickHandlers_) {
       // LOG(INFO) << "tick() for " << it.id_;
       it.fn_();
     }
+    const auto tickEnd = std::chrono::steady_clock::now();
+    const auto tickDuration = tickEnd - tickStart;
+    tickDurationMetric_.record(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(tickDuration).count()));
+    if (tickDuration > serverNetworkUpdatePeriod_) {
+      tickOverrunMetric_.inc();
+    }
+
+    nextTickAt_ += serverNetworkUpdatePeriod_;
+    if (nextTickAt_ <= tickEnd) {
+      // NOTE: missed ticks are skipped, not run back to back
+      nextTickAt_ = tickEnd + serverNetworkUpdatePeriod_;
+    }
+  }
+
+  // thread-safe, wakeup handlers will run in thread calling tick()
+  void wakeup() {
+    std::lock_guard<std::mutex> lock(wakeupMutex_);
+    if (!wakeupRequested_) {
+      wakeupRequested_ = true;
+      wakeupCondition_.notify_one();
+    }
   }
 
   bool needServerRun() const { return needServerRun_; }
@@ -38,15 +100,36 @@ public:
 
   std::vector<TickHandler> getTickHandlers() const { return tickHandlers_; }
 
+  // NOTE: add handlers before first call of tick()
+  void addWakeupHandler(const TickHandler& wakeupHandler) {
+    wakeupHandlers_.push_back(wakeupHandler);
+  }
+
 private:
   PeriodType serverNetworkUpdatePeriod_;
 
+  std::chrono::steady_clock::time_point nextTickAt_;
+
   std::vector<TickHandler> tickHandlers_;
+
+  std::vector<TickHandler> wakeupHandlers_;
+
+  std::mutex wakeupMutex_;
+
+  std::condition_variable wakeupCondition_;
+
+  bool wakeupRequested_ = false;
   // TODO: use Sigslots
   // https://www.jianshu.com/p/7827dc7f0ad5
   // or https://www.boost.org/doc/libs/1_63_0/doc/html/signals.html
 
   bool needServerRun_ = true;
+
+  metrics::Histogram& tickDurationMetric_;
+
+  metrics::Counter& tickOverrunMetric_;
+
+  metrics::Counter& wakeupMetric_;
 };
 } // namespace algo
 } // namespace gloer
@@ -60,6 +60,34 @@ ServerConfig::ServerConfig(const ::fs::path& configPath, const ::fs::path& workd
   // TODO
   // wrtcPort
   threads_ = 1;
+  wrtcFactories_ = 1;
+  wrtcFactoryPolicy_ = WRTCFactoryPolicy::LEAST_LOAD;
+  wrtcMinPort_ = 0;
+  wrtcMaxPort_ = 0;
+  wrtcEnumerateNetworks_ = true;
+  wrtcPortAllocatorPoolSize_ = 2;
+  wrtcHostCandidatesOnly_ = false;
+  wrtcCertPoolSize_ = 8;
+  wrtcMaxConcurrentSessionSetups_ = 32;
+  wrtcMaxQueuedSessionSetups_ = 1024;
+  wrtcCandidateBatchMs_ = 20;
+  wrtcSdpTemplateCacheSize_ = 0;
+  // 16 Kbyte for the highest throughput, while also being the most portable one
+  // @see viblast.com/blog/2015/2/5/webrtc-data-channel-message-size/
+  wrtcMaxMessageBytes_ = 16 * 1024;
+  metricsRoute_ = "/metrics";
+  traceSampleRate_ = 0.0;
+  traceRoute_ = "/trace";
+  inboundSessionQueueSize_ = 64;
+  inboundQuantum_ = 4;
+  inboundTickBudget_ = 4096;
+  inboundPauseWatermark_ = 48;
+  inboundResumeWatermark_ = 16;
+  inboundGlobalPauseWatermark_ = 8192;
+  inboundGlobalResumeWatermark_ = 4096;
+  // disabled
+  wsRateLimit_ = RateLimitConfig{};
+  wrtcRateLimit_ = RateLimitConfig{};
 
   const ::fs::path workDir = gloer::storage::getThisBinaryDirectoryPath();
   const ::fs::path assetsDir = (workDir / gloer::config::ASSETS_DIR);
@@ -100,7 +128,26 @@ ServerConfig::ServerConfig(const ::fs::path& configPath, const ::fs::path& workd
 void ServerConfig::print() const {
   LOG(INFO) << "address: " << address_.to_string() << '\n'
             << "port: " << wsPort_ << '\n'
-            << "threads: " << threads_;
+            << "threads: " << threads_ << '\n'
+            << "wrtcFactories: " << wrtcFactories_;
+}
+
+bool ServerConfig::validate() const {
+  bool isValid = true;
+
+  if ((wrtcMinPort_ == 0) != (wrtcMaxPort_ == 0)) {
+    LOG(WARNING) << "ServerConfig: set both or none of wrtcMinPort and wrtcMaxPort, got "
+                 << wrtcMinPort_ << "-" << wrtcMaxPort_;
+    isValid = false;
+  }
+
+  if (wrtcMinPort_ > wrtcMaxPort_) {
+    LOG(WARNING) << "ServerConfig: wrtcMinPort " << wrtcMinPort_ << " is above wrtcMaxPort "
+                 << wrtcMaxPort_;
+    isValid = false;
+  }
+
+  return isValid;
 }
 
 /*void ServerConfig::loadConfFromLuaScript(sol::state* luaScript) {
@@ -19,6 +19,7 @@
 
 #include <net/core.hpp>
 #include <string>
+#include <vector>
 
 namespace sol {
 class state;
@@ -31,6 +32,34 @@ const std::string ASSETS_DIR = "assets";
 const std::string CONFIGS_DIR = "configuration_files";
 //const std::string CONFIG_NAME = "server_conf.lua";
 
+// how new WebRTC sessions are assigned to PeerConnectionFactory instances
+enum class WRTCFactoryPolicy {
+  ROUND_ROBIN,
+  LEAST_LOAD // factory with least number of alive sessions
+};
+
+// what happens to incoming message over rate limit, see net::RateLimiter
+enum class RateLimitAction {
+  DROP,      // message is dropped
+  DELAY,     // message is handled, next read waits for tokens (data channel: same as DROP)
+  DISCONNECT // session is closed
+};
+
+// token-bucket limits of incoming messages, 0 disables limit
+struct RateLimitConfig {
+  double sessionMessagesPerSec = 0.0;
+  double sessionBytesPerSec = 0.0;
+
+  // shared by all sessions from same remote address
+  double addressMessagesPerSec = 0.0;
+  double addressBytesPerSec = 0.0;
+
+  // size of buckets, as seconds of rate
+  double burstSeconds = 1.0;
+
+  RateLimitAction action = RateLimitAction::DROP;
+};
+
 struct ServerConfig {
   //ServerConfig(sol::state* luaScript, const fs::path& workdir);
 
@@ -38,6 +67,9 @@ struct ServerConfig {
 
   void print() const;
 
+  // false if settings are inconsistent, reasons are logged
+  bool validate() const;
+
   //void loadConfFromLuaScript(sol::state* luaScript);
 
   const fs::path workdir_;
@@ -53,6 +85,89 @@ struct ServerConfig {
 
   int32_t threads_;
 
+  // number of PeerConnectionFactory instances,
+  // each with own network, worker and signaling thread
+  uint32_t wrtcFactories_;
+
+  WRTCFactoryPolicy wrtcFactoryPolicy_;
+
+  // UDP port range for WebRTC ICE candidates, 0 means any port
+  uint16_t wrtcMinPort_;
+  uint16_t wrtcMaxPort_;
+
+  // names of network interfaces used for WebRTC ICE candidates, empty means all
+  std::vector<std::string> wrtcNetworkWhitelist_;
+
+  bool wrtcEnumerateNetworks_;
+
+  // port allocators per PeerConnectionFactory gathering candidates ahead of new sessions,
+  // 0 disables pool
+  uint32_t wrtcPortAllocatorPoolSize_;
+
+  /**
+   * Server with public address: host UDP candidates only, no STUN, TURN or TCP,
+   * single bundled transport per peer.
+   * NOTE: server still runs full ICE, answers do not announce a=ice-lite.
+   * ICE-lite with single-port UDP mux is not implemented, see todo.txt
+   **/
+  bool wrtcHostCandidatesOnly_;
+
+  // number of pre-generated DTLS certificates, 0 disables pool
+  uint32_t wrtcCertPoolSize_;
+
+  // max. number of sessions created at the same time, other offers wait in queue
+  uint32_t wrtcMaxConcurrentSessionSetups_;
+
+  // max. number of offers waiting in that queue, further offers are dropped
+  uint32_t wrtcMaxQueuedSessionSetups_;
+
+  // window for coalescing trickle-ICE candidates into one WS message, 0 sends each candidate
+  uint32_t wrtcCandidateBatchMs_;
+
+  // answers to known offer shapes rendered from template instead of CreateAnswer,
+  // max. number of cached offer shapes, 0 disables templates
+  uint32_t wrtcSdpTemplateCacheSize_;
+
+  // max. size of data channel message in both directions, larger messages are dropped
+  uint32_t wrtcMaxMessageBytes_;
+
+  // HTTP route on WebSockets port serving metrics in Prometheus text format, empty disables
+  std::string metricsRoute_;
+
+  // part of incoming messages traced through pipeline, 0 disables, see MessageTracer
+  double traceSampleRate_;
+
+  // HTTP route on WebSockets port serving last traces in Chrome trace-event JSON, empty disables
+  std::string traceRoute_;
+
+  // max. messages of one session waiting for game tick, newer messages of session are dropped
+  uint32_t inboundSessionQueueSize_;
+
+  // messages of one session handled in a row before turn of next session
+  uint32_t inboundQuantum_;
+
+  // max. messages handled per game tick, rest waits for next tick
+  uint32_t inboundTickBudget_;
+
+  // WebSocket session stops reading when its queued messages reach it, 0 disables pausing.
+  // NOTE: keep below inboundSessionQueueSize_, so paused session does not drop messages
+  uint32_t inboundPauseWatermark_;
+
+  // paused session resumes reading when its queued messages fall to it
+  uint32_t inboundResumeWatermark_;
+
+  // WebSocket sessions stop reading when messages queued by all sessions reach it, 0 disables
+  uint32_t inboundGlobalPauseWatermark_;
+
+  // paused sessions resume reading when messages queued by all sessions fall to it
+  uint32_t inboundGlobalResumeWatermark_;
+
+  // limits of WebSocket input, checked before message is parsed
+  RateLimitConfig wsRateLimit_;
+
+  // limits of data channel input, checked before message is parsed
+  RateLimitConfig wrtcRateLimit_;
+
   std::string cert_;
   std::string key_;
   std::string dh_;
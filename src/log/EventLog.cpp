@@ -0,0 +1,321 @@
+#include "log/EventLog.hpp" // IWYU pragma: associated
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace gloer {
+namespace log {
+
+namespace {
+
+static constexpr char kFileMagic[] = {'G', 'L', 'E', 'V', 'L', 'O', 'G', '1'};
+
+static constexpr uint32_t kFileVersion = 1;
+
+// file grows by at least this size to remap rarely
+static constexpr size_t kMinFileGrowth = 16 * 1024 * 1024;
+
+// limit of file name and format in SITE record
+static constexpr size_t kMaxSiteString = 1024;
+
+// u16 record size, u8 kind, u32 thread index
+static constexpr size_t kEventRecordHeaderSize = 2 + 1 + 4;
+
+static std::atomic<uint32_t> nextThreadIndex{0};
+
+static size_t roundUpToPowerOfTwo(size_t value) {
+  size_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+static uint64_t unixTimeNs() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::system_clock::now().time_since_epoch())
+                                   .count());
+}
+
+template <typename T> static void appendValue(std::string& out, T value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void appendString(std::string& out, const std::string& value) {
+  const uint16_t size = static_cast<uint16_t>(std::min(value.size(), kMaxSiteString));
+  appendValue(out, size);
+  out.append(value.data(), size);
+}
+
+} // namespace
+
+std::atomic<EventLog*> EventLog::active_{nullptr};
+
+std::atomic<uint64_t> EventLog::generation_{0};
+
+std::mutex EventLog::sitesMutex_;
+
+std::vector<EventLog::Site> EventLog::sites_;
+
+EventSlotWriter::EventSlotWriter(EventSlot& slot, uint16_t siteId) : slot_(slot) {
+  const uint64_t timestampNs = unixTimeNs();
+  std::memcpy(slot_.data, &timestampNs, sizeof(timestampNs));
+  std::memcpy(slot_.data + sizeof(timestampNs), &siteId, sizeof(siteId));
+  // arg count written in finish()
+  pos_ = sizeof(timestampNs) + sizeof(siteId) + sizeof(argCount_);
+}
+
+uint16_t EventSlotWriter::finish() {
+  slot_.data[sizeof(uint64_t) + sizeof(uint16_t)] = static_cast<char>(argCount_);
+  slot_.size = static_cast<uint16_t>(pos_);
+  return slot_.size;
+}
+
+void EventSlotWriter::put(EventArgType type, const void* value, size_t size) {
+  if (full_ || pos_ + 1 + size > EventSlot::kDataSize) {
+    full_ = true;
+    return;
+  }
+  slot_.data[pos_++] = static_cast<char>(type);
+  std::memcpy(slot_.data + pos_, value, size);
+  pos_ += size;
+  argCount_++;
+}
+
+void EventSlotWriter::putString(std::string_view value) {
+  const size_t headerSize = 1 + sizeof(uint16_t);
+  if (full_ || pos_ + headerSize > EventSlot::kDataSize) {
+    full_ = true;
+    return;
+  }
+  const uint16_t size =
+      static_cast<uint16_t>(std::min(value.size(), EventSlot::kDataSize - pos_ - headerSize));
+  slot_.data[pos_++] = static_cast<char>(EventArgType::STRING);
+  std::memcpy(slot_.data + pos_, &size, sizeof(size));
+  pos_ += sizeof(size);
+  std::memcpy(slot_.data + pos_, value.data(), size);
+  pos_ += size;
+  argCount_++;
+  // NOTE: truncated string is last arg
+  full_ = size < value.size();
+}
+
+EventRing::EventRing(size_t capacity, uint32_t threadIndex)
+    : slots_(roundUpToPowerOfTwo(std::max<size_t>(capacity, 2))), mask_(slots_.size() - 1),
+      threadIndex_(threadIndex) {}
+
+EventSlot* EventRing::claim() {
+  const size_t head = head_.load(std::memory_order_relaxed);
+  if (head - tail_.load(std::memory_order_acquire) >= slots_.size()) {
+    return nullptr;
+  }
+  return &slots_[head & mask_];
+}
+
+void EventRing::publish() {
+  head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+EventLog::EventLog(size_t ringCapacity, uint32_t flushIntervalMs)
+    : ringCapacity_(ringCapacity), flushIntervalMs_(std::max<uint32_t>(1, flushIntervalMs)) {}
+
+EventLog::~EventLog() { stop(); }
+
+uint16_t EventLog::registerSite(std::atomic<uint16_t>& siteId, const char* file, uint32_t line,
+                                int level, const char* format) {
+  std::lock_guard<std::mutex> lock(sitesMutex_);
+  // NOTE: other thread may register site first
+  if (const uint16_t registeredId = siteId.load()) {
+    return registeredId;
+  }
+  if (sites_.size() >= UINT16_MAX) {
+    // NOTE: 0 is unknown site for decoder
+    return 0;
+  }
+  sites_.push_back(Site{file, line, level, format});
+  siteId.store(static_cast<uint16_t>(sites_.size()));
+  return siteId.load();
+}
+
+bool EventLog::start(const std::string& path) {
+  if (fd_ >= 0 || active_.load()) {
+    LOG(WARNING) << "EventLog::start: event log already started";
+    return false;
+  }
+
+  fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    LOG(WARNING) << "EventLog::start: can`t open " << path;
+    return false;
+  }
+
+  fileSize_ = 0;
+  writtenSites_ = 0;
+  rings_.clear();
+  if (!append(kFileMagic, sizeof(kFileMagic)) || !append(&kFileVersion, sizeof(kFileVersion))) {
+    LOG(WARNING) << "EventLog::start: can`t map " << path;
+    stop();
+    return false;
+  }
+
+  stopRequested_ = false;
+  startedGeneration_ = ++generation_;
+  flushThread_ = std::thread(&EventLog::runFlushThread, this);
+
+  active_.store(this, std::memory_order_release);
+  return true;
+}
+
+void EventLog::stop() {
+  EventLog* expected = this;
+  active_.compare_exchange_strong(expected, nullptr);
+
+  if (flushThread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(flushMutex_);
+      stopRequested_ = true;
+    }
+    flushCondition_.notify_one();
+    flushThread_.join();
+  }
+
+  if (fd_ < 0) {
+    return;
+  }
+
+  flush();
+
+  if (mapped_) {
+    ::munmap(mapped_, mappedSize_);
+    mapped_ = nullptr;
+    mappedSize_ = 0;
+  }
+  if (::ftruncate(fd_, static_cast<off_t>(fileSize_)) != 0) {
+    LOG(WARNING) << "EventLog::stop: can`t truncate file";
+  }
+  ::close(fd_);
+  fd_ = -1;
+}
+
+EventRing* EventLog::threadRing() {
+  struct CachedRing {
+    uint64_t generation = 0;
+    EventRing* ring = nullptr;
+  };
+  thread_local CachedRing cached;
+
+  if (cached.generation == startedGeneration_) {
+    return cached.ring;
+  }
+
+  std::lock_guard<std::mutex> lock(ringsMutex_);
+  rings_.push_back(std::make_unique<EventRing>(ringCapacity_, nextThreadIndex++));
+  cached.generation = startedGeneration_;
+  cached.ring = rings_.back().get();
+  return cached.ring;
+}
+
+void EventLog::runFlushThread() {
+  std::unique_lock<std::mutex> lock(flushMutex_);
+  while (!stopRequested_) {
+    flushCondition_.wait_for(lock, std::chrono::milliseconds(flushIntervalMs_),
+                             [this] { return stopRequested_; });
+    lock.unlock();
+    if (!flush()) {
+      LOG(WARNING) << "EventLog: can`t grow file, events are dropped";
+    }
+    lock.lock();
+  }
+}
+
+bool EventLog::flush() {
+  std::string sites;
+  {
+    std::lock_guard<std::mutex> lock(sitesMutex_);
+    for (; writtenSites_ < sites_.size(); ++writtenSites_) {
+      const Site& site = sites_[writtenSites_];
+      std::string body;
+      appendValue(body, static_cast<uint8_t>(EventRecordKind::SITE));
+      appendValue(body, static_cast<uint16_t>(writtenSites_ + 1));
+      appendValue(body, static_cast<uint8_t>(site.level));
+      appendValue(body, site.line);
+      appendString(body, site.file);
+      appendString(body, site.format);
+      appendValue(sites, static_cast<uint16_t>(sizeof(uint16_t) + body.size()));
+      sites.append(body);
+    }
+  }
+  if (!sites.empty() && !append(sites.data(), sites.size())) {
+    return false;
+  }
+
+  std::vector<EventRing*> rings;
+  {
+    std::lock_guard<std::mutex> lock(ringsMutex_);
+    rings.reserve(rings_.size());
+    for (const auto& ring : rings_) {
+      rings.push_back(ring.get());
+    }
+  }
+
+  bool ok = true;
+  for (EventRing* ring : rings) {
+    const uint32_t threadIndex = ring->threadIndex();
+    const size_t consumed = ring->consume([this, &ok, threadIndex](const EventSlot& slot) {
+      const uint16_t recordSize = static_cast<uint16_t>(kEventRecordHeaderSize + slot.size);
+      if (!ok || !reserve(recordSize)) {
+        ok = false;
+        return;
+      }
+      char* out = mapped_ + fileSize_;
+      std::memcpy(out, &recordSize, sizeof(recordSize));
+      out[2] = static_cast<char>(EventRecordKind::EVENT);
+      std::memcpy(out + 3, &threadIndex, sizeof(threadIndex));
+      std::memcpy(out + kEventRecordHeaderSize, slot.data, slot.size);
+      fileSize_ += recordSize;
+    });
+    writtenCount_.fetch_add(consumed, std::memory_order_relaxed);
+  }
+  return ok;
+}
+
+bool EventLog::append(const void* data, size_t size) {
+  if (!reserve(size)) {
+    return false;
+  }
+  std::memcpy(mapped_ + fileSize_, data, size);
+  fileSize_ += size;
+  return true;
+}
+
+bool EventLog::reserve(size_t size) {
+  if (fileSize_ + size <= mappedSize_) {
+    return true;
+  }
+  if (fd_ < 0) {
+    return false;
+  }
+
+  const size_t newSize = std::max({mappedSize_ * 2, fileSize_ + size, kMinFileGrowth});
+  if (mapped_) {
+    ::munmap(mapped_, mappedSize_);
+    mapped_ = nullptr;
+    mappedSize_ = 0;
+  }
+  if (::ftruncate(fd_, static_cast<off_t>(newSize)) != 0) {
+    return false;
+  }
+  void* mapped = ::mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+  mapped_ = static_cast<char*>(mapped);
+  mappedSize_ = newSize;
+  return true;
+}
+
+} // namespace log
+} // namespace gloer
@@ -0,0 +1,273 @@
+#pragma once
+
+/** @file
+ * @brief Binary structured event log, see GLOG_EVENT
+ *
+ * Calling thread only copies (timestamp, site id, raw args) into own ring buffer,
+ * background thread appends records to memory-mapped file.
+ * Text is rendered offline by scripts/decode_event_log.py.
+ *
+ * File format (little-endian):
+ *   header: "GLEVLOG1", u32 version
+ *   records: u16 record size (with size field), u8 kind, kind-specific body
+ *   SITE body: u16 site id, u8 level, u32 line, u16 + file, u16 + format
+ *   EVENT body: u32 thread index, u64 unix time ns, u16 site id, u8 arg count, args
+ *   arg: u8 type, value (i64, u64, f64, u8 bool or u16 + string bytes)
+ **/
+
+#include "log/Logger.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace gloer {
+namespace log {
+
+enum class EventArgType : uint8_t { INT = 1, UINT, DOUBLE, STRING, BOOL };
+
+enum class EventRecordKind : uint8_t { SITE = 1, EVENT };
+
+/**
+ * Fixed-size event slot, args that do not fit are dropped (strings are truncated).
+ * NOTE: fixed slots keep ring single-producer single-consumer without wrap handling
+ **/
+struct EventSlot {
+  static constexpr size_t kDataSize = 254;
+
+  uint16_t size = 0;
+  char data[kDataSize];
+};
+
+/**
+ * Appends event fields to slot.
+ * NOTE: args after first one that does not fit are skipped, arg count stays consistent
+ **/
+class EventSlotWriter {
+public:
+  EventSlotWriter(EventSlot& slot, uint16_t siteId);
+
+  template <typename T> void arg(const T& value) {
+    if constexpr (std::is_same_v<T, bool>) {
+      const uint8_t byte = value ? 1 : 0;
+      put(EventArgType::BOOL, &byte, sizeof(byte));
+    } else if constexpr (std::is_enum_v<T>) {
+      arg(static_cast<std::underlying_type_t<T>>(value));
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+      const int64_t number = value;
+      put(EventArgType::INT, &number, sizeof(number));
+    } else if constexpr (std::is_integral_v<T>) {
+      const uint64_t number = value;
+      put(EventArgType::UINT, &number, sizeof(number));
+    } else if constexpr (std::is_floating_point_v<T>) {
+      const double number = value;
+      put(EventArgType::DOUBLE, &number, sizeof(number));
+    } else {
+      putString(std::string_view(value));
+    }
+  }
+
+  // finishes slot, returns written size
+  uint16_t finish();
+
+private:
+  void put(EventArgType type, const void* value, size_t size);
+
+  void putString(std::string_view value);
+
+  EventSlot& slot_;
+  size_t pos_ = 0;
+  uint8_t argCount_ = 0;
+  bool full_ = false;
+};
+
+/**
+ * Per-thread ring of event slots.
+ * NOTE: lock-free, one producer (owning thread) and one consumer (flush thread)
+ **/
+class EventRing {
+public:
+  EventRing(size_t capacity, uint32_t threadIndex);
+
+  // slot for next event or nullptr if ring is full
+  EventSlot* claim();
+
+  // makes claimed slot visible to consumer
+  void publish();
+
+  // calls |func| for each published slot, returns number of consumed slots
+  template <typename Func> size_t consume(Func&& func) {
+    const size_t head = head_.load(std::memory_order_acquire);
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t count = head - tail;
+    for (; tail != head; ++tail) {
+      func(slots_[tail & mask_]);
+    }
+    tail_.store(tail, std::memory_order_release);
+    return count;
+  }
+
+  uint32_t threadIndex() const { return threadIndex_; }
+
+private:
+  std::vector<EventSlot> slots_;
+
+  const size_t mask_;
+
+  const uint32_t threadIndex_;
+
+  // written by producer
+  alignas(64) std::atomic<size_t> head_{0};
+
+  // written by consumer
+  alignas(64) std::atomic<size_t> tail_{0};
+};
+
+/**
+ * Binary event log sink, at most one is active.
+ * NOTE: call stop() only after threads writing events stopped
+ **/
+class EventLog {
+public:
+  // slots per thread ring, rounded up to power of two
+  static constexpr size_t kDefaultRingCapacity = 4096;
+
+  static constexpr uint32_t kDefaultFlushIntervalMs = 50;
+
+  explicit EventLog(size_t ringCapacity = kDefaultRingCapacity,
+                    uint32_t flushIntervalMs = kDefaultFlushIntervalMs);
+
+  ~EventLog();
+
+  EventLog(const EventLog&) = delete;
+  EventLog& operator=(const EventLog&) = delete;
+
+  // opens |path| and makes log active, returns false if file can`t be mapped
+  bool start(const std::string& path);
+
+  // flushes pending events, truncates file to written size
+  void stop();
+
+  /**
+   * Registers call site on first call, |siteId| caches id of call site.
+   * NOTE: site ids are shared by all EventLog instances
+   **/
+  static uint16_t registerSite(std::atomic<uint16_t>& siteId, const char* file, uint32_t line,
+                               int level, const char* format);
+
+  template <typename... Args>
+  static void write(std::atomic<uint16_t>& siteCache, const char* file, uint32_t line, int level,
+                    const char* format, const Args&... args) {
+    EventLog* log = active_.load(std::memory_order_acquire);
+    if (!log) {
+      return;
+    }
+    uint16_t siteId = siteCache.load(std::memory_order_relaxed);
+    if (!siteId) {
+      siteId = registerSite(siteCache, file, line, level, format);
+    }
+    EventRing* ring = log->threadRing();
+    EventSlot* slot = ring ? ring->claim() : nullptr;
+    if (!slot) {
+      log->droppedCount_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    EventSlotWriter writer(*slot, siteId);
+    (writer.arg(args), ...);
+    writer.finish();
+    ring->publish();
+  }
+
+  uint64_t writtenCount() const { return writtenCount_.load(); }
+
+  // events lost because ring of writing thread was full
+  uint64_t droppedCount() const { return droppedCount_.load(); }
+
+private:
+  struct Site {
+    std::string file;
+    uint32_t line;
+    int level;
+    std::string format;
+  };
+
+  // ring of calling thread, created on first event
+  EventRing* threadRing();
+
+  void runFlushThread();
+
+  // writes new sites and events of all rings, returns false if file can`t grow
+  bool flush();
+
+  bool append(const void* data, size_t size);
+
+  bool reserve(size_t size);
+
+  static std::atomic<EventLog*> active_;
+
+  // changes on each start, invalidates cached thread rings
+  static std::atomic<uint64_t> generation_;
+
+  static std::mutex sitesMutex_;
+
+  static std::vector<Site> sites_;
+
+  const size_t ringCapacity_;
+
+  const uint32_t flushIntervalMs_;
+
+  uint64_t startedGeneration_ = 0;
+
+  std::mutex ringsMutex_;
+
+  std::vector<std::unique_ptr<EventRing>> rings_;
+
+  // number of sites_ already written to file
+  size_t writtenSites_ = 0;
+
+  int fd_ = -1;
+
+  char* mapped_ = nullptr;
+
+  size_t mappedSize_ = 0;
+
+  size_t fileSize_ = 0;
+
+  std::thread flushThread_;
+
+  std::mutex flushMutex_;
+
+  std::condition_variable flushCondition_;
+
+  bool stopRequested_ = false;
+
+  std::atomic<uint64_t> writtenCount_{0};
+
+  std::atomic<uint64_t> droppedCount_{0};
+};
+
+} // namespace log
+} // namespace gloer
+
+/**
+ * Binary event, first arg is format, "{}" in format are replaced with next args by decoder.
+ * Args are integers, floating point numbers, bools, enums and strings.
+ * Example: GLOG_EVENT(WRTC, INFO, "session {} closed after {} ms", id, ms);
+ * NOTE: no-op without active EventLog, args are not evaluated below compile-time level
+ **/
+#define GLOG_EVENT(module, level, ...)                                                             \
+  do {                                                                                             \
+    if (GLOER_LOG_IS_ON(module, level)) {                                                          \
+      static std::atomic<uint16_t> gloerEventSiteId{0};                                            \
+      ::gloer::log::EventLog::write(gloerEventSiteId, __FILE__, __LINE__, GLOER_LOG_LEVEL_##level, \
+                                    __VA_ARGS__);                                                  \
+    }                                                                                              \
+  } while (0)
@@ -1,5 +1,6 @@
 #include "log/Logger.hpp" // IWYU pragma: associated
 #include "config/ServerConfig.hpp"
+#include "log/EventLog.hpp"
 #include "rang.hpp"
 #include "storage/path.hpp"
 
@@ -18,11 +19,66 @@
 #  endif
 #endif
 
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <sstream>
 
 namespace gloer {
 namespace log {
 
+namespace {
+
+static const char* kModuleNames[] = {"core", "ws", "wrtc", "game"};
+
+static_assert(sizeof(kModuleNames) / sizeof(kModuleNames[0]) ==
+                  static_cast<size_t>(LogModule::TOTAL),
+              "kModuleNames must match LogModule");
+
+} // namespace
+
+bool setModuleLevels(const std::string& spec) {
+  std::array<int, static_cast<size_t>(LogModule::TOTAL)> levels;
+  for (size_t i = 0; i < levels.size(); ++i) {
+    levels[i] = moduleLevel(static_cast<LogModule>(i));
+  }
+
+  std::istringstream ss(spec);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    const size_t eq = item.find('=');
+    if (eq == std::string::npos || eq + 2 != item.size() || item[eq + 1] < '0' ||
+        item[eq + 1] > '3') {
+      return false;
+    }
+    const std::string name = item.substr(0, eq);
+    size_t module = 0;
+    while (module < levels.size() && name != kModuleNames[module]) {
+      ++module;
+    }
+    if (module == levels.size()) {
+      return false;
+    }
+    levels[module] = item[eq + 1] - '0';
+  }
+
+  for (size_t i = 0; i < levels.size(); ++i) {
+    setModuleLevel(static_cast<LogModule>(i), levels[i]);
+  }
+  return true;
+}
+
+bool LogRateLimiter::allow(uint32_t intervalMs) {
+  const int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now().time_since_epoch())
+                            .count();
+  int64_t nextAllowedMs = nextAllowedMs_.load(std::memory_order_relaxed);
+  // NOTE: only one of concurrent callers wins the interval
+  return nowMs >= nextAllowedMs &&
+         nextAllowedMs_.compare_exchange_strong(nextAllowedMs, nowMs + intervalMs,
+                                                std::memory_order_relaxed);
+}
+
 struct CustomConsoleSink {
   rang::fg getLevelColor(const LEVELS level) const {
     if (level.value == WARNING.value) {
@@ -55,6 +111,12 @@ Logger::Logger(bool enableConsoleSink, bool enableFileSink)
   initLogging();
 }
 
+Logger::Logger(bool enableConsoleSink, bool enableFileSink, bool enableEventLog)
+    : enableConsoleSink_(enableConsoleSink), enableFileSink_(enableFileSink),
+      enableEventLog_(enableEventLog) {
+  initLogging();
+}
+
 Logger::~Logger() { shutDownLogging(); }
 
 void Logger::initLogging() {
@@ -74,12 +136,35 @@ void Logger::initLogging() {
     fileSinkHandle_ = logWorker_->addDefaultLogger(log_prefix_, log_directory_, log_default_id_);
   }
   g3::initializeLogging(logWorker_.get());
+
+  if (enableEventLog_) {
+    // NOTE: decode with scripts/decode_event_log.py
+    const std::string eventLogPath =
+        (::fs::path(log_directory_) / (log_prefix_ + ".evlog")).string();
+    eventLog_ = std::make_unique<EventLog>();
+    if (!eventLog_->start(eventLogPath)) {
+      LOG(WARNING) << "Logger: can`t start event log " << eventLogPath;
+      eventLog_.reset();
+    }
+  }
+
+  // runtime module levels, like GLOER_LOG_LEVELS="ws=2,wrtc=1"
+  if (const char* levels = std::getenv("GLOER_LOG_LEVELS")) {
+    if (!setModuleLevels(levels)) {
+      LOG(WARNING) << "Logger: invalid GLOER_LOG_LEVELS " << levels;
+    }
+  }
 }
 
 void Logger::shutDownLogging() {
   // NOTE: no need to call g3::internal::shutDownLogging();
   // 1 Shutdownlogging does stop the logging, sets the logging ptr to null
   // 2 G3log should be stopped with RAII or with stop hooks
+  // NOTE: event log writes own warnings to text log, stop it first
+  if (eventLog_) {
+    eventLog_->stop();
+    eventLog_.reset();
+  }
   if (logWorker_.get())
     logWorker_ = nullptr;
   if (consoleSinkHandle_.get())
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -12,11 +15,71 @@
 #include <g3log/sinkhandle.hpp>
 // IWYU pragma: end_exports
 
+/**
+ * Minimum level of GLOG* statements compiled in:
+ * 0 - DEBUG, 1 - INFO, 2 - WARNING, 3 - FATAL.
+ * Statements below it are removed by compiler, their arguments are never evaluated.
+ **/
+#ifndef GLOER_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define GLOER_LOG_MIN_LEVEL 1
+#else
+#define GLOER_LOG_MIN_LEVEL 0
+#endif // NDEBUG
+#endif // GLOER_LOG_MIN_LEVEL
+
+// 1 enables GLOG_PAYLOAD statements (message contents, SDP), debug builds only
+#ifndef GLOER_LOG_PAYLOADS
+#define GLOER_LOG_PAYLOADS 0
+#endif // GLOER_LOG_PAYLOADS
+
+#define GLOER_LOG_LEVEL_DEBUG 0
+#define GLOER_LOG_LEVEL_INFO 1
+#define GLOER_LOG_LEVEL_WARNING 2
+#define GLOER_LOG_LEVEL_FATAL 3
+
 namespace gloer {
 namespace log {
 
+/**
+ * Log modules with own runtime level
+ * NOTE: keep in sync with kModuleNames in Logger.cpp
+ **/
+enum class LogModule : uint8_t { CORE, WS, WRTC, GAME, TOTAL };
+
+namespace detail {
+// runtime minimum level of each module, DEBUG by default (only compile-time level applies)
+inline std::array<std::atomic<int>, static_cast<size_t>(LogModule::TOTAL)> moduleLevels{};
+} // namespace detail
+
+inline int moduleLevel(LogModule module) {
+  return detail::moduleLevels[static_cast<size_t>(module)].load(std::memory_order_relaxed);
+}
+
+inline void setModuleLevel(LogModule module, int level) {
+  detail::moduleLevels[static_cast<size_t>(module)].store(level, std::memory_order_relaxed);
+}
+
+/**
+ * Sets runtime levels from comma-separated list like "ws=2,wrtc=0",
+ * module names are lowercase LogModule names.
+ * Returns false and keeps levels unchanged if list is malformed.
+ **/
+bool setModuleLevels(const std::string& spec);
+
+// allows one call per interval, used by GLOG_EVERY_MS
+class LogRateLimiter {
+public:
+  bool allow(uint32_t intervalMs);
+
+private:
+  std::atomic<int64_t> nextAllowedMs_{0};
+};
+
 struct CustomConsoleSink;
 
+class EventLog;
+
 /**
  * Supported log levels: DEBUG, INFO, WARNING, FATAL
  *
@@ -24,7 +87,13 @@ struct CustomConsoleSink;
  *
  * @code{.cpp}
  * LOG(WARNING) << "This log " << "call";
+ * GLOG(WS, INFO) << "checked against compile-time and WS module level";
+ * GLOG_EVERY_N(WRTC, WARNING, 100) << "every 100th call";
+ * GLOG_EVERY_MS(WRTC, WARNING, 1000) << "at most once per second";
+ * GLOG_PAYLOAD(WS) << "only with GLOER_LOG_PAYLOADS: " << message;
  * @endcode
+ *
+ * NOTE: prefer GLOG* macros on hot paths, LOG always formats message
  **/
 class Logger {
 public:
@@ -32,6 +101,9 @@ public:
 
   Logger(bool enableConsoleSink, bool enableFileSink);
 
+  // |enableEventLog| starts binary event log next to text log, see GLOG_EVENT
+  Logger(bool enableConsoleSink, bool enableFileSink, bool enableEventLog);
+
   ~Logger();
 
   std::shared_ptr<::g3::LogWorker> getLogWorker() const;
@@ -51,6 +123,10 @@ private:
 
   bool enableFileSink_ = true;
 
+  bool enableEventLog_ = false;
+
+  std::unique_ptr<EventLog> eventLog_;
+
   std::string log_prefix_ = "wrtcServer";
 
   std::string log_directory_;
@@ -60,3 +136,34 @@ private:
 
 } // namespace log
 } // namespace gloer
+
+#define GLOER_LOG_IS_ON(module, level)                                                             \
+  (GLOER_LOG_LEVEL_##level >= GLOER_LOG_MIN_LEVEL &&                                               \
+   GLOER_LOG_LEVEL_##level >= ::gloer::log::moduleLevel(::gloer::log::LogModule::module))
+
+#define GLOG(module, level)                                                                        \
+  if (!GLOER_LOG_IS_ON(module, level)) {                                                           \
+  } else                                                                                           \
+    LOG(level)
+
+// NOTE: lambda gives each statement own counter
+#define GLOG_EVERY_N(module, level, n)                                                             \
+  if (!GLOER_LOG_IS_ON(module, level) || !([]() {                                                  \
+        static std::atomic<uint64_t> counter{0};                                                   \
+        return counter.fetch_add(1, std::memory_order_relaxed) % (n) == 0;                         \
+      })()) {                                                                                      \
+  } else                                                                                           \
+    LOG(level)
+
+#define GLOG_EVERY_MS(module, level, intervalMs)                                                   \
+  if (!GLOER_LOG_IS_ON(module, level) || !([]() {                                                  \
+        static ::gloer::log::LogRateLimiter limiter;                                               \
+        return limiter.allow(intervalMs);                                                          \
+      })()) {                                                                                      \
+  } else                                                                                           \
+    LOG(level)
+
+#define GLOG_PAYLOAD(module)                                                                       \
+  if (!(GLOER_LOG_PAYLOADS && GLOER_LOG_IS_ON(module, DEBUG))) {                                   \
+  } else                                                                                           \
+    LOG(DEBUG)
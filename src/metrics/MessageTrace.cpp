@@ -0,0 +1,156 @@
+#include "metrics/MessageTrace.hpp" // IWYU pragma: associated
+#include "metrics/Metrics.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+
+namespace gloer {
+namespace metrics {
+
+namespace {
+
+static constexpr size_t kStages = static_cast<size_t>(TraceStage::TOTAL);
+
+// name of time between previous stage and stage
+static const char* kStageNames[kStages] = {
+    "read", "read_to_dispatch", "queue_wait", "handler_to_send", "handler", "send_queue"};
+
+// time of stage is measured from this stage, READ has none
+static const TraceStage kPreviousStage[kStages] = {
+    TraceStage::READ,             TraceStage::READ,
+    TraceStage::DISPATCH_ENQUEUE, TraceStage::DISPATCH_DEQUEUE,
+    TraceStage::DISPATCH_DEQUEUE, TraceStage::SEND_ENQUEUE};
+
+static size_t roundUpToPowerOfTwo(size_t value) {
+  size_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+static uint64_t steadyTimeNs() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now().time_since_epoch())
+                                   .count());
+}
+
+} // namespace
+
+thread_local uint64_t MessageTracer::currentTrace_ = 0;
+
+MessageTracer& MessageTracer::instance() {
+  static MessageTracer tracer;
+  return tracer;
+}
+
+MessageTracer::MessageTracer(size_t capacity)
+    : slots_(new Slot[roundUpToPowerOfTwo(std::max<size_t>(capacity, 1))]),
+      mask_(roundUpToPowerOfTwo(std::max<size_t>(capacity, 1)) - 1),
+      totalHistogram_(MetricsRegistry::instance().histogram(
+          "gloer_trace_total_us", "Time from read to write of response of sampled message")) {
+  for (size_t i = 1; i < kStages; i++) {
+    stageHistograms_[i] = &MetricsRegistry::instance().histogram(
+        "gloer_trace_stage_us", "Time between pipeline stages of sampled message",
+        std::string("stage=\"") + kStageNames[i] + "\"");
+  }
+}
+
+void MessageTracer::setSampleRate(double rate) {
+  if (!(rate > 0.0)) {
+    sampleEvery_.store(0);
+    return;
+  }
+  const double every = std::round(1.0 / std::min(rate, 1.0));
+  sampleEvery_.store(static_cast<uint32_t>(std::min(every, 4294967295.0)));
+}
+
+uint64_t MessageTracer::start(const std::string& sessId) {
+  const uint64_t id = nextId_.fetch_add(1, std::memory_order_relaxed) + 1;
+  Slot& slot = slots_[id & mask_];
+
+  slot.id.store(0, std::memory_order_relaxed);
+  for (auto& stageNs : slot.stageNs) {
+    stageNs.store(0, std::memory_order_relaxed);
+  }
+  slot.sessionHash.store(std::hash<std::string>{}(sessId), std::memory_order_relaxed);
+  slot.stageNs[static_cast<size_t>(TraceStage::READ)].store(steadyTimeNs(),
+                                                             std::memory_order_relaxed);
+  slot.id.store(id, std::memory_order_release);
+  return id;
+}
+
+void MessageTracer::record(uint64_t traceId, TraceStage stage) {
+  if (!traceId || stage == TraceStage::READ || stage >= TraceStage::TOTAL) {
+    return;
+  }
+  Slot& slot = slots_[traceId & mask_];
+  if (slot.id.load(std::memory_order_acquire) != traceId) {
+    return; // overwritten by newer trace
+  }
+
+  const size_t index = static_cast<size_t>(stage);
+  const uint64_t nowNs = steadyTimeNs();
+  uint64_t expected = 0;
+  if (!slot.stageNs[index].compare_exchange_strong(expected, nowNs)) {
+    return; // e.g. second response to same message
+  }
+
+  const uint64_t previousNs =
+      slot.stageNs[static_cast<size_t>(kPreviousStage[index])].load(std::memory_order_relaxed);
+  if (previousNs && previousNs <= nowNs) {
+    stageHistograms_[index]->record((nowNs - previousNs) / 1000);
+  }
+
+  if (stage == TraceStage::WRITE_COMPLETE) {
+    const uint64_t readNs =
+        slot.stageNs[static_cast<size_t>(TraceStage::READ)].load(std::memory_order_relaxed);
+    if (readNs && readNs <= nowNs) {
+      totalHistogram_.record((nowNs - readNs) / 1000);
+    }
+  }
+}
+
+std::string MessageTracer::toChromeTraceJson() const {
+  std::string result = "{\"traceEvents\":[";
+  bool first = true;
+  char event[256];
+
+  for (size_t i = 0; i <= mask_; i++) {
+    const Slot& slot = slots_[i];
+    const uint64_t id = slot.id.load(std::memory_order_acquire);
+    if (!id) {
+      continue;
+    }
+    const uint64_t sessionHash = slot.sessionHash.load(std::memory_order_relaxed);
+
+    // one complete event per measured stage, one row per trace
+    for (size_t stage = 1; stage < kStages; stage++) {
+      const uint64_t endNs = slot.stageNs[stage].load(std::memory_order_relaxed);
+      const size_t previous = static_cast<size_t>(kPreviousStage[stage]);
+      const uint64_t beginNs = slot.stageNs[previous].load(std::memory_order_relaxed);
+      if (!endNs || !beginNs || beginNs > endNs) {
+        continue;
+      }
+      const int size = std::snprintf(
+          event, sizeof(event),
+          "%s{\"name\":\"%s\",\"cat\":\"message\",\"ph\":\"X\",\"pid\":1,\"tid\":%" PRIu64
+          ",\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"session\":\"%016" PRIx64 "\"}}",
+          first ? "" : ",", kStageNames[stage], id, static_cast<double>(beginNs) / 1000.0,
+          static_cast<double>(endNs - beginNs) / 1000.0, sessionHash);
+      if (size > 0) {
+        result.append(event, std::min(static_cast<size_t>(size), sizeof(event) - 1));
+        first = false;
+      }
+    }
+  }
+
+  result += "],\"displayTimeUnit\":\"ms\"}";
+  return result;
+}
+
+} // namespace metrics
+} // namespace gloer
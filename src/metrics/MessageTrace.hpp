@@ -0,0 +1,130 @@
+#pragma once
+
+/** @file
+ * @brief Sampled latency trace of incoming messages through read, dispatch and send path
+ *
+ * Sampled message gets trace id on read, id follows message as "current trace" of thread:
+ *   READ              WS on_read / data channel OnMessage
+ *   DISPATCH_ENQUEUE  DispatchQueue::dispatch (or FairDispatchQueue)
+ *   DISPATCH_DEQUEUE  DispatchQueue::DispatchQueued, before callback
+ *   SEND_ENQUEUE      session send() called by callback
+ *   HANDLER_END       DispatchQueue::DispatchQueued, after callback
+ *   WRITE_COMPLETE    WS write completed / data channel accepted message
+ * Time between stages is recorded into gloer_trace_stage_us histograms,
+ * last traces are exported in Chrome trace-event format (chrome://tracing, Perfetto).
+ * NOTE: not sampled message costs one relaxed load and thread-local counter increment
+ **/
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace gloer {
+namespace metrics {
+
+class Histogram;
+
+// NOTE: order of stages in message lifetime, SEND_ENQUEUE happens inside handler
+enum class TraceStage : uint8_t {
+  READ = 0,
+  DISPATCH_ENQUEUE,
+  DISPATCH_DEQUEUE,
+  SEND_ENQUEUE,
+  HANDLER_END,
+  WRITE_COMPLETE,
+  TOTAL
+};
+
+/**
+ * Ring of last sampled traces, process-wide.
+ * NOTE: slot of old trace is reused by new trace, stages of overwritten trace are ignored
+ **/
+class MessageTracer {
+public:
+  static constexpr size_t kDefaultCapacity = 4096;
+
+  static MessageTracer& instance();
+
+  explicit MessageTracer(size_t capacity = kDefaultCapacity);
+
+  MessageTracer(const MessageTracer&) = delete;
+  MessageTracer& operator=(const MessageTracer&) = delete;
+
+  // part of messages to trace: 0 disables tracing, 1 traces each message, 0.01 each 100th
+  void setSampleRate(double rate);
+
+  /**
+   * Starts trace of incoming message and records READ if message is sampled.
+   * Returns trace id or 0 if message is not sampled.
+   **/
+  uint64_t begin(const std::string& sessId) {
+    const uint32_t every = sampleEvery_.load(std::memory_order_relaxed);
+    if (!every) {
+      return 0;
+    }
+    thread_local uint32_t skipped = 0;
+    if (++skipped < every) {
+      return 0;
+    }
+    skipped = 0;
+    return start(sessId);
+  }
+
+  // records time of |stage|, only first record of each stage counts
+  void record(uint64_t traceId, TraceStage stage);
+
+  // last traces in Chrome trace-event JSON format
+  std::string toChromeTraceJson() const;
+
+  // trace of message handled by calling thread, 0 if none
+  static uint64_t current() { return currentTrace_; }
+
+  /**
+   * Makes |traceId| current trace of calling thread until destruction.
+   * Example: MessageTracer::Scope traceScope(MessageTracer::instance().begin(getId()));
+   **/
+  class Scope {
+  public:
+    explicit Scope(uint64_t traceId) : previous_(currentTrace_) { currentTrace_ = traceId; }
+
+    ~Scope() { currentTrace_ = previous_; }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    const uint64_t previous_;
+  };
+
+private:
+  struct Slot {
+    // 0 while slot is being reset
+    std::atomic<uint64_t> id{0};
+    std::atomic<uint64_t> sessionHash{0};
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(TraceStage::TOTAL)> stageNs{};
+  };
+
+  uint64_t start(const std::string& sessId);
+
+  static thread_local uint64_t currentTrace_;
+
+  std::unique_ptr<Slot[]> slots_;
+
+  const size_t mask_;
+
+  std::atomic<uint64_t> nextId_{0};
+
+  std::atomic<uint32_t> sampleEvery_{0};
+
+  // time since previous stage, by stage, nullptr for READ
+  std::array<Histogram*, static_cast<size_t>(TraceStage::TOTAL)> stageHistograms_{};
+
+  // READ to WRITE_COMPLETE
+  Histogram& totalHistogram_;
+};
+
+} // namespace metrics
+} // namespace gloer
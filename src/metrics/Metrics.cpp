@@ -0,0 +1,228 @@
+#include "metrics/Metrics.hpp" // IWYU pragma: associated
+#include "log/Logger.hpp"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace gloer {
+namespace metrics {
+
+namespace {
+
+static std::atomic<size_t> nextThreadShard{0};
+
+static const char* typeName(int type) {
+  static const char* kTypeNames[] = {"counter", "gauge", "histogram"};
+  return kTypeNames[type];
+}
+
+// name{labels} or name{labels,extra}
+static std::string seriesName(const std::string& name, const std::string& labels,
+                              const std::string& extraLabel = "") {
+  std::string result = name;
+  if (labels.empty() && extraLabel.empty()) {
+    return result;
+  }
+  result += '{';
+  result += labels;
+  if (!labels.empty() && !extraLabel.empty()) {
+    result += ',';
+  }
+  result += extraLabel;
+  result += '}';
+  return result;
+}
+
+} // namespace
+
+size_t threadShard() {
+  thread_local const size_t shard = nextThreadShard++ % kMetricShards;
+  return shard;
+}
+
+uint64_t Counter::value() const {
+  uint64_t result = 0;
+  for (const Shard& shard : shards_) {
+    result += shard.value.load(std::memory_order_relaxed);
+  }
+  return result;
+}
+
+void Gauge::set(int64_t value) {
+  shards_[0].value.store(value, std::memory_order_relaxed);
+  for (size_t i = 1; i < shards_.size(); i++) {
+    shards_[i].value.store(0, std::memory_order_relaxed);
+  }
+}
+
+int64_t Gauge::value() const {
+  int64_t result = 0;
+  for (const Shard& shard : shards_) {
+    result += shard.value.load(std::memory_order_relaxed);
+  }
+  return result;
+}
+
+uint64_t Histogram::bucketUpperBound(size_t index) {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  const size_t shift = index / kSubBuckets - 1;
+  const uint64_t lower = static_cast<uint64_t>(kSubBuckets + index % kSubBuckets) << shift;
+  return lower + ((uint64_t{1} << shift) - 1);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+  Snapshot result;
+  result.buckets.resize(kBuckets, 0);
+  for (const Shard& shard : shards_) {
+    result.count += shard.count.load(std::memory_order_relaxed);
+    result.sum += shard.sum.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < kBuckets; i++) {
+      result.buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+    }
+  }
+  return result;
+}
+
+uint64_t Histogram::Snapshot::percentile(double quantile) const {
+  uint64_t total = 0;
+  for (const uint64_t bucket : buckets) {
+    total += bucket;
+  }
+  if (!total) {
+    return 0;
+  }
+  // NOTE: count and buckets are summed separately, so rank uses buckets only
+  const uint64_t rank = std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(std::min(std::max(quantile, 0.0), 1.0) * total)));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); i++) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      return bucketUpperBound(i);
+    }
+  }
+  return bucketUpperBound(buckets.size() - 1);
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+  // NOTE: never destroyed, metrics may be updated by threads that outlive main()
+  static MetricsRegistry* registry = new MetricsRegistry();
+  return *registry;
+}
+
+MetricsRegistry::Family& MetricsRegistry::family(const std::string& name,
+                                                 const std::string& help, Type type) {
+  auto it = families_.find(name);
+  if (it == families_.end()) {
+    it = families_.emplace(name, Family{}).first;
+    it->second.type = type;
+    it->second.help = help;
+  } else if (it->second.type != type) {
+    LOG(WARNING) << "MetricsRegistry: metric " << name << " registered with other type";
+  }
+  return it->second;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help,
+                                  const std::string& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& metric = family(name, help, Type::COUNTER).counters[labels];
+  if (!metric) {
+    metric = std::make_unique<Counter>();
+  }
+  return *metric;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help,
+                              const std::string& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& metric = family(name, help, Type::GAUGE).gauges[labels];
+  if (!metric) {
+    metric = std::make_unique<Gauge>();
+  }
+  return *metric;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                      const std::string& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& metric = family(name, help, Type::HISTOGRAM).histograms[labels];
+  if (!metric) {
+    metric = std::make_unique<Histogram>();
+  }
+  return *metric;
+}
+
+uint64_t MetricsRegistry::addCallbackGauge(const std::string& name, const std::string& help,
+                                           const std::string& labels,
+                                           std::function<double()> callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint64_t id = nextCallbackId_++;
+  family(name, help, Type::GAUGE).callbacks[id] = std::make_pair(labels, std::move(callback));
+  callbackNames_[id] = name;
+  return id;
+}
+
+void MetricsRegistry::removeCallbackGauge(uint64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = callbackNames_.find(id);
+  if (it == callbackNames_.end()) {
+    return;
+  }
+  families_[it->second].callbacks.erase(id);
+  callbackNames_.erase(it);
+}
+
+std::string MetricsRegistry::toPrometheusText() const {
+  std::ostringstream out;
+
+  // NOTE: callbacks run under mutex_, they must not use registry
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& [name, family] : families_) {
+    if (family.counters.empty() && family.gauges.empty() && family.histograms.empty() &&
+        family.callbacks.empty()) {
+      continue;
+    }
+    out << "# HELP " << name << " " << family.help << "\n";
+    out << "# TYPE " << name << " " << typeName(static_cast<int>(family.type)) << "\n";
+
+    for (const auto& [labels, counter] : family.counters) {
+      out << seriesName(name, labels) << " " << counter->value() << "\n";
+    }
+    for (const auto& [labels, gauge] : family.gauges) {
+      out << seriesName(name, labels) << " " << gauge->value() << "\n";
+    }
+    for (const auto& callback : family.callbacks) {
+      out << seriesName(name, callback.second.first) << " " << callback.second.second() << "\n";
+    }
+    for (const auto& [labels, histogram] : family.histograms) {
+      const Histogram::Snapshot snapshot = histogram->snapshot();
+      // NOTE: one "le" bucket per power of two keeps output short
+      size_t last = 0;
+      for (size_t i = 0; i < snapshot.buckets.size(); i++) {
+        if (snapshot.buckets[i]) {
+          last = i;
+        }
+      }
+      const size_t lastGroupEnd = (last / Histogram::kSubBuckets + 1) * Histogram::kSubBuckets;
+      uint64_t cumulative = 0;
+      for (size_t i = 0; i < lastGroupEnd; i++) {
+        cumulative += snapshot.buckets[i];
+        if (i % Histogram::kSubBuckets == Histogram::kSubBuckets - 1) {
+          const std::string le =
+              "le=\"" + std::to_string(Histogram::bucketUpperBound(i)) + "\"";
+          out << seriesName(name + "_bucket", labels, le) << " " << cumulative << "\n";
+        }
+      }
+      out << seriesName(name + "_bucket", labels, "le=\"+Inf\"") << " " << cumulative << "\n";
+      out << seriesName(name + "_sum", labels) << " " << snapshot.sum << "\n";
+      out << seriesName(name + "_count", labels) << " " << cumulative << "\n";
+    }
+  }
+  return out.str();
+}
+
+} // namespace metrics
+} // namespace gloer
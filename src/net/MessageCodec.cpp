@@ -0,0 +1,180 @@
+#include "net/MessageCodec.hpp" // IWYU pragma: associated
+#include "algo/NetworkOperation.hpp"
+#include <rapidjson/document.h>
+
+namespace gloer {
+namespace net {
+
+const MessageCodec& MessageCodec::forType(MessageCodecType type) {
+  static const JsonCodec jsonCodec;
+  static const BinaryCodec binaryCodec;
+  return type == MessageCodecType::BINARY ? static_cast<const MessageCodec&>(binaryCodec)
+                                          : static_cast<const MessageCodec&>(jsonCodec);
+}
+
+MessageCodecType MessageCodec::detect(const std::string& data, bool isBinary) {
+  if (!isBinary && !data.empty() && data[0] == '{') {
+    return MessageCodecType::JSON;
+  }
+  return MessageCodecType::BINARY;
+}
+
+bool JsonCodec::decode(const char* data, size_t size, DecodedMessage& result) const {
+  // NOTE: only "type" field is needed, but whole document is parsed to validate message
+  rapidjson::Document document;
+  document.Parse(data, size);
+  if (document.HasParseError() || !document.IsObject()) {
+    return false;
+  }
+
+  const auto it = document.FindMember("type");
+  if (it == document.MemberEnd() || !it->value.IsString()) {
+    return false;
+  }
+
+  uint32_t opcode = 0;
+  if (!algo::Opcodes::parseOpcode(it->value.GetString(), opcode)) {
+    return false;
+  }
+
+  result.opcode = opcode;
+  result.flags = 0;
+  result.payload = data;
+  result.payloadSize = size;
+  return true;
+}
+
+std::string JsonCodec::encode(uint16_t /*opcode*/, uint16_t /*flags*/, const char* payload,
+                              size_t payloadSize) const {
+  return std::string(payload, payloadSize);
+}
+
+bool BinaryCodec::decode(const char* data, size_t size, DecodedMessage& result) const {
+  BinaryReader reader(data, size);
+
+  uint16_t opcode = 0;
+  uint16_t flags = 0;
+  uint32_t payloadSize = 0;
+  if (!reader.readU16(opcode) || !reader.readU16(flags) || !reader.readVarint(payloadSize)) {
+    return false;
+  }
+
+  // NOTE: trailing bytes after payload are malformed message too
+  const char* payload = nullptr;
+  if (!reader.readBytes(payloadSize, payload) || reader.remaining() != 0) {
+    return false;
+  }
+
+  result.opcode = opcode;
+  result.flags = flags;
+  result.payload = payload;
+  result.payloadSize = payloadSize;
+  return true;
+}
+
+std::string BinaryCodec::encode(uint16_t opcode, uint16_t flags, const char* payload,
+                                size_t payloadSize) const {
+  std::string out;
+  out.reserve(kMaxHeaderSize + payloadSize);
+  BinaryWriter writer(out);
+  writer.writeU16(opcode);
+  writer.writeU16(flags);
+  writer.writeVarint(static_cast<uint32_t>(payloadSize));
+  writer.writeBytes(payload, payloadSize);
+  return out;
+}
+
+bool BinaryReader::readU8(uint8_t& value) {
+  if (remaining() < 1) {
+    return false;
+  }
+  value = static_cast<uint8_t>(*pos_++);
+  return true;
+}
+
+bool BinaryReader::readU16(uint16_t& value) {
+  if (remaining() < 2) {
+    return false;
+  }
+  const auto* bytes = reinterpret_cast<const uint8_t*>(pos_);
+  value = static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+  pos_ += 2;
+  return true;
+}
+
+bool BinaryReader::readU32(uint32_t& value) {
+  if (remaining() < 4) {
+    return false;
+  }
+  const auto* bytes = reinterpret_cast<const uint8_t*>(pos_);
+  value = static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+          (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+  pos_ += 4;
+  return true;
+}
+
+bool BinaryReader::readVarint(uint32_t& value) {
+  uint32_t result = 0;
+  const char* pos = pos_;
+  // 5 bytes are enough for 32 bits
+  for (uint32_t shift = 0; shift < 35; shift += 7) {
+    if (pos == end_) {
+      return false;
+    }
+    const uint8_t byte = static_cast<uint8_t>(*pos++);
+    if (shift == 28 && (byte & 0xF0)) {
+      return false; // overflow
+    }
+    result |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      pos_ = pos;
+      value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool BinaryReader::readBytes(size_t size, const char*& value) {
+  if (remaining() < size) {
+    return false;
+  }
+  value = pos_;
+  pos_ += size;
+  return true;
+}
+
+void BinaryWriter::writeU8(uint8_t value) { out_.push_back(static_cast<char>(value)); }
+
+void BinaryWriter::writeU16(uint16_t value) {
+  out_.push_back(static_cast<char>(value & 0xFF));
+  out_.push_back(static_cast<char>((value >> 8) & 0xFF));
+}
+
+void BinaryWriter::writeU32(uint32_t value) {
+  for (int shift = 0; shift < 32; shift += 8) {
+    out_.push_back(static_cast<char>((value >> shift) & 0xFF));
+  }
+}
+
+void BinaryWriter::writeVarint(uint32_t value) {
+  while (value >= 0x80) {
+    out_.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  out_.push_back(static_cast<char>(value));
+}
+
+void BinaryWriter::writeBytes(const char* data, size_t size) { out_.append(data, size); }
+
+size_t BinaryWriter::varintSize(uint32_t value) {
+  size_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+} // namespace net
+} // namespace gloer
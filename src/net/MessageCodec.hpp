@@ -0,0 +1,149 @@
+#pragma once
+
+/** @file
+ * @brief Message codecs used between session message handlers and operation callbacks
+ *
+ * JSON codec - text messages with stringified numeric "type" field (default).
+ * Binary codec - fixed header followed by payload:
+ *   u16 opcode (little-endian)
+ *   u16 flags (little-endian)
+ *   varint payload length (LEB128, up to 5 bytes)
+ *   payload
+ * Codec is negotiated per session by first received message, see SessionBase::negotiateCodec
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace gloer {
+namespace net {
+
+enum class MessageCodecType : uint8_t { UNKNOWN, JSON, BINARY };
+
+/**
+ * Decoded message, does not own data.
+ * NOTE: payload points into decoded buffer, buffer must outlive DecodedMessage
+ **/
+struct DecodedMessage {
+  uint32_t opcode = 0;
+  uint16_t flags = 0;
+  const char* payload = nullptr;
+  size_t payloadSize = 0;
+};
+
+class MessageCodec {
+public:
+  virtual ~MessageCodec() {}
+
+  virtual MessageCodecType type() const = 0;
+
+  // returns false for malformed message
+  virtual bool decode(const char* data, size_t size, DecodedMessage& result) const = 0;
+
+  bool decode(const std::string& data, DecodedMessage& result) const {
+    return decode(data.data(), data.size(), result);
+  }
+
+  virtual std::string encode(uint16_t opcode, uint16_t flags, const char* payload,
+                             size_t payloadSize) const = 0;
+
+  std::string encode(uint16_t opcode, uint16_t flags, const std::string& payload) const {
+    return encode(opcode, flags, payload.data(), payload.size());
+  }
+
+  // codecs are stateless, so single instance per type is shared by all sessions
+  static const MessageCodec& forType(MessageCodecType type);
+
+  // JSON messages are text objects, everything else is treated as binary framing
+  static MessageCodecType detect(const std::string& data, bool isBinary);
+};
+
+/**
+ * Reads opcode from "type" field, payload is whole message.
+ * NOTE: encode does not wrap payload, caller already formats JSON text
+ **/
+class JsonCodec : public MessageCodec {
+public:
+  using MessageCodec::decode;
+  using MessageCodec::encode;
+
+  MessageCodecType type() const override { return MessageCodecType::JSON; }
+
+  bool decode(const char* data, size_t size, DecodedMessage& result) const override;
+
+  std::string encode(uint16_t opcode, uint16_t flags, const char* payload,
+                     size_t payloadSize) const override;
+};
+
+class BinaryCodec : public MessageCodec {
+public:
+  static constexpr size_t kMaxHeaderSize = 2 + 2 + 5;
+
+  using MessageCodec::decode;
+  using MessageCodec::encode;
+
+  MessageCodecType type() const override { return MessageCodecType::BINARY; }
+
+  bool decode(const char* data, size_t size, DecodedMessage& result) const override;
+
+  std::string encode(uint16_t opcode, uint16_t flags, const char* payload,
+                     size_t payloadSize) const override;
+};
+
+/**
+ * Zero-copy reader of binary payload fields (little-endian).
+ * NOTE: each read returns false and leaves reader unchanged if not enough data
+ **/
+class BinaryReader {
+public:
+  BinaryReader(const char* data, size_t size) : pos_(data), end_(data + size) {}
+
+  explicit BinaryReader(const DecodedMessage& message)
+      : BinaryReader(message.payload, message.payloadSize) {}
+
+  bool readU8(uint8_t& value);
+
+  bool readU16(uint16_t& value);
+
+  bool readU32(uint32_t& value);
+
+  bool readVarint(uint32_t& value);
+
+  // points |value| into payload, no copy
+  bool readBytes(size_t size, const char*& value);
+
+  size_t remaining() const { return static_cast<size_t>(end_ - pos_); }
+
+private:
+  const char* pos_;
+  const char* end_;
+};
+
+/**
+ * Appends little-endian fields to caller-owned buffer.
+ * NOTE: reserve buffer up front to encode without reallocations
+ **/
+class BinaryWriter {
+public:
+  explicit BinaryWriter(std::string& out) : out_(out) {}
+
+  void writeU8(uint8_t value);
+
+  void writeU16(uint16_t value);
+
+  void writeU32(uint32_t value);
+
+  void writeVarint(uint32_t value);
+
+  void writeBytes(const char* data, size_t size);
+
+  // size of LEB128 encoded |value|
+  static size_t varintSize(uint32_t value);
+
+private:
+  std::string& out_;
+};
+
+} // namespace net
+} // namespace gloer
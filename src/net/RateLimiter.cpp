@@ -0,0 +1,166 @@
+#include "net/RateLimiter.hpp" // IWYU pragma: associated
+#include "log/Logger.hpp"
+#include "metrics/Metrics.hpp"
+#include <algorithm>
+#include <iterator>
+
+namespace gloer {
+namespace net {
+
+namespace {
+
+// minimal size of address map before expired addresses are removed
+static constexpr size_t kMinAddressesCleanup = 64;
+
+// by RateLimitVerdict
+static const char* kVerdictNames[] = {"allow", "drop", "delay", "disconnect"};
+
+static config::RateLimitConfig limitConfig(const config::RateLimitConfig& config,
+                                           const std::string& transport, bool canDelayReads) {
+  config::RateLimitConfig result = config;
+  if (!canDelayReads && result.action == config::RateLimitAction::DELAY) {
+    LOG(WARNING) << "RateLimiter: " << transport << " can`t delay reads, messages over limit "
+                 << "are dropped";
+    result.action = config::RateLimitAction::DROP;
+  }
+  return result;
+}
+
+} // namespace
+
+TokenBucket::TokenBucket(double ratePerSec, double burstSeconds, clock::time_point now)
+    : ratePerSec_(std::max(ratePerSec, 0.0)),
+      capacity_(std::max(ratePerSec, 0.0) * std::max(burstSeconds, 0.0)), tokens_(capacity_),
+      updatedAt_(now) {}
+
+bool TokenBucket::canTake(double cost, clock::time_point now) {
+  if (!isLimited()) {
+    return true;
+  }
+  if (now > updatedAt_) {
+    const double elapsedSec = std::chrono::duration<double>(now - updatedAt_).count();
+    tokens_ = std::min(capacity_, tokens_ + elapsedSec * ratePerSec_);
+    updatedAt_ = now;
+  }
+  // NOTE: cost bigger than bucket passes when bucket is full
+  return tokens_ >= std::min(cost, capacity_);
+}
+
+void TokenBucket::take(double cost) {
+  if (isLimited()) {
+    tokens_ -= cost;
+  }
+}
+
+TokenBucket::clock::duration TokenBucket::debtDuration() const {
+  if (!isLimited() || tokens_ >= 0.0) {
+    return clock::duration::zero();
+  }
+  return std::chrono::duration_cast<clock::duration>(
+      std::chrono::duration<double>(-tokens_ / ratePerSec_));
+}
+
+SessionRateLimiter::SessionRateLimiter(const config::RateLimitConfig& config,
+                                       std::shared_ptr<AddressBuckets> addressBuckets,
+                                       const LimitedMetrics& limitedMetrics)
+    : action_(config.action),
+      messages_(config.sessionMessagesPerSec, config.burstSeconds, TokenBucket::clock::now()),
+      bytes_(config.sessionBytesPerSec, config.burstSeconds, TokenBucket::clock::now()),
+      addressBuckets_(std::move(addressBuckets)), limitedMetrics_(limitedMetrics) {}
+
+RateLimitVerdict SessionRateLimiter::check(size_t bytes, TokenBucket::clock::duration& delay) {
+  const auto now = TokenBucket::clock::now();
+  const double cost = static_cast<double>(bytes);
+
+  // NOTE: address buckets are shared with sessions on other threads
+  std::unique_lock<std::mutex> addressLock;
+  if (addressBuckets_) {
+    addressLock = std::unique_lock<std::mutex>(addressBuckets_->mutex);
+  }
+
+  bool isWithinLimits = messages_.canTake(1.0, now) && bytes_.canTake(cost, now);
+  if (isWithinLimits && addressBuckets_) {
+    isWithinLimits =
+        addressBuckets_->messages.canTake(1.0, now) && addressBuckets_->bytes.canTake(cost, now);
+  }
+
+  if (isWithinLimits || action_ == config::RateLimitAction::DELAY) {
+    messages_.take(1.0);
+    bytes_.take(cost);
+    if (addressBuckets_) {
+      addressBuckets_->messages.take(1.0);
+      addressBuckets_->bytes.take(cost);
+    }
+  }
+
+  if (isWithinLimits) {
+    return RateLimitVerdict::ALLOW;
+  }
+
+  RateLimitVerdict verdict = RateLimitVerdict::DROP;
+  if (action_ == config::RateLimitAction::DELAY) {
+    verdict = RateLimitVerdict::DELAY;
+    delay = std::max(messages_.debtDuration(), bytes_.debtDuration());
+    if (addressBuckets_) {
+      delay = std::max({delay, addressBuckets_->messages.debtDuration(),
+                        addressBuckets_->bytes.debtDuration()});
+    }
+  } else if (action_ == config::RateLimitAction::DISCONNECT) {
+    verdict = RateLimitVerdict::DISCONNECT;
+  }
+  limitedMetrics_[static_cast<size_t>(verdict)]->inc();
+  return verdict;
+}
+
+RateLimiter::RateLimiter(const config::RateLimitConfig& config, const std::string& transport,
+                         bool canDelayReads)
+    : config_(limitConfig(config, transport, canDelayReads)) {
+  // NOTE: allowed messages are counted by session metrics
+  for (size_t i = static_cast<size_t>(RateLimitVerdict::DROP); i < limitedMetrics_.size(); i++) {
+    limitedMetrics_[i] = &metrics::MetricsRegistry::instance().counter(
+        "gloer_rate_limited_total", "Incoming messages over rate limit, by action",
+        "transport=\"" + transport + "\",action=\"" + kVerdictNames[i] + "\"");
+  }
+}
+
+bool RateLimiter::isEnabled() const {
+  return config_.sessionMessagesPerSec > 0.0 || config_.sessionBytesPerSec > 0.0 ||
+         config_.addressMessagesPerSec > 0.0 || config_.addressBytesPerSec > 0.0;
+}
+
+std::unique_ptr<SessionRateLimiter>
+RateLimiter::createSessionLimiter(const std::string& address) {
+  if (!isEnabled()) {
+    return nullptr;
+  }
+
+  std::shared_ptr<SessionRateLimiter::AddressBuckets> addressBuckets;
+  if (!address.empty() &&
+      (config_.addressMessagesPerSec > 0.0 || config_.addressBytesPerSec > 0.0)) {
+    std::scoped_lock lock(addressesMutex_);
+    std::weak_ptr<SessionRateLimiter::AddressBuckets>& found = addresses_[address];
+    addressBuckets = found.lock();
+    if (!addressBuckets) {
+      const auto now = TokenBucket::clock::now();
+      addressBuckets = std::make_shared<SessionRateLimiter::AddressBuckets>();
+      addressBuckets->messages =
+          TokenBucket(config_.addressMessagesPerSec, config_.burstSeconds, now);
+      addressBuckets->bytes = TokenBucket(config_.addressBytesPerSec, config_.burstSeconds, now);
+      found = addressBuckets;
+    }
+
+    // NOTE: addresses without sessions are removed when map doubles in size
+    if (addresses_.size() >= std::max(kMinAddressesCleanup, 2 * addressesAfterCleanup_)) {
+      for (auto it = addresses_.begin(); it != addresses_.end();) {
+        it = it->second.expired() ? addresses_.erase(it) : std::next(it);
+      }
+      addressesAfterCleanup_ = addresses_.size();
+    }
+  }
+
+  return std::make_unique<SessionRateLimiter>(config_, std::move(addressBuckets),
+                                              limitedMetrics_);
+}
+
+} // namespace net
+} // namespace gloer
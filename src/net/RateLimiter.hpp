@@ -0,0 +1,145 @@
+#pragma once
+
+/** @file
+ * @brief Token-bucket limits of incoming messages per session and per remote address
+ *
+ * Each session has buckets of messages and bytes, sessions from same remote address
+ * also share buckets of that address. Message is checked on read path before parsing:
+ *   SessionRateLimiter::check(bytes, delay) -> ALLOW, DROP, DELAY or DISCONNECT
+ * NOTE: bucket allows message bigger than bucket if bucket is full, then bucket goes into debt
+ **/
+
+#include "config/ServerConfig.hpp"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace gloer {
+namespace metrics {
+class Counter;
+} // namespace metrics
+} // namespace gloer
+
+namespace gloer {
+namespace net {
+
+class TokenBucket {
+public:
+  using clock = std::chrono::steady_clock;
+
+  // unlimited bucket
+  TokenBucket() {}
+
+  // starts full, |ratePerSec| <= 0 means unlimited bucket
+  TokenBucket(double ratePerSec, double burstSeconds, clock::time_point now);
+
+  bool isLimited() const { return ratePerSec_ > 0.0; }
+
+  // refills bucket, true if |cost| tokens are available at |now|
+  bool canTake(double cost, clock::time_point now);
+
+  // takes |cost| tokens, bucket goes into debt if tokens are not available
+  void take(double cost);
+
+  // time until bucket is out of debt
+  clock::duration debtDuration() const;
+
+private:
+  double ratePerSec_ = 0.0;
+
+  double capacity_ = 0.0;
+
+  double tokens_ = 0.0;
+
+  clock::time_point updatedAt_;
+};
+
+enum class RateLimitVerdict {
+  ALLOW,
+  DROP,
+  // message is allowed, next read of session waits
+  DELAY,
+  DISCONNECT
+};
+
+/**
+ * Limits of one session, used by one thread at a time (session strand or signaling thread).
+ * Created by RateLimiter::createSessionLimiter
+ **/
+class SessionRateLimiter {
+public:
+  struct AddressBuckets {
+    std::mutex mutex;
+    TokenBucket messages;
+    TokenBucket bytes;
+  };
+
+  using LimitedMetrics = std::array<metrics::Counter*, 4>;
+
+  SessionRateLimiter(const config::RateLimitConfig& config,
+                     std::shared_ptr<AddressBuckets> addressBuckets,
+                     const LimitedMetrics& limitedMetrics);
+
+  /**
+   * Checks message of |bytes| against limits of session and its address,
+   * takes tokens if message is allowed. Sets |delay| for DELAY verdict.
+   **/
+  RateLimitVerdict check(size_t bytes, TokenBucket::clock::duration& delay);
+
+private:
+  const config::RateLimitAction action_;
+
+  TokenBucket messages_;
+
+  TokenBucket bytes_;
+
+  // nullptr if address is unknown or address limits are disabled
+  std::shared_ptr<AddressBuckets> addressBuckets_;
+
+  // by RateLimitVerdict, nullptr for ALLOW
+  const LimitedMetrics limitedMetrics_;
+};
+
+/**
+ * Limits of one transport, keeps buckets of remote addresses while sessions from them exist.
+ **/
+class RateLimiter {
+public:
+  /**
+   * |transport| labels metrics, e.g. "ws".
+   * Transport that can`t pause reads (data channel) sets |canDelayReads| to false,
+   * then DELAY action works as DROP: message is dropped and bucket doesn`t go into debt
+   **/
+  RateLimiter(const config::RateLimitConfig& config, const std::string& transport,
+              bool canDelayReads = true);
+
+  RateLimiter(const RateLimiter&) = delete;
+  RateLimiter& operator=(const RateLimiter&) = delete;
+
+  bool isEnabled() const;
+
+  /**
+   * Limiter of new session from |address|, empty |address| disables address limits.
+   * Returns nullptr if limits are disabled.
+   **/
+  std::unique_ptr<SessionRateLimiter> createSessionLimiter(const std::string& address);
+
+private:
+  const config::RateLimitConfig config_;
+
+  std::mutex addressesMutex_;
+
+  std::unordered_map<std::string, std::weak_ptr<SessionRateLimiter::AddressBuckets>> addresses_;
+
+  // size of |addresses_| after last removal of expired addresses
+  size_t addressesAfterCleanup_ = 0;
+
+  SessionRateLimiter::LimitedMetrics limitedMetrics_{};
+};
+
+} // namespace net
+} // namespace gloer
@@ -1,6 +1,9 @@
 ﻿#pragma once
 
 #include "log/Logger.hpp"
+#include "net/MessageCodec.hpp"
+#include "net/TrafficCapture.hpp"
+#include <atomic>
 #include <boost/asio.hpp>
 #include <functional>
 #include <memory>
@@ -37,6 +40,14 @@ public:
   typedef std::function<void(const session_type& sessId, const std::string& message)>
       on_message_callback;
 
+  /**
+   * same as on_message_callback, but also reports binary flag of message
+   * (WebRTC data channels can send both text and binary data)
+   **/
+  typedef std::function<void(const session_type& sessId, const std::string& message,
+                             bool isBinary)>
+      on_binary_message_callback;
+
   typedef std::function<void(const session_type& sessId)> on_close_callback;
 
   typedef uint32_t metadata_key;
@@ -53,9 +64,66 @@ public:
 
   // virtual void setExpiredCallback(); // TODO
 
-  virtual void SetOnMessageHandler(on_message_callback handler) { onMessageCallback_ = handler; }
-
-  virtual void SetOnCloseHandler(on_close_callback handler) { onCloseCallback_ = handler; }
+  /**
+   * NOTE: handlers set while TrafficCapture is active also record incoming traffic,
+   * no overhead otherwise
+   **/
+  virtual void SetOnMessageHandler(on_message_callback handler) {
+    if (handler && TrafficCapture::isActive()) {
+      handler = [handler](const session_type& sessId, const std::string& message) {
+        TrafficCapture::write(CaptureRecordKind::MESSAGE, captureTransportOf<session_type>(),
+                              static_cast<std::string>(sessId), message, /* isBinary */ false);
+        handler(sessId, message);
+      };
+    }
+    onMessageCallback_ = handler;
+  }
+
+  // NOTE: if set, called instead of on_message_callback
+  virtual void SetOnBinaryMessageHandler(on_binary_message_callback handler) {
+    if (handler && TrafficCapture::isActive()) {
+      handler = [handler](const session_type& sessId, const std::string& message, bool isBinary) {
+        TrafficCapture::write(CaptureRecordKind::MESSAGE, captureTransportOf<session_type>(),
+                              static_cast<std::string>(sessId), message, isBinary);
+        handler(sessId, message, isBinary);
+      };
+    }
+    onBinaryMessageCallback_ = handler;
+  }
+
+  virtual void SetOnCloseHandler(on_close_callback handler) {
+    if (handler && TrafficCapture::isActive()) {
+      handler = [handler](const session_type& sessId) {
+        TrafficCapture::write(CaptureRecordKind::CLOSE, captureTransportOf<session_type>(),
+                              static_cast<std::string>(sessId), std::string{},
+                              /* isBinary */ false);
+        handler(sessId);
+      };
+    }
+    onCloseCallback_ = handler;
+  }
+
+  MessageCodecType codecType() const { return codecType_.load(); }
+
+  const MessageCodec& codec() const { return MessageCodec::forType(codecType()); }
+
+  /**
+   * Sends |payload| of operation |opcode| with codec of session:
+   * JSON codec sends payload as is, binary codec adds frame header.
+   * NOTE: replies to clients must go through it, raw send() skips binary framing
+   **/
+  void sendOperation(uint32_t opcode, const std::string& payload) {
+    send(codec().encode(static_cast<uint16_t>(opcode), 0, payload));
+  }
+
+  /**
+   * First message selects codec of session, later messages must use same codec.
+   * Returns false if |type| differs from already negotiated codec.
+   **/
+  bool negotiateCodec(MessageCodecType type) {
+    MessageCodecType expected = MessageCodecType::UNKNOWN;
+    return codecType_.compare_exchange_strong(expected, type) || expected == type;
+  }
 
 protected:
   const session_type id_;
@@ -64,8 +132,12 @@ protected:
 
   on_message_callback onMessageCallback_;
 
+  on_binary_message_callback onBinaryMessageCallback_;
+
   on_close_callback onCloseCallback_;
 
+  std::atomic<MessageCodecType> codecType_{MessageCodecType::UNKNOWN};
+
   const size_t MAX_ID_LEN = 2048;
 };
 
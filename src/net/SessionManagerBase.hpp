@@ -54,6 +54,21 @@ public:
     return sessions_;
   }
 
+  /**
+   * Replaces contents of |sessions| with valid sessions, without copy of map.
+   * NOTE: reuse |sessions| between calls to avoid allocations
+   **/
+  void collectSessions(std::vector<std::shared_ptr<SessType>>& sessions) const {
+    sessions.clear();
+    std::scoped_lock lock(sessionsMutex_);
+    sessions.reserve(sessions_.size());
+    for (const auto& sessionkv : sessions_) {
+      if (sessionkv.second) {
+        sessions.push_back(sessionkv.second);
+      }
+    }
+  }
+
   virtual std::shared_ptr<SessType> getSessById(const SessGUID& sessionID);
 
   virtual bool addSession(const SessGUID& sessionID, std::shared_ptr<SessType> sess);
@@ -16,6 +16,9 @@ namespace net {
 
 class SessionPair : public SessionBase<ws::SessionGUID> {
 public:
+  // returns true if session must stop reading until resumeRead()
+  typedef std::function<bool(const ws::SessionGUID& sessId)> on_read_pause_callback;
+
   SessionPair(const ws::SessionGUID& id);
 
   virtual ~SessionPair() {}
@@ -29,6 +32,23 @@ public:
   virtual bool hasPairedWRTCSession() = 0;
 
   virtual std::weak_ptr<wrtc::WRTCSession> getWRTCSession() const = 0;
+
+  // IP address of remote peer, empty if unknown
+  virtual std::string remoteAddress() const { return ""; }
+
+  /**
+   * Asked after each handled message, e.g. when queue of handled messages is saturated.
+   * Paused session does not read, so TCP flow control slows down peer
+   **/
+  virtual void SetOnReadPauseHandler(on_read_pause_callback handler) {
+    onReadPauseCallback_ = handler;
+  }
+
+  // continues reading paused by on_read_pause_callback, may be called from any thread
+  virtual void resumeRead() {}
+
+protected:
+  on_read_pause_callback onReadPauseCallback_;
 };
 
 } // namespace net
@@ -0,0 +1,229 @@
+#include "net/TrafficCapture.hpp" // IWYU pragma: associated
+#include "log/Logger.hpp"
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+namespace gloer {
+namespace net {
+
+namespace {
+
+static constexpr char kFileMagic[] = {'G', 'L', 'C', 'A', 'P', 'T', '0', '1'};
+
+static constexpr uint32_t kFileVersion = 1;
+
+// u8 kind, u8 transport, u8 flags, u64 time
+static constexpr size_t kRecordHeaderSize = 1 + 1 + 1 + 8;
+
+static constexpr uint8_t kBinaryFlag = 1;
+
+// stdio buffer, records reach disk in large writes
+static constexpr size_t kFileBufferSize = 1024 * 1024;
+
+static uint64_t steadyTimeNs() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now().time_since_epoch())
+                                   .count());
+}
+
+} // namespace
+
+std::mutex TrafficCapture::activeMutex_;
+
+std::atomic<TrafficCapture*> TrafficCapture::active_{nullptr};
+
+TrafficCapture::~TrafficCapture() { stop(); }
+
+bool TrafficCapture::start(const std::string& path) {
+  std::scoped_lock lock(activeMutex_);
+  if (file_) {
+    LOG(WARNING) << "TrafficCapture::start: already started";
+    return false;
+  }
+
+  if (active_.load(std::memory_order_relaxed)) {
+    LOG(WARNING) << "TrafficCapture::start: other capture is active";
+    return false;
+  }
+
+  file_ = std::fopen(path.c_str(), "wb");
+  if (!file_) {
+    LOG(WARNING) << "TrafficCapture::start: can`t create " << path;
+    return false;
+  }
+  std::setvbuf(file_, nullptr, _IOFBF, kFileBufferSize);
+
+  std::fwrite(kFileMagic, 1, sizeof(kFileMagic), file_);
+  std::fwrite(&kFileVersion, 1, sizeof(kFileVersion), file_);
+  startNs_ = steadyTimeNs();
+
+  active_.store(this, std::memory_order_release);
+
+  LOG(INFO) << "TrafficCapture: writing " << path;
+  return true;
+}
+
+void TrafficCapture::stop() {
+  // NOTE: waits for running write(), later writes don`t see this capture
+  std::scoped_lock lock(activeMutex_);
+  if (active_.load(std::memory_order_relaxed) == this) {
+    active_.store(nullptr, std::memory_order_release);
+  }
+
+  if (!file_) {
+    return;
+  }
+  std::fclose(file_);
+  file_ = nullptr;
+
+  LOG(INFO) << "TrafficCapture: written " << writtenCount_.load() << " records, "
+            << writtenBytes_.load() << " bytes";
+}
+
+void TrafficCapture::write(CaptureRecordKind kind, CaptureTransport transport,
+                           const std::string& sessId, const std::string& payload,
+                           bool isBinary) {
+  if (!isActive()) {
+    return;
+  }
+
+  // capture can`t be stopped or destroyed while lock is held
+  std::scoped_lock lock(activeMutex_);
+  TrafficCapture* capture = active_.load(std::memory_order_relaxed);
+  if (!capture) {
+    return;
+  }
+  capture->append(kind, transport, sessId, payload, isBinary);
+}
+
+void TrafficCapture::append(CaptureRecordKind kind, CaptureTransport transport,
+                            const std::string& sessId, const std::string& payload,
+                            bool isBinary) {
+  if (sessId.size() > std::numeric_limits<uint16_t>::max() ||
+      payload.size() > kMaxPayloadSize) {
+    LOG(WARNING) << "TrafficCapture: skipped too big record";
+    return;
+  }
+  const uint16_t sessIdSize = static_cast<uint16_t>(sessId.size());
+  const uint32_t payloadSize = static_cast<uint32_t>(payload.size());
+
+  // NOTE: called by write() under activeMutex_
+  if (!file_) {
+    return;
+  }
+
+  // NOTE: time is taken under lock, records are ordered by time
+  const uint64_t timeNs = steadyTimeNs() - startNs_;
+
+  char header[kRecordHeaderSize];
+  header[0] = static_cast<char>(kind);
+  header[1] = static_cast<char>(transport);
+  header[2] = static_cast<char>(isBinary ? kBinaryFlag : 0);
+  std::memcpy(header + 3, &timeNs, sizeof(timeNs));
+
+  std::fwrite(header, 1, sizeof(header), file_);
+  std::fwrite(&sessIdSize, 1, sizeof(sessIdSize), file_);
+  std::fwrite(sessId.data(), 1, sessIdSize, file_);
+  std::fwrite(&payloadSize, 1, sizeof(payloadSize), file_);
+  std::fwrite(payload.data(), 1, payloadSize, file_);
+
+  writtenCount_.fetch_add(1, std::memory_order_relaxed);
+  writtenBytes_.fetch_add(sizeof(header) + sizeof(sessIdSize) + sessIdSize +
+                              sizeof(payloadSize) + payloadSize,
+                          std::memory_order_relaxed);
+}
+
+TrafficCaptureReader::~TrafficCaptureReader() {
+  if (file_) {
+    std::fclose(file_);
+  }
+}
+
+bool TrafficCaptureReader::open(const std::string& path) {
+  if (file_) {
+    std::fclose(file_);
+  }
+  failed_ = false;
+
+  file_ = std::fopen(path.c_str(), "rb");
+  if (!file_) {
+    LOG(WARNING) << "TrafficCaptureReader::open: can`t open " << path;
+    return false;
+  }
+  std::setvbuf(file_, nullptr, _IOFBF, kFileBufferSize);
+
+  char magic[sizeof(kFileMagic)];
+  uint32_t version = 0;
+  if (!read(magic, sizeof(magic)) || std::memcmp(magic, kFileMagic, sizeof(magic)) != 0 ||
+      !read(&version, sizeof(version)) || version != kFileVersion) {
+    LOG(WARNING) << "TrafficCaptureReader::open: invalid header of " << path;
+    failed_ = true;
+    return false;
+  }
+  return true;
+}
+
+bool TrafficCaptureReader::next(CaptureRecord& record) {
+  if (!file_ || failed_) {
+    return false;
+  }
+
+  char header[kRecordHeaderSize];
+  const size_t headerRead = std::fread(header, 1, sizeof(header), file_);
+  if (headerRead == 0 && std::feof(file_)) {
+    return false; // end of capture
+  }
+  if (headerRead != sizeof(header)) {
+    failed_ = true;
+    return false;
+  }
+
+  const uint8_t kind = static_cast<uint8_t>(header[0]);
+  const uint8_t transport = static_cast<uint8_t>(header[1]);
+  if (kind < static_cast<uint8_t>(CaptureRecordKind::MESSAGE) ||
+      kind > static_cast<uint8_t>(CaptureRecordKind::CLOSE) ||
+      transport < static_cast<uint8_t>(CaptureTransport::WS) ||
+      transport > static_cast<uint8_t>(CaptureTransport::WRTC)) {
+    LOG(WARNING) << "TrafficCaptureReader::next: invalid record";
+    failed_ = true;
+    return false;
+  }
+  record.kind = static_cast<CaptureRecordKind>(kind);
+  record.transport = static_cast<CaptureTransport>(transport);
+  record.isBinary = (static_cast<uint8_t>(header[2]) & kBinaryFlag) != 0;
+  std::memcpy(&record.timeNs, header + 3, sizeof(record.timeNs));
+
+  uint16_t sessIdSize = 0;
+  if (!read(&sessIdSize, sizeof(sessIdSize))) {
+    return false;
+  }
+  record.sessId.resize(sessIdSize);
+  if (!read(&record.sessId[0], sessIdSize)) {
+    return false;
+  }
+
+  uint32_t payloadSize = 0;
+  if (!read(&payloadSize, sizeof(payloadSize))) {
+    return false;
+  }
+  // NOTE: size comes from file, don`t allocate more than writer could write
+  if (payloadSize > TrafficCapture::kMaxPayloadSize) {
+    LOG(WARNING) << "TrafficCaptureReader::next: invalid payload size " << payloadSize;
+    failed_ = true;
+    return false;
+  }
+  record.payload.resize(payloadSize);
+  return read(&record.payload[0], payloadSize);
+}
+
+bool TrafficCaptureReader::read(void* data, size_t size) {
+  if (size && std::fread(data, 1, size, file_) != size) {
+    failed_ = true;
+    return false;
+  }
+  return true;
+}
+
+} // namespace net
+} // namespace gloer
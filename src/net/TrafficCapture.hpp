@@ -0,0 +1,144 @@
+#pragma once
+
+/** @file
+ * @brief Capture of incoming session traffic for offline replay
+ *
+ * Records are written by SessionBase message and close handlers while capture is active,
+ * see SessionBase::SetOnMessageHandler. Replay driver of gameserver reads them back.
+ *
+ * File format (little-endian):
+ *   header: "GLCAPT01", u32 version
+ *   record: u8 kind, u8 transport, u8 flags, u64 ns since capture start,
+ *           u16 + session id, u32 + payload (empty for CLOSE)
+ **/
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+namespace gloer {
+namespace net {
+namespace ws {
+class SessionGUID;
+} // namespace ws
+namespace wrtc {
+class SessionGUID;
+} // namespace wrtc
+} // namespace net
+} // namespace gloer
+
+namespace gloer {
+namespace net {
+
+enum class CaptureRecordKind : uint8_t { MESSAGE = 1, CLOSE };
+
+enum class CaptureTransport : uint8_t { WS = 1, WRTC };
+
+// transport of session by its id type
+template <typename session_type> constexpr CaptureTransport captureTransportOf() {
+  static_assert(std::is_same<session_type, ws::SessionGUID>::value ||
+                    std::is_same<session_type, wrtc::SessionGUID>::value,
+                "unknown session type");
+  return std::is_same<session_type, ws::SessionGUID>::value ? CaptureTransport::WS
+                                                            : CaptureTransport::WRTC;
+}
+
+struct CaptureRecord {
+  CaptureRecordKind kind = CaptureRecordKind::MESSAGE;
+  CaptureTransport transport = CaptureTransport::WS;
+  bool isBinary = false;
+  // time since capture start
+  uint64_t timeNs = 0;
+  std::string sessId;
+  std::string payload;
+};
+
+/**
+ * Append-only capture file, at most one is active.
+ * NOTE: write() holds activeMutex_ while it appends, so stop() (and destructor)
+ * returns only after running writes finished and capture may be destroyed
+ * while sessions still receive messages
+ **/
+class TrafficCapture {
+public:
+  // same as WebSocket read_message_max, bigger records are skipped
+  static constexpr uint32_t kMaxPayloadSize = 64 * 1024 * 1024;
+
+  TrafficCapture() {}
+
+  ~TrafficCapture();
+
+  TrafficCapture(const TrafficCapture&) = delete;
+  TrafficCapture& operator=(const TrafficCapture&) = delete;
+
+  // creates |path| and makes capture active, returns false if file can`t be created
+  bool start(const std::string& path);
+
+  // flushes buffered records and closes file
+  void stop();
+
+  static bool isActive() { return active_.load(std::memory_order_acquire) != nullptr; }
+
+  // appends record to active capture, no-op without active capture
+  static void write(CaptureRecordKind kind, CaptureTransport transport, const std::string& sessId,
+                    const std::string& payload, bool isBinary);
+
+  uint64_t writtenCount() const { return writtenCount_.load(); }
+
+  uint64_t writtenBytes() const { return writtenBytes_.load(); }
+
+private:
+  void append(CaptureRecordKind kind, CaptureTransport transport, const std::string& sessId,
+              const std::string& payload, bool isBinary);
+
+  // guards active_ and file_ of all captures
+  static std::mutex activeMutex_;
+
+  // NOTE: changed under activeMutex_, read without lock only by isActive()
+  static std::atomic<TrafficCapture*> active_;
+
+  FILE* file_ = nullptr;
+
+  uint64_t startNs_ = 0;
+
+  std::atomic<uint64_t> writtenCount_{0};
+
+  std::atomic<uint64_t> writtenBytes_{0};
+};
+
+/**
+ * Reads records of capture file in order.
+ * NOTE: incomplete record at end of file (capture was not stopped) is ignored
+ **/
+class TrafficCaptureReader {
+public:
+  TrafficCaptureReader() {}
+
+  ~TrafficCaptureReader();
+
+  TrafficCaptureReader(const TrafficCaptureReader&) = delete;
+  TrafficCaptureReader& operator=(const TrafficCaptureReader&) = delete;
+
+  // returns false if file can`t be opened or has invalid header
+  bool open(const std::string& path);
+
+  // returns false at end of file or on invalid record,
+  // payload bigger than TrafficCapture::kMaxPayloadSize is invalid
+  bool next(CaptureRecord& record);
+
+  // true if reading stopped on invalid or incomplete record
+  bool failed() const { return failed_; }
+
+private:
+  bool read(void* data, size_t size);
+
+  FILE* file_ = nullptr;
+
+  bool failed_ = false;
+};
+
+} // namespace net
+} // namespace gloer
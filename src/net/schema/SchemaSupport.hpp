@@ -0,0 +1,85 @@
+#pragma once
+
+/** @file
+ * @brief Helpers shared by message structs generated from *.idl files
+ * @see scripts/generate_messages.py
+ */
+
+#include "net/MessageCodec.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <rapidjson/document.h>
+#include <string>
+#include <string_view>
+
+namespace gloer {
+namespace net {
+namespace schema {
+
+namespace detail {
+
+inline std::string_view jsonString(const rapidjson::Value& value) {
+  return std::string_view(value.GetString(), value.GetStringLength());
+}
+
+template <typename Writer> bool writeJsonKey(Writer& writer, std::string_view key) {
+  return writer.Key(key.data(), static_cast<rapidjson::SizeType>(key.size()));
+}
+
+template <typename Writer> bool writeJsonString(Writer& writer, std::string_view value) {
+  return writer.String(value.data(), static_cast<rapidjson::SizeType>(value.size()));
+}
+
+inline uint32_t zigzagEncode(int32_t value) {
+  return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+inline int32_t zigzagDecode(uint32_t value) {
+  return static_cast<int32_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+inline void writeBinaryString(BinaryWriter& writer, std::string_view value) {
+  writer.writeVarint(static_cast<uint32_t>(value.size()));
+  writer.writeBytes(value.data(), value.size());
+}
+
+inline bool readBinaryString(BinaryReader& reader, std::string_view& value) {
+  uint32_t size = 0;
+  const char* data = nullptr;
+  if (!reader.readVarint(size) || !reader.readBytes(size, data)) {
+    return false;
+  }
+  value = std::string_view(data, size);
+  return true;
+}
+
+inline size_t binaryStringSize(std::string_view value) {
+  return BinaryWriter::varintSize(static_cast<uint32_t>(value.size())) + value.size();
+}
+
+} // namespace detail
+
+/**
+ * Writes {"type":"<opcode>","payload":{...}} envelope used by signaling messages
+ **/
+template <typename Writer, typename T>
+bool toJsonEnvelope(const std::string& type, const T& message, Writer& writer) {
+  return writer.StartObject() && detail::writeJsonKey(writer, "type") &&
+         detail::writeJsonString(writer, type) && detail::writeJsonKey(writer, "payload") &&
+         toJson(message, writer) && writer.EndObject();
+}
+
+/**
+ * Reads "payload" member of envelope
+ **/
+template <typename T> bool fromJsonPayload(const rapidjson::Value& envelope, T& message) {
+  if (!envelope.IsObject()) {
+    return false;
+  }
+  const auto it = envelope.FindMember("payload");
+  return it != envelope.MemberEnd() && fromJson(it->value, message);
+}
+
+} // namespace schema
+} // namespace net
+} // namespace gloer
@@ -54,14 +54,9 @@ WRTCInputCallbacks::WRTCInputCallbacks() {}
 
 WRTCInputCallbacks::~WRTCInputCallbacks() {}
 
-std::map<WRTCNetworkOperation, WRTCNetworkOperationCallback>
-WRTCInputCallbacks::getCallbacks() const {
-  return operationCallbacks_;
-}
-
 void WRTCInputCallbacks::addCallback(const WRTCNetworkOperation& op,
                                      const WRTCNetworkOperationCallback& cb) {
-  operationCallbacks_[op] = cb;
+  operationCallbacks_[op.operationCode_._to_integral()] = cb;
 }
 
 } // namespace wrtc
@@ -175,8 +175,6 @@ public:
 
   ~WRTCInputCallbacks();
 
-  std::map<WRTCNetworkOperation, WRTCNetworkOperationCallback> getCallbacks() const override;
-
   void addCallback(const WRTCNetworkOperation& op, const WRTCNetworkOperationCallback& cb) override;
 };
 
@@ -113,6 +113,7 @@ void DCO::OnStateChange() {
       if (spt) {
         RTC_DCHECK(spt->isDataChannelOpen() == true);
         // spt->onDataChannelOpen();
+        spt->onSetupStage_s(SessionSetupStage::CHANNEL_OPEN);
       }
 
       ////////
@@ -180,30 +181,23 @@ void DCO::OnBufferedAmountChange(uint64_t /* previous_amount */) {
 
 // Message received.
 void DCO::OnMessage(const webrtc::DataBuffer& buffer) {
-  const std::string data = std::string(buffer.data.data<char>(), buffer.size());
-  LOG(WARNING) << std::this_thread::get_id() << ":"
-               << "DCO::OnMessage = " << data;
+  GLOG(WRTC, DEBUG) << std::this_thread::get_id() << ":"
+                    << "DCO::OnMessage " << (buffer.binary ? "binary" : "text")
+                    << " of size = " << buffer.size();
+  GLOG_PAYLOAD(WRTC) << "DCO::OnMessage = "
+                     << std::string(buffer.data.data<char>(), buffer.size());
 
   if (!nm_->getRunner()) {
     LOG(WARNING) << "empty m_observer";
     return;
   }
 
-  // TODO if (buffer->binary)
-  /*
-    std::unique_ptr<webrtc::DataBuffer> protectedBuffer(new webrtc::DataBuffer(buffer));
-    callOnMainThread([protectedClient = makeRef(*m_client), buffer = WTFMove(protectedBuffer)] {
-        const char* data = reinterpret_cast<const char*>(buffer->data.data<char>());
-        if (buffer->binary)
-            protectedClient->didReceiveRawData(data, buffer->size());
-        else
-            protectedClient->didReceiveStringData(String::fromUTF8(data, buffer->size()));
-    });
-   */
+  // NOTE: binary flag passed to WRTCSession with buffer,
+  // see onBinaryMessageCallback_ in WRTCSession::onDataChannelMessage
 
   auto spt = wrtcSess_.lock();
-  const auto wrtcSessId = spt->getId();
   if (spt) {
+    const auto wrtcSessId = spt->getId();
     if (spt->isClosing()) {
       // session is closing...
       nm_->sessionManager().unregisterSession(wrtcSessId);
@@ -288,12 +282,9 @@ void PCO::OnIceCandidate(const webrtc::IceCandidateInterface* candidate) {
     return;
   }
 
-  RTC_DCHECK(wrtcSess.get() != nullptr);
-  if (wrtcSess.get()) {
-    wrtcSess->updateDataChannelState();
-  }
+  wrtcSess->updateDataChannelState();
 
-  WRTCSession::onIceCandidate(nm_, wsSession_.lock(), wsConnId_, candidate);
+  wrtcSess->onIceCandidate(candidate);
 }
 
 void PCO::OnSignalingChange(webrtc::PeerConnectionInterface::SignalingState new_state) {
@@ -471,6 +462,11 @@ void PCO::OnIceConnectionChange(webrtc::PeerConnectionInterface::IceConnectionSt
       //             << static_cast<std::string>(webrtcConnId_);
       // nm_->getRunner()->unregisterSession(webrtcConnId_); // use needClose
 
+      if (new_state == webrtc::PeerConnectionInterface::kIceConnectionConnected ||
+          new_state == webrtc::PeerConnectionInterface::kIceConnectionCompleted) {
+        wrtcSess->onSetupStage_s(SessionSetupStage::ICE_CONNECTED);
+      }
+
       if (needClose) {
         // LOG(WARNING) << "PCO::OnIceConnectionChange: closed session with id = " << static_cast<std::string>(webrtcConnId_);
         // wrtcSess->close_s(false); // called from unregisterSession
@@ -503,6 +499,11 @@ void PCO::OnIceGatheringChange(webrtc::PeerConnectionInterface::IceGatheringStat
   }
   case webrtc::PeerConnectionInterface::kIceGatheringComplete: {
     state = "kIceGatheringComplete";
+    // no more candidates, don`t wait for end of batch window
+    std::shared_ptr<WRTCSession> wrtcSess = nm_->sessionManager().getSessById(webrtcConnId_);
+    if (wrtcSess) {
+      wrtcSess->flushIceCandidates_s();
+    }
     break;
   }
   default:
@@ -0,0 +1,301 @@
+#include "net/wrtc/PeerFactoryContext.hpp" // IWYU pragma: associated
+#include "log/Logger.hpp"
+#include "metrics/Metrics.hpp"
+#include <string>
+#include <thread>
+#include <webrtc/api/peerconnectioninterface.h>
+#include <algorithm>
+#include <webrtc/p2p/base/basicpacketsocketfactory.h>
+#include <webrtc/p2p/client/basicportallocator.h>
+#include <webrtc/rtc_base/asyncinvoker.h>
+#include <webrtc/rtc_base/checks.h>
+#include <webrtc/rtc_base/network.h>
+#include <webrtc/rtc_base/thread.h>
+
+namespace {
+
+// NOTE: ServerConfig::validate rejects bad range before server starts,
+// here it falls back to default ports instead of aborting on network thread
+static bool IsValidPortRange(uint16_t min_port, uint16_t max_port) {
+  if (min_port > max_port) {
+    LOG(WARNING) << "Invalid WebRTC port range " << min_port << "-" << max_port
+                 << ", using default ports";
+    return false;
+  }
+  return min_port != 0 && max_port != 0;
+}
+
+static gloer::metrics::Counter& allocatorPoolMetric(const char* result) {
+  return gloer::metrics::MetricsRegistry::instance().counter(
+      "gloer_wrtc_port_allocator_pool_total", "Port allocators requested by sessions",
+      std::string("result=\"") + result + "\"");
+}
+
+/**
+ * BasicNetworkManager that reports only whitelisted network interfaces
+ * NOTE: empty whitelist means all interfaces
+ **/
+class WhitelistNetworkManager : public rtc::BasicNetworkManager {
+public:
+  explicit WhitelistNetworkManager(const std::vector<std::string>& whitelist)
+      : whitelist_(whitelist) {}
+
+  void GetNetworks(NetworkList* networks) const override {
+    rtc::BasicNetworkManager::GetNetworks(networks);
+    if (whitelist_.empty()) {
+      return;
+    }
+    networks->erase(std::remove_if(networks->begin(), networks->end(),
+                                   [this](const rtc::Network* network) {
+                                     return std::find(whitelist_.begin(), whitelist_.end(),
+                                                      network->name()) == whitelist_.end();
+                                   }),
+                    networks->end());
+  }
+
+private:
+  const std::vector<std::string> whitelist_;
+};
+
+} // namespace
+
+namespace gloer {
+namespace net {
+namespace wrtc {
+
+PeerFactoryContext::PeerFactoryContext(size_t index, bool networkThreadWithSocketServer,
+                                       const PortAllocatorConf& portAllocatorConf)
+    : index_(index), networkThreadWithSocketServer_(networkThreadWithSocketServer),
+      portAllocatorConf_(portAllocatorConf) {}
+
+PeerFactoryContext::~PeerFactoryContext() {
+  LOG(INFO) << "destroyed PeerFactoryContext " << index_;
+}
+
+bool PeerFactoryContext::init() {
+  RTC_DCHECK(!peerConnectionFactory_.get());
+  RTC_DCHECK(!signalingThread_);
+  RTC_DCHECK(!workerThread_);
+  RTC_DCHECK(!networkThread_);
+  RTC_DCHECK(!socketFactory_.get());
+
+  const std::string suffix = std::to_string(index_ + 1);
+
+  // @see
+  // github.com/pristineio/webrtc-mirror/blob/7a5bcdffaab90a05bc1146b2b1ea71c004e54d71/webrtc/rtc_base/thread.cc
+  networkThread_ = networkThreadWithSocketServer_ ? rtc::Thread::CreateWithSocketServer()
+                                                  : rtc::Thread::Create();
+  networkThread_->SetName("network_thread" + suffix, nullptr);
+  // NOTE: check will be executed regardless of compilation mode.
+  RTC_CHECK(networkThread_->Start()) << "Failed to start network_thread" << suffix;
+  LOG(INFO) << "Started network_thread" << suffix;
+
+  workerThread_ = rtc::Thread::Create();
+  workerThread_->SetName("worker_thread" + suffix, nullptr);
+  RTC_CHECK(workerThread_->Start()) << "Failed to start worker_thread" << suffix;
+  LOG(INFO) << "Started worker_thread" << suffix;
+
+  signalingThread_ = rtc::Thread::Create();
+  signalingThread_->SetName("signaling_thread" + suffix, nullptr);
+  RTC_CHECK(signalingThread_->Start()) << "Failed to start signaling_thread" << suffix;
+  LOG(INFO) << "Started signaling_thread" << suffix;
+
+  RTCNetworkManager_.reset(new WhitelistNetworkManager(portAllocatorConf_.networkWhitelist));
+
+  socketFactory_.reset(new rtc::BasicPacketSocketFactory(networkThread_.get()));
+
+  // NOTE: NetworkManager lives on the network thread.
+  // Enumerate interfaces once and keep updating, so port allocators of new sessions
+  // get cached network list instead of enumerating interfaces per session.
+  networkThread_->Invoke<void>(RTC_FROM_HERE, [this]() { RTCNetworkManager_->StartUpdating(); });
+
+  invoker_ = std::make_unique<rtc::AsyncInvoker>();
+  if (portAllocatorConf_.poolSize > 0) {
+    // warm up pool before first clients, allocators wait for enumerated networks
+    networkThread_->Invoke<void>(RTC_FROM_HERE, [this]() { scheduleAllocatorPoolRefill_n(); });
+  }
+
+  const bool hasPCF = workerThread_->Invoke<bool>(RTC_FROM_HERE, [this]() {
+    rtc::CritScope lock(&pcfMutex_);
+    // @see
+    // github.com/sourcey/libsourcey/blob/master/src/webrtc/src/peerfactorycontext.cpp#L53
+    peerConnectionFactory_ = webrtc::CreateModularPeerConnectionFactory(
+        networkThread_.get(), workerThread_.get(), signalingThread_.get(), nullptr, nullptr,
+        nullptr);
+
+    if (peerConnectionFactory_.get() == nullptr) {
+      LOG(WARNING) << "Error: Could not create CreatePeerConnectionFactory.";
+      return false;
+    }
+
+    LOG(INFO) << "Created PeerConnectionFactory " << index_;
+    return true;
+  });
+
+  return hasPCF;
+}
+
+void PeerFactoryContext::finish() {
+  LOG(INFO) << std::this_thread::get_id() << ":"
+            << "PeerFactoryContext::finish " << index_;
+
+  if (sessionsCount_.load() != 0) {
+    LOG(WARNING) << "PeerFactoryContext::finish: still used by sessions: " << sessionsCount_.load();
+  }
+
+  {
+    rtc::CritScope lock(&pcfMutex_);
+    if (peerConnectionFactory_.get() == nullptr) {
+      LOG(WARNING) << "Error: Invalid CreatePeerConnectionFactory.";
+    }
+    peerConnectionFactory_ = nullptr;
+  }
+
+  // cancels pending refills of allocator pool
+  invoker_.reset();
+
+  // network manager and socket factory must be destroyed on the network thread
+  if (networkThread_.get()) {
+    networkThread_->Invoke<void>(RTC_FROM_HERE, [this]() {
+      // pooled allocators use network manager and socket factory
+      allocatorPool_.clear();
+      if (RTCNetworkManager_) {
+        RTCNetworkManager_->StopUpdating();
+      }
+      RTCNetworkManager_.reset();
+      socketFactory_.reset();
+    });
+  }
+
+  // Never call Stop on the current thread.  Instead use the inherited Quit
+  // function which will exit the base MessageQueue without terminating the
+  // underlying OS thread.
+  if (networkThread_.get())
+    networkThread_->Quit();
+  if (signalingThread_.get())
+    signalingThread_->Quit();
+  if (workerThread_.get())
+    workerThread_->Quit();
+}
+
+std::unique_ptr<cricket::BasicPortAllocator> PeerFactoryContext::createPortAllocator_n() {
+  RTC_DCHECK_RUN_ON(networkThread());
+
+  if (portAllocatorConf_.poolSize == 0) {
+    return newPortAllocator_n();
+  }
+
+  static gloer::metrics::Counter& poolHits = allocatorPoolMetric("hit");
+  static gloer::metrics::Counter& poolMisses = allocatorPoolMetric("miss");
+
+  std::unique_ptr<cricket::BasicPortAllocator> portAllocator;
+  if (!allocatorPool_.empty()) {
+    portAllocator = std::move(allocatorPool_.front());
+    allocatorPool_.pop_front();
+    poolHits.inc();
+  } else {
+    // burst drained pool, new allocator gathers while session is created
+    portAllocator = newPortAllocator_n();
+    poolMisses.inc();
+  }
+
+  scheduleAllocatorPoolRefill_n();
+  return portAllocator;
+}
+
+void PeerFactoryContext::releasePortAllocator(
+    std::unique_ptr<cricket::BasicPortAllocator> portAllocator) {
+  if (!portAllocator) {
+    return;
+  }
+
+  if (!networkThread()->IsCurrent()) {
+    // NOTE: Invoke is blocking, so |portAllocator| can be captured by reference
+    networkThread()->Invoke<void>(RTC_FROM_HERE, [&portAllocator] { portAllocator.reset(); });
+    return;
+  }
+
+  portAllocator.reset();
+}
+
+void PeerFactoryContext::scheduleAllocatorPoolRefill_n() {
+  RTC_DCHECK_RUN_ON(networkThread());
+
+  if (isAllocatorRefillPending_ || !invoker_) {
+    return;
+  }
+  isAllocatorRefillPending_ = true;
+  // NOTE: refill runs after current task, so session setup is not delayed by it
+  invoker_->AsyncInvoke<void>(RTC_FROM_HERE, networkThread_.get(), [this]() {
+    isAllocatorRefillPending_ = false;
+    refillAllocatorPool_n();
+  });
+}
+
+void PeerFactoryContext::refillAllocatorPool_n() {
+  RTC_DCHECK_RUN_ON(networkThread());
+
+  while (allocatorPool_.size() < portAllocatorConf_.poolSize) {
+    auto portAllocator = newPortAllocator_n();
+    if (!portAllocator) {
+      return;
+    }
+    allocatorPool_.push_back(std::move(portAllocator));
+  }
+}
+
+std::unique_ptr<cricket::BasicPortAllocator> PeerFactoryContext::newPortAllocator_n() {
+  RTC_DCHECK_RUN_ON(networkThread());
+
+  RTC_DCHECK(RTCNetworkManager_.get() != nullptr);
+  RTC_DCHECK(socketFactory_.get() != nullptr);
+  if (!RTCNetworkManager_ || !socketFactory_) {
+    LOG(WARNING) << "PeerFactoryContext::createPortAllocator_n: invalid "
+                    "RTCNetworkManager_ or socketFactory_";
+    return nullptr;
+  }
+
+  auto portAllocator = std::make_unique<cricket::BasicPortAllocator>(RTCNetworkManager_.get(),
+                                                                     socketFactory_.get());
+
+  // This doesn't make everything go on one port, but should limit the number.
+  // If you don't expect many concurrent connections you can open only a small range of ports.
+  if (IsValidPortRange(portAllocatorConf_.minPort, portAllocatorConf_.maxPort)) {
+    portAllocator->SetPortRange(portAllocatorConf_.minPort, portAllocatorConf_.maxPort);
+  }
+
+  // TODO: more setting for portAllocator
+  // https://github.com/mobhuyan/webrtc/blob/98a867ccd2af391267d0568f279dd3274e623f81/pc/peerconnection.cc#L4232
+
+  if (!portAllocatorConf_.enumerateNetworkInterfaces) {
+    portAllocator->set_flags(portAllocator->flags() |
+                             cricket::PORTALLOCATOR_DISABLE_ADAPTER_ENUMERATION);
+  }
+
+  if (portAllocatorConf_.hostCandidatesOnly) {
+    portAllocator->set_flags(portAllocator->flags() | cricket::PORTALLOCATOR_DISABLE_STUN |
+                             cricket::PORTALLOCATOR_DISABLE_RELAY |
+                             cricket::PORTALLOCATOR_DISABLE_TCP);
+  }
+
+  if (portAllocatorConf_.poolSize > 0) {
+    // same flags as PeerConnection adds in InitializePortAllocator_n,
+    // pooled session is gathered with them before PeerConnection exists
+    portAllocator->set_flags(portAllocator->flags() |
+                             cricket::PORTALLOCATOR_ENABLE_SHARED_SOCKET |
+                             cricket::PORTALLOCATOR_ENABLE_IPV6 |
+                             cricket::PORTALLOCATOR_ENABLE_IPV6_ON_WIFI);
+    portAllocator->Initialize();
+    // starts gathering, PeerConnection keeps pooled session if its
+    // ice_candidate_pool_size and ICE servers are the same
+    portAllocator->SetConfiguration(portAllocatorConf_.stunServers,
+                                    portAllocatorConf_.turnServers, kPooledSessionsPerAllocator,
+                                    /* prune_turn_ports */ false);
+  }
+
+  return portAllocator;
+}
+
+} // namespace wrtc
+} // namespace net
+} // namespace gloer
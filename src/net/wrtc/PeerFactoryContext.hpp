@@ -0,0 +1,169 @@
+#pragma once
+
+/**
+ * \note PeerConnectionFactory with its own network/worker/signaling threads.
+ * WRTCServer may own several contexts to spread DTLS/SCTP work across cores.
+ **/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include <webrtc/api/peerconnectioninterface.h>
+#include <webrtc/p2p/base/portallocator.h>
+#include <webrtc/rtc_base/criticalsection.h>
+#include <webrtc/rtc_base/scoped_ref_ptr.h>
+
+namespace rtc {
+class AsyncInvoker;
+class Thread;
+class NetworkManager;
+class PacketSocketFactory;
+} // namespace rtc
+
+namespace cricket {
+class BasicPortAllocator;
+} // namespace cricket
+
+namespace gloer {
+namespace net {
+namespace wrtc {
+
+// settings shared by all port allocators of PeerFactoryContext
+struct PortAllocatorConf {
+  // UDP port range for ICE candidates, 0 means any port
+  uint16_t minPort = 0;
+  uint16_t maxPort = 0;
+
+  // names of network interfaces used for ICE candidates, empty means all
+  std::vector<std::string> networkWhitelist;
+
+  // if false, gathers candidates only on the default route
+  bool enumerateNetworkInterfaces = true;
+
+  // disables STUN, TURN and TCP candidates, see ServerConfig::wrtcHostCandidatesOnly_
+  bool hostCandidatesOnly = false;
+
+  // allocators kept gathering candidates ahead of new sessions, 0 disables pool
+  uint32_t poolSize = 0;
+
+  // ICE servers of RTCConfiguration, PeerConnection discards candidates of pooled
+  // allocator gathered with other servers
+  cricket::ServerAddresses stunServers;
+  std::vector<cricket::RelayServerConfig> turnServers;
+};
+
+// @see
+// github.com/sourcey/libsourcey/blob/master/src/webrtc/include/scy/webrtc/peerfactorycontext.h
+class PeerFactoryContext {
+public:
+  // candidates gathered ahead by pooled allocator, taken by first transport of PeerConnection.
+  // NOTE: RTCConfiguration::ice_candidate_pool_size must be the same
+  static constexpr int kPooledSessionsPerAllocator = 1;
+
+  PeerFactoryContext(size_t index, bool networkThreadWithSocketServer,
+                     const PortAllocatorConf& portAllocatorConf);
+
+  ~PeerFactoryContext();
+
+  // starts threads and creates PeerConnectionFactory
+  bool init();
+
+  // releases PeerConnectionFactory and stops threads
+  void finish();
+
+  size_t index() const { return index_; }
+
+  /**
+   * Returns port allocator on top of shared RTCNetworkManager_ and socketFactory_.
+   * Network enumeration is done once per PeerFactoryContext and cached,
+   * see RTCNetworkManager_->StartUpdating() in init().
+   * If pool is enabled, allocator is taken from pool with candidates already gathered
+   * (PeerConnection takes them as pooled session, see ice_candidate_pool_size)
+   * and pool is refilled in background.
+   * NOTE: PeerConnection takes ownership of port allocator and binds own sockets,
+   * so one allocator can`t serve several sessions.
+   **/
+  std::unique_ptr<cricket::BasicPortAllocator> createPortAllocator_n()
+      RTC_RUN_ON(networkThread());
+
+  /**
+   * Destroys port allocator that was not passed to PeerConnection.
+   * NOTE: allocator lives on the network thread and must be destroyed there,
+   * blocks caller until it is destroyed.
+   **/
+  void releasePortAllocator(std::unique_ptr<cricket::BasicPortAllocator> portAllocator);
+
+  rtc::Thread* signalingThread() const { return signalingThread_.get(); }
+
+  rtc::Thread* workerThread() const { return workerThread_.get(); }
+
+  rtc::Thread* networkThread() const { return networkThread_.get(); }
+
+  // number of alive WRTCSessions created by this context, used for load balancing
+  uint32_t sessionsCount() const { return sessionsCount_.load(); }
+
+  void addSessionCount(uint32_t count) { sessionsCount_ += count; }
+
+  void subSessionCount(uint32_t count) { sessionsCount_ -= count; }
+
+public:
+  // @see
+  // github.com/sourcey/libsourcey/blob/master/src/webrtc/src/peerfactorycontext.cpp
+  std::unique_ptr<rtc::NetworkManager> RTCNetworkManager_;
+
+  std::unique_ptr<rtc::PacketSocketFactory> socketFactory_;
+
+  rtc::CriticalSection pcfMutex_; // TODO: to private
+
+  // The peer conncetion factory that sets up signaling and worker threads. It
+  // is also used to create the PeerConnection.
+  rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface>
+      peerConnectionFactory_ RTC_GUARDED_BY(pcfMutex_);
+
+private:
+  // configured allocator, with pool enabled it starts gathering of pooled session
+  std::unique_ptr<cricket::BasicPortAllocator> newPortAllocator_n() RTC_RUN_ON(networkThread());
+
+  void scheduleAllocatorPoolRefill_n() RTC_RUN_ON(networkThread());
+
+  void refillAllocatorPool_n() RTC_RUN_ON(networkThread());
+
+  const size_t index_;
+
+  const bool networkThreadWithSocketServer_;
+
+  const PortAllocatorConf portAllocatorConf_;
+
+  std::unique_ptr<rtc::Thread> networkThread_;
+
+  /*
+   * The worker thread is delegated resource-intensive tasks
+   * such as media streaming to ensure that the signaling thread doesn’t get
+   * blocked
+   */
+  std::unique_ptr<rtc::Thread> workerThread_;
+
+  // All PeerConnection callbacks will be made on the signaling thread.
+  std::unique_ptr<rtc::Thread> signalingThread_;
+
+  std::atomic<uint32_t> sessionsCount_{0};
+
+  // posts refills of allocatorPool_ to network thread
+  std::unique_ptr<rtc::AsyncInvoker> invoker_;
+
+  // NOTE: accessed only on network thread
+  std::deque<std::unique_ptr<cricket::BasicPortAllocator>> allocatorPool_;
+
+  // NOTE: accessed only on network thread
+  bool isAllocatorRefillPending_ = false;
+
+  RTC_DISALLOW_COPY_AND_ASSIGN(PeerFactoryContext);
+};
+
+} // namespace wrtc
+} // namespace net
+} // namespace gloer
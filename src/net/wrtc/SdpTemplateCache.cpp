@@ -0,0 +1,213 @@
+#include "net/wrtc/SdpTemplateCache.hpp" // IWYU pragma: associated
+#include <string_view>
+#include <utility>
+
+namespace gloer {
+namespace net {
+namespace wrtc {
+
+namespace {
+
+static constexpr std::string_view kOrigin = "o=";
+static constexpr std::string_view kConnection = "c=";
+static constexpr std::string_view kIceUfrag = "a=ice-ufrag:";
+static constexpr std::string_view kIcePwd = "a=ice-pwd:";
+static constexpr std::string_view kFingerprint = "a=fingerprint:";
+static constexpr std::string_view kCandidate = "a=candidate:";
+static constexpr std::string_view kEndOfCandidates = "a=end-of-candidates";
+
+static bool startsWith(std::string_view line, std::string_view prefix) {
+  return line.compare(0, prefix.size(), prefix) == 0;
+}
+
+// calls |func| with line without line ending and line ending ("\r\n", "\n" or empty)
+template <typename Func> static void forEachLine(const std::string& sdp, Func&& func) {
+  const std::string_view text(sdp);
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t end = text.find('\n', pos);
+    std::string_view ending = "\n";
+    if (end == std::string_view::npos) {
+      end = text.size();
+      ending = "";
+    }
+    std::string_view line = text.substr(pos, end - pos);
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+      ending = "\r\n";
+    }
+    func(line, ending);
+    pos = end + 1;
+  }
+}
+
+// per-session lines of offer, shape does not depend on them
+static bool isPerSessionLine(std::string_view line) {
+  return startsWith(line, kOrigin) || startsWith(line, kConnection) ||
+         startsWith(line, kIceUfrag) || startsWith(line, kIcePwd) ||
+         startsWith(line, kFingerprint) || startsWith(line, kCandidate) ||
+         startsWith(line, kEndOfCandidates);
+}
+
+static bool containsLine(const std::string& sdp, std::string_view prefix,
+                         const std::string& value) {
+  std::string line;
+  line.reserve(prefix.size() + value.size() + 2);
+  line.append(prefix.data(), prefix.size()).append(value).append("\r\n");
+  return sdp.find(line) != std::string::npos;
+}
+
+} // namespace
+
+SdpTemplateCache::SdpTemplateCache(size_t maxShapes) : maxShapes_(maxShapes) {}
+
+std::string SdpTemplateCache::offerShape(const std::string& offerSdp) {
+  std::string shape;
+  shape.reserve(offerSdp.size());
+  forEachLine(offerSdp, [&shape](std::string_view line, std::string_view /*ending*/) {
+    if (line.empty() || isPerSessionLine(line)) {
+      return;
+    }
+    shape.append(line.data(), line.size()).push_back('\n');
+  });
+  return shape;
+}
+
+bool SdpTemplateCache::makeTemplate(const std::string& answerSdp, Template& result) {
+  bool hasOrigin = false;
+  bool hasUfrag = false;
+  bool hasPwd = false;
+  bool hasFingerprint = false;
+
+  std::vector<Segment>& segments = result.segments;
+  const auto addLiteral = [&segments](std::string_view text) {
+    if (text.empty()) {
+      return;
+    }
+    if (segments.empty() || segments.back().kind != Segment::LITERAL) {
+      segments.push_back(Segment{Segment::LITERAL, std::string()});
+    }
+    segments.back().literal.append(text.data(), text.size());
+  };
+  const auto addValue = [&segments](Segment::Kind kind) {
+    segments.push_back(Segment{kind, std::string()});
+  };
+
+  forEachLine(answerSdp, [&](std::string_view line, std::string_view ending) {
+    if (startsWith(line, kCandidate) || startsWith(line, kEndOfCandidates)) {
+      // candidates are trickled separately
+      return;
+    }
+    if (startsWith(line, kOrigin)) {
+      // o=<username> <sess-id> <sess-version> <nettype> <addrtype> <unicast-address>
+      const size_t idBegin = line.find(' ');
+      const size_t idEnd =
+          idBegin == std::string_view::npos ? idBegin : line.find(' ', idBegin + 1);
+      if (idEnd != std::string_view::npos) {
+        addLiteral(line.substr(0, idBegin + 1));
+        addValue(Segment::SESSION_ID);
+        addLiteral(line.substr(idEnd));
+        addLiteral(ending);
+        hasOrigin = true;
+        return;
+      }
+    }
+    const std::pair<std::string_view, Segment::Kind> values[] = {
+        {kIceUfrag, Segment::ICE_UFRAG},
+        {kIcePwd, Segment::ICE_PWD},
+        {kFingerprint, Segment::FINGERPRINT}};
+    for (const auto& value : values) {
+      if (startsWith(line, value.first)) {
+        addLiteral(value.first);
+        addValue(value.second);
+        addLiteral(ending);
+        hasUfrag |= value.second == Segment::ICE_UFRAG;
+        hasPwd |= value.second == Segment::ICE_PWD;
+        hasFingerprint |= value.second == Segment::FINGERPRINT;
+        return;
+      }
+    }
+    addLiteral(line);
+    addLiteral(ending);
+  });
+
+  return hasOrigin && hasUfrag && hasPwd && hasFingerprint;
+}
+
+bool SdpTemplateCache::learn(const std::string& shape, const std::string& answerSdp) {
+  Template answerTemplate;
+  if (!makeTemplate(answerSdp, answerTemplate)) {
+    return false;
+  }
+
+  rtc::CritScope lock(&templatesMutex_);
+  if (templates_.size() >= maxShapes_ && templates_.find(shape) == templates_.end()) {
+    return false;
+  }
+  templates_[shape] = std::move(answerTemplate);
+  return true;
+}
+
+bool SdpTemplateCache::render(const std::string& shape, const SdpAnswerParams& params,
+                              std::string& answerSdp) {
+  rtc::CritScope lock(&templatesMutex_);
+  const auto it = templates_.find(shape);
+  if (it == templates_.end()) {
+    misses_++;
+    return false;
+  }
+  hits_++;
+
+  const Template& answerTemplate = it->second;
+  const auto valueOf = [&params](const Segment& segment) -> const std::string& {
+    switch (segment.kind) {
+    case Segment::SESSION_ID:
+      return params.sessionId;
+    case Segment::ICE_UFRAG:
+      return params.iceUfrag;
+    case Segment::ICE_PWD:
+      return params.icePwd;
+    case Segment::FINGERPRINT:
+      return params.fingerprint;
+    default:
+      return segment.literal;
+    }
+  };
+
+  // NOTE: exact size first, so answer is rendered without reallocations
+  size_t answerSize = 0;
+  for (const Segment& segment : answerTemplate.segments) {
+    answerSize += valueOf(segment).size();
+  }
+  answerSdp.clear();
+  answerSdp.reserve(answerSize);
+  for (const Segment& segment : answerTemplate.segments) {
+    answerSdp.append(valueOf(segment));
+  }
+  return true;
+}
+
+bool SdpTemplateCache::validate(const std::string& answerSdp, const SdpAnswerParams& params) {
+  if (answerSdp.compare(0, 4, "v=0\r") != 0 || answerSdp.find("\r\nm=") == std::string::npos) {
+    return false;
+  }
+  if (params.sessionId.empty() || params.iceUfrag.empty() || params.icePwd.empty() ||
+      params.fingerprint.empty()) {
+    return false;
+  }
+  if (answerSdp.find(std::string(" ") + params.sessionId + " ") == std::string::npos) {
+    return false;
+  }
+  return containsLine(answerSdp, kIceUfrag, params.iceUfrag) &&
+         containsLine(answerSdp, kIcePwd, params.icePwd) &&
+         containsLine(answerSdp, kFingerprint, params.fingerprint);
+}
+
+size_t SdpTemplateCache::size() const {
+  rtc::CritScope lock(&templatesMutex_);
+  return templates_.size();
+}
+
+} // namespace wrtc
+} // namespace net
+} // namespace gloer
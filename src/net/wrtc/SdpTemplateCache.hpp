@@ -0,0 +1,84 @@
+#pragma once
+
+/**
+ * \note answer SDP templates keyed by offer shape.
+ * Offers from the same client build differ only in per-session values
+ * (origin, ICE credentials, DTLS fingerprint, candidates), so answers to them differ only
+ * in per-session values too. First answer to each offer shape is produced by regular
+ * CreateAnswer and stored as template, next answers are rendered by substitution.
+ **/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <webrtc/rtc_base/criticalsection.h>
+#include <webrtc/rtc_base/thread_annotations.h>
+
+namespace gloer {
+namespace net {
+namespace wrtc {
+
+// per-session values substituted into answer template
+struct SdpAnswerParams {
+  std::string sessionId;
+  std::string iceUfrag;
+  std::string icePwd;
+  // algorithm and value, like "sha-256 AB:CD:..."
+  std::string fingerprint;
+};
+
+// NOTE: thread-safe, shared by signaling threads of all PeerConnectionFactory instances
+class SdpTemplateCache {
+public:
+  explicit SdpTemplateCache(size_t maxShapes);
+
+  // offer without per-session lines, equal shapes receive equal answers
+  static std::string offerShape(const std::string& offerSdp);
+
+  // stores template made from |answerSdp| created by CreateAnswer for offer of |shape|,
+  // returns false if answer has no per-session values to substitute or cache is full
+  bool learn(const std::string& shape, const std::string& answerSdp);
+
+  // returns false if no template known for |shape|
+  bool render(const std::string& shape, const SdpAnswerParams& params,
+              std::string& answerSdp);
+
+  // checks that rendered answer is complete and carries |params|
+  static bool validate(const std::string& answerSdp, const SdpAnswerParams& params);
+
+  size_t size() const;
+
+  uint64_t hits() const { return hits_.load(); }
+
+  uint64_t misses() const { return misses_.load(); }
+
+private:
+  struct Segment {
+    enum Kind { LITERAL, SESSION_ID, ICE_UFRAG, ICE_PWD, FINGERPRINT };
+    Kind kind;
+    std::string literal;
+  };
+
+  struct Template {
+    std::vector<Segment> segments;
+  };
+
+  static bool makeTemplate(const std::string& answerSdp, Template& result);
+
+  const size_t maxShapes_;
+
+  mutable rtc::CriticalSection templatesMutex_;
+
+  std::map<std::string, Template> templates_ RTC_GUARDED_BY(templatesMutex_);
+
+  std::atomic<uint64_t> hits_{0};
+
+  std::atomic<uint64_t> misses_{0};
+};
+
+} // namespace wrtc
+} // namespace net
+} // namespace gloer
@@ -37,7 +37,7 @@ namespace wrtc {
  * @param id id of session to be removed
  */
 void SessionManager::unregisterSession(const wrtc::SessionGUID& id) {
-  LOG(WARNING) << "unregisterSession for id = " << static_cast<std::string>(id);
+  GLOG(WRTC, INFO) << "unregisterSession for id = " << static_cast<std::string>(id);
   /*if (!signalingThread()->IsCurrent()) {
     return signalingThread()->Invoke<void>(RTC_FROM_HERE,
                                            [this, id] { return unregisterSession(id); });
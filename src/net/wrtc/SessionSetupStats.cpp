@@ -0,0 +1,51 @@
+#include "net/wrtc/SessionSetupStats.hpp" // IWYU pragma: associated
+#include <sstream>
+
+namespace gloer {
+namespace net {
+namespace wrtc {
+
+void SessionSetupStats::record(const SessionSetupStage& stage, uint64_t latencyUs) {
+  if (stage._to_integral() >= SessionSetupStage::TOTAL) {
+    return;
+  }
+
+  AtomicStageLatency& latency = stages_[stage._to_integral()];
+  latency.count++;
+  latency.totalUs += latencyUs;
+
+  uint64_t prevMax = latency.maxUs.load();
+  while (prevMax < latencyUs && !latency.maxUs.compare_exchange_weak(prevMax, latencyUs)) {
+  }
+}
+
+StageLatency SessionSetupStats::get(const SessionSetupStage& stage) const {
+  StageLatency result;
+  if (stage._to_integral() >= SessionSetupStage::TOTAL) {
+    return result;
+  }
+
+  const AtomicStageLatency& latency = stages_[stage._to_integral()];
+  result.count = latency.count.load();
+  result.totalUs = latency.totalUs.load();
+  result.maxUs = latency.maxUs.load();
+  return result;
+}
+
+std::string SessionSetupStats::toString() const {
+  std::ostringstream ss;
+  for (const SessionSetupStage stage : SessionSetupStage::_values()) {
+    if (stage == +SessionSetupStage::TOTAL) {
+      continue;
+    }
+    const StageLatency latency = get(stage);
+    const uint64_t avgUs = latency.count ? latency.totalUs / latency.count : 0;
+    ss << stage._to_string() << ": count=" << latency.count << " avg_us=" << avgUs
+       << " max_us=" << latency.maxUs << "; ";
+  }
+  return ss.str();
+}
+
+} // namespace wrtc
+} // namespace net
+} // namespace gloer
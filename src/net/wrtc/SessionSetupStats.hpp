@@ -0,0 +1,56 @@
+#pragma once
+
+/**
+ * \note latency of WebRTC connection establishment stages,
+ * all stages measured from the moment client offer was received via WebSocket.
+ **/
+
+#include <enum.h>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace gloer {
+namespace net {
+namespace wrtc {
+
+/**
+ * SETUP_STARTED - offer left bounded setup queue
+ * ANSWER_SENT - answer sent to client via WebSocket
+ * ICE_CONNECTED - ICE connected, DTLS handshake not finished yet
+ * CHANNEL_OPEN - DTLS and SCTP are up, data channel open, session ready for game data
+ **/
+BETTER_ENUM(SessionSetupStage, uint32_t, SETUP_STARTED, ANSWER_SENT, ICE_CONNECTED,
+            CHANNEL_OPEN, TOTAL)
+
+struct StageLatency {
+  uint64_t count = 0;
+  uint64_t totalUs = 0;
+  uint64_t maxUs = 0;
+};
+
+// NOTE: lock-free, may be used from signaling threads of all PeerConnectionFactory instances
+class SessionSetupStats {
+public:
+  void record(const SessionSetupStage& stage, uint64_t latencyUs);
+
+  StageLatency get(const SessionSetupStage& stage) const;
+
+  // human-readable summary of all stages
+  std::string toString() const;
+
+private:
+  struct AtomicStageLatency {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> totalUs{0};
+    std::atomic<uint64_t> maxUs{0};
+  };
+
+  std::array<AtomicStageLatency, static_cast<size_t>(SessionSetupStage::TOTAL)> stages_;
+};
+
+} // namespace wrtc
+} // namespace net
+} // namespace gloer
@@ -4,13 +4,18 @@
 #include "algo/StringUtils.hpp"
 #include "config/ServerConfig.hpp"
 #include "log/Logger.hpp"
+#include "metrics/MessageTrace.hpp"
+#include "metrics/Metrics.hpp"
 #include "net/NetworkManagerBase.hpp"
+#include "net/schema/Messages.generated.hpp"
 #include "net/wrtc/Observers.hpp"
+#include "net/wrtc/PeerFactoryContext.hpp"
 #include "net/wrtc/WRTCSession.hpp"
 #include "net/wrtc/wrtc.hpp"
 #include "net/SessionPair.hpp"
 #include <api/call/callfactoryinterface.h>
 #include <api/jsep.h>
+#include <algorithm>
 #include <boost/beast/http.hpp>
 #include <boost/beast/websocket.hpp>
 #include <iostream>
@@ -27,6 +32,7 @@
 #include <webrtc/media/base/mediaengine.h>
 #include <webrtc/p2p/base/basicpacketsocketfactory.h>
 #include <webrtc/p2p/client/basicportallocator.h>
+#include <webrtc/pc/iceserverparsing.h>
 #include <webrtc/pc/peerconnectionfactory.h>
 #include <webrtc/rtc_base/asyncinvoker.h>
 #include <webrtc/rtc_base/bind.h>
@@ -38,6 +44,7 @@
 #include <webrtc/rtc_base/scoped_ref_ptr.h>
 #include <webrtc/rtc_base/ssladapter.h>
 #include <webrtc/rtc_base/thread.h>
+#include <webrtc/rtc_base/timeutils.h>
 /*
 namespace rtc {
 
@@ -77,8 +84,9 @@ static void pingCallback(std::shared_ptr<WRTCSession> clientSession, net::WRTCNe
   std::string dataCopy = *messageBuffer.get();
 
   // const std::string incomingStr = beast::buffers_to_string(messageBuffer->data());
-  LOG(INFO) << std::this_thread::get_id() << ":"
-            << "pingCallback incomingMsg=" << dataCopy;
+  GLOG_EVERY_MS(WRTC, INFO, 1000) << std::this_thread::get_id() << ":"
+                                  << "pingCallback";
+  GLOG_PAYLOAD(WRTC) << "pingCallback incomingMsg=" << dataCopy;
 
   // send same message back (ping-pong)
   if (clientSession && clientSession.get() && clientSession->isDataChannelOpen() &&
@@ -126,8 +134,9 @@ static void serverTimeCallback(std::shared_ptr<WRTCSession> clientSession, net::
   std::string dataCopy = *messageBuffer.get();
 
   // const std::string incomingStr = beast::buffers_to_string(messageBuffer->data());
-  LOG(INFO) << std::this_thread::get_id() << ":"
-            << "serverTimeCallback incomingMsg=" << dataCopy;
+  GLOG_EVERY_MS(WRTC, INFO, 1000) << std::this_thread::get_id() << ":"
+                                  << "serverTimeCallback";
+  GLOG_PAYLOAD(WRTC) << "serverTimeCallback incomingMsg=" << dataCopy;
 
   std::chrono::system_clock::time_point nowTp = std::chrono::system_clock::now();
   std::time_t t = std::chrono::system_clock::to_time_t(nowTp);
@@ -136,9 +145,22 @@ static void serverTimeCallback(std::shared_ptr<WRTCSession> clientSession, net::
   msg += std::ctime(&t);
 
   // send same message back (ping-pong)
+  // NOTE: JSON codec sends text as is, binary codec adds frame header
   if (clientSession && clientSession.get() && clientSession->isDataChannelOpen() &&
       !clientSession->isExpired())
-    clientSession->send(msg);
+    clientSession->sendOperation((+algo::WRTC_OPCODE::SERVER_TIME)._to_integral(), msg);
+}
+
+static metrics::Counter& setupRejectedMetric() {
+  static metrics::Counter& counter = metrics::MetricsRegistry::instance().counter(
+      "gloer_wrtc_setup_rejected_total", "Offers dropped because session setup queue was full");
+  return counter;
+}
+
+static metrics::Histogram& certGenTimeMetric() {
+  static metrics::Histogram& histogram = metrics::MetricsRegistry::instance().histogram(
+      "gloer_wrtc_cert_gen_us", "DTLS certificate generation time");
+  return histogram;
 }
 
 } // namespace
@@ -146,7 +168,30 @@ static void serverTimeCallback(std::shared_ptr<WRTCSession> clientSession, net::
 // call from main thread
 WRTCServer::WRTCServer(net::WRTCNetworkManager* nm, const gloer::config::ServerConfig& serverConfig, wrtc::SessionManager& sm)
     : nm_(nm), webrtcConf_(webrtc::PeerConnectionInterface::RTCConfiguration()),
-      webrtcGamedataOpts_(webrtc::PeerConnectionInterface::RTCOfferAnswerOptions()), sm_(sm) {
+      webrtcGamedataOpts_(webrtc::PeerConnectionInterface::RTCOfferAnswerOptions()), sm_(sm),
+      peerFactoriesCount_(serverConfig.wrtcFactories_),
+      peerFactoryPolicy_(serverConfig.wrtcFactoryPolicy_), hostCandidatesOnly_(serverConfig.wrtcHostCandidatesOnly_),
+      candidateBatchMs_(serverConfig.wrtcCandidateBatchMs_),
+      maxMessageBytes_(serverConfig.wrtcMaxMessageBytes_),
+      rateLimiter_(serverConfig.wrtcRateLimit_, "wrtc", /* canDelayReads */ false),
+      certPoolSize_(serverConfig.wrtcCertPoolSize_),
+      maxConcurrentSessionSetups_(
+          std::max<uint32_t>(1, serverConfig.wrtcMaxConcurrentSessionSetups_)),
+      maxQueuedSessionSetups_(serverConfig.wrtcMaxQueuedSessionSetups_) {
+
+  if (serverConfig.traceSampleRate_ > 0.0) {
+    metrics::MessageTracer::instance().setSampleRate(serverConfig.traceSampleRate_);
+  }
+
+  if (serverConfig.wrtcSdpTemplateCacheSize_) {
+    sdpTemplateCache_ = std::make_unique<SdpTemplateCache>(serverConfig.wrtcSdpTemplateCacheSize_);
+  }
+
+  portAllocatorConf_.minPort = serverConfig.wrtcMinPort_;
+  portAllocatorConf_.maxPort = serverConfig.wrtcMaxPort_;
+  portAllocatorConf_.networkWhitelist = serverConfig.wrtcNetworkWhitelist_;
+  portAllocatorConf_.enumerateNetworkInterfaces = serverConfig.wrtcEnumerateNetworks_;
+  portAllocatorConf_.hostCandidatesOnly = hostCandidatesOnly_;
 
   // @see
   // webrtc.googlesource.com/src/+/master/examples/objcnativeapi/objc/objc_call_client.mm#63
@@ -203,8 +248,66 @@ WRTCServer::WRTCServer(net::WRTCNetworkManager* nm, const gloer::config::ServerC
     // TODO ice_server.password = kTurnPassword;
     // TODO
     // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
-    resetWebRtcConfig_t(
-        {ice_servers[0], ice_servers[1], ice_servers[2], ice_servers[3], ice_servers[4]});
+    if (hostCandidatesOnly_) {
+      // server has public address, STUN servers not needed
+      resetWebRtcConfig_t({});
+    } else {
+      resetWebRtcConfig_t(
+          {ice_servers[0], ice_servers[1], ice_servers[2], ice_servers[3], ice_servers[4]});
+    }
+  }
+
+  portAllocatorConf_.poolSize = serverConfig.wrtcPortAllocatorPoolSize_;
+  if (portAllocatorConf_.poolSize > 0) {
+    // PeerConnection takes candidates of pooled allocator only with same pool size and servers
+    webrtcConf_.ice_candidate_pool_size = PeerFactoryContext::kPooledSessionsPerAllocator;
+    if (webrtc::ParseIceServers(webrtcConf_.servers, &portAllocatorConf_.stunServers,
+                                &portAllocatorConf_.turnServers) != webrtc::RTCErrorType::NONE) {
+      LOG(WARNING) << "WRTCServer: invalid ICE servers, port allocator pool disabled";
+      portAllocatorConf_.poolSize = 0;
+      webrtcConf_.ice_candidate_pool_size = 0;
+    }
+  }
+
+  registerMetrics();
+}
+
+void WRTCServer::registerMetrics() {
+  auto& registry = metrics::MetricsRegistry::instance();
+
+  metricsCallbacks_.push_back(registry.addCallbackGauge(
+      "gloer_wrtc_certificates_generated", "DTLS certificates generated", "",
+      [this]() { return static_cast<double>(getCertGenStats().generatedCount); }));
+  metricsCallbacks_.push_back(registry.addCallbackGauge(
+      "gloer_wrtc_certificate_pool_misses", "Sessions that found DTLS certificate pool empty", "",
+      [this]() { return static_cast<double>(getCertGenStats().poolMissCount); }));
+
+  for (const SessionSetupStage stage : SessionSetupStage::_values()) {
+    if (stage == +SessionSetupStage::TOTAL) {
+      continue;
+    }
+    const std::string labels = std::string("stage=\"") + stage._to_string() + "\"";
+    metricsCallbacks_.push_back(registry.addCallbackGauge(
+        "gloer_wrtc_setup_stage_count", "Sessions that reached setup stage", labels,
+        [this, stage]() { return static_cast<double>(sessionSetupStats_.get(stage).count); }));
+    metricsCallbacks_.push_back(registry.addCallbackGauge(
+        "gloer_wrtc_setup_stage_avg_us", "Avg. latency of setup stage since offer", labels,
+        [this, stage]() {
+          const StageLatency latency = sessionSetupStats_.get(stage);
+          return latency.count ? static_cast<double>(latency.totalUs) / latency.count : 0.0;
+        }));
+    metricsCallbacks_.push_back(registry.addCallbackGauge(
+        "gloer_wrtc_setup_stage_max_us", "Max. latency of setup stage since offer", labels,
+        [this, stage]() { return static_cast<double>(sessionSetupStats_.get(stage).maxUs); }));
+  }
+
+  if (sdpTemplateCache_) {
+    metricsCallbacks_.push_back(registry.addCallbackGauge(
+        "gloer_wrtc_sdp_template_hits", "Answers rendered from SDP template", "",
+        [this]() { return static_cast<double>(sdpTemplateCache_->hits()); }));
+    metricsCallbacks_.push_back(registry.addCallbackGauge(
+        "gloer_wrtc_sdp_template_misses", "Offers without SDP template", "",
+        [this]() { return static_cast<double>(sdpTemplateCache_->misses()); }));
   }
 }
 
@@ -216,16 +319,25 @@ void WRTCServer::addCallback(const WRTCNetworkOperation& op,
 WRTCServer::~WRTCServer() { // TODO: virtual
   LOG(INFO) << "destroyed WRTCServer";
 
+  for (const uint64_t id : metricsCallbacks_) {
+    metrics::MetricsRegistry::instance().removeCallbackGauge(id);
+  }
+
   // auto call Quit()?
 }
 
 std::string WRTCServer::sessionDescriptionStrFromJson(const rapidjson::Document& message_object) {
-  LOG(INFO) << std::this_thread::get_id() << ":"
-            << "sessionDescriptionStrFromJson";
+  GLOG(WRTC, DEBUG) << std::this_thread::get_id() << ":"
+                    << "sessionDescriptionStrFromJson";
 
-  std::string sdp = message_object["payload"]["sdp"].GetString();
-  LOG(WARNING) << "sdp = " << sdp;
-  return sdp;
+  schema::SessionDescription payload;
+  if (!schema::fromJsonPayload(message_object, payload)) {
+    LOG(WARNING) << "sessionDescriptionStrFromJson: ignored malformed session description";
+    return "";
+  }
+  GLOG(WRTC, INFO) << "sessionDescriptionStrFromJson: sdp size = " << payload.sdp.size();
+  GLOG_PAYLOAD(WRTC) << "sdp = " << payload.sdp;
+  return std::string(payload.sdp);
 }
 
 void WRTCServer::InitAndRun_t() {
@@ -233,11 +345,8 @@ void WRTCServer::InitAndRun_t() {
 
   RTC_DCHECK_RUN_ON(&thread_checker_);
 
-  RTC_DCHECK(!peerConnectionFactory_.get());
-  RTC_DCHECK(!signaling_thread_);
-  RTC_DCHECK(!worker_thread_);
-  RTC_DCHECK(!network_thread_);
-  RTC_DCHECK(!socketFactory_.get());
+  RTC_DCHECK(peerFactories_.empty());
+  RTC_DCHECK_GT(peerFactoriesCount_, 0);
 
   LOG(INFO) << std::this_thread::get_id() << ":"
             << "WRTCServer::InitAndRun";
@@ -250,68 +359,26 @@ void WRTCServer::InitAndRun_t() {
     LOG(WARNING) << "Error in InitializeSSL()";
   }
 
-  // @see
-  // github.com/pristineio/webrtc-mirror/blob/7a5bcdffaab90a05bc1146b2b1ea71c004e54d71/webrtc/rtc_base/thread.cc
-  owned_networkThread_ = networkThreadWithSocketServer_
-                             ? rtc::Thread::CreateWithSocketServer()
-                             : rtc::Thread::Create(); // reset(new rtc::Thread());
-  owned_networkThread_->SetName("network_thread1", nullptr);
-  network_thread_ = owned_networkThread_.get();
-  /*if (!network_thread_->IsCurrent()) {
-    // @see github.com/modulesio/webrtc/blob/master/pc/channelmanager.cc#L132
-    LOG(INFO) << "Running network_thread with SetAllowBlockingCalls = false";
-    // Do not allow invoking calls to other threads on the network thread.
-    network_thread_->Invoke<void>(RTC_FROM_HERE,
-                                  [&] { network_thread_->SetAllowBlockingCalls(false); });
-  }*/
-  // NOTE: check will be executed regardless of compilation mode.
-  RTC_CHECK(owned_networkThread_->Start()) << "Failed to start network_thread";
-  LOG(INFO) << "Started network_thread";
-
-  owned_workerThread_ = rtc::Thread::Create();
-  owned_workerThread_->SetName("worker_thread1", nullptr);
-  worker_thread_ = owned_workerThread_.get();
-  // NOTE: check will be executed regardless of compilation mode.
-  RTC_CHECK(owned_workerThread_->Start()) << "Failed to start worker_thread";
-  LOG(INFO) << "Started worker_thread";
-
-  owned_signalingThread_ = rtc::Thread::Create();
-  owned_signalingThread_->SetName("signaling_thread1", nullptr);
-  signaling_thread_ = owned_signalingThread_.get();
-  // NOTE: check will be executed regardless of compilation mode.
-  RTC_CHECK(owned_signalingThread_->Start()) << "Failed to start signaling_thread";
-  LOG(INFO) << "Started signaling_thread";
-
-  RTCNetworkManager_.reset(new rtc::BasicNetworkManager());
-
-  socketFactory_.reset(new rtc::BasicPacketSocketFactory(owned_networkThread_.get()));
-
-  const bool hasPCI = owned_workerThread_->Invoke<bool>(RTC_FROM_HERE, [this]() {
-    rtc::CritScope lock(&pcfMutex_);
-    // @see
-    // github.com/sourcey/libsourcey/blob/master/src/webrtc/src/peerfactorycontext.cpp#L53
-    peerConnectionFactory_ = webrtc::CreateModularPeerConnectionFactory(
-        owned_networkThread_.get(), owned_workerThread_.get(), owned_signalingThread_.get(),
-        nullptr, nullptr, nullptr);
-
-    // TODO: pass other settings e.t.c.
-    // @see
-    // github.com/sourcey/libsourcey/blob/master/src/webrtc/src/peerfactorycontext.cpp#L53
-    /*peerConnectionFactory_ = webrtc::CreateModularPeerConnectionFactory(nullptr, nullptr, nullptr,
-                                                                      nullptr, nullptr, nullptr);*/
-
-    LOG(INFO) << "Created PeerConnectionFactory";
-    if (peerConnectionFactory_.get() == nullptr) {
+  // each PeerConnectionFactory gets own network, worker and signaling thread
+  for (uint32_t i = 0; i < std::max(peerFactoriesCount_, 1u); i++) {
+    auto peerFactory = std::make_unique<PeerFactoryContext>(i, networkThreadWithSocketServer_,
+                                                            portAllocatorConf_);
+    if (!peerFactory->init()) {
       LOG(WARNING) << "Error: Could not create CreatePeerConnectionFactory.";
-      return false;
+      return;
     }
+    peerFactories_.push_back(std::move(peerFactory));
+  }
 
-    return true;
-  });
+  LOG(INFO) << "Created " << peerFactories_.size() << " PeerConnectionFactory instances";
 
-  if (!hasPCI) {
-    LOG(WARNING) << "Error: Could not create CreatePeerConnectionFactory.";
-    return;
+  if (certPoolSize_ > 0) {
+    certThread_ = rtc::Thread::Create();
+    certThread_->SetName("cert_thread", nullptr);
+    RTC_CHECK(certThread_->Start()) << "Failed to start cert_thread";
+    LOG(INFO) << "Started cert_thread";
+    // warm up pool before first clients
+    scheduleCertPoolRefill();
   }
 
   /*rtc::Thread* signalingThread = rtc::Thread::Current();
@@ -368,6 +435,14 @@ void WRTCServer::resetWebRtcConfig_t(
   // TODO: more webrtcConf_ settings
   // github.com/WebKit/webkit/blob/master/Source/ThirdParty/libwebrtc/Source/webrtc/pc/peerconnection.cc#L3117
 
+  if (hostCandidatesOnly_) {
+    // single transport (and port) per peer:
+    // data channel only, everything bundled, RTCP multiplexed
+    webrtcConf_.bundle_policy = webrtc::PeerConnectionInterface::kBundlePolicyMaxBundle;
+    webrtcConf_.rtcp_mux_policy = webrtc::PeerConnectionInterface::kRtcpMuxPolicyRequire;
+    webrtcConf_.tcp_candidate_policy = webrtc::PeerConnectionInterface::kTcpCandidatePolicyDisabled;
+  }
+
   // @see w3c.github.io/webrtc-pc/#rtcconfiguration-dictionary
   // set servers
   webrtcConf_.servers.clear();
@@ -460,30 +535,34 @@ void WRTCServer::finish() {
   /*LOG(INFO) << std::this_thread::get_id() << ":"
             << "WRTCServer::Quit4";*/
 
+  LOG(INFO) << "WRTCServer: session setup latency: " << sessionSetupStats_.toString();
+
   {
-    rtc::CritScope lock(&pcfMutex_);
-    if (peerConnectionFactory_.get() == nullptr) {
-      LOG(WARNING) << "Error: Invalid CreatePeerConnectionFactory.";
-      return;
+    rtc::CritScope lock(&sessionSetupMutex_);
+    if (!sessionSetupQueue_.empty()) {
+      LOG(WARNING) << "WRTCServer::finish: dropped queued session setups: "
+                   << sessionSetupQueue_.size();
     }
-    peerConnectionFactory_ = nullptr;
+    sessionSetupQueue_.clear();
   }
 
-  /*LOG(INFO) << std::this_thread::get_id() << ":"
-            << "WRTCServer::Quit5";*/
+  // waits for running pool refill, pending refills are dropped
+  if (certThread_.get()) {
+    certThread_->Stop();
+  }
+
+  {
+    rtc::CritScope lock(&certPoolMutex_);
+    certPool_.clear();
+  }
 
+  // NOTE: factory threads quit last, setup queue and certThread_ post tasks to them
   // CloseDataChannel?
   // webrtc.googlesource.com/src/+/master/examples/unityplugin/simple_peer_connection.cc
-  // Tells the thread to stop and waits until it is joined.
-  // Never call Stop on the current thread.  Instead use the inherited Quit
-  // function which will exit the base MessageQueue without terminating the
-  // underlying OS thread.
-  if (owned_networkThread_.get())
-    owned_networkThread_->Quit();
-  if (owned_signalingThread_.get())
-    owned_signalingThread_->Quit();
-  if (owned_workerThread_.get())
-    owned_workerThread_->Quit();
+  // Tells the threads to stop
+  for (auto& peerFactory : peerFactories_) {
+    peerFactory->finish();
+  }
 
   /*LOG(INFO) << std::this_thread::get_id() << ":"
             << "WRTCServer::Quit6";*/
@@ -508,8 +587,6 @@ webrtc::PeerConnectionInterface::RTCConfiguration WRTCServer::getWRTCConf() cons
 }
 
 void WRTCServer::addGlobalDataChannelCount_s(uint32_t count) {
-  RTC_DCHECK_RUN_ON(signalingThread());
-
   // LOG(INFO) << "WRTCServer::addGlobalDataChannelCount_s";
   dataChannelGlobalCount_ += count;
   // TODO: check overflow
@@ -518,17 +595,15 @@ void WRTCServer::addGlobalDataChannelCount_s(uint32_t count) {
 
   // expected: 1 session == 1 dataChannel
   // NOTE: reconnect == new session
-  RTC_DCHECK_LE(dataChannelGlobalCount_, std::numeric_limits<uint32_t>::max());
+  RTC_DCHECK_LE(dataChannelGlobalCount_.load(), std::numeric_limits<uint32_t>::max());
   // session may exist with closed dataChannel
   // session may be deleted from map, but still exist
-  // RTC_DCHECK_LE(dataChannelGlobalCount_, sm_.getSessionsCount());
+  // RTC_DCHECK_LE(dataChannelGlobalCount_.load(), sm_.getSessionsCount());
 }
 
 void WRTCServer::subGlobalDataChannelCount_s(uint32_t count) {
-  RTC_DCHECK_RUN_ON(signalingThread());
-
   // LOG(INFO) << "WRTCServer::subGlobalDataChannelCount_s";
-  RTC_DCHECK_GT(dataChannelGlobalCount_, 0);
+  RTC_DCHECK_GT(dataChannelGlobalCount_.load(), 0);
   dataChannelGlobalCount_ -= count;
   // TODO: check overflow
   LOG(INFO) << "WRTCServer::subGlobalDataChannelCount_s: data channel count: "
@@ -536,10 +611,10 @@ void WRTCServer::subGlobalDataChannelCount_s(uint32_t count) {
 
   // expected: 1 session == 1 dataChannel
   // NOTE: reconnect == new session
-  RTC_DCHECK_LE(dataChannelGlobalCount_, std::numeric_limits<uint32_t>::max());
+  RTC_DCHECK_LE(dataChannelGlobalCount_.load(), std::numeric_limits<uint32_t>::max());
   // session may exist with closed dataChannel
   // session may be deleted from map, but still exist
-  // RTC_DCHECK_LE(dataChannelGlobalCount_, sm_.getSessionsCount());
+  // RTC_DCHECK_LE(dataChannelGlobalCount_.load(), sm_.getSessionsCount());
 }
 
 /**
@@ -591,7 +666,7 @@ void WRTCServer::sendTo(const wrtc::SessionGUID& sessionID, const std::string& m
  * @param id id of session to be removed
  */
 void WRTCServer::unregisterSession(const SessionGUID& id) {
-  LOG(WARNING) << "unregisterSession for id = " << static_cast<std::string>(id);
+  GLOG(WRTC, INFO) << "unregisterSession for id = " << static_cast<std::string>(id);
   if (!signalingThread()->IsCurrent()) {
     return signalingThread()->Invoke<void>(RTC_FROM_HERE,
                                            [this, id] { return unregisterSession(id); });
@@ -648,26 +723,42 @@ void WRTCServer::webRtcBackgroundThreadEntry() { InitAndRun_t(); }
 std::shared_ptr<WRTCSession>
 WRTCServer::createNewSession(bool isServer, std::shared_ptr<gloer::net::SessionPair> clientWsSession,
                              net::WRTCNetworkManager* nm) {
-  // TODO: don`t run heavy operations on signaling_thread!!!
+  return createNewSession(isServer, clientWsSession, nm, nm->getRunner()->choosePeerFactory());
+}
+
+std::shared_ptr<WRTCSession>
+WRTCServer::createNewSession(bool isServer, std::shared_ptr<gloer::net::SessionPair> clientWsSession,
+                             net::WRTCNetworkManager* nm, PeerFactoryContext* peerFactory,
+                             std::unique_ptr<cricket::BasicPortAllocator> portAllocator) {
+  RTC_DCHECK(peerFactory != nullptr);
+  if (!peerFactory) {
+    LOG(WARNING) << "WRTCServer: Invalid PeerFactoryContext";
+    return nullptr;
+  }
+
   {
-    if (!nm->getRunner()->signalingThread()->IsCurrent()) {
-      return nm->getRunner()->signalingThread()->Invoke<std::shared_ptr<WRTCSession>>(
-          RTC_FROM_HERE, [isServer, clientWsSession, nm] {
-            return createNewSession(isServer, clientWsSession, nm);
+    if (!peerFactory->signalingThread()->IsCurrent()) {
+      // NOTE: Invoke is blocking, so |portAllocator| can be captured by reference
+      return peerFactory->signalingThread()->Invoke<std::shared_ptr<WRTCSession>>(
+          RTC_FROM_HERE, [isServer, clientWsSession, nm, peerFactory, &portAllocator] {
+            return createNewSession(isServer, clientWsSession, nm, peerFactory,
+                                    std::move(portAllocator));
           });
     }
   }
-  RTC_DCHECK_RUN_ON(nm->getRunner()->signalingThread());
+  RTC_DCHECK_RUN_ON(peerFactory->signalingThread());
 
   RTC_DCHECK(nm != nullptr);
   if (!nm) {
     LOG(WARNING) << "WRTCServer: Invalid NetworkManager";
+    peerFactory->releasePortAllocator(std::move(portAllocator));
     return nullptr;
   }
 
   RTC_DCHECK(clientWsSession.get() != nullptr);
   if (!clientWsSession || clientWsSession.get() == nullptr) {
     LOG(WARNING) << "WRTCServer invalid clientSession!";
+    peerFactory->releasePortAllocator(std::move(portAllocator));
     return nullptr;
   }
 
@@ -676,6 +767,7 @@ WRTCServer::createNewSession(bool isServer, std::shared_ptr<gloer::net::SessionP
   if (alreadyPaired) {
     LOG(WARNING) << std::this_thread::get_id() << ":"
                  << "WRTCServer::createNewSession alreadyPaired with " << static_cast<std::string>(clientWsSession->getId());
+    peerFactory->releasePortAllocator(std::move(portAllocator));
     return nullptr;
   }
 
@@ -697,25 +789,32 @@ WRTCServer::createNewSession(bool isServer, std::shared_ptr<gloer::net::SessionP
   // TODO ice_server.password = kTurnPassword;
   LOG(INFO) << "creating peer_connection...";
   {
-    RTC_DCHECK(nm->getRunner()->RTCNetworkManager_.get() != nullptr);
-    if (!nm->getRunner()->RTCNetworkManager_.get() || !nm->getRunner()->socketFactory_.get()) {
+    RTC_DCHECK(peerFactory->RTCNetworkManager_.get() != nullptr);
+    if (!peerFactory->RTCNetworkManager_.get() || !peerFactory->socketFactory_.get()) {
       LOG(WARNING) << "WRTCServer::createNewSession: invalid "
                       "RTCNetworkManager_ or socketFactory_";
+      peerFactory->releasePortAllocator(std::move(portAllocator));
       return nullptr;
     }
 
-    LOG(INFO) << "creating WRTCSession...";
-    createdWRTCSession = std::make_shared<WRTCSession>(nm, clientWsSession, webrtcConnId, wsConnId);
+    // NOTE: checked before session takes |portAllocator|, it must die on network thread
+    RTC_DCHECK(nm->sessionManager().onNewSessCallback_ != nullptr);
+    if (!nm->sessionManager().onNewSessCallback_) {
+      LOG(WARNING) << "WRTC: Not set onNewSessCallback_!";
+      peerFactory->releasePortAllocator(std::move(portAllocator));
+      return nullptr;
+    }
 
-    {
-      RTC_DCHECK(nm->sessionManager().onNewSessCallback_ != nullptr);
-      if (!nm->sessionManager().onNewSessCallback_) {
-        LOG(WARNING) << "WRTC: Not set onNewSessCallback_!";
-        return nullptr;
-      }
-      nm->sessionManager().onNewSessCallback_(createdWRTCSession);
+    LOG(INFO) << "creating WRTCSession on PeerConnectionFactory " << peerFactory->index();
+    createdWRTCSession = std::make_shared<WRTCSession>(nm, peerFactory, clientWsSession,
+                                                       webrtcConnId, wsConnId);
+
+    if (portAllocator) {
+      createdWRTCSession->setPortAllocator(std::move(portAllocator));
     }
 
+    nm->sessionManager().onNewSessCallback_(createdWRTCSession);
+
     LOG(INFO) << "creating peerConnectionObserver...";
     createdWRTCSession->createPeerConnectionObserver();
 
@@ -753,40 +852,65 @@ WRTCServer::createNewSession(bool isServer, std::shared_ptr<gloer::net::SessionP
 std::shared_ptr<WRTCSession>
 WRTCServer::setRemoteDescriptionAndCreateOffer(std::shared_ptr<gloer::net::SessionPair> clientWsSession,
                                                net::WRTCNetworkManager* nm) {
+  return setRemoteDescriptionAndCreateOffer(clientWsSession, nm,
+                                            nm->getRunner()->choosePeerFactory());
+}
+
+std::shared_ptr<WRTCSession>
+WRTCServer::setRemoteDescriptionAndCreateOffer(std::shared_ptr<gloer::net::SessionPair> clientWsSession,
+                                               net::WRTCNetworkManager* nm,
+                                               PeerFactoryContext* peerFactory,
+                                               std::unique_ptr<cricket::BasicPortAllocator> portAllocator) {
+  RTC_DCHECK(peerFactory != nullptr);
+  if (!peerFactory) {
+    LOG(WARNING) << "WRTCServer: Invalid PeerFactoryContext";
+    return nullptr;
+  }
 
-  // TODO: don`t run heavy operations on signaling_thread!!!
+  // NOTE: port allocator is created on network thread and DTLS certificate is taken
+  // from pool (or generated on certThread_), so signaling thread only wires up PeerConnection
   {
-    if (!nm->getRunner()->signalingThread()->IsCurrent()) {
-      return nm->getRunner()->signalingThread()->Invoke<std::shared_ptr<WRTCSession>>(
-          RTC_FROM_HERE, [clientWsSession, nm] {
-            return setRemoteDescriptionAndCreateOffer(clientWsSession, nm);
+    if (!peerFactory->signalingThread()->IsCurrent()) {
+      if (!portAllocator && !peerFactory->networkThread()->IsCurrent()) {
+        portAllocator =
+            peerFactory->networkThread()->Invoke<std::unique_ptr<cricket::BasicPortAllocator>>(
+                RTC_FROM_HERE, [peerFactory] { return peerFactory->createPortAllocator_n(); });
+      }
+      // NOTE: Invoke is blocking, so |portAllocator| can be captured by reference
+      return peerFactory->signalingThread()->Invoke<std::shared_ptr<WRTCSession>>(
+          RTC_FROM_HERE, [clientWsSession, nm, peerFactory, &portAllocator] {
+            return setRemoteDescriptionAndCreateOffer(clientWsSession, nm, peerFactory,
+                                                      std::move(portAllocator));
           });
     }
   }
 
-  RTC_DCHECK_RUN_ON(nm->getRunner()->signalingThread());
+  RTC_DCHECK_RUN_ON(peerFactory->signalingThread());
 
   LOG(INFO) << std::this_thread::get_id() << ":"
             << "WRTCServer::setRemoteDescriptionAndCreateOffer";
 
   if (!nm || nm == nullptr) { //// <<<<
     LOG(WARNING) << "WRTCServer: Invalid NetworkManager";
+    peerFactory->releasePortAllocator(std::move(portAllocator));
     return nullptr;
   }
 
   if (!clientWsSession || clientWsSession == nullptr) { //// <<<<
     LOG(WARNING) << "WRTCServer invalid clientSession!";
+    peerFactory->releasePortAllocator(std::move(portAllocator));
     return nullptr;
   }
 
-  if (!nm->getRunner()->RTCNetworkManager_.get() || !nm->getRunner()->socketFactory_.get()) {
+  if (!peerFactory->RTCNetworkManager_.get() || !peerFactory->socketFactory_.get()) {
     LOG(WARNING) << "WRTCServer::setRemoteDescriptionAndCreateOffer: invalid "
                     "RTCNetworkManager_ or socketFactory_";
+    peerFactory->releasePortAllocator(std::move(portAllocator));
     return nullptr;
   }
 
   std::shared_ptr<WRTCSession> createdWRTCSession
-    = createNewSession(false, clientWsSession, nm);
+    = createNewSession(false, clientWsSession, nm, peerFactory, std::move(portAllocator));
 
   RTC_DCHECK(createdWRTCSession.get() != nullptr);
   if (!createdWRTCSession) {
@@ -829,40 +953,151 @@ WRTCServer::setRemoteDescriptionAndCreateOffer(std::shared_ptr<gloer::net::Sessi
 // get sdp from client by websockets
 void WRTCServer::setRemoteDescriptionAndCreateAnswer(std::shared_ptr<gloer::net::SessionPair> clientWsSession,
                                                      net::WRTCNetworkManager* nm, const std::string& sdp) {
+  if (!nm || nm == nullptr) {
+    LOG(WARNING) << "WRTCServer: Invalid NetworkManager";
+    return;
+  }
+
+  if (!clientWsSession || clientWsSession == nullptr) {
+    LOG(WARNING) << "WRTCServer invalid clientSession!";
+    return;
+  }
+
+  if (sdp.empty()) {
+    LOG(WARNING) << "WRTCServer: ignored offer with empty sdp";
+    return;
+  }
+
+  auto task = std::make_shared<SessionSetupTask>();
+  task->clientWsSession = clientWsSession;
+  task->nm = nm;
+  task->sdp = sdp;
+  task->offerReceivedUs = rtc::TimeMicros();
+
+  // NOTE: don`t block caller (asio thread) while session is created
+  nm->getRunner()->enqueueSessionSetup(task);
+}
 
-  // TODO: don`t run heavy operations on signaling_thread!!!
+void WRTCServer::enqueueSessionSetup(std::shared_ptr<SessionSetupTask> task) {
   {
-    if (!nm->getRunner()->signalingThread()->IsCurrent()) {
-      return nm->getRunner()->signalingThread()->Invoke<void>(
-          RTC_FROM_HERE, [clientWsSession, nm, sdp] {
-            return setRemoteDescriptionAndCreateAnswer(clientWsSession, nm, sdp);
-          });
+    rtc::CritScope lock(&sessionSetupMutex_);
+    if (activeSessionSetups_ >= maxConcurrentSessionSetups_) {
+      if (sessionSetupQueue_.size() >= maxQueuedSessionSetups_) {
+        // NOTE: offer is dropped, client may retry after its signaling timeout
+        GLOG_EVERY_MS(WRTC, WARNING, 1000)
+            << "WRTCServer: session setup queue is full, dropped offer from "
+            << static_cast<std::string>(task->clientWsSession->getId());
+        setupRejectedMetric().inc();
+        return;
+      }
+      sessionSetupQueue_.push_back(task);
+      return;
     }
+    activeSessionSetups_++;
   }
 
-  RTC_DCHECK_RUN_ON(nm->getRunner()->signalingThread());
+  startSessionSetup(task);
+}
 
-  LOG(INFO) << std::this_thread::get_id() << ":"
-            << "WRTCServer::SetRemoteDescriptionAndCreateAnswer";
+void WRTCServer::startSessionSetup(std::shared_ptr<SessionSetupTask> task) {
+  RTC_DCHECK(task.get() != nullptr);
 
-  if (!nm || nm == nullptr) { //// <<<<
-    LOG(WARNING) << "WRTCServer: Invalid NetworkManager";
+  // NOTE: task that failed to start passes its slot to next queued task in loop,
+  // not by recursion, so long queue can`t overflow stack
+  while (task) {
+    sessionSetupStats_.record(SessionSetupStage::SETUP_STARTED,
+                              static_cast<uint64_t>(rtc::TimeMicros() - task->offerReceivedUs));
+
+    // choose factory when setup starts, not when offer received, so load is up to date
+    task->peerFactory = choosePeerFactory();
+    if (task->peerFactory && asyncInvoker_) {
+      asyncInvoker_->AsyncInvoke<void>(RTC_FROM_HERE, task->peerFactory->networkThread(),
+                                       [this, task] { runSessionSetup_n(task); });
+      return;
+    }
+
+    LOG(WARNING) << "WRTCServer::startSessionSetup: Invalid PeerFactoryContext";
+    task = takeNextSessionSetup();
+  }
+}
+
+void WRTCServer::runSessionSetup_n(std::shared_ptr<SessionSetupTask> task) {
+  RTC_DCHECK_RUN_ON(task->peerFactory->networkThread());
+
+  // port allocator lives on network thread, create it before signaling thread is involved
+  task->portAllocator = task->peerFactory->createPortAllocator_n();
+  if (!task->portAllocator) {
+    LOG(WARNING) << "WRTCServer::runSessionSetup_n: invalid portAllocator";
+    finishSessionSetup();
     return;
   }
 
-  if (!clientWsSession || clientWsSession == nullptr) { //// <<<<
-    LOG(WARNING) << "WRTCServer invalid clientSession!";
+  asyncInvoker_->AsyncInvoke<void>(RTC_FROM_HERE, task->peerFactory->signalingThread(),
+                                   [this, task] { runSessionSetup_s(task); });
+}
+
+void WRTCServer::runSessionSetup_s(std::shared_ptr<SessionSetupTask> task) {
+  RTC_DCHECK_RUN_ON(task->peerFactory->signalingThread());
+
+  setRemoteDescriptionAndCreateAnswer(task);
+
+  // NOTE: allocator is left in task if setup failed before session took it
+  task->peerFactory->releasePortAllocator(std::move(task->portAllocator));
+
+  // NOTE: CreateAnswer is asynchronous too, slot is freed when answer requested
+  finishSessionSetup();
+}
+
+void WRTCServer::finishSessionSetup() {
+  std::shared_ptr<SessionSetupTask> nextTask = takeNextSessionSetup();
+  if (nextTask) {
+    startSessionSetup(nextTask);
+  }
+}
+
+std::shared_ptr<WRTCServer::SessionSetupTask> WRTCServer::takeNextSessionSetup() {
+  rtc::CritScope lock(&sessionSetupMutex_);
+  if (sessionSetupQueue_.empty()) {
+    RTC_DCHECK_GT(activeSessionSetups_, 0);
+    activeSessionSetups_--;
+    return nullptr;
+  }
+  // slot passes to next task
+  std::shared_ptr<SessionSetupTask> nextTask = sessionSetupQueue_.front();
+  sessionSetupQueue_.pop_front();
+  return nextTask;
+}
+
+void WRTCServer::setRemoteDescriptionAndCreateAnswer(std::shared_ptr<SessionSetupTask> task) {
+  RTC_DCHECK(task.get() != nullptr);
+  PeerFactoryContext* peerFactory = task->peerFactory;
+  net::WRTCNetworkManager* nm = task->nm;
+  std::shared_ptr<gloer::net::SessionPair> clientWsSession = task->clientWsSession;
+
+  RTC_DCHECK(peerFactory != nullptr);
+  if (!peerFactory) {
+    LOG(WARNING) << "WRTCServer: Invalid PeerFactoryContext";
     return;
   }
 
-  if (!nm->getRunner()->RTCNetworkManager_.get() || !nm->getRunner()->socketFactory_.get()) {
+  RTC_DCHECK_RUN_ON(peerFactory->signalingThread());
+
+  LOG(INFO) << std::this_thread::get_id() << ":"
+            << "WRTCServer::SetRemoteDescriptionAndCreateAnswer";
+
+  if (!clientWsSession->isOpen()) {
+    LOG(WARNING) << "WRTCServer: WebSocket session closed before WRTCSession creation";
+    return;
+  }
+
+  if (!peerFactory->RTCNetworkManager_.get() || !peerFactory->socketFactory_.get()) {
     LOG(WARNING) << "WRTCServer::setRemoteDescriptionAndCreateAnswer: invalid "
                     "RTCNetworkManager_ or socketFactory_";
     return;
   }
 
-  std::shared_ptr<WRTCSession> createdWRTCSession
-    = createNewSession(true, clientWsSession, nm);
+  std::shared_ptr<WRTCSession> createdWRTCSession = createNewSession(
+      true, clientWsSession, nm, peerFactory, std::move(task->portAllocator));
 
   // RTC_DCHECK(createdWRTCSession.get() != nullptr); // may be empty
   if (!createdWRTCSession) {
@@ -882,8 +1117,10 @@ void WRTCServer::setRemoteDescriptionAndCreateAnswer(std::shared_ptr<gloer::net:
   // TODO:
   // github.com/YOU-i-Labs/webkit/blob/master/Source/WebCore/Modules/mediastream/libwebrtc/LibWebRTCMediaEndpoint.cpp#L182
 
+  createdWRTCSession->setOfferReceivedTime(task->offerReceivedUs);
+
   // got offer from client
-  auto clientSessionDescription = createdWRTCSession->createSessionDescription(kOffer, sdp);
+  auto clientSessionDescription = createdWRTCSession->createSessionDescription(kOffer, task->sdp);
   if (!clientSessionDescription) {
     LOG(WARNING) << "empty clientSessionDescription!";
     return;
@@ -894,22 +1131,174 @@ void WRTCServer::setRemoteDescriptionAndCreateAnswer(std::shared_ptr<gloer::net:
 
   createdWRTCSession->setRemoteDescription(clientSessionDescription);
 
-  createdWRTCSession->CreateAnswer();
+  if (!createdWRTCSession->createAnswerFromTemplate(task->sdp)) {
+    createdWRTCSession->CreateAnswer();
+  }
 }
 
 rtc::Thread* WRTCServer::startThread() { return startThread_; }
 
+rtc::scoped_refptr<rtc::RTCCertificate> WRTCServer::generateCertificate() {
+  const int64_t startUs = rtc::TimeMicros();
+
+  rtc::scoped_refptr<rtc::RTCCertificate> certificate =
+      rtc::RTCCertificateGenerator::GenerateCertificate(rtc::KeyParams(rtc::KT_ECDSA),
+                                                        absl::nullopt);
+
+  const uint64_t genTimeUs = static_cast<uint64_t>(rtc::TimeMicros() - startUs);
+
+  if (!certificate.get()) {
+    LOG(WARNING) << "WRTCServer::generateCertificate: failed to generate certificate";
+    return nullptr;
+  }
+
+  certGenTimeMetric().record(genTimeUs);
+  {
+    rtc::CritScope lock(&certPoolMutex_);
+    certGenStats_.generatedCount++;
+  }
+
+  return certificate;
+}
+
+void WRTCServer::refillCertPool_c() {
+  RTC_DCHECK(certThread_.get() && certThread_->IsCurrent());
+
+  // NOTE: cleared before pool size is checked, so take during refill schedules next refill
+  certRefillPending_ = false;
+
+  while (true) {
+    {
+      rtc::CritScope lock(&certPoolMutex_);
+      if (certPool_.size() >= certPoolSize_) {
+        break;
+      }
+    }
+
+    // NOTE: generate without lock, may be slow
+    rtc::scoped_refptr<rtc::RTCCertificate> certificate = generateCertificate();
+    if (!certificate.get()) {
+      break;
+    }
+
+    rtc::CritScope lock(&certPoolMutex_);
+    certPool_.push_back(certificate);
+  }
+}
+
+void WRTCServer::scheduleCertPoolRefill() {
+  if (!certThread_.get() || !asyncInvoker_) {
+    return;
+  }
+
+  // only one refill task at a time
+  bool expected = false;
+  if (!certRefillPending_.compare_exchange_strong(expected, true)) {
+    return;
+  }
+
+  asyncInvoker_->AsyncInvoke<void>(RTC_FROM_HERE, certThread_.get(),
+                                   [this] { refillCertPool_c(); });
+}
+
+void WRTCServer::invokeDelayed(rtc::Thread* thread, std::function<void()> functor,
+                               uint32_t delayMs) {
+  if (!thread || !asyncInvoker_) {
+    LOG(WARNING) << "WRTCServer::invokeDelayed: invalid thread";
+    return;
+  }
+
+  asyncInvoker_->AsyncInvokeDelayed<void>(RTC_FROM_HERE, thread, std::move(functor), delayMs);
+}
+
+rtc::scoped_refptr<rtc::RTCCertificate> WRTCServer::takeCertificate() {
+  rtc::scoped_refptr<rtc::RTCCertificate> certificate;
+
+  {
+    rtc::CritScope lock(&certPoolMutex_);
+    // NOTE: expiration of certificate is UTC time, not monotonic rtc::TimeMillis
+    const uint64_t now = static_cast<uint64_t>(rtc::TimeUTCMillis());
+    while (!certPool_.empty() && !certificate.get()) {
+      certificate = certPool_.back();
+      certPool_.pop_back();
+      if (certificate->HasExpired(now)) {
+        certificate = nullptr;
+      }
+    }
+    if (!certificate.get()) {
+      certGenStats_.poolMissCount++;
+    }
+  }
+
+  scheduleCertPoolRefill();
+
+  if (!certificate.get()) {
+    GLOG_EVERY_MS(WRTC, WARNING, 1000)
+        << "WRTCServer::takeCertificate: empty pool, certificate generated asynchronously";
+  }
+
+  return certificate;
+}
+
+std::unique_ptr<rtc::RTCCertificateGeneratorInterface>
+WRTCServer::createCertGenerator(rtc::Thread* signalingThread) {
+  if (!certThread_.get() || !signalingThread) {
+    // PeerConnectionFactory uses default generator on its network thread
+    return nullptr;
+  }
+  return std::make_unique<rtc::RTCCertificateGenerator>(signalingThread, certThread_.get());
+}
+
+WRTCServer::CertGenStats WRTCServer::getCertGenStats() const {
+  rtc::CritScope lock(&certPoolMutex_);
+  return certGenStats_;
+}
+
 // see
 // github.com/WebKit/webkit/blob/master/Source/ThirdParty/libwebrtc/Source/webrtc/pc/peerconnectionfactory.h
 rtc::Thread* WRTCServer::signalingThread() {
   // This method can be called on a different thread when the factory is
   // created in CreatePeerConnectionFactory().
-  return signaling_thread_;
+  return peerFactories_.empty() ? nullptr : peerFactories_.front()->signalingThread();
 }
 
-rtc::Thread* WRTCServer::workerThread() { return worker_thread_; }
+rtc::Thread* WRTCServer::workerThread() {
+  return peerFactories_.empty() ? nullptr : peerFactories_.front()->workerThread();
+}
+
+rtc::Thread* WRTCServer::networkThread() {
+  return peerFactories_.empty() ? nullptr : peerFactories_.front()->networkThread();
+}
+
+PeerFactoryContext* WRTCServer::choosePeerFactory() {
+  RTC_DCHECK(!peerFactories_.empty());
+  if (peerFactories_.empty()) {
+    LOG(WARNING) << "WRTCServer::choosePeerFactory: no PeerConnectionFactory";
+    return nullptr;
+  }
 
-rtc::Thread* WRTCServer::networkThread() { return network_thread_; }
+  if (peerFactories_.size() == 1) {
+    return peerFactories_.front().get();
+  }
+
+  switch (peerFactoryPolicy_) {
+  case config::WRTCFactoryPolicy::LEAST_LOAD: {
+    // NOTE: sessions count may change concurrently, approximate value is enough
+    auto it = std::min_element(
+        peerFactories_.begin(), peerFactories_.end(),
+        [](const std::unique_ptr<PeerFactoryContext>& a,
+           const std::unique_ptr<PeerFactoryContext>& b) {
+          return a->sessionsCount() < b->sessionsCount();
+        });
+    return it->get();
+  }
+  case config::WRTCFactoryPolicy::ROUND_ROBIN:
+  default: {
+    const size_t next = nextPeerFactory_.fetch_add(1, std::memory_order_relaxed);
+    return peerFactories_[next % peerFactories_.size()].get();
+  }
+  }
+}
 
 } // namespace wrtc
 } // namespace net
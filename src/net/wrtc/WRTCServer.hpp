@@ -16,6 +16,8 @@
 #include <webrtc/rtc_base/criticalsection.h>
 #include <webrtc/rtc_base/messagehandler.h>
 #include <webrtc/rtc_base/messagequeue.h>
+#include <webrtc/rtc_base/rtccertificate.h>
+#include <webrtc/rtc_base/rtccertificategenerator.h>
 #include <webrtc/rtc_base/scoped_ref_ptr.h>
 #include <webrtc/rtc_base/ssladapter.h>
 #include <webrtc/rtc_base/thread.h>
@@ -24,6 +26,15 @@
 #include "net/wrtc/Callbacks.hpp"
 #include <net/NetworkManagerBase.hpp>
 #include "net/wrtc/SessionGUID.hpp"
+#include "config/ServerConfig.hpp"
+#include "net/RateLimiter.hpp"
+#include "net/wrtc/PeerFactoryContext.hpp"
+#include "net/wrtc/SdpTemplateCache.hpp"
+#include "net/wrtc/SessionSetupStats.hpp"
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
 
 //#include <webrtc/base/single_thread_task_runner.h>
 //#include <webrtc/base/task_runner.h>
@@ -177,28 +188,97 @@ public:
 
   webrtc::PeerConnectionInterface::RTCConfiguration getWRTCConf() const;
 
-  void addGlobalDataChannelCount_s(uint32_t count) RTC_RUN_ON(signalingThread());
-
-  void subGlobalDataChannelCount_s(uint32_t count) RTC_RUN_ON(signalingThread());
-
-  // creates WRTCSession based on WebSocket message
-  static void
-  setRemoteDescriptionAndCreateAnswer(std::shared_ptr<SessionPair> clientWsSession,
-                                      net::WRTCNetworkManager* nm,
-                                      const std::string& sdp); // RTC_RUN_ON(signaling_thread());
-
+  // NOTE: called from signaling threads of all PeerConnectionFactory instances
+  void addGlobalDataChannelCount_s(uint32_t count);
+
+  void subGlobalDataChannelCount_s(uint32_t count);
+
+  /**
+   * Creates WRTCSession based on WebSocket message.
+   * NOTE: returns immediately, session is created asynchronously:
+   * port allocator on network thread, then PeerConnection and answer on signaling thread.
+   * At most wrtcMaxConcurrentSessionSetups_ sessions are created at the same time,
+   * at most wrtcMaxQueuedSessionSetups_ offers wait, further offers are dropped.
+   **/
+  static void setRemoteDescriptionAndCreateAnswer(std::shared_ptr<SessionPair> clientWsSession,
+                                                  net::WRTCNetworkManager* nm,
+                                                  const std::string& sdp);
+
+  /**
+   * Creates WRTCSession that sends offer.
+   * NOTE: blocks caller on network and signaling threads. Used only by clients
+   * (gameclient, wrtcloopback) that create few sessions, server answers offers
+   * without blocking, see setRemoteDescriptionAndCreateAnswer.
+   **/
   static std::shared_ptr<WRTCSession>
   setRemoteDescriptionAndCreateOffer(std::shared_ptr<SessionPair> clientWsSession,
                                      net::WRTCNetworkManager* nm); // RTC_RUN_ON(signaling_thread());
 
   rtc::Thread* startThread();
 
+  // threads of first PeerConnectionFactory,
+  // NOTE: each WRTCSession uses threads of own PeerFactoryContext
   rtc::Thread* signalingThread();
 
   rtc::Thread* workerThread();
 
   rtc::Thread* networkThread();
 
+  // selects PeerConnectionFactory for new session based on wrtcFactoryPolicy_
+  PeerFactoryContext* choosePeerFactory();
+
+  size_t getPeerFactoriesCount() const { return peerFactories_.size(); }
+
+  // see ServerConfig::wrtcHostCandidatesOnly_
+  bool isHostCandidatesOnly() const { return hostCandidatesOnly_; }
+
+  // see ServerConfig::wrtcCandidateBatchMs_
+  uint32_t candidateBatchMs() const { return candidateBatchMs_; }
+
+  // see ServerConfig::wrtcMaxMessageBytes_
+  size_t maxMessageBytes() const { return maxMessageBytes_; }
+
+  // limits of incoming messages, see ServerConfig::wrtcRateLimit_
+  RateLimiter& rateLimiter() { return rateLimiter_; }
+
+  // nullptr if disabled, see ServerConfig::wrtcSdpTemplateCacheSize_
+  SdpTemplateCache* sdpTemplateCache() { return sdpTemplateCache_.get(); }
+
+  /**
+   * Runs |functor| on |thread| after |delayMs|.
+   * NOTE: pending calls are dropped when server destroyed, capture sessions by weak_ptr
+   **/
+  void invokeDelayed(rtc::Thread* thread, std::function<void()> functor, uint32_t delayMs);
+
+  /**
+   * Takes pre-generated DTLS certificate from pool and schedules pool refill.
+   * Returns nullptr if pool is empty, then PeerConnection generates certificate
+   * asynchronously, see createCertGenerator.
+   * NOTE: may be called from signaling threads of all PeerConnectionFactory instances
+   **/
+  rtc::scoped_refptr<rtc::RTCCertificate> takeCertificate();
+
+  /**
+   * Generator of PeerConnection that missed pool, generates on certThread_
+   * and calls back on |signalingThread|. Returns nullptr if pool is disabled,
+   * then PeerConnectionFactory uses its default generator.
+   **/
+  std::unique_ptr<rtc::RTCCertificateGeneratorInterface>
+  createCertGenerator(rtc::Thread* signalingThread);
+
+  struct CertGenStats {
+    uint64_t generatedCount = 0;
+    // sessions that found pool empty, their certificates are generated asynchronously
+    uint64_t poolMissCount = 0;
+  };
+
+  CertGenStats getCertGenStats() const;
+
+  // latency of connection establishment stages, see SessionSetupStage
+  SessionSetupStats& sessionSetupStats() { return sessionSetupStats_; }
+
+  const SessionSetupStats& sessionSetupStats() const { return sessionSetupStats_; }
+
 public:
   // std::thread webrtcStartThread_; // we create separate threads for wrtc
 
@@ -207,23 +287,6 @@ public:
 
   webrtc::PeerConnectionInterface::RTCOfferAnswerOptions webrtcGamedataOpts_; // TODO: to private
 
-  // @see
-  // github.com/sourcey/libsourcey/blob/master/src/webrtc/include/scy/webrtc/peerfactorycontext.h
-  // @see github.com/sourcey/libsourcey/blob/master/src/webrtc/src/peerfactorycontext.cpp
-  std::unique_ptr<rtc::NetworkManager> RTCNetworkManager_;
-
-  std::unique_ptr<rtc::PacketSocketFactory> socketFactory_;
-
-  // The peer connection through which we engage in the Session Description
-  // Protocol (SDP) handshake.
-  rtc::CriticalSection pcfMutex_; // TODO: to private
-  // @see
-  // chromium.googlesource.com/external/webrtc/stable/talk/+/master/app/webrtc/peerconnectioninterface.h
-  // The peer conncetion factory that sets up signaling and worker threads. It
-  // is also used to create the PeerConnection.
-  rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface>
-      peerConnectionFactory_ RTC_GUARDED_BY(pcfMutex_);
-
   /*
    * The signaling thread handles the bulk of WebRTC computation;
    * it creates all of the basic components and fires events we can consume by
@@ -239,18 +302,11 @@ public:
 
   std::unique_ptr<rtc::AsyncInvoker> asyncInvoker_;
 
-  std::unique_ptr<rtc::Thread> owned_signalingThread_;
-  rtc::Thread* signaling_thread_ = nullptr;
-
-  std::unique_ptr<rtc::Thread> owned_networkThread_;
-  rtc::Thread* network_thread_ = nullptr;
-  /*
-   * The worker thread is delegated resource-intensive tasks
-   * such as media streaming to ensure that the signaling thread doesn’t get
-   * blocked
-   */
-  std::unique_ptr<rtc::Thread> owned_workerThread_;
-  rtc::Thread* worker_thread_ = nullptr;
+  // @see
+  // chromium.googlesource.com/external/webrtc/stable/talk/+/master/app/webrtc/peerconnectioninterface.h
+  // Each PeerConnectionFactory sets up own signaling, worker and network threads.
+  // Sessions are sharded across factories, so DTLS/SCTP work scales across cores.
+  std::vector<std::unique_ptr<PeerFactoryContext>> peerFactories_;
 
   static std::string sessionDescriptionStrFromJson(
     const rapidjson::Document& message_object);
@@ -259,6 +315,15 @@ public:
   createNewSession(bool isServer, std::shared_ptr<SessionPair> clientWsSession,
                    net::WRTCNetworkManager* nm); // RTC_RUN_ON(signaling_thread());
 
+  // NOTE: if |portAllocator| is empty, session creates it on network thread.
+  // Blocks caller if called outside of signaling thread, server pipeline calls it
+  // on signaling thread only.
+  static std::shared_ptr<WRTCSession>
+  createNewSession(bool isServer, std::shared_ptr<SessionPair> clientWsSession,
+                   net::WRTCNetworkManager* nm, PeerFactoryContext* peerFactory,
+                   std::unique_ptr<cricket::BasicPortAllocator> portAllocator =
+                       nullptr); // RTC_RUN_ON(peerFactory->signalingThread());
+
   void addCallback(const WRTCNetworkOperation& op, const WRTCNetworkOperationCallback& cb);
 
 private:
@@ -267,6 +332,44 @@ private:
   /*rtc::scoped_refptr<webrtc::PeerConnectionInterface>
       peerConnection_;*/
 
+  // state of asynchronous session creation, passed from stage to stage
+  struct SessionSetupTask {
+    std::shared_ptr<SessionPair> clientWsSession;
+    net::WRTCNetworkManager* nm = nullptr;
+    std::string sdp;
+    PeerFactoryContext* peerFactory = nullptr;
+    // rtc::TimeMicros() when offer was received via WebSocket
+    int64_t offerReceivedUs = 0;
+    // created on network thread, moved to WRTCSession on signaling thread
+    std::unique_ptr<cricket::BasicPortAllocator> portAllocator;
+  };
+
+  // starts task or puts it into sessionSetupQueue_ if too many setups in progress
+  void enqueueSessionSetup(std::shared_ptr<SessionSetupTask> task);
+
+  void startSessionSetup(std::shared_ptr<SessionSetupTask> task);
+
+  void runSessionSetup_n(std::shared_ptr<SessionSetupTask> task); // RTC_RUN_ON(task->peerFactory->networkThread())
+
+  void runSessionSetup_s(std::shared_ptr<SessionSetupTask> task); // RTC_RUN_ON(task->peerFactory->signalingThread())
+
+  // frees setup slot and starts next queued task
+  void finishSessionSetup();
+
+  // pops next queued task that takes over setup slot, frees slot if queue is empty
+  std::shared_ptr<SessionSetupTask> takeNextSessionSetup();
+
+  static void setRemoteDescriptionAndCreateAnswer(
+      std::shared_ptr<SessionSetupTask> task); // RTC_RUN_ON(task->peerFactory->signalingThread());
+
+  // NOTE: if |portAllocator| is empty, it is created on network thread before
+  // signaling thread is involved
+  static std::shared_ptr<WRTCSession> setRemoteDescriptionAndCreateOffer(
+      std::shared_ptr<SessionPair> clientWsSession, net::WRTCNetworkManager* nm,
+      PeerFactoryContext* peerFactory,
+      std::unique_ptr<cricket::BasicPortAllocator> portAllocator =
+          nullptr); // RTC_RUN_ON(peerFactory->signalingThread());
+
   // TODO: weak ptr
   net::WRTCNetworkManager* nm_;
 
@@ -278,7 +381,7 @@ private:
 
   webrtc::PeerConnectionInterface::RTCConfiguration webrtcConf_;
 
-  uint32_t dataChannelGlobalCount_ RTC_GUARDED_BY(signalingThread()) = 0;
+  std::atomic<uint32_t> dataChannelGlobalCount_{0};
   // TODO: close data_channel on timer?
   // uint32_t getMaxSessionId() const { return maxSessionId_; }
   // TODO: limit max num of open sessions
@@ -288,6 +391,63 @@ private:
 
   bool networkThreadWithSocketServer_{true};
 
+  const uint32_t peerFactoriesCount_;
+
+  const config::WRTCFactoryPolicy peerFactoryPolicy_;
+
+  PortAllocatorConf portAllocatorConf_;
+
+  const bool hostCandidatesOnly_;
+
+  const uint32_t candidateBatchMs_;
+
+  const size_t maxMessageBytes_;
+
+  RateLimiter rateLimiter_;
+
+  std::unique_ptr<SdpTemplateCache> sdpTemplateCache_;
+
+  // ECDSA key generation is slow, so certificates generated in background on certThread_
+  rtc::scoped_refptr<rtc::RTCCertificate> generateCertificate();
+
+  void refillCertPool_c(); // RTC_RUN_ON(certThread_)
+
+  void scheduleCertPoolRefill();
+
+  const uint32_t certPoolSize_;
+
+  std::unique_ptr<rtc::Thread> certThread_;
+
+  rtc::CriticalSection certPoolMutex_;
+
+  std::vector<rtc::scoped_refptr<rtc::RTCCertificate>> certPool_ RTC_GUARDED_BY(certPoolMutex_);
+
+  CertGenStats certGenStats_ RTC_GUARDED_BY(certPoolMutex_);
+
+  std::atomic<bool> certRefillPending_{false};
+
+  const uint32_t maxConcurrentSessionSetups_;
+
+  // offers beyond this number of waiting setups are dropped
+  const uint32_t maxQueuedSessionSetups_;
+
+  rtc::CriticalSection sessionSetupMutex_;
+
+  std::deque<std::shared_ptr<SessionSetupTask>> sessionSetupQueue_ RTC_GUARDED_BY(sessionSetupMutex_);
+
+  uint32_t activeSessionSetups_ RTC_GUARDED_BY(sessionSetupMutex_) = 0;
+
+  SessionSetupStats sessionSetupStats_;
+
+  // exports stats above as callback gauges of metrics::MetricsRegistry
+  void registerMetrics();
+
+  // callback gauges, removed in destructor
+  std::vector<uint64_t> metricsCallbacks_;
+
+  // used by ROUND_ROBIN policy
+  std::atomic<size_t> nextPeerFactory_{0};
+
   // ThreadChecker is a helper class used to help verify that some methods of a
   // class are called from the same thread.
   rtc::ThreadChecker thread_checker_;
@@ -2,10 +2,15 @@
 #include "algo/DispatchQueue.hpp"
 #include "algo/NetworkOperation.hpp"
 #include "algo/StringUtils.hpp"
+#include "log/EventLog.hpp"
 #include "log/Logger.hpp"
+#include "metrics/MessageTrace.hpp"
+#include "metrics/Metrics.hpp"
 #include "net/NetworkManagerBase.hpp"
+#include "net/schema/Messages.generated.hpp"
 #include "net/wrtc/Observers.hpp"
 #include "net/wrtc/PeerConnectivityChecker.hpp"
+#include "net/wrtc/PeerFactoryContext.hpp"
 #include "net/wrtc/WRTCServer.hpp"
 #include "net/wrtc/wrtc.hpp"
 #include "net/ws/server/ServerSession.hpp"
@@ -17,6 +22,7 @@
 #include <boost/beast/websocket.hpp>
 #include <iostream>
 #include <logging/rtc_event_log/rtc_event_log_factory_interface.h>
+#include <p2p/base/p2pconstants.h>
 #include <p2p/base/portallocator.h>
 #include <rapidjson/encodings.h>
 #include <rapidjson/stringbuffer.h>
@@ -28,10 +34,13 @@
 #include <webrtc/rtc_base/bind.h>
 #include <webrtc/rtc_base/checks.h>
 #include <webrtc/rtc_base/copyonwritebuffer.h>
+#include <webrtc/rtc_base/helpers.h>
 #include <webrtc/rtc_base/rtccertificategenerator.h>
 #include <webrtc/rtc_base/scoped_ref_ptr.h>
 #include <webrtc/rtc_base/ssladapter.h>
+#include <webrtc/rtc_base/sslfingerprint.h>
 #include <webrtc/rtc_base/thread.h>
+#include <webrtc/rtc_base/timeutils.h>
 #include <net/ws/SessionGUID.hpp>
 #include <net/wrtc/SessionGUID.hpp>
 
@@ -40,27 +49,64 @@ namespace {
 using namespace ::gloer::net::wrtc;
 
 std::unique_ptr<webrtc::IceCandidateInterface>
-createIceCandidateFromJson(const rapidjson::Document& message_object) {
-  LOG(INFO) << std::this_thread::get_id() << ":"
-            << "createIceCandidateFromJson";
-  std::string candidate = message_object["payload"][kCandidateSdpName].GetString();
-  LOG(INFO) << "got candidate from client =" << candidate;
-  int sdp_mline_index = message_object["payload"][kCandidateSdpMlineIndexName].GetInt();
-  std::string sdp_mid = message_object["payload"][kCandidateSdpMidName].GetString();
+createIceCandidate(const gloer::net::schema::IceCandidate& payload) {
   webrtc::SdpParseError error;
-  // TODO: free memory?
-  // TODO: handle error?
   std::unique_ptr<webrtc::IceCandidateInterface> iceCanidate(
-      webrtc::CreateIceCandidate(sdp_mid, sdp_mline_index, candidate, &error));
+      webrtc::CreateIceCandidate(std::string(payload.sdpMid), payload.sdpMLineIndex,
+                                 std::string(payload.candidate), &error));
   if (!iceCanidate.get()) {
-    LOG(WARNING) << "createIceCandidateFromJson:: iceCanidate IS NULL" << error.description.c_str();
+    LOG(WARNING) << "createIceCandidate:: iceCanidate IS NULL" << error.description.c_str();
   }
   return iceCanidate;
 }
 
-static bool IsValidPortRange(uint16_t min_port, uint16_t max_port) {
-  RTC_DCHECK(min_port <= max_port);
-  return min_port != 0 && max_port != 0;
+/**
+ * Per-session values of answer rendered from template
+ * NOTE: fingerprint must match certificate of PeerConnection, or SetLocalDescription fails
+ **/
+bool makeSdpAnswerParams(const rtc::RTCCertificate* certificate, SdpAnswerParams& params) {
+  std::unique_ptr<rtc::SSLFingerprint> fingerprint(
+      rtc::SSLFingerprint::CreateFromCertificate(certificate));
+  if (!fingerprint) {
+    LOG(WARNING) << "makeSdpAnswerParams: can`t create fingerprint";
+    return false;
+  }
+  params.fingerprint = fingerprint->algorithm + " " + fingerprint->GetRfc4572Fingerprint();
+  // same as WebRTC session id, see WebRtcSessionDescriptionFactory
+  params.sessionId = std::to_string(rtc::CreateRandomId64() & INT64_MAX);
+  params.iceUfrag = rtc::CreateRandomString(cricket::ICE_UFRAG_LENGTH);
+  params.icePwd = rtc::CreateRandomString(cricket::ICE_PWD_LENGTH);
+  return true;
+}
+
+// NOTE: totals of all data channels, per-session series would grow with number of clients
+struct WrtcSessionMetrics {
+  gloer::metrics::Counter& bytesIn;
+  gloer::metrics::Counter& bytesOut;
+  gloer::metrics::Counter& messagesIn;
+  gloer::metrics::Counter& messagesOut;
+  gloer::metrics::Counter& sendFailures;
+  gloer::metrics::Counter& dropsQueueFull;
+  gloer::metrics::Counter& overBufferLimit;
+  gloer::metrics::Histogram& bufferedAmount;
+};
+
+WrtcSessionMetrics& wrtcSessionMetrics() {
+  auto& registry = gloer::metrics::MetricsRegistry::instance();
+  static WrtcSessionMetrics sessionMetrics{
+      registry.counter("gloer_wrtc_received_bytes_total",
+                       "Bytes of data channel messages received"),
+      registry.counter("gloer_wrtc_sent_bytes_total", "Bytes of data channel messages sent"),
+      registry.counter("gloer_wrtc_received_messages_total", "Data channel messages received"),
+      registry.counter("gloer_wrtc_sent_messages_total", "Data channel messages sent"),
+      registry.counter("gloer_wrtc_send_failures_total", "Data channel Send() calls that failed"),
+      registry.counter("gloer_wrtc_dropped_messages_total", "Data channel messages dropped",
+                       "reason=\"queue_full\""),
+      registry.counter("gloer_wrtc_over_buffer_limit_total",
+                       "Sends with buffered_amount above MAX_TO_BUFFER_BYTES"),
+      registry.histogram("gloer_wrtc_buffered_amount_bytes",
+                         "Data channel buffered_amount before send")};
+  return sessionMetrics;
 }
 
 } // namespace
@@ -73,18 +119,25 @@ const boost::posix_time::time_duration WRTCSession::timerDeadlinePeriod =
     boost::posix_time::seconds(10);
 
 WRTCSession::WRTCSession(net::WRTCNetworkManager* wrtc_nm,
+  PeerFactoryContext* peerFactory,
   std::shared_ptr<gloer::net::SessionPair> wsSession,
   //net::WSServerNetworkManager* ws_nm,
   const wrtc::SessionGUID& webrtcId, const ws::SessionGUID& wsId)
     : SessionBase<wrtc::SessionGUID>(webrtcId), lastDataChannelstate_(webrtc::DataChannelInterface::kClosed),
       wrtc_nm_(wrtc_nm),
+      maxMessageBytes_(wrtc_nm->getRunner()->maxMessageBytes()),
+      peerFactory_(peerFactory),
       //ws_nm_(ws_nm),
       wsSession_(wsSession),
       ws_id_(wsId), isClosing_(false) {
 
   RTC_DCHECK(wrtc_nm_ != nullptr);
+  RTC_DCHECK(peerFactory_ != nullptr);
   //RTC_DCHECK(ws_nm_ != nullptr);
 
+  // used by WRTCServer::choosePeerFactory
+  peerFactory_->addSessionCount(1);
+
   RTC_DCHECK_GT(static_cast<std::string>(webrtcId).length(), 0);
   RTC_DCHECK_GT(static_cast<std::string>(wsId).length(), 0);
 
@@ -100,6 +153,9 @@ WRTCSession::WRTCSession(net::WRTCNetworkManager* wrtc_nm,
       close_s(false, false); // NOTE: both ws and wrtc must exist at the same time
       return;
     }
+    // NOTE: data channel limits are separate from ws ones (ServerConfig::wrtcRateLimit_),
+    // data channels from same address share address buckets
+    rateLimiter_ = wrtc_nm_->getRunner()->rateLimiter().createSessionLimiter(spt->remoteAddress());
   }
 
   // wrtc session requires ws session (only at creation time)
@@ -147,12 +203,14 @@ WRTCSession::~WRTCSession() {
       connectionChecker_ = nullptr;
     };
 
-    if (!wrtc_nm_->getRunner()->signalingThread()->IsCurrent()) {
-      wrtc_nm_->getRunner()->signalingThread()->Invoke<void>(RTC_FROM_HERE, closeHook);
+    if (!signalingThread()->IsCurrent()) {
+      signalingThread()->Invoke<void>(RTC_FROM_HERE, closeHook);
     } else {
       closeHook();
     }
   }
+
+  peerFactory_->subSessionCount(1);
 }
 
 void WRTCSession::close_s(bool closePci, bool resetChannelObserver) {
@@ -225,7 +283,7 @@ void WRTCSession::close_s(bool closePci, bool resetChannelObserver) {
   // port_allocator_ lives on the network thread and should be destroyed there.
   // see
   // github.com/WebKit/webkit/blob/master/Source/ThirdParty/libwebrtc/Source/webrtc/pc/peerconnection.cc#L877
-  if (!wrtc_nm_->getRunner()->networkThread()->IsCurrent()) {
+  if (!networkThread()->IsCurrent()) {
     networkThread()->Invoke<void>(RTC_FROM_HERE, [this] { portAllocator_.reset(); });
   } else {
     portAllocator_ = nullptr;
@@ -293,13 +351,6 @@ bool WRTCSession::isClosing() const {
   return isClosing_;
 }
 
-/**
- * 16 Kbyte for the highest throughput, while also being the most portable one
- * @see viblast.com/blog/2015/2/5/webrtc-data-channel-message-size/
- **/
-size_t WRTCSession::MAX_IN_MSG_SIZE_BYTE = 16 * 1024;
-size_t WRTCSession::MAX_OUT_MSG_SIZE_BYTE = 16 * 1024;
-
 void WRTCSession::createPeerConnectionObserver() {
   RTC_DCHECK_RUN_ON(signalingThread());
 
@@ -430,13 +481,14 @@ void WRTCSession::CloseDataChannel(bool resetObserver) {
 bool WRTCSession::InitializePortAllocator_n() {
   RTC_DCHECK_RUN_ON(networkThread());
 
-  if (!portAllocator_) {
-    portAllocator_ = std::make_unique<cricket::BasicPortAllocator>(
-        wrtc_nm_->getRunner()->RTCNetworkManager_.get(), wrtc_nm_->getRunner()->socketFactory_.get());
-  } else {
+  if (portAllocator_) {
     LOG(WARNING) << "Recreating portAllocator_";
   }
 
+  // NOTE: uses network manager shared by all sessions of PeerFactoryContext,
+  // port range and network interfaces configured by ServerConfig
+  portAllocator_ = peerFactory_->createPortAllocator_n();
+
   RTC_DCHECK(portAllocator_.get() != nullptr);
   if (!portAllocator_ || !portAllocator_.get()) {
     close_s(false, false);
@@ -444,21 +496,6 @@ bool WRTCSession::InitializePortAllocator_n() {
     return false;
   }
 
-  // NOTE: We need port per session
-  // This doesn't make everything go on one port, but should limit the number.
-  // If you don't expect many concurrent connections you can open only a small range of ports.
-  if (IsValidPortRange(minPort_, maxPort_)) {
-    portAllocator_->SetPortRange(minPort_, maxPort_);
-  }
-
-  // TODO: more setting for portAllocator_
-  // https://github.com/mobhuyan/webrtc/blob/98a867ccd2af391267d0568f279dd3274e623f81/pc/peerconnection.cc#L4232
-
-  if (!enableEnumeratingAllNetworkInterfaces_) {
-    portAllocator_->set_flags(portAllocator_->flags() |
-                              cricket::PORTALLOCATOR_DISABLE_ADAPTER_ENUMERATION);
-  }
-
   return true;
 }
 
@@ -483,8 +520,9 @@ void WRTCSession::createPeerConnection() {
 
   // The port allocator lives on the network thread and should be initialized
   // there.
-  // InitializePortAllocator();
-  if (!wrtc_nm_->getRunner()->networkThread()->Invoke<bool>(
+  // NOTE: may be already created by WRTCServer::runSessionSetup_n
+  if (!portAllocator_ &&
+      !networkThread()->Invoke<bool>(
           RTC_FROM_HERE, ::rtc::Bind(&WRTCSession::InitializePortAllocator_n, this))) {
     LOG(WARNING) << "WRTCServer::createPeerConnection: invalid portAllocator_";
     return;
@@ -498,8 +536,8 @@ void WRTCSession::createPeerConnection() {
     // prevents pci_ garbage collection by 'operator='
     rtc::CritScope lock(&peerConIMutex_);
 
-    RTC_DCHECK(wrtc_nm_->getRunner()->peerConnectionFactory_.get() != nullptr);
-    if (!wrtc_nm_->getRunner()->peerConnectionFactory_.get()) {
+    RTC_DCHECK(peerFactory_->peerConnectionFactory_.get() != nullptr);
+    if (!peerFactory_->peerConnectionFactory_.get()) {
       close_s(false, false);
       LOG(WARNING) << "Error: Invalid CreatePeerConnectionFactory.";
       return;
@@ -512,9 +550,26 @@ void WRTCSession::createPeerConnection() {
       return;
     }
 
-    pci_ = wrtc_nm_->getRunner()->peerConnectionFactory_->CreatePeerConnection(
-        wrtc_nm_->getRunner()->getWRTCConf(), /*std::move(portAllocator_)*/ nullptr,
-        /* cert_generator */ nullptr, peerConnectionObserver_.get());
+    webrtc::PeerConnectionInterface::RTCConfiguration wrtcConf =
+        wrtc_nm_->getRunner()->getWRTCConf();
+
+    // use pre-generated DTLS certificate, so PeerConnection don`t generate own
+    rtc::scoped_refptr<rtc::RTCCertificate> certificate =
+        wrtc_nm_->getRunner()->takeCertificate();
+    std::unique_ptr<rtc::RTCCertificateGeneratorInterface> certGenerator;
+    if (certificate.get()) {
+      wrtcConf.certificates.push_back(certificate);
+    } else {
+      // NOTE: pool miss must not generate on signaling thread
+      certGenerator =
+          wrtc_nm_->getRunner()->createCertGenerator(peerFactory_->signalingThread());
+    }
+    certificate_ = certificate;
+
+    // NOTE: PeerConnection takes ownership of portAllocator_
+    pci_ = peerFactory_->peerConnectionFactory_->CreatePeerConnection(
+        wrtcConf, std::move(portAllocator_), std::move(certGenerator),
+        peerConnectionObserver_.get());
 
     RTC_DCHECK(pci_.get() != nullptr);
     if (!pci_ || !pci_.get()) {
@@ -597,14 +652,31 @@ void WRTCSession::send(const std::string& data) {
 
   /*LOG(INFO) << std::this_thread::get_id() << ":"
             << "WRTCSession::sendDataViaDataChannel const std::string&";*/
-  WRTCSession::send(wrtc_nm_, shared_from_this(), data);
+  // NOTE: binary codec sessions receive binary data channel messages
+  WRTCSession::send(wrtc_nm_, shared_from_this(), data,
+                    codecType() == MessageCodecType::BINARY);
+}
+
+void WRTCSession::send(const std::string& data, bool isBinary) {
+  WRTCSession::send(wrtc_nm_, shared_from_this(), data, isBinary);
 }
 
 bool WRTCSession::send(net::WRTCNetworkManager* nm, std::shared_ptr<WRTCSession> wrtcSess,
                        const std::string& data) {
+  const bool isBinary = wrtcSess && wrtcSess->codecType() == MessageCodecType::BINARY;
+  return WRTCSession::send(nm, wrtcSess, data, isBinary);
+}
+
+bool WRTCSession::send(net::WRTCNetworkManager* nm, std::shared_ptr<WRTCSession> wrtcSess,
+                       const std::string& data, bool isBinary) {
   // RTC_DCHECK_RUN_ON(&wrtcSess->thread_checker_);
   // LOG(WARNING) << "WRTCSession::send 1";
-  const bool isClosing_n = nm->getRunner()->signalingThread()->Invoke<bool>(
+  if (!wrtcSess || !wrtcSess.get()) {
+    LOG(WARNING) << "WRTCSession::sendDataViaDataChannel: wrtc session is not established";
+    return false;
+  }
+
+  const bool isClosing_n = wrtcSess->signalingThread()->Invoke<bool>(
       RTC_FROM_HERE, [wrtcSess] { return wrtcSess->isClosing(); });
   if (isClosing_n) {
     // session is closing...
@@ -657,7 +729,7 @@ bool WRTCSession::send(net::WRTCNetworkManager* nm, std::shared_ptr<WRTCSession>
       return false;
     }
 
-    if (data.size() > MAX_OUT_MSG_SIZE_BYTE) {
+    if (data.size() > wrtcSess->maxMessageBytes_) {
       LOG(WARNING) << "WRTCSession::sendDataViaDataChannel: Too big messageBuffer of size "
                    << data.size();
       return false;
@@ -674,11 +746,18 @@ bool WRTCSession::send(net::WRTCNetworkManager* nm, std::shared_ptr<WRTCSession>
 
   // write to send queue
   {
+    // NOTE: called by handler of traced message, see DispatchQueue::DispatchQueued
+    const uint64_t traceId = metrics::MessageTracer::current();
     if (!wrtcSess->sendQueue_.isFull()) {
-      wrtcSess->sendQueue_.write(std::make_shared<std::string>(data));
+      wrtcSess->sendQueue_.write(
+          QueuedMessage{std::make_shared<std::string>(data), isBinary, traceId});
+      if (traceId) {
+        metrics::MessageTracer::instance().record(traceId, metrics::TraceStage::SEND_ENQUEUE);
+      }
     } else {
       // Too many messages in queue
-      LOG(WARNING) << "WRTC send_queue_ isFull!";
+      GLOG_EVERY_MS(WRTC, WARNING, 1000) << "WRTC send_queue_ isFull!";
+      wrtcSessionMetrics().dropsQueueFull.inc();
       return false;
     }
   }
@@ -747,50 +826,37 @@ bool WRTCSession::sendQueued(net::WRTCNetworkManager* nm, std::shared_ptr<WRTCSe
   /*LOG(INFO) << std::this_thread::get_id() << ":"
               << "WRTCSession::sendDataViaDataChannel const webrtc::DataBuffer& buffer";*/
 
-  if (!wrtcSess->isSendBusy_ && !wrtcSess->sendQueue_.isEmpty()) {
-    wrtcSess->isSendBusy_ = true;
-
-    if (!wrtcSess->sendQueue_.frontPtr() || !wrtcSess->sendQueue_.frontPtr()->get()) {
-      LOG(WARNING) << "WRTC: invalid sendQueue_.frontPtr()";
-      wrtcSess->isSendBusy_ = false;
-      return false;
-    }
+  if (wrtcSess->isSendBusy_) {
+    return true;
+  }
+  wrtcSess->isSendBusy_ = true;
 
-    // std::shared_ptr<const std::string> dp = *(sendQueue_.frontPtr());
-    std::shared_ptr<const std::string> dp;
-    {
-      wrtcSess->sendQueue_.read(dp);
+  // NOTE: whole queue is sent in one signaling thread task,
+  // message is removed from queue by read, so next message is never skipped
+  QueuedMessage queued;
+  while (wrtcSess->sendQueue_.read(queued)) {
+    std::shared_ptr<const std::string> dp = std::move(queued.data);
 
-      if (!wrtcSess->sendQueue_.isEmpty()) {
-        // Remove the already written string from the queue
-        // sendQueue_.erase(sendQueue_.begin());
-        wrtcSess->sendQueue_.popFront();
-      }
+    if (!dp || !dp.get()) {
+      LOG(WARNING) << "WRTC invalid sendQueue_.front()) ";
+      continue;
     }
 
     // check buffer size
     {
       if (!dp->size()) {
         LOG(WARNING) << "WRTCSession::sendDataViaDataChannel: Invalid messageBuffer";
-        wrtcSess->isSendBusy_ = false;
-        return false;
+        continue;
       }
 
-      if (dp->size() > MAX_OUT_MSG_SIZE_BYTE) {
+      if (dp->size() > wrtcSess->maxMessageBytes_) {
         LOG(WARNING) << "WRTCSession::sendDataViaDataChannel: Too big messageBuffer of size "
                      << dp->size();
-        wrtcSess->isSendBusy_ = false;
-        return false;
+        continue;
       }
     }
 
-    webrtc::DataBuffer buffer(rtc::CopyOnWriteBuffer(dp->c_str(), dp->size()), /* binary */ false);
-
-    if (!dp || !dp.get()) {
-      LOG(WARNING) << "WRTC invalid sendQueue_.front()) ";
-      wrtcSess->isSendBusy_ = false;
-      return false;
-    }
+    webrtc::DataBuffer buffer(rtc::CopyOnWriteBuffer(dp->c_str(), dp->size()), queued.isBinary);
 
     // We are not currently writing, so send this immediately
     {
@@ -814,8 +880,10 @@ bool WRTCSession::sendQueued(net::WRTCNetworkManager* nm, std::shared_ptr<WRTCSe
       // the SCTP level. See comment above Send below.
       const uint64_t buffered_bytes = wrtcSess->dataChannelI_->buffered_amount();
       // LOG(WARNING) << "buffered_bytes = " << buffered_bytes;
+      wrtcSessionMetrics().bufferedAmount.record(buffered_bytes);
       if (buffered_bytes > wrtcSess->MAX_TO_BUFFER_BYTES) {
         LOG(WARNING) << "REACHED DATACHANNEL MAX_TO_BUFFER_BYTES!";
+        wrtcSessionMetrics().overBufferLimit.inc();
         // wrtcSess->isSendBusy_ = false;
         // return false;
       }
@@ -831,8 +899,18 @@ bool WRTCSession::sendQueued(net::WRTCNetworkManager* nm, std::shared_ptr<WRTCSe
       // LOG(WARNING) << "WRTCSession::send 4 " << dp->c_str() << " size " << buffer.size();
       // LOG(WARNING) << "wrtcSess->dataChannelI_->state() " << wrtcSess->dataChannelI_->state();
       // LOG(WARNING) << "IsStable() " << wrtcSess->IsStable();
-      if (!wrtcSess->dataChannelI_->Send(std::move(buffer))) {
+      const size_t bufferSize = buffer.size();
+      if (wrtcSess->dataChannelI_->Send(std::move(buffer))) {
+        wrtcSessionMetrics().bytesOut.inc(bufferSize);
+        wrtcSessionMetrics().messagesOut.inc();
+        // NOTE: no completion of data channel write, message is accepted by SCTP here
+        if (queued.traceId) {
+          metrics::MessageTracer::instance().record(queued.traceId,
+                                                    metrics::TraceStage::WRITE_COMPLETE);
+        }
+      } else {
         LOG(WARNING) << "Can`t send via dataChannelI_";
+        wrtcSessionMetrics().sendFailures.inc();
         switch (wrtcSess->dataChannelI_->state()) {
         case webrtc::DataChannelInterface::kConnecting: {
           LOG(WARNING)
@@ -864,18 +942,13 @@ bool WRTCSession::sendQueued(net::WRTCNetworkManager* nm, std::shared_ptr<WRTCSe
         }
         }
       }
-
-      // send queued messages too
-      if (!wrtcSess->sendQueue_.isEmpty()) {
-        sendQueued(nm, wrtcSess);
-      }
-
-      // AsyncInvoke TODO: use
-      // github.com/WebKit/webkit/blob/master/Source/ThirdParty/libwebrtc/Source/webrtc/pc/peerconnection.cc#L6133
-      wrtcSess->isSendBusy_ = false;
     }
   }
 
+  // AsyncInvoke TODO: use
+  // github.com/WebKit/webkit/blob/master/Source/ThirdParty/libwebrtc/Source/webrtc/pc/peerconnection.cc#L6133
+  wrtcSess->isSendBusy_ = false;
+
   return true;
 }
 
@@ -1035,32 +1108,78 @@ void WRTCSession::setLocalDescription(webrtc::SessionDescriptionInterface* sdi)
   // setLocalDescription(&local_description_observer, sdi);
 }
 
-void WRTCSession::createAndAddIceCandidateFromJson(const rapidjson::Document& message_object) {
-  {
-    if (!signalingThread()->IsCurrent()) {
-      return signalingThread()->Invoke<void>(RTC_FROM_HERE, [this, &message_object] {
-        return createAndAddIceCandidateFromJson(message_object);
-      });
+std::vector<std::unique_ptr<webrtc::IceCandidateInterface>>
+WRTCSession::createIceCandidatesFromJson(const rapidjson::Document& message_object) {
+  LOG(INFO) << std::this_thread::get_id() << ":"
+            << "createIceCandidatesFromJson";
+  std::vector<std::unique_ptr<webrtc::IceCandidateInterface>> candidates;
+
+  const auto it = message_object.IsObject() ? message_object.FindMember("payload")
+                                            : message_object.MemberEnd();
+  if (it == message_object.MemberEnd()) {
+    LOG(WARNING) << "createIceCandidatesFromJson: ignored message without payload";
+    return candidates;
+  }
+
+  // NOTE: validates all fields of payload in one pass, see net/schema/Messages.idl
+  gloer::net::schema::IceCandidate payload;
+  if (it->value.IsObject()) {
+    // single candidate (WS_OPCODE::CANDIDATE)
+    if (!gloer::net::schema::fromJson(it->value, payload)) {
+      LOG(WARNING) << "createIceCandidatesFromJson: ignored malformed candidate";
+      return candidates;
+    }
+    if (auto candidate = createIceCandidate(payload)) {
+      candidates.push_back(std::move(candidate));
     }
+    return candidates;
   }
 
-  RTC_DCHECK_RUN_ON(signalingThread());
+  if (!it->value.IsArray()) {
+    LOG(WARNING) << "createIceCandidatesFromJson: ignored malformed payload";
+    return candidates;
+  }
 
-  /*{
-    if (!nm_->getRunner()->workerThread_ || !nm_->getRunner()->workerThread_.get()) {
-      LOG(WARNING) << "WRTCSession::sendDataViaDataChannel: invalid workerThread_";
-      return;
+  // batch of candidates (WS_OPCODE::CANDIDATE_BATCH)
+  candidates.reserve(it->value.Size());
+  for (const auto& candidateValue : it->value.GetArray()) {
+    if (!gloer::net::schema::fromJson(candidateValue, payload)) {
+      LOG(WARNING) << "createIceCandidatesFromJson: ignored malformed candidate in batch";
+      continue;
     }
-
-    if (!nm_->getRunner()->workerThread_->IsCurrent()) {
-      return nm_->getRunner()->workerThread_->Invoke<void>(
-          RTC_FROM_HERE, [this] { return createAndAddIceCandidate(message_object); });
+    if (auto candidate = createIceCandidate(payload)) {
+      candidates.push_back(std::move(candidate));
     }
-  }*/
+  }
+  return candidates;
+}
+
+void WRTCSession::createAndAddIceCandidateFromJson(const rapidjson::Document& message_object) {
+  // NOTE: single candidate and CANDIDATE_BATCH differ only by payload
+  createAndAddIceCandidatesFromJson(message_object);
+}
+
+void WRTCSession::createAndAddIceCandidatesFromJson(const rapidjson::Document& message_object) {
+  // parse on caller thread, signaling thread only applies candidates
+  auto candidates = createIceCandidatesFromJson(message_object);
+  if (candidates.empty()) {
+    return;
+  }
+
+  // NOTE: one signaling thread task for whole batch
+  if (!signalingThread()->IsCurrent()) {
+    return signalingThread()->Invoke<void>(
+        RTC_FROM_HERE, [this, &candidates] { return addIceCandidates_s(candidates); });
+  }
+  addIceCandidates_s(candidates);
+}
+
+void WRTCSession::addIceCandidates_s(
+    const std::vector<std::unique_ptr<webrtc::IceCandidateInterface>>& candidates) {
+  RTC_DCHECK_RUN_ON(signalingThread());
 
   LOG(INFO) << std::this_thread::get_id() << ":"
-            << "WRTCSession::createAndAddIceCandidate";
-  auto candidate_object = createIceCandidateFromJson(message_object);
+            << "WRTCSession::addIceCandidates_s " << candidates.size();
   {
     LOG(INFO) << std::this_thread::get_id() << ":"
               << "WRTCSession::createAndAddIceCandidate peerConIMutex_";
@@ -1090,10 +1209,10 @@ void WRTCSession::createAndAddIceCandidateFromJson(const rapidjson::Document& me
       return;
     }
 
-    // sends IceCandidate to Client via websockets, see OnIceCandidate
-    if (!pci_->AddIceCandidate(candidate_object.get())) {
-      LOG(WARNING) << "createAndAddIceCandidate: Failed to apply the received candidate!";
-      return;
+    for (const auto& candidate : candidates) {
+      if (!pci_->AddIceCandidate(candidate.get())) {
+        LOG(WARNING) << "createAndAddIceCandidate: Failed to apply the received candidate!";
+      }
     }
   }
 }
@@ -1328,6 +1447,54 @@ void WRTCSession::CreateAnswer() {
   // LOG(INFO) << "peer_connection created answer";
 }
 
+bool WRTCSession::createAnswerFromTemplate(const std::string& offerSdp) {
+  {
+    if (!signalingThread()->IsCurrent()) {
+      return signalingThread()->Invoke<bool>(
+          RTC_FROM_HERE, [this, &offerSdp] { return createAnswerFromTemplate(offerSdp); });
+    }
+  }
+
+  RTC_DCHECK_RUN_ON(signalingThread());
+
+  SdpTemplateCache* sdpTemplateCache = wrtc_nm_->getRunner()->sdpTemplateCache();
+  if (!sdpTemplateCache || isClosing()) {
+    return false;
+  }
+
+  // NOTE: without own certificate PeerConnection generates one, fingerprint unknown
+  SdpAnswerParams params;
+  if (!certificate_.get() || !makeSdpAnswerParams(certificate_.get(), params)) {
+    return false;
+  }
+
+  const std::string shape = SdpTemplateCache::offerShape(offerSdp);
+  std::string answerSdp;
+  if (!sdpTemplateCache->render(shape, params, answerSdp)) {
+    answerTemplateShape_ = shape;
+    return false;
+  }
+
+#if RTC_DCHECK_IS_ON
+  if (!SdpTemplateCache::validate(answerSdp, params)) {
+    LOG(WARNING) << "createAnswerFromTemplate: invalid rendered answer, relearning template";
+    answerTemplateShape_ = shape;
+    return false;
+  }
+#endif // RTC_DCHECK_IS_ON
+
+  webrtc::SessionDescriptionInterface* sdi = createSessionDescription(kAnswer, answerSdp);
+  if (!sdi) {
+    LOG(WARNING) << "createAnswerFromTemplate: can`t parse rendered answer, relearning template";
+    answerTemplateShape_ = shape;
+    return false;
+  }
+
+  // NOTE: onAnswerCreated takes ownership of sdi like after CSDO::OnSuccess
+  onAnswerCreated(sdi);
+  return true;
+}
+
 void WRTCSession::CreateOffer() {
   LOG(INFO) << "peer_connection->CreateOffer...";
   RTC_DCHECK_RUN_ON(signalingThread());
@@ -1375,12 +1542,10 @@ void WRTCSession::CreateOffer() {
 // Callback for when the server receives a message on the data channel.
 void WRTCSession::onDataChannelMessage(const webrtc::DataBuffer& buffer) {
 
-  LOG(WARNING) << rtc::Thread::Current()->name() << ":"
-               << "WRTCSession::OnDataChannelMessage";
+  GLOG(WRTC, DEBUG) << rtc::Thread::Current()->name() << ":"
+                    << "WRTCSession::OnDataChannelMessage";
 
   RTC_DCHECK_RUN_ON(signalingThread());
-
-  LOG(WARNING) << "WRTCSession::onDataChannelMessage";
   setFullyCreated(true); // TODO
 
   if (isClosing()) {
@@ -1395,12 +1560,33 @@ void WRTCSession::onDataChannelMessage(const webrtc::DataBuffer& buffer) {
     return;
   }
 
-  if (buffer.size() > MAX_IN_MSG_SIZE_BYTE) {
+  wrtcSessionMetrics().bytesIn.inc(buffer.size());
+  wrtcSessionMetrics().messagesIn.inc();
+
+  if (buffer.size() > maxMessageBytes_) {
     LOG(WARNING) << "WRTCSession::onDataChannelMessage: Too big messageBuffer of size "
                  << buffer.size();
     return;
   }
 
+  if (rateLimiter_) {
+    // NOTE: data channel can not pause reading, limiter turns DELAY into DROP
+    TokenBucket::clock::duration readDelay;
+    const RateLimitVerdict verdict = rateLimiter_->check(buffer.size(), readDelay);
+    if (verdict == RateLimitVerdict::DISCONNECT) {
+      LOG(WARNING) << "WRTCSession::onDataChannelMessage: closing session over rate limit "
+                   << static_cast<const std::string&>(getId());
+      close_s(false, false);
+      return;
+    }
+    if (verdict != RateLimitVerdict::ALLOW) {
+      GLOG_EVERY_MS(WRTC, WARNING, 1000)
+          << "WRTCSession::onDataChannelMessage: dropped message over rate limit, session "
+          << static_cast<const std::string&>(getId());
+      return;
+    }
+  }
+
   const std::string data = std::string(buffer.data.data<char>(), buffer.size());
 
   RTC_DCHECK(dataChannelI_.get() != nullptr);
@@ -1426,6 +1612,16 @@ void WRTCSession::onDataChannelMessage(const webrtc::DataBuffer& buffer) {
     // return;
   }
 
+  // handler dispatches message on this thread, trace follows it, see MessageTracer
+  metrics::MessageTracer::Scope traceScope(
+      metrics::MessageTracer::instance().begin(static_cast<const std::string&>(getId())));
+
+  // binary-aware handler takes precedence, see SetOnBinaryMessageHandler
+  if (onBinaryMessageCallback_) {
+    onBinaryMessageCallback_(getId(), data, buffer.binary);
+    return;
+  }
+
   if (!onMessageCallback_) {
     LOG(WARNING) << "WRTCSession::onDataChannelMessage: Not set onMessageCallback_!";
     // close_s(false, false);
@@ -1543,87 +1739,101 @@ void WRTCSession::onDataChannelCreated(net::WRTCNetworkManager* nm,
 // TODO: on closed
 
 // Callback for when the STUN server responds with the ICE candidates.
-// Sends by websocket JSON containing { candidate, sdpMid, sdpMLineIndex }
-// TODO: WORKS WITHOUT OnIceCandidate???
-void WRTCSession::onIceCandidate(net::WRTCNetworkManager* nm,
-                                 std::shared_ptr<gloer::net::SessionPair> wsSess,
-                                 const ws::SessionGUID& wsConnId,
-                                 const webrtc::IceCandidateInterface* candidate) {
-  if (!wsSess) {
-    LOG(WARNING) << "onIceCandidate: Invalid websocket session";
-    RTC_DCHECK(wsSess);
+// Candidates are coalesced for wrtcCandidateBatchMs_ or until gathering completes,
+// see flushIceCandidates_s
+void WRTCSession::onIceCandidate(const webrtc::IceCandidateInterface* candidate) {
+  RTC_DCHECK_RUN_ON(signalingThread());
+
+  if (!candidate) {
+    LOG(WARNING) << "onIceCandidate: Invalid IceCandidateInterface";
+    RTC_DCHECK(candidate);
     return;
   }
 
-  if (!nm) {
-    LOG(WARNING) << "onIceCandidate: Invalid NetworkManager";
-    RTC_DCHECK(nm);
+  LOG(INFO) << std::this_thread::get_id() << ":"
+            << "WRTCSession::OnIceCandidate";
+  PendingIceCandidate pending;
+  if (!candidate->ToString(&pending.candidate)) {
+    LOG(WARNING) << "Failed to serialize candidate";
     return;
   }
+  pending.sdpMid = candidate->sdp_mid();
+  pending.sdpMLineIndex = candidate->sdp_mline_index();
+  pendingIceCandidates_.push_back(std::move(pending));
 
-  if (!candidate) {
-    LOG(WARNING) << "onIceCandidate: Invalid IceCandidateInterface";
-    // close_s(false, false);
-    RTC_DCHECK(candidate);
+  const uint32_t batchMs = wrtc_nm_->getRunner()->candidateBatchMs();
+  if (batchMs == 0) {
+    flushIceCandidates_s();
     return;
   }
 
-  const std::string sdp_mid_copy = candidate->sdp_mid();
+  // first candidate of batch starts window
+  if (pendingIceCandidates_.size() == 1) {
+    std::weak_ptr<WRTCSession> weakSess = shared_from_this();
+    wrtc_nm_->getRunner()->invokeDelayed(signalingThread(),
+                                         [weakSess]() {
+                                           if (auto sess = weakSess.lock()) {
+                                             sess->flushIceCandidates_s();
+                                           }
+                                         },
+                                         batchMs);
+  }
+}
+
+// Sends by websocket JSON containing { candidate, sdpMid, sdpMLineIndex },
+// or array of them (CANDIDATE_BATCH) if more than one candidate queued
+void WRTCSession::flushIceCandidates_s() {
+  RTC_DCHECK_RUN_ON(signalingThread());
 
-  //auto wsSess = wsSession_.lock();//ws_nm->sessionManager().getSessById(wsConnId);
-  if (!wsSess || !wsSess.get()) {
-    LOG(WARNING) << "onIceCandidate: Invalid getSessById for " << static_cast<std::string>(wsConnId);
-    return;
+  if (pendingIceCandidates_.empty()) {
+    return; // already flushed by gathering complete
   }
 
-  LOG(INFO) << std::this_thread::get_id() << ":"
-            << "WRTCSession::OnIceCandidate";
-  std::string candidate_str;
-  if (!candidate->ToString(&candidate_str)) {
-    LOG(WARNING) << "Failed to serialize candidate";
-    // LOG(LS_ERROR) << "Failed to serialize candidate";
+  auto wsSess = wsSession_.lock();
+  if (!wsSess || !wsSess.get() || !wsSess->isOpen()) {
+    LOG(WARNING) << "flushIceCandidates_s: Invalid websocket session for "
+                 << static_cast<std::string>(ws_id_);
+    pendingIceCandidates_.clear();
     return;
   }
 
-  // LOG(FATAL) << "onIceCandidate" << sdp_mid_copy << " " << candidate_str;
-
-  rapidjson::Document message_object;
-  message_object.SetObject();
-  message_object.AddMember(
-      "type", rapidjson::StringRef(algo::Opcodes::opcodeToStr(algo::WS_OPCODE::CANDIDATE)),
-      message_object.GetAllocator());
-  rapidjson::Value candidate_value;
-  candidate_value.SetString(rapidjson::StringRef(candidate_str.c_str()));
-  rapidjson::Value sdp_mid_value;
-  sdp_mid_value.SetString(rapidjson::StringRef(sdp_mid_copy.c_str()));
-  rapidjson::Value message_payload;
-  message_payload.SetObject();
-  // candidate: Host candidate for RTP on UDP - in this ICE line our browser is
-  // giving its host candidates- the IP example "candidate":
-  // "candidate:1791031112 1 udp 2122260223 10.10.15.25 57339 typ host
-  // generation 0 ufrag say/ network-id 1 network-cost 10",
-  message_payload.AddMember(kCandidateSdpName, candidate_value, message_object.GetAllocator());
-  // sdpMid: audio or video or ...
-  message_payload.AddMember(kCandidateSdpMidName, sdp_mid_value, message_object.GetAllocator());
-  message_payload.AddMember(kCandidateSdpMlineIndexName, candidate->sdp_mline_index(),
-                            message_object.GetAllocator());
-  message_object.AddMember("payload", message_payload, message_object.GetAllocator());
+  // NOTE: streams JSON directly, no intermediate rapidjson::Document
   rapidjson::StringBuffer strbuf;
   rapidjson::Writer<rapidjson::StringBuffer> writer(strbuf);
-  bool done = message_object.Accept(writer);
+  bool done = true;
+  const algo::WS_OPCODE opcode = pendingIceCandidates_.size() == 1
+                                     ? algo::WS_OPCODE::CANDIDATE
+                                     : algo::WS_OPCODE::CANDIDATE_BATCH;
+  if (pendingIceCandidates_.size() == 1) {
+    gloer::net::schema::IceCandidate message;
+    message.candidate = pendingIceCandidates_.front().candidate;
+    message.sdpMid = pendingIceCandidates_.front().sdpMid;
+    message.sdpMLineIndex = pendingIceCandidates_.front().sdpMLineIndex;
+    done = gloer::net::schema::toJsonEnvelope(
+        algo::Opcodes::opcodeToStr(algo::WS_OPCODE::CANDIDATE), message, writer);
+  } else {
+    const std::string type = algo::Opcodes::opcodeToStr(algo::WS_OPCODE::CANDIDATE_BATCH);
+    done = writer.StartObject() && writer.Key("type") &&
+           writer.String(type.c_str(), static_cast<rapidjson::SizeType>(type.size())) &&
+           writer.Key("payload") && writer.StartArray();
+    for (const PendingIceCandidate& pending : pendingIceCandidates_) {
+      gloer::net::schema::IceCandidate message;
+      message.candidate = pending.candidate;
+      message.sdpMid = pending.sdpMid;
+      message.sdpMLineIndex = pending.sdpMLineIndex;
+      done = done && gloer::net::schema::toJson(message, writer);
+    }
+    done = done && writer.EndArray() && writer.EndObject();
+  }
+  pendingIceCandidates_.clear();
+
   if (!done) {
-    LOG(WARNING) << "OnIceCandidate: INVALID JSON!";
+    LOG(WARNING) << "flushIceCandidates_s: INVALID JSON!";
     return;
   }
-  std::string payload = strbuf.GetString();
 
-  RTC_DCHECK(wsSess.get() != nullptr);
-  RTC_DCHECK(wsSess->isOpen() == true);
-  if (wsSess && wsSess.get() && wsSess->isOpen())
-    wsSess->send(payload); // TODO: use Task queue
-  /*else {
-    close_s(false, false);
-  }*/
+  wsSess->sendOperation(opcode._to_integral(),
+                        std::string(strbuf.GetString(), strbuf.GetSize())); // TODO: use Task queue
 }
 
 bool WRTCSession::IsStable() {
@@ -1658,6 +1868,14 @@ void WRTCSession::onAnswerCreated(webrtc::SessionDescriptionInterface* sdi) {
     return;
   }
 
+  if (!answerTemplateShape_.empty()) {
+    SdpTemplateCache* sdpTemplateCache = wrtc_nm_->getRunner()->sdpTemplateCache();
+    if (sdpTemplateCache && !sdpTemplateCache->learn(answerTemplateShape_, offer_string)) {
+      LOG(INFO) << "onAnswerCreated: answer not cached as template";
+    }
+    answerTemplateShape_.clear();
+  }
+
   /*auto wsSess = ws_nm_->sessionManager().getSessById(ws_id_);
   RTC_DCHECK(wsSess.get() != nullptr); // TODO: REMOVE <<<<<<<<
   if (!wsSess || !wsSess.get()) {
@@ -1679,29 +1897,14 @@ void WRTCSession::onAnswerCreated(webrtc::SessionDescriptionInterface* sdi) {
   LOG(INFO) << "OnAnswerCreated";
   // store the server’s own answer
   setLocalDescription(sdi);
-  // TODO: replace rapidjson to ...?
-  rapidjson::Document message_object;
-  message_object.SetObject();
-  rapidjson::Value type;
-  message_object.AddMember(
-      "type", rapidjson::StringRef(algo::Opcodes::opcodeToStr(algo::WS_OPCODE::ANSWER)),
-      message_object.GetAllocator());
-  rapidjson::Value sdp_value;
-  sdp_value.SetString(rapidjson::StringRef(offer_string.c_str()));
-
-  rapidjson::Value message_payload;
-  message_payload.SetObject();
-  message_payload.AddMember(
-      "type",
-      kAnswerSdpName, // rapidjson::StringRef(ANSWER_OPERATION.operationCodeStr_.c_str()),
-      message_object.GetAllocator());
-  message_payload.AddMember("sdp", sdp_value, message_object.GetAllocator());
-  message_object.AddMember("payload", message_payload, message_object.GetAllocator());
+  gloer::net::schema::SessionDescription message;
+  message.type = kAnswerSdpName;
+  message.sdp = offer_string;
 
   rapidjson::StringBuffer strbuf;
   rapidjson::Writer<rapidjson::StringBuffer> writer(strbuf);
-  bool done = message_object.Accept(writer);
-  if (!done) {
+  if (!gloer::net::schema::toJsonEnvelope(algo::Opcodes::opcodeToStr(algo::WS_OPCODE::ANSWER),
+                                          message, writer)) {
     LOG(WARNING) << "OnAnswerCreated: INVALID JSON!";
     return;
   }
@@ -1716,8 +1919,11 @@ void WRTCSession::onAnswerCreated(webrtc::SessionDescriptionInterface* sdi) {
     auto spt = wsSession_.lock();
     RTC_DCHECK(spt->isOpen() == true);
     if (spt && spt.get() && spt->isOpen())
-      spt->send(payload); // TODO: use Task queue
+      spt->sendOperation((+algo::WS_OPCODE::ANSWER)._to_integral(),
+                         payload); // TODO: use Task queue
   }
+
+  onSetupStage_s(SessionSetupStage::ANSWER_SENT);
 }
 
 // Callback for when the offer is created. This sends the answer back to the
@@ -1782,31 +1988,14 @@ void WRTCSession::onOfferCreated(webrtc::SessionDescriptionInterface* sdi) {
   // std::this_thread::sleep_for(std::chrono::milliseconds(1000)); // TODO
 
   // setRemoteDescription(sdi); // <<<<<<<<<<<<<<<<<<<<
-  // TODO: replace rapidjson to ...?
-  rapidjson::Document message_object;
-  message_object.SetObject();
-  rapidjson::Value type;
-  message_object.AddMember("type",
-                           rapidjson::StringRef(algo::Opcodes::opcodeToStr(algo::WS_OPCODE::OFFER)),
-                           message_object.GetAllocator());
-  rapidjson::Value sdp_value;
-  sdp_value.SetString(rapidjson::StringRef(offer_string.c_str()));
-
-  // RTC_DCHECK(algo::Opcodes::opcodeToStr(algo::WS_OPCODE::OFFER) == "2");
-
-  rapidjson::Value message_payload;
-  message_payload.SetObject();
-  message_payload.AddMember(
-      "type",
-      kOfferSdpName, // rapidjson::StringRef(ANSWER_OPERATION.operationCodeStr_.c_str()),
-      message_object.GetAllocator());
-  message_payload.AddMember("sdp", sdp_value, message_object.GetAllocator());
-  message_object.AddMember("payload", message_payload, message_object.GetAllocator());
+  gloer::net::schema::SessionDescription message;
+  message.type = kOfferSdpName;
+  message.sdp = offer_string;
 
   rapidjson::StringBuffer strbuf;
   rapidjson::Writer<rapidjson::StringBuffer> writer(strbuf);
-  bool done = message_object.Accept(writer);
-  if (!done) {
+  if (!gloer::net::schema::toJsonEnvelope(algo::Opcodes::opcodeToStr(algo::WS_OPCODE::OFFER),
+                                          message, writer)) {
     LOG(WARNING) << "OnOfferCreated: INVALID JSON!";
     return;
   }
@@ -1825,10 +2014,39 @@ void WRTCSession::onOfferCreated(webrtc::SessionDescriptionInterface* sdi) {
     auto spt = wsSession_.lock();
     RTC_DCHECK(spt.get() != nullptr && spt->isOpen() == true);
     if (spt && spt.get() && spt->isOpen())
-      spt->send(payload); // TODO: use Task queue
+      spt->sendOperation((+algo::WS_OPCODE::OFFER)._to_integral(),
+                         payload); // TODO: use Task queue
   }
 }
 
+void WRTCSession::setPortAllocator(std::unique_ptr<cricket::BasicPortAllocator> portAllocator) {
+  RTC_DCHECK(!portAllocator_);
+  portAllocator_ = std::move(portAllocator);
+}
+
+void WRTCSession::setOfferReceivedTime(int64_t offerReceivedUs) {
+  offerReceivedUs_ = offerReceivedUs;
+}
+
+void WRTCSession::onSetupStage_s(const SessionSetupStage& stage) {
+  RTC_DCHECK_RUN_ON(signalingThread());
+
+  if (offerReceivedUs_ == 0) {
+    return;
+  }
+
+  const uint32_t stageBit = 1u << stage._to_integral();
+  if (recordedSetupStages_ & stageBit) {
+    return;
+  }
+  recordedSetupStages_ |= stageBit;
+
+  const int64_t latencyUs = rtc::TimeMicros() - offerReceivedUs_;
+  wrtc_nm_->getRunner()->sessionSetupStats().record(stage, static_cast<uint64_t>(latencyUs));
+  GLOG_EVENT(WRTC, INFO, "session {} setup stage {} after {} us",
+             static_cast<const std::string&>(getId()), stage._to_string(), latencyUs);
+}
+
 void WRTCSession::onDataChannelAllocated() {
   RTC_DCHECK_RUN_ON(signalingThread());
 
@@ -1845,9 +2063,9 @@ void WRTCSession::onDataChannelDeallocated() {
   subDataChannelCount_s(1);
 }
 
-rtc::Thread* WRTCSession::networkThread() const { return wrtc_nm_->getRunner()->networkThread(); }
-rtc::Thread* WRTCSession::workerThread() const { return wrtc_nm_->getRunner()->workerThread(); }
-rtc::Thread* WRTCSession::signalingThread() const { return wrtc_nm_->getRunner()->signalingThread(); }
+rtc::Thread* WRTCSession::networkThread() const { return peerFactory_->networkThread(); }
+rtc::Thread* WRTCSession::workerThread() const { return peerFactory_->workerThread(); }
+rtc::Thread* WRTCSession::signalingThread() const { return peerFactory_->signalingThread(); }
 
 // TODO
 // github.com/shenghan97/vegee/blob/master/Server/webrtc-streamer/src/PeerConnectionManager.cpp#L531
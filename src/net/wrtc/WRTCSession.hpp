@@ -6,6 +6,7 @@
 
 #include "net/SessionBase.hpp"
 #include "net/core.hpp"
+#include "net/wrtc/SessionSetupStats.hpp"
 #include "net/wrtc/WRTCServer.hpp"
 #include <api/datachannelinterface.h>
 #include <atomic>
@@ -13,6 +14,7 @@
 #include <cstdint>
 #include <folly/ProducerConsumerQueue.h>
 #include <iostream>
+#include <memory>
 #include <rapidjson/document.h>
 #include <string>
 #include <thread>
@@ -84,6 +86,7 @@ namespace wrtc {
 
 class DCO;
 class PCO;
+class PeerFactoryContext;
 class SSDO;
 class CSDO;
 class PeerConnectivityChecker;
@@ -97,10 +100,19 @@ private:
   // NOTE: ProducerConsumerQueue must be created with a fixed maximum size
   // We use Queue per connection
   static const size_t MAX_SENDQUEUE_SIZE = 120;
+
+  // message waiting in sendQueue_, remembers how to send it via data channel
+  struct QueuedMessage {
+    std::shared_ptr<const std::string> data;
+    bool isBinary = false;
+    // sampled message trace, see MessageTracer
+    uint64_t traceId = 0;
+  };
 public:
   WRTCSession() = delete;
 
   explicit WRTCSession(net::WRTCNetworkManager* wrtc_nm,
+    PeerFactoryContext* peerFactory,
     std::shared_ptr<gloer::net::SessionPair> wsSession,
     /*net::WSServerNetworkManager* ws_nm,*/
     const wrtc::SessionGUID& webrtcId, const ws::SessionGUID& wsId)
@@ -114,6 +126,9 @@ public:
 
   void send(const std::string& ss) override; // RTC_RUN_ON(thread_checker_);
 
+  // sends |data| as binary (ArrayBuffer on browser side) or as UTF-8 text
+  void send(const std::string& data, bool isBinary); // RTC_RUN_ON(thread_checker_);
+
   void setObservers(bool isServer) RTC_RUN_ON(thread_checker_);
 
   bool isExpired() const override RTC_RUN_ON(signalingThread());
@@ -131,16 +146,29 @@ public:
   void createAndAddIceCandidateFromJson(const rapidjson::Document& message_object)
       RTC_RUN_ON(signalingThread());
 
+  /**
+   * Parses payload of CANDIDATE (object) or CANDIDATE_BATCH (array of objects) message.
+   * Malformed candidates of batch are skipped, others are returned.
+   * NOTE: thread-safe, doesn`t use session state
+   **/
+  static std::vector<std::unique_ptr<webrtc::IceCandidateInterface>>
+  createIceCandidatesFromJson(const rapidjson::Document& message_object);
+
+  // adds all candidates of CANDIDATE_BATCH message in one signaling thread task
+  void createAndAddIceCandidatesFromJson(const rapidjson::Document& message_object)
+      RTC_RUN_ON(signalingThread());
+
   // Triggered when a remote peer opens a data channel.
   void onDataChannelCreated(net::WRTCNetworkManager* nm,
                             rtc::scoped_refptr<webrtc::DataChannelInterface> channel)
       RTC_RUN_ON(signalingThread());
 
-  static void
-  onIceCandidate(net::WRTCNetworkManager* nm,
-                 std::shared_ptr<gloer::net::SessionPair> wsSess,
-                 const net::ws::SessionGUID& wsConnId,
-                 const webrtc::IceCandidateInterface* candidate); // RTC_RUN_ON(signaling_thread());
+  // queues local candidate, see flushIceCandidates_s
+  void onIceCandidate(const webrtc::IceCandidateInterface* candidate)
+      RTC_RUN_ON(signalingThread());
+
+  // sends queued local candidates to remote peer in one message
+  void flushIceCandidates_s() RTC_RUN_ON(signalingThread());
 
   void onAnswerCreated(webrtc::SessionDescriptionInterface* desc) RTC_RUN_ON(signalingThread());
 
@@ -162,6 +190,9 @@ public:
   static bool send(net::WRTCNetworkManager* nm, std::shared_ptr<WRTCSession> wrtcSess,
                    const std::string& data); // RTC_RUN_ON(thread_checker_);
 
+  static bool send(net::WRTCNetworkManager* nm, std::shared_ptr<WRTCSession> wrtcSess,
+                   const std::string& data, bool isBinary); // RTC_RUN_ON(thread_checker_);
+
   static bool
   sendQueued(net::WRTCNetworkManager* nm,
              std::shared_ptr<WRTCSession> wrtcSess); // RTC_GUARDED_BY(signaling_thread())
@@ -210,6 +241,13 @@ public:
 
   void CreateAnswer() RTC_RUN_ON(signalingThread());
 
+  /**
+   * Renders answer to |offerSdp| from SdpTemplateCache and applies it like answer
+   * created by CreateAnswer. Returns false if no template known for offer shape,
+   * then answer created by following CreateAnswer becomes template.
+   **/
+  bool createAnswerFromTemplate(const std::string& offerSdp) RTC_RUN_ON(signalingThread());
+
   void CreateOffer() RTC_RUN_ON(signalingThread()); // TODO: use in client
 
   bool fullyCreated() const; // RTC_RUN_ON(FullyCreatedMutex_); // RTC_RUN_ON(signaling_thread());
@@ -235,6 +273,15 @@ public:
 
   bool InitializePortAllocator_n() RTC_RUN_ON(networkThread());
 
+  // port allocator created in advance on network thread, see WRTCServer::runSessionSetup_n
+  void setPortAllocator(std::unique_ptr<cricket::BasicPortAllocator> portAllocator);
+
+  // rtc::TimeMicros() when client offer was received, enables setup latency tracking
+  void setOfferReceivedTime(int64_t offerReceivedUs);
+
+  // records latency of connection establishment stage (only once per stage)
+  void onSetupStage_s(const SessionSetupStage& stage) RTC_RUN_ON(signalingThread());
+
   rtc::Thread* networkThread() const;
 
   rtc::Thread* workerThread() const;
@@ -251,21 +298,27 @@ public:
 
   void subDataChannelCount_s(uint32_t count) RTC_RUN_ON(signalingThread());
 
+  void addIceCandidates_s(
+      const std::vector<std::unique_ptr<webrtc::IceCandidateInterface>>& candidates)
+      RTC_RUN_ON(signalingThread());
+
 private:
   // rtc::CriticalSection FullyCreatedMutex_;
   // https://stackoverflow.com/questions/7223164/is-mutex-needed-to-synchronize-a-simple-flag-between-pthreads
   std::atomic<bool> isFullyCreated_ = false;
   // bool isFullyCreated_ RTC_GUARDED_BY(FullyCreatedMutex_) = false; // TODO AtomicBool
 
-  /**
-   * 16 Kbyte for the highest throughput, while also being the most portable one
-   * @see viblast.com/blog/2015/2/5/webrtc-data-channel-message-size/
-   **/
-  static size_t MAX_IN_MSG_SIZE_BYTE;
-  static size_t MAX_OUT_MSG_SIZE_BYTE;
-
   net::WRTCNetworkManager* wrtc_nm_;
 
+  // limit of incoming and outgoing messages, see ServerConfig::wrtcMaxMessageBytes_
+  const size_t maxMessageBytes_;
+
+  // NOTE: nullptr if rate limits are disabled, accessed only on signaling thread
+  std::unique_ptr<SessionRateLimiter> rateLimiter_;
+
+  // PeerConnectionFactory and threads used by session, owned by WRTCServer
+  PeerFactoryContext* peerFactory_;
+
   //net::WSServerNetworkManager* ws_nm_;
 
   // wrtc session requires ws session (only at creation time)
@@ -288,17 +341,37 @@ private:
    * without locks.
    **/
 
-  ::folly::ProducerConsumerQueue<std::shared_ptr<const std::string>> sendQueue_{MAX_SENDQUEUE_SIZE};
+  ::folly::ProducerConsumerQueue<QueuedMessage> sendQueue_{MAX_SENDQUEUE_SIZE};
   //std::vector<std::shared_ptr<const std::string>> sendQueue_;
 
   bool isClosing_ RTC_GUARDED_BY(signalingThread());
 
-  std::unique_ptr<cricket::BasicPortAllocator> portAllocator_;
+  // DTLS certificate of PeerConnection, fingerprint of answers rendered from template
+  rtc::scoped_refptr<rtc::RTCCertificate> certificate_ RTC_GUARDED_BY(signalingThread());
 
-  bool enableEnumeratingAllNetworkInterfaces_{true};
+  // offer shape without answer template, answer created by CreateAnswer is learned
+  std::string answerTemplateShape_ RTC_GUARDED_BY(signalingThread());
+
+  // created on network thread, moved to PeerConnection in createPeerConnection
+  std::unique_ptr<cricket::BasicPortAllocator> portAllocator_;
 
   bool isSendBusy_ RTC_GUARDED_BY(signalingThread()) = false;
 
+  // 0 means setup latency not tracked (session created by offer from server)
+  int64_t offerReceivedUs_ = 0;
+
+  // bit mask of SessionSetupStage already recorded
+  uint32_t recordedSetupStages_ RTC_GUARDED_BY(signalingThread()) = 0;
+
+  struct PendingIceCandidate {
+    std::string candidate;
+    std::string sdpMid;
+    int sdpMLineIndex = 0;
+  };
+
+  // local candidates waiting for batch window, see onIceCandidate
+  std::vector<PendingIceCandidate> pendingIceCandidates_ RTC_GUARDED_BY(signalingThread());
+
   const uint64_t MAX_TO_BUFFER_BYTES{1024 * 1024};
 
   uint32_t dataChannelCount_{0};
@@ -307,10 +380,6 @@ private:
   // class are called from the same thread.
   rtc::ThreadChecker thread_checker_;
 
-  uint16_t minPort_ = 0;
-
-  uint16_t maxPort_ = 65535;
-
   RTC_DISALLOW_COPY_AND_ASSIGN(WRTCSession);
 };
 
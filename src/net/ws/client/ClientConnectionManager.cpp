@@ -67,7 +67,7 @@ void ClientConnectionManager::addCallback(const ws::WsNetworkOperation& op, cons
  * @param id id of session to be removed
  */
 void ClientConnectionManager::unregisterSession(const ws::SessionGUID& id) {
-  LOG(WARNING) << "unregisterSession for id = " << static_cast<std::string>(id);
+  GLOG(WS, INFO) << "unregisterSession for id = " << static_cast<std::string>(id);
   const ws::SessionGUID idCopy = id; // unknown lifetime, use idCopy
   std::shared_ptr<SessionPair> sess = getSessById(idCopy);
 
@@ -101,7 +101,7 @@ void ClientConnectionManager::unregisterSession(const ws::SessionGUID& id) {
  * sm->sendToAll(msg);
  **/
 void ClientConnectionManager::sendToAll(const std::string& message) {
-  LOG(WARNING) << "ClientConnectionManager::sendToAll:" << message;
+  GLOG_PAYLOAD(WS) << "ClientConnectionManager::sendToAll: " << message;
   {
     // NOTE: don`t call getSessions == lock in loop
     const auto sessionsCopy = sm_.getSessions();
@@ -37,13 +37,9 @@ ClientInputCallbacks::ClientInputCallbacks() {}
 
 ClientInputCallbacks::~ClientInputCallbacks() {}
 
-std::map<ws::WsNetworkOperation, ClientNetworkOperationCallback> ClientInputCallbacks::getCallbacks() const {
-  return operationCallbacks_;
-}
-
 void ClientInputCallbacks::addCallback(const ws::WsNetworkOperation& op,
                                    const ClientNetworkOperationCallback& cb) {
-  operationCallbacks_[op] = cb;
+  operationCallbacks_[op.operationCode_._to_integral()] = cb;
 }
 } // namespace ws
 } // namespace net
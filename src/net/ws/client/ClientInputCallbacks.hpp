@@ -68,8 +68,6 @@ public:
 
   ~ClientInputCallbacks();
 
-  std::map<ws::WsNetworkOperation, ClientNetworkOperationCallback> getCallbacks() const override;
-
   void addCallback(const ws::WsNetworkOperation& op, const ClientNetworkOperationCallback& cb) override;
 };
 
@@ -66,7 +66,7 @@ ClientSession::~ClientSession() {
   // LOG(INFO) << "~ClientSession";
   const ws::SessionGUID wsConnId = getId(); // remember id before session deletion
 
-  close();
+  // NOTE: no close() here, it needs shared_from_this, socket is closed by ws_ destructor
 
   if (!onCloseCallback_) {
     LOG(WARNING) << "WRTCSession::onDataChannelMessage: Not set onMessageCallback_!";
@@ -381,12 +381,16 @@ void ClientSession::close() {
     // LOG(WARNING) << "Close error: Tried to close already closed webSocket, ignoring...";
     return;
   }
-  /*boost::system::error_code errorCode;
-  ws_.close(boost::beast::websocket::close_reason(boost::beast::websocket::close_code::normal),
-            errorCode);
-  if (errorCode) {
-    LOG(WARNING) << "ClientSession: Close error: " << errorCode.message();
-  }*/
+
+  // NOTE: may be called from any thread, stream is used only on strand of ws_
+  ::boost::asio::post(ws_.get_executor(),
+                      beast::bind_front_handler(&ClientSession::do_close, shared_from_this()));
+}
+
+void ClientSession::do_close() {
+  if (!ws_.is_open()) {
+    return;
+  }
 
   // Close the WebSocket connection
   ws_.async_close(websocket::close_code::normal,
@@ -450,7 +454,7 @@ void ClientSession::on_read(beast::error_code ec, std::size_t bytes_transferred)
   }
 
   if (ec)
-    on_session_fail(ec, "read");
+    return on_session_fail(ec, "read");
 
   // Note that there is activity
   // onRemoteActivity();
@@ -484,7 +488,7 @@ void ClientSession::on_read(beast::error_code ec, std::size_t bytes_transferred)
     return;
   }
 
-  LOG(WARNING) << "ClientSession on_read: " << data;
+  GLOG_PAYLOAD(WS) << "ClientSession on_read: " << data;
 
   onMessageCallback_(getId(), data);
 
@@ -550,42 +554,37 @@ void ClientSession::on_write(beast::error_code ec, std::size_t bytes_transferred
 
   if (!sendQueue_.isEmpty()) {
     // Remove the already written string from the queue
-    // sendQueue_.erase(sendQueue_.begin());
     sendQueue_.popFront();
   }
 
   if (!sendQueue_.isEmpty()) {
+    do_write();
+  } else {
+    GLOG(WS, DEBUG) << "write send_queue_.empty()";
+    isSendBusy_ = false;
+  }
+}
 
-    if (!sendQueue_.frontPtr() || !sendQueue_.frontPtr()->get()) {
-      LOG(WARNING) << "ws: invalid sendQueue_.frontPtr()";
-      return;
-    }
-
-    // std::shared_ptr<const std::string> dp = *(sendQueue_.frontPtr());
-    std::shared_ptr<const std::string> dp;
-    sendQueue_.read(dp);
-
-    if (!dp || !dp.get()) {
-      LOG(WARNING) << "invalid sendQueue_.front()) ";
-      return;
-    }
+void ClientSession::do_write() {
+  RTC_DCHECK(!sendQueue_.isEmpty());
 
-    // LOG(INFO) << "write buffer: " << *dp;
-
-    // This controls whether or not outgoing message opcodes are set to binary or text.
-    ws_.text(true); // TODO: ws().text(derived().ws().got_text());
-    ws_.async_write(
-        ::boost::asio::buffer(*dp),
-        /*::boost::asio::bind_executor(strand_, std::bind(&ClientSession::on_write, shared_from_this(),
-                                                std::placeholders::_1, std::placeholders::_2)));
-        */
-        beast::bind_front_handler(
-                        &ClientSession::on_write,
-                        shared_from_this()));
-  } else {
-    LOG(INFO) << "write send_queue_.empty()";
+  if (!sendQueue_.frontPtr() || !sendQueue_.frontPtr()->get()) {
+    LOG(WARNING) << "ws: invalid sendQueue_.frontPtr()";
+    sendQueue_.popFront();
     isSendBusy_ = false;
+    return;
   }
+
+  // NOTE: message is removed from queue in on_write, queue keeps buffer alive while writing
+  const std::shared_ptr<const std::string>& dp = *sendQueue_.frontPtr();
+
+  // This controls whether or not outgoing message opcodes are set to binary or text.
+  ws_.text(true); // TODO: ws().text(derived().ws().got_text());
+  ws_.async_write(
+      ::boost::asio::buffer(*dp),
+      beast::bind_front_handler(
+                      &ClientSession::on_write,
+                      shared_from_this()));
 }
 
 /**
@@ -608,56 +607,28 @@ void ClientSession::send(const std::string& ss) {
     return;
   }
 
-  // TODO: use folly fixed size queue
-  if (!sendQueue_.isFull()) {
-    sendQueue_.write(ssShared);
-  } else {
-    // Too many messages in queue
-    LOG(WARNING) << "send_queue_ isFull!";
-    return;
-  }
-
-  // Are we already writing?
-  /*if (sendQueue_.size() > 1) {
-    LOG(INFO) << "send_queue_.size() > 1";
-    return;
-  }*/
+  // NOTE: send() may be called from any thread, queue is used only on strand of ws_
+  ::boost::asio::post(ws_.get_executor(),
+                      beast::bind_front_handler(&ClientSession::on_send, shared_from_this(),
+                                                std::move(ssShared)));
+}
 
+void ClientSession::on_send(std::shared_ptr<const std::string> ss) {
   if (!isOpen()) {
     LOG(WARNING) << "!ws_.is_open()";
     return;
   }
 
-  if (!isSendBusy_ && !sendQueue_.isEmpty()) {
-    isSendBusy_ = true;
-
-    if (!sendQueue_.frontPtr() || !sendQueue_.frontPtr()->get()) {
-      LOG(WARNING) << "ws: invalid sendQueue_.frontPtr()";
-      return;
-    }
-
-    // std::shared_ptr<const std::string> dp = *(sendQueue_.frontPtr());
-    std::shared_ptr<const std::string> dp;
-    sendQueue_.read(dp);
-
-    if (!dp || !dp.get()) {
-      LOG(WARNING) << "invalid sendQueue_.front()) ";
-      return;
-    }
+  if (!sendQueue_.write(std::move(ss))) {
+    // Too many messages in queue
+    GLOG_EVERY_MS(WS, WARNING, 1000) << "send_queue_ isFull!";
+    return;
+  }
 
-    // We are not currently writing, so send this immediately
-    {
-      // This controls whether or not outgoing message opcodes are set to binary or text.
-      ws_.text(true); // TODO: ws().text(derived().ws().got_text());
-      ws_.async_write(
-          ::boost::asio::buffer(*dp),
-          /*::boost::asio::bind_executor(strand_, std::bind(&ClientSession::on_write, shared_from_this(),
-                                                  std::placeholders::_1, std::placeholders::_2)));
-          */
-          beast::bind_front_handler(
-                          &ClientSession::on_write,
-                          shared_from_this()));
-    }
+  // Are we already writing?
+  if (!isSendBusy_) {
+    isSendBusy_ = true;
+    do_write();
   }
 }
 
@@ -84,12 +84,20 @@ public:
 
   void on_accept(boost::beast::error_code ec);
 
+  void do_close();
+
   void on_close(beast::error_code ec);
 
   void do_read();
 
   void send(const std::string& ss) override;
 
+  // queues message on strand of session, starts write if idle
+  void on_send(std::shared_ptr<const std::string> ss);
+
+  // writes front of sendQueue_, message stays in queue until on_write
+  void do_write();
+
   bool isExpired() const override;
 
   void on_read(boost::beast::error_code ec, std::size_t bytes_transferred);
@@ -159,6 +167,7 @@ private:
 
   std::string host_;
 
+  // NOTE: accessed only on strand of ws_
   bool isSendBusy_;
 
   // std::vector<std::shared_ptr<const std::string>> sendQueue_;
@@ -168,7 +177,7 @@ private:
    * @see github.com/boostorg/beast/issues/1207
    *
    * @note ProducerConsumerQueue is a one producer and one consumer queue
-   * without locks.
+   * without locks. Both ends are used only on strand of ws_, see send()
    **/
   folly::ProducerConsumerQueue<std::shared_ptr<const std::string>> sendQueue_{MAX_SENDQUEUE_SIZE};
   //std::vector<std::shared_ptr<const std::string>> sendQueue_;
@@ -39,7 +39,9 @@ Listener::Listener(
   ::boost::asio::io_context& ioc,
   ::boost::asio::ssl::context& ctx,
   const ::boost::asio::ip::tcp::endpoint& endpoint,
-  std::shared_ptr<std::string const> doc_root, net::WSServerNetworkManager* nm)
+  std::shared_ptr<std::string const> doc_root, net::WSServerNetworkManager* nm,
+  const std::string& metricsRoute, const std::string& traceRoute,
+  std::shared_ptr<RateLimiter> rateLimiter)
     : acceptor_(ioc)
       //, socket_(ioc)
       , ioc_(ioc)
@@ -47,6 +49,9 @@ Listener::Listener(
       , doc_root_(doc_root)
       , nm_(nm)
       , endpoint_(endpoint)
+      , metricsRoute_(metricsRoute)
+      , traceRoute_(traceRoute)
+      , rateLimiter_(std::move(rateLimiter))
       // , strand_(boost::asio::make_strand(ioc.get_executor()))
 {
   configureAcceptor();
@@ -347,7 +352,7 @@ void Listener::on_accept(beast::error_code ec, ::boost::asio::ip::tcp::socket so
       // constructed using the basic_stream_socket(io_service&) constructor.
       // boost.org/doc/libs/1_54_0/doc/html/boost_asio/reference/basic_stream_socket/basic_stream_socket/overload5.html
       auto newWsSession = std::make_shared<ServerSession>(
-        std::move(socket), ctx_, nm_, newSessId);
+        std::move(socket), ctx_, nm_, newSessId, metricsRoute_, traceRoute_, rateLimiter_);
       nm_->sessionManager().addSession(newSessId, newWsSession);
 
       if (!nm_->sessionManager().onNewSessCallback_) {
@@ -34,6 +34,8 @@
 namespace gloer {
 namespace net {
 
+class RateLimiter;
+
 //class NetworkManager;
 
 //class SessionBase;
@@ -53,7 +55,9 @@ public:
   Listener(boost::asio::io_context& ioc,
              ::boost::asio::ssl::context& ctx,
              const boost::asio::ip::tcp::endpoint& endpoint,
-             std::shared_ptr<std::string const> doc_root, net::WSServerNetworkManager* nm);
+             std::shared_ptr<std::string const> doc_root, net::WSServerNetworkManager* nm,
+             const std::string& metricsRoute = "", const std::string& traceRoute = "",
+             std::shared_ptr<RateLimiter> rateLimiter = nullptr);
 
   void configureAcceptor();
 
@@ -96,6 +100,15 @@ private:
 
   ::boost::asio::ssl::context& ctx_;
 
+  // HTTP route of metrics served by sessions, empty disables it
+  const std::string metricsRoute_;
+
+  // HTTP route of message traces served by sessions, empty disables it
+  const std::string traceRoute_;
+
+  // limits of incoming messages shared by sessions, nullptr disables limits
+  std::shared_ptr<RateLimiter> rateLimiter_;
+
   //bool enable_connection_aborted_ = true;
 
   // if < 0 => uses ::boost::asio::socket_base::max_listen_connections
@@ -3,7 +3,9 @@
 #include "algo/DispatchQueue.hpp"
 #include "config/ServerConfig.hpp"
 #include "log/Logger.hpp"
+#include "metrics/MessageTrace.hpp"
 #include "net/NetworkManagerBase.hpp"
+#include "net/RateLimiter.hpp"
 #include "net/wrtc/WRTCServer.hpp"
 #include "net/wrtc/WRTCSession.hpp"
 #include "net/wrtc/wrtc.hpp"
@@ -69,7 +71,7 @@ void ServerConnectionManager::addCallback(const ws::WsNetworkOperation& op, cons
  * sm->sendToAll(msg);
  **/
 void ServerConnectionManager::sendToAll(const std::string& message) {
-  LOG(WARNING) << "ServerConnectionManager::sendToAll:" << message;
+  GLOG_PAYLOAD(WS) << "ServerConnectionManager::sendToAll: " << message;
   {
     // NOTE: don`t call getSessions == lock in loop
     const auto sessionsCopy = sm_.getSessions();
@@ -164,8 +166,14 @@ void ServerConnectionManager::initListener(const config::ServerConfig& serverCon
     return;
   }
 
+  if (serverConfig.traceSampleRate_ > 0.0) {
+    metrics::MessageTracer::instance().setSampleRate(serverConfig.traceSampleRate_);
+  }
+
   // Create and launch a listening port
-  wsListener_ = std::make_shared<Listener>(ioc_, ctx_, tcpEndpoint, workdirPtr, nm_);
+  wsListener_ = std::make_shared<Listener>(
+      ioc_, ctx_, tcpEndpoint, workdirPtr, nm_, serverConfig.metricsRoute_,
+      serverConfig.traceRoute_, std::make_shared<RateLimiter>(serverConfig.wsRateLimit_, "ws"));
   if (!wsListener_ || !wsListener_.get()) {
     LOG(WARNING) << "ServerConnectionManager::runIocWsListener: Invalid iocWsListener_";
     return;
@@ -37,13 +37,9 @@ ServerInputCallbacks::ServerInputCallbacks() {}
 
 ServerInputCallbacks::~ServerInputCallbacks() {}
 
-std::map<ws::WsNetworkOperation, ServerNetworkOperationCallback> ServerInputCallbacks::getCallbacks() const {
-  return operationCallbacks_;
-}
-
 void ServerInputCallbacks::addCallback(const ws::WsNetworkOperation& op,
                                    const ServerNetworkOperationCallback& cb) {
-  operationCallbacks_[op] = cb;
+  operationCallbacks_[op.operationCode_._to_integral()] = cb;
 }
 
 } // namespace ws
@@ -57,12 +57,19 @@ struct ServerConfig;
 } // namespace config
 } // namespace gloer
 
+namespace gloer {
+namespace algo {
+class JsonMessage;
+} // namespace algo
+} // namespace gloer
+
 namespace gloer {
 namespace net {
 namespace ws {
 
+// NOTE: |message| is parsed once by dispatcher, callbacks must not parse it again
 typedef std::function<void(std::shared_ptr<SessionPair> session, net::WSServerNetworkManager* nm,
-                           std::shared_ptr<std::string> messageBuffer)>
+                           std::shared_ptr<const algo::JsonMessage> message)>
     ServerNetworkOperationCallback;
 
 class ServerInputCallbacks
@@ -72,8 +79,6 @@ public:
 
   ~ServerInputCallbacks();
 
-  std::map<ws::WsNetworkOperation, ServerNetworkOperationCallback> getCallbacks() const override;
-
   void addCallback(const ws::WsNetworkOperation& op, const ServerNetworkOperationCallback& cb) override;
 };
 
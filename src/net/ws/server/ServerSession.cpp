@@ -1,8 +1,12 @@
 #include "net/ws/server/ServerSession.hpp" // IWYU pragma: associated
 #include "net/ws/server/ServerSessionManager.hpp"
 #include "algo/DispatchQueue.hpp"
+#include "log/EventLog.hpp"
 #include "log/Logger.hpp"
+#include "metrics/MessageTrace.hpp"
+#include "metrics/Metrics.hpp"
 #include "net/NetworkManagerBase.hpp"
+#include "net/RateLimiter.hpp"
 #include "net/wrtc/WRTCServer.hpp"
 #include "net/wrtc/WRTCSession.hpp"
 #include "net/ws/server/ServerConnectionManager.hpp"
@@ -50,22 +54,59 @@ namespace gloer {
 namespace net {
 namespace ws {
 
+namespace {
+
+// NOTE: totals of all WS sessions, per-session series would grow with number of clients
+struct WsSessionMetrics {
+  metrics::Counter& bytesIn;
+  metrics::Counter& bytesOut;
+  metrics::Counter& messagesIn;
+  metrics::Counter& messagesOut;
+  metrics::Counter& dropsQueueFull;
+  metrics::Counter& dropsTooBig;
+  metrics::Histogram& sendQueueDepth;
+  metrics::Counter& metricsRequests;
+};
+
+static WsSessionMetrics& wsSessionMetrics() {
+  auto& registry = metrics::MetricsRegistry::instance();
+  static WsSessionMetrics sessionMetrics{
+      registry.counter("gloer_ws_received_bytes_total", "Bytes of WebSocket messages received"),
+      registry.counter("gloer_ws_sent_bytes_total", "Bytes of WebSocket messages sent"),
+      registry.counter("gloer_ws_received_messages_total", "WebSocket messages received"),
+      registry.counter("gloer_ws_sent_messages_total", "WebSocket messages sent"),
+      registry.counter("gloer_ws_dropped_messages_total", "WebSocket messages dropped",
+                       "reason=\"queue_full\""),
+      registry.counter("gloer_ws_dropped_messages_total", "WebSocket messages dropped",
+                       "reason=\"too_big\""),
+      registry.histogram("gloer_ws_send_queue_depth",
+                         "Send queue depth of WebSocket session after enqueue"),
+      registry.counter("gloer_metrics_requests_total", "HTTP requests of metrics route")};
+  return sessionMetrics;
+}
+
+} // namespace
+
 // @note ::tcp::socket socket represents the local end of a connection between two peers
 // NOTE: Following the std::move, the moved-from object is in the same state
 // as if constructed using the basic_stream_socket(io_service&) constructor.
 // boost.org/doc/libs/1_54_0/doc/html/boost_asio/reference/basic_stream_socket/basic_stream_socket/overload5.html
 ServerSession::ServerSession(boost::asio::ip::tcp::socket&& socket,
   ::boost::asio::ssl::context& ctx, net::WSServerNetworkManager* nm,
-  const ws::SessionGUID& id)
+  const ws::SessionGUID& id, const std::string& metricsRoute, const std::string& traceRoute,
+  std::shared_ptr<RateLimiter> rateLimiter)
     : SessionPair(id)
       , ctx_(ctx)
       , ws_(std::move(socket))
+      , readDelayTimer_(ws_.get_executor())
       //, ws_(boost::asio::make_strand(ioc))
       /* after ws_ */
       //strand_(boost::asio::make_strand(ws_.get_executor())),
       , nm_(nm)
       //timer_(ws_.get_executor().context(), (std::chrono::steady_clock::time_point::max)()),
       , isSendBusy_(false)
+      , metricsRoute_(metricsRoute)
+      , traceRoute_(traceRoute)
       //, resolver_(socket.get_executor().context())
       // , resolver_(boost::asio::make_strand(ioc))
 {
@@ -81,6 +122,18 @@ ServerSession::ServerSession(boost::asio::ip::tcp::socket&& socket,
 
   RTC_DCHECK_LT(static_cast<std::string>(id).length(), MAX_ID_LEN);
 
+  {
+    beast::error_code ec;
+    const auto endpoint = beast::get_lowest_layer(ws_).socket().remote_endpoint(ec);
+    if (!ec) {
+      remoteAddress_ = endpoint.address().to_string();
+    }
+  }
+
+  if (rateLimiter) {
+    rateLimiter_ = rateLimiter->createSessionLimiter(remoteAddress_);
+  }
+
   // TODO: SSL as in
   // github.com/vinniefalco/beast/blob/master/example/server-framework/main.cpp
   // Set options before performing the handshake.
@@ -305,13 +358,86 @@ void ServerSession::start_accept() {
       strand_, std::bind(&ServerSession::on_accept, shared_from_this(), std::placeholders::_1)));
   */
 
-  // Accept the websocket handshake
-  ws_.async_accept(
+  if (metricsRoute_.empty()) {
+    // Accept the websocket handshake
+    ws_.async_accept(
+        beast::bind_front_handler(
+            &ServerSession::on_accept,
+            shared_from_this()));
+    return;
+  }
+
+  // NOTE: HTTP request is read first, so plain HTTP routes share port with WebSockets
+  beast::get_lowest_layer(ws_).expires_after(std::chrono::seconds(30));
+  http::async_read(
+      ws_.next_layer(), httpBuffer_, httpRequest_,
       beast::bind_front_handler(
-          &ServerSession::on_accept,
+          &ServerSession::on_http_request,
           shared_from_this()));
 }
 
+void ServerSession::on_http_request(beast::error_code ec, std::size_t bytes_transferred) {
+  boost::ignore_unused(bytes_transferred);
+
+  if (ec)
+    return on_session_fail(ec, "http_read");
+
+  // websocket stream has own timeouts
+  beast::get_lowest_layer(ws_).expires_never();
+
+  if (websocket::is_upgrade(httpRequest_)) {
+    // Accept the websocket handshake
+    ws_.async_accept(
+        httpRequest_,
+        beast::bind_front_handler(
+            &ServerSession::on_accept,
+            shared_from_this()));
+    return;
+  }
+
+  httpResponse_.version(httpRequest_.version());
+  httpResponse_.keep_alive(false);
+  httpResponse_.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+  if (httpRequest_.method() == http::verb::get && httpRequest_.target() == metricsRoute_) {
+    wsSessionMetrics().metricsRequests.inc();
+    httpResponse_.result(http::status::ok);
+    httpResponse_.set(http::field::content_type, "text/plain; version=0.0.4");
+    httpResponse_.body() = metrics::MetricsRegistry::instance().toPrometheusText();
+  } else if (httpRequest_.method() == http::verb::get && !traceRoute_.empty() &&
+             httpRequest_.target() == traceRoute_) {
+    httpResponse_.result(http::status::ok);
+    httpResponse_.set(http::field::content_type, "application/json");
+    httpResponse_.body() = metrics::MessageTracer::instance().toChromeTraceJson();
+  } else {
+    httpResponse_.result(http::status::not_found);
+    httpResponse_.set(http::field::content_type, "text/plain");
+    httpResponse_.body() = "not found";
+  }
+  httpResponse_.prepare_payload();
+
+  beast::get_lowest_layer(ws_).expires_after(std::chrono::seconds(30));
+  http::async_write(
+      ws_.next_layer(), httpResponse_,
+      beast::bind_front_handler(
+          &ServerSession::on_http_write,
+          shared_from_this()));
+}
+
+void ServerSession::on_http_write(beast::error_code ec, std::size_t bytes_transferred) {
+  boost::ignore_unused(bytes_transferred);
+
+  if (ec)
+    return on_session_fail(ec, "http_write");
+
+  // plain HTTP request served, connection is not upgraded
+  beast::error_code shutdownEc;
+  beast::get_lowest_layer(ws_).socket().shutdown(::boost::asio::ip::tcp::socket::shutdown_send,
+                                                 shutdownEc);
+
+  /// \note must free shared pointer and close connection in destructor
+  nm_->sessionManager().unregisterSession(getId());
+}
+
 #if 0
 void ServerSession::on_control_callback(::websocket::frame_type kind, beast::string_view payload) {
   // LOG(INFO) << "WS on_control_callback";
@@ -540,8 +666,35 @@ void ServerSession::on_read(beast::error_code ec, std::size_t bytes_transferred)
     return;
   }
 
+  wsSessionMetrics().bytesIn.inc(recievedBuffer_.size());
+  wsSessionMetrics().messagesIn.inc();
+
+  // NOTE: limits are checked before parsing to keep cost of flood low
+  TokenBucket::clock::duration readDelay = TokenBucket::clock::duration::zero();
+  const RateLimitVerdict verdict =
+      rateLimiter_ ? rateLimiter_->check(recievedBuffer_.size(), readDelay)
+                   : RateLimitVerdict::ALLOW;
+  if (verdict == RateLimitVerdict::DROP) {
+    GLOG_EVERY_MS(WS, WARNING, 1000)
+        << "ServerSession::on_read: dropped message over rate limit, session "
+        << static_cast<const std::string&>(getId());
+    recievedBuffer_.consume(recievedBuffer_.size());
+    do_read();
+    return;
+  }
+  if (verdict == RateLimitVerdict::DISCONNECT) {
+    LOG(WARNING) << "ServerSession::on_read: closing session over rate limit "
+                 << static_cast<const std::string&>(getId());
+    recievedBuffer_.consume(recievedBuffer_.size());
+    const ws::SessionGUID copyId = getId();
+    /// \note must free shared pointer and close connection in destructor
+    nm_->sessionManager().unregisterSession(copyId);
+    return;
+  }
+
   if (recievedBuffer_.size() > MAX_IN_MSG_SIZE_BYTE) {
     LOG(WARNING) << "ServerSession::on_read: Too big messageBuffer of size " << recievedBuffer_.size();
+    wsSessionMetrics().dropsTooBig.inc();
     return;
   }
 
@@ -554,22 +707,91 @@ void ServerSession::on_read(beast::error_code ec, std::size_t bytes_transferred)
   // handleIncomingJSON(sharedBuffer);
 
   // handleIncomingJSON(data);
-  if (!onMessageCallback_) {
+  if (!onMessageCallback_ && !onBinaryMessageCallback_) {
     LOG(WARNING) << "ServerSession::on_read: Not set onMessageCallback_!";
     return;
   }
 
-  LOG(WARNING) << "WsSession on_read: " << data;
+  GLOG_PAYLOAD(WS) << "WsSession on_read: " << data;
+  GLOG_EVENT(WS, DEBUG, "ws session {} read {} bytes", static_cast<const std::string&>(getId()),
+             data.size());
 
-  onMessageCallback_(getId(), data);
+  // handler dispatches message on this thread, trace follows it, see MessageTracer
+  metrics::MessageTracer::Scope traceScope(
+      metrics::MessageTracer::instance().begin(static_cast<const std::string&>(getId())));
+
+  // binary-aware handler takes precedence, see SetOnBinaryMessageHandler
+  if (onBinaryMessageCallback_) {
+    onBinaryMessageCallback_(getId(), data, ws_.got_binary());
+  } else {
+    onMessageCallback_(getId(), data);
+  }
 
   // Clear the buffer
   recievedBuffer_.consume(recievedBuffer_.size());
 
+  if (verdict == RateLimitVerdict::DELAY) {
+    // NOTE: TCP flow control slows down peer while read waits
+    readDelayTimer_.expires_after(readDelay);
+    readDelayTimer_.async_wait(
+        beast::bind_front_handler(&ServerSession::on_read_delay, shared_from_this()));
+    return;
+  }
+
+  if (pauseReadIfRequested()) {
+    return;
+  }
+
   // Do another read
   do_read();
 }
 
+void ServerSession::on_read_delay(beast::error_code ec) {
+  if (ec == ::boost::asio::error::operation_aborted) {
+    return;
+  }
+
+  if (!isOpen()) {
+    return;
+  }
+
+  if (pauseReadIfRequested()) {
+    return;
+  }
+
+  do_read();
+}
+
+bool ServerSession::pauseReadIfRequested() {
+  if (!onReadPauseCallback_ || !onReadPauseCallback_(getId())) {
+    return false;
+  }
+  // NOTE: unread data stays in socket buffers, TCP flow control slows down peer
+  isReadPaused_ = true;
+  GLOG(WS, DEBUG) << "ServerSession: paused reading of session "
+                  << static_cast<const std::string&>(getId());
+  return true;
+}
+
+void ServerSession::resumeRead() {
+  // NOTE: called from game thread, reading continues on strand of session
+  ::boost::asio::post(ws_.get_executor(),
+                      beast::bind_front_handler(&ServerSession::on_read_resume, shared_from_this()));
+}
+
+void ServerSession::on_read_resume() {
+  if (!isReadPaused_) {
+    return;
+  }
+  isReadPaused_ = false;
+
+  if (!isOpen()) {
+    return;
+  }
+
+  do_read();
+}
+
 /*std::shared_ptr<algo::DispatchQueue> ServerSession::getWRTCQueue() const {
   return getRunner()->getWRTCQueue();
 }*/
@@ -623,6 +845,9 @@ void ServerSession::on_write(beast::error_code ec, std::size_t bytes_transferred
     return on_session_fail(ec, "write");
   }
 
+  wsSessionMetrics().bytesOut.inc(bytes_transferred);
+  wsSessionMetrics().messagesOut.inc();
+
   if (!isOpen()) {
     LOG(WARNING) << "!ws_.is_open()";
     //on_session_fail(ec, "timeout");
@@ -631,43 +856,42 @@ void ServerSession::on_write(beast::error_code ec, std::size_t bytes_transferred
   }
 
   if (!sendQueue_.isEmpty()) {
+    if (const uint64_t traceId = sendQueue_.frontPtr()->traceId) {
+      metrics::MessageTracer::instance().record(traceId, metrics::TraceStage::WRITE_COMPLETE);
+    }
     // Remove the already written string from the queue
-    // sendQueue_.erase(sendQueue_.begin());
     sendQueue_.popFront();
   }
 
   if (!sendQueue_.isEmpty()) {
+    do_write();
+  } else {
+    GLOG(WS, DEBUG) << "write send_queue_.empty()";
+    isSendBusy_ = false;
+  }
+}
 
-    if (!sendQueue_.frontPtr() || !sendQueue_.frontPtr()->get()) {
-      LOG(WARNING) << "ws: invalid sendQueue_.frontPtr()";
-      return;
-    }
-
-    // std::shared_ptr<const std::string> dp = *(sendQueue_.frontPtr());
-    std::shared_ptr<const std::string> dp;
-    sendQueue_.read(dp);
-
-    if (!dp || !dp.get()) {
-      LOG(WARNING) << "invalid sendQueue_.front()) ";
-      return;
-    }
-
-    // LOG(INFO) << "write buffer: " << *dp;
+void ServerSession::do_write() {
+  RTC_DCHECK(!sendQueue_.isEmpty());
 
-    // This controls whether or not outgoing message opcodes are set to binary or text.
-    ws_.text(true); // TODO: ws().text(derived().ws().got_text());
-    ws_.async_write(
-        ::boost::asio::buffer(*dp),
-        /*::boost::asio::bind_executor(strand_, std::bind(&ServerSession::on_write, shared_from_this(),
-                                                std::placeholders::_1, std::placeholders::_2)));
-        */
-        beast::bind_front_handler(
-                        &ServerSession::on_write,
-                        shared_from_this()));
-  } else {
-    LOG(INFO) << "write send_queue_.empty()";
+  if (!sendQueue_.frontPtr() || !sendQueue_.frontPtr()->data) {
+    LOG(WARNING) << "ws: invalid sendQueue_.frontPtr()";
+    sendQueue_.popFront();
     isSendBusy_ = false;
+    return;
   }
+
+  // NOTE: message is removed from queue in on_write, queue keeps buffer alive while writing
+  const std::shared_ptr<const std::string>& dp = sendQueue_.frontPtr()->data;
+
+  // This controls whether or not outgoing message opcodes are set to binary or text.
+  // NOTE: session uses binary frames only if client negotiated binary codec
+  ws_.text(codecType() != MessageCodecType::BINARY);
+  ws_.async_write(
+      ::boost::asio::buffer(*dp),
+      beast::bind_front_handler(
+                      &ServerSession::on_write,
+                      shared_from_this()));
 }
 
 /**
@@ -687,24 +911,23 @@ void ServerSession::send(const std::string& ss) {
 
   if (ssShared->size() > MAX_OUT_MSG_SIZE_BYTE) {
     LOG(WARNING) << "ServerSession::send: Too big messageBuffer of size " << ssShared->size();
+    wsSessionMetrics().dropsTooBig.inc();
     return;
   }
 
-  // TODO: use folly fixed size queue
-  if (!sendQueue_.isFull()) {
-    sendQueue_.write(ssShared);
-  } else {
-    // Too many messages in queue
-    LOG(WARNING) << "send_queue_ isFull!";
-    return;
+  // NOTE: called by handler of traced message, see DispatchQueue::DispatchQueued
+  const uint64_t traceId = metrics::MessageTracer::current();
+  if (traceId) {
+    metrics::MessageTracer::instance().record(traceId, metrics::TraceStage::SEND_ENQUEUE);
   }
 
-  // Are we already writing?
-  /*if (sendQueue_.size() > 1) {
-    LOG(INFO) << "send_queue_.size() > 1";
-    return;
-  }*/
+  // NOTE: send() is called from game thread, queue is used only on strand of ws_
+  ::boost::asio::post(ws_.get_executor(),
+                      beast::bind_front_handler(&ServerSession::on_send, shared_from_this(),
+                                                std::move(ssShared), traceId));
+}
 
+void ServerSession::on_send(std::shared_ptr<const std::string> ss, uint64_t traceId) {
   if (!isOpen()) {
     LOG(WARNING) << "!ws_.is_open()";
     //beast::error_code ec(beast::error::timeout);
@@ -714,36 +937,18 @@ void ServerSession::send(const std::string& ss) {
     return;
   }
 
-  if (!isSendBusy_ && !sendQueue_.isEmpty()) {
-    isSendBusy_ = true;
-
-    if (!sendQueue_.frontPtr() || !sendQueue_.frontPtr()->get()) {
-      LOG(WARNING) << "ws: invalid sendQueue_.frontPtr()";
-      return;
-    }
-
-    // std::shared_ptr<const std::string> dp = *(sendQueue_.frontPtr());
-    std::shared_ptr<const std::string> dp;
-    sendQueue_.read(dp);
-
-    if (!dp || !dp.get()) {
-      LOG(WARNING) << "invalid sendQueue_.front()) ";
-      return;
-    }
+  if (!sendQueue_.write(QueuedMessage{std::move(ss), traceId})) {
+    // Too many messages in queue
+    GLOG_EVERY_MS(WS, WARNING, 1000) << "send_queue_ isFull!";
+    wsSessionMetrics().dropsQueueFull.inc();
+    return;
+  }
+  wsSessionMetrics().sendQueueDepth.record(sendQueue_.sizeGuess());
 
-    // We are not currently writing, so send this immediately
-    {
-      // This controls whether or not outgoing message opcodes are set to binary or text.
-      ws_.text(true); // TODO: ws().text(derived().ws().got_text());
-      ws_.async_write(
-          ::boost::asio::buffer(*dp),
-          /*::boost::asio::bind_executor(strand_, std::bind(&ServerSession::on_write, shared_from_this(),
-                                                  std::placeholders::_1, std::placeholders::_2)));
-          */
-          beast::bind_front_handler(
-                          &ServerSession::on_write,
-                          shared_from_this()));
-    }
+  // Are we already writing?
+  if (!isSendBusy_) {
+    isSendBusy_ = true;
+    do_write();
   }
 }
 
@@ -11,11 +11,13 @@
 #include <api/datachannelinterface.h>
 #include <boost/asio.hpp>
 #include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
 #include <boost/beast/websocket.hpp>
 #include <boost/beast/ssl.hpp>
 #include <cstddef>
 #include <cstdint>
 #include <folly/ProducerConsumerQueue.h>
+#include <memory>
 #include <net/core.hpp>
 #include <rapidjson/document.h>
 #include <string>
@@ -35,6 +37,9 @@ namespace net {
 
 //class NetworkManager;
 
+class RateLimiter;
+class SessionRateLimiter;
+
 namespace ws {
 class SessionGUID;
 class WSServer;
@@ -63,14 +68,27 @@ private:
   // We use Queue per connection
   static const size_t MAX_SENDQUEUE_SIZE = 120;
 
+  // message waiting in sendQueue_
+  struct QueuedMessage {
+    std::shared_ptr<const std::string> data;
+    // sampled message trace, see MessageTracer
+    uint64_t traceId = 0;
+  };
+
 public:
   ServerSession() = delete;
 
   // Take ownership of the socket
+  // NOTE: plain HTTP GET of |metricsRoute| is answered with metrics,
+  // GET of |traceRoute| with message traces, empty disables route.
+  // Incoming messages are limited by |rateLimiter|, nullptr disables limits
   explicit ServerSession(boost::asio::ip::tcp::socket&& socket,
     ::boost::asio::ssl::context& ctx,
     net::WSServerNetworkManager* nm,
-    const ws::SessionGUID& id);
+    const ws::SessionGUID& id,
+    const std::string& metricsRoute = "",
+    const std::string& traceRoute = "",
+    std::shared_ptr<RateLimiter> rateLimiter = nullptr);
 
   ~ServerSession();
 
@@ -91,6 +109,10 @@ public:
   void on_timer(boost::beast::error_code ec);
 #endif // 0
 
+  void on_http_request(boost::beast::error_code ec, std::size_t bytes_transferred);
+
+  void on_http_write(boost::beast::error_code ec, std::size_t bytes_transferred);
+
   void on_accept(boost::beast::error_code ec);
 
   void on_close(beast::error_code ec);
@@ -101,10 +123,24 @@ public:
 
   void send(const std::string& ss) override;
 
+  // queues message on strand of session, starts write if idle
+  void on_send(std::shared_ptr<const std::string> ss, uint64_t traceId);
+
+  // writes front of sendQueue_, message stays in queue until on_write
+  void do_write();
+
   bool isExpired() const override;
 
   void on_read(boost::beast::error_code ec, std::size_t bytes_transferred);
 
+  // continues reading after delay of rate limit
+  void on_read_delay(boost::beast::error_code ec);
+
+  void resumeRead() override;
+
+  // continues reading paused by onReadPauseCallback_, runs on strand of ws_
+  void on_read_resume();
+
   void on_write(boost::beast::error_code ec, std::size_t bytes_transferred);
 
   void on_ping(boost::beast::error_code ec);
@@ -124,6 +160,8 @@ public:
 
   bool isOpen() const override;
 
+  std::string remoteAddress() const override { return remoteAddress_; }
+
   bool fullyCreated() const { return isFullyCreated_; }
 
   //bool waitForConnect(std::size_t maxWait_ms) const;
@@ -153,6 +191,9 @@ private:
 
   bool isExpired_{false};
 
+  // asks onReadPauseCallback_, true if reading is paused until resumeRead()
+  bool pauseReadIfRequested();
+
   static size_t MAX_IN_MSG_SIZE_BYTE;
   static size_t MAX_OUT_MSG_SIZE_BYTE;
 
@@ -164,6 +205,18 @@ private:
   //boost::beast::websocket::stream<boost::asio::ip::tcp::socket> ws_;
   boost::beast::websocket::stream<boost::beast::tcp_stream> ws_;
 
+  // next read waits on it if session is over rate limit, see on_read
+  boost::asio::steady_timer readDelayTimer_;
+
+  // cached on creation, socket may be closed later
+  std::string remoteAddress_;
+
+  // NOTE: nullptr if rate limits are disabled, accessed only on strand of ws_
+  std::unique_ptr<SessionRateLimiter> rateLimiter_;
+
+  // NOTE: accessed only on strand of ws_, see pauseReadIfRequested
+  bool isReadPaused_{false};
+
   /**
    * I/O objects such as sockets and streams are not thread-safe. For efficiency, networking adopts
    * a model of using threads without explicit locking by requiring all access to I/O objects to be
@@ -176,10 +229,22 @@ private:
 
   boost::beast::multi_buffer recievedBuffer_;
 
+  // HTTP request read before WebSocket upgrade, see start_accept
+  boost::beast::flat_buffer httpBuffer_;
+
+  boost::beast::http::request<boost::beast::http::string_body> httpRequest_;
+
+  boost::beast::http::response<boost::beast::http::string_body> httpResponse_;
+
+  const std::string metricsRoute_;
+
+  const std::string traceRoute_;
+
   //boost::asio::steady_timer timer_;
 
   ::boost::asio::ssl::context& ctx_;
 
+  // NOTE: accessed only on strand of ws_
   bool isSendBusy_;
 
   // std::vector<std::shared_ptr<const std::string>> sendQueue_;
@@ -189,9 +254,9 @@ private:
    * @see github.com/boostorg/beast/issues/1207
    *
    * @note ProducerConsumerQueue is a one producer and one consumer queue
-   * without locks.
+   * without locks. Both ends are used only on strand of ws_, see send()
    **/
-  folly::ProducerConsumerQueue<std::shared_ptr<const std::string>> sendQueue_{MAX_SENDQUEUE_SIZE};
+  folly::ProducerConsumerQueue<QueuedMessage> sendQueue_{MAX_SENDQUEUE_SIZE};
   //std::vector<std::shared_ptr<const std::string>> sendQueue_;
 
   net::WSServerNetworkManager* nm_;
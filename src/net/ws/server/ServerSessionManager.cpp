@@ -15,7 +15,7 @@ namespace ws {
  * @param id id of session to be removed
  */
 void ServerSessionManager::unregisterSession(const ws::SessionGUID& id) {
-  LOG(WARNING) << "unregisterSession for id = " << static_cast<std::string>(id);
+  GLOG(WS, INFO) << "unregisterSession for id = " << static_cast<std::string>(id);
   const ws::SessionGUID idCopy = id; // unknown lifetime, use idCopy
   std::shared_ptr<SessionPair> sess = getSessById(idCopy);
 
@@ -7,8 +7,17 @@
 #include "algo/StringUtils.hpp"
 #include "config/ServerConfig.hpp"
 #include "log/Logger.hpp"
+#include "net/NetworkManagerBase.hpp"
+#include "net/SessionPair.hpp"
+#include "net/ws/SessionGUID.hpp"
+#include "net/ws/client/ClientConnectionManager.hpp"
+#include "net/ws/client/ClientSession.hpp"
+#include "net/ws/client/ClientSessionManager.hpp"
+#include "net/ws/server/ServerConnectionManager.hpp"
+#include "net/ws/server/ServerSessionManager.hpp"
 #include "storage/path.hpp"
 #include <algorithm>
+#include <atomic>
 #include <boost/asio.hpp>
 #include <boost/asio/bind_executor.hpp>
 #include <boost/asio/buffer.hpp>
@@ -21,12 +30,14 @@
 #include <boost/beast/http.hpp>
 #include <boost/beast/websocket.hpp>
 #include <boost/beast/websocket/ssl.hpp>
+#include <chrono>
 #include <cstddef>
 #include <cstdlib>
 #include <fstream>
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <net/core.hpp>
 #include <sstream>
 #include <streambuf>
@@ -300,6 +311,103 @@ SCENARIO("ssltest", "[ssltest]") {
   ioc.run();*/
 }
 
+SCENARIO("ws send queue", "[ws]") {
+  using namespace ::gloer::net;
+
+  // NOTE: burst is below MAX_SENDQUEUE_SIZE of sessions, so no message may be dropped
+  static constexpr size_t kMessages = 100;
+
+  const fs::path workDir = gloer::storage::getThisBinaryDirectoryPath();
+
+  gloer::config::ServerConfig serverConfig(fs::path{}, workDir);
+  serverConfig.address_ = ::net::ip::make_address("127.0.0.1");
+  serverConfig.wsPort_ = 8086;
+  serverConfig.threads_ = 1;
+
+  auto serverNM = std::make_shared<WSServerNetworkManager>(serverConfig);
+  serverNM->prepare(serverConfig);
+
+  // echo every message back from io thread of server session
+  // NOTE: raw pointer, handler is owned by serverNM
+  WSServerNetworkManager* serverNMPtr = serverNM.get();
+  serverNM->sessionManager().SetOnNewSessionHandler(
+      [serverNMPtr](std::shared_ptr<SessionPair> sess) {
+        sess->SetOnMessageHandler([serverNMPtr](const ws::SessionGUID& sessId,
+                                                const std::string& message) {
+          if (auto sessPtr = serverNMPtr->sessionManager().getSessById(sessId)) {
+            sessPtr->send(message);
+          }
+        });
+      });
+  serverNM->run(serverConfig);
+
+  gloer::config::ServerConfig clientConfig(fs::path{}, workDir);
+  clientConfig.threads_ = 1;
+
+  auto clientNM = std::make_shared<WSClientNetworkManager>(clientConfig);
+  clientNM->prepare(clientConfig);
+  // NOTE: io thread exits when io_context has no work, session connects after run()
+  auto workGuard = ::net::make_work_guard(clientNM->getRunner()->getIOC());
+  clientNM->run(clientConfig);
+
+  std::mutex receivedMutex;
+  std::vector<std::string> received;
+  std::atomic<bool> connected{false};
+
+  const ws::SessionGUID clientId(std::string{"send-queue-test"});
+  std::shared_ptr<ws::ClientSession> client = clientNM->getRunner()->addClientSession(clientId);
+  client->SetOnMessageHandler([&](const ws::SessionGUID&, const std::string& message) {
+    std::lock_guard<std::mutex> lock(receivedMutex);
+    received.push_back(message);
+  });
+  client->setCreatedCb([&connected](const std::string& state) {
+    if (state == "handshake") {
+      connected = true;
+    }
+  });
+  client->connectAsClient("127.0.0.1", "8086");
+
+  const auto connectEnd = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!connected.load() && std::chrono::steady_clock::now() < connectEnd) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  REQUIRE(connected.load());
+
+  // burst from thread other than io threads of both sessions
+  for (size_t i = 0; i < kMessages; i++) {
+    client->send(std::to_string(i));
+  }
+
+  const auto echoEnd = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (std::chrono::steady_clock::now() < echoEnd) {
+    {
+      std::lock_guard<std::mutex> lock(receivedMutex);
+      if (received.size() >= kMessages) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  {
+    // every queued message is written once and in order on both sides
+    std::lock_guard<std::mutex> lock(receivedMutex);
+    REQUIRE(received.size() == kMessages);
+    for (size_t i = 0; i < kMessages; i++) {
+      REQUIRE(received[i] == std::to_string(i));
+    }
+  }
+
+  client->close();
+  workGuard.reset();
+  clientNM->finish();
+  client.reset();
+  clientNM->sessionManager().unregisterSession(clientId);
+
+  serverNM->getRunner()->getIOC().stop();
+  serverNM->finish();
+}
+
 SCENARIO("matchers", "[matchers]") {
   REQUIRE_THAT("Hello olleH",
                Predicate<std::string>(
@@ -5,13 +5,30 @@
  */
 
 #include "algo/DispatchQueue.hpp"
+#include "algo/FairDispatchQueue.hpp"
+#include "algo/JsonMessage.hpp"
 #include "algo/NetworkOperation.hpp"
+#include "algo/TickManager.hpp"
+#include "config/ServerConfig.hpp"
+#include "log/EventLog.hpp"
+#include "metrics/MessageTrace.hpp"
+#include "metrics/Metrics.hpp"
+#include "net/MessageCodec.hpp"
+#include "net/RateLimiter.hpp"
+#include "net/SessionBase.hpp"
+#include "net/TrafficCapture.hpp"
+#include "net/schema/Messages.generated.hpp"
+#include "net/wrtc/SdpTemplateCache.hpp"
+#include "net/wrtc/WRTCSession.hpp"
 #include "storage/path.hpp"
 #include <chrono>
+#include <cstdio>
 #include <cstdlib>
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
 #include <string>
 #include <thread>
 #include <vector>
@@ -77,17 +94,136 @@ SCENARIO("utils", "[network]") {
     std::string dispatchResult = "0";
     testQueue->dispatch([&dispatchResult] { dispatchResult = "1"; });
     REQUIRE(dispatchResult == "0");
-    testQueue->DispatchQueued();
+    REQUIRE(testQueue->DispatchQueued() == 1);
     REQUIRE(dispatchResult == "1");
-    testQueue->DispatchQueued();
+    REQUIRE(testQueue->DispatchQueued() == 0);
     REQUIRE(dispatchResult == "1");
     testQueue->dispatch([&dispatchResult] { dispatchResult = "2"; });
     testQueue->dispatch([&dispatchResult] { dispatchResult = "3"; });
     REQUIRE(dispatchResult == "1");
-    testQueue->DispatchQueued();
+    REQUIRE(testQueue->DispatchQueued() == 2);
     REQUIRE(dispatchResult == "3");
   }
 
+  GIVEN("FairDispatchQueue") {
+    FairDispatchQueue queue(std::string{"fair test queue"}, /* sessionCapacity */ 2,
+                            /* quantum */ 1, /* tickBudget */ 3);
+    std::string order;
+    // messages of unknown session are dropped
+    REQUIRE(!queue.dispatch("chatty", [&order] { order += "c0"; }));
+    for (const char* sessId : {"chatty", "quiet", "a", "b", "closed"}) {
+      queue.addSession(sessId);
+    }
+    REQUIRE(queue.dispatch("chatty", [&order] { order += "c1"; }));
+    REQUIRE(queue.dispatch("chatty", [&order] { order += "c2"; }));
+    // full queue of session drops only its own messages
+    REQUIRE(!queue.dispatch("chatty", [&order] { order += "c3"; }));
+    REQUIRE(queue.dispatch("quiet", [&order] { order += "q1"; }));
+    REQUIRE(queue.sessionDropped("chatty") == 1);
+    REQUIRE(queue.sessionDropped("quiet") == 0);
+    REQUIRE(queue.droppingSessions().size() == 1);
+    REQUIRE(queue.sizeGuess() == 3);
+
+    // sessions take turns
+    REQUIRE(queue.DispatchQueued() == 3);
+    REQUIRE(order == "c1q1c2");
+    REQUIRE(queue.isEmpty());
+
+    // rest of messages over tick budget waits for next call
+    for (int i = 0; i < 2; i++) {
+      queue.dispatch("a", [&order] { order += "a"; });
+      queue.dispatch("b", [&order] { order += "b"; });
+    }
+    order.clear();
+    REQUIRE(queue.DispatchQueued() == 3);
+    REQUIRE(queue.sessionSize("a") + queue.sessionSize("b") == 1);
+    REQUIRE(queue.DispatchQueued() == 1);
+    REQUIRE(order == "abab");
+
+    // messages queued before session is removed still run
+    queue.dispatch("closed", [&order] { order += "x"; });
+    queue.removeSession("closed");
+    // late message of removed session doesn`t recreate its queue
+    REQUIRE(!queue.dispatch("closed", [&order] { order += "y"; }));
+    REQUIRE(queue.sessionSize("closed") == 0);
+    REQUIRE(queue.DispatchQueued() == 1);
+    REQUIRE(order == "ababx");
+  }
+
+  GIVEN("ServerConfig") {
+    gloer::config::ServerConfig config(::fs::path{}, ::fs::path{});
+    REQUIRE(config.validate());
+
+    config.wrtcMinPort_ = 50000;
+    config.wrtcMaxPort_ = 0;
+    REQUIRE(!config.validate());
+
+    config.wrtcMaxPort_ = 40000;
+    REQUIRE(!config.validate());
+
+    config.wrtcMaxPort_ = 50100;
+    REQUIRE(config.validate());
+  }
+
+  GIVEN("RateLimiter") {
+    using namespace gloer::net;
+    using namespace std::chrono_literals;
+    using gloer::config::RateLimitAction;
+    using gloer::config::RateLimitConfig;
+
+    // bucket of 10 tokens refills 1 token per 100ms
+    const TokenBucket::clock::time_point start = TokenBucket::clock::now();
+    TokenBucket bucket(10.0, 1.0, start);
+    for (int i = 0; i < 10; i++) {
+      REQUIRE(bucket.canTake(1.0, start));
+      bucket.take(1.0);
+    }
+    REQUIRE(!bucket.canTake(1.0, start));
+    REQUIRE(bucket.canTake(1.0, start + 100ms));
+
+    TokenBucket::clock::duration delay{};
+
+    // second session from same address is limited by address bucket
+    RateLimitConfig dropConfig;
+    dropConfig.sessionMessagesPerSec = 2.0;
+    dropConfig.addressMessagesPerSec = 3.0;
+    RateLimiter dropLimiter(dropConfig, "test");
+    auto first = dropLimiter.createSessionLimiter("10.0.0.1");
+    auto second = dropLimiter.createSessionLimiter("10.0.0.1");
+    REQUIRE(first->check(10, delay) == RateLimitVerdict::ALLOW);
+    REQUIRE(first->check(10, delay) == RateLimitVerdict::ALLOW);
+    REQUIRE(first->check(10, delay) == RateLimitVerdict::DROP);
+    REQUIRE(second->check(10, delay) == RateLimitVerdict::ALLOW);
+    REQUIRE(second->check(10, delay) == RateLimitVerdict::DROP);
+
+    // transport that can`t pause reads drops messages, bucket doesn`t go into debt
+    RateLimitConfig noDelayConfig;
+    noDelayConfig.sessionMessagesPerSec = 2.0;
+    noDelayConfig.action = RateLimitAction::DELAY;
+    RateLimiter noDelayLimiter(noDelayConfig, "test", /* canDelayReads */ false);
+    auto noDelay = noDelayLimiter.createSessionLimiter("");
+    REQUIRE(noDelay->check(1, delay) == RateLimitVerdict::ALLOW);
+    REQUIRE(noDelay->check(1, delay) == RateLimitVerdict::ALLOW);
+    for (int i = 0; i < 100; i++) {
+      REQUIRE(noDelay->check(1, delay) == RateLimitVerdict::DROP);
+    }
+
+    // delayed message is allowed, delay pays off debt of bucket
+    RateLimitConfig delayConfig;
+    delayConfig.sessionMessagesPerSec = 2.0;
+    delayConfig.action = RateLimitAction::DELAY;
+    RateLimiter delayLimiter(delayConfig, "test");
+    auto delayed = delayLimiter.createSessionLimiter("");
+    REQUIRE(delayed->check(1, delay) == RateLimitVerdict::ALLOW);
+    REQUIRE(delayed->check(1, delay) == RateLimitVerdict::ALLOW);
+    REQUIRE(delayed->check(1, delay) == RateLimitVerdict::DELAY);
+    REQUIRE(delay > 400ms);
+    REQUIRE(delay <= 500ms);
+
+    RateLimiter disabledLimiter(RateLimitConfig{}, "test");
+    REQUIRE(!disabledLimiter.createSessionLimiter("10.0.0.1"));
+  }
+
   GIVEN("NetworkOperation") {
     WS_OPCODE WS_OPCODE_CANDIDATE = WS_OPCODE::CANDIDATE;
     REQUIRE(Opcodes::opcodeToStr(WS_OPCODE_CANDIDATE) == "1");
@@ -95,5 +231,495 @@ SCENARIO("utils", "[network]") {
     REQUIRE(Opcodes::wsOpcodeFromStr("1")._to_integral() == 1);
     REQUIRE(WS_OPCODE_CANDIDATE._name() == Opcodes::wsOpcodeFromStr("1")._name());
     REQUIRE(Opcodes::wsOpcodeFromDescrStr("CANDIDATE")._to_integral() == 1);
+
+    uint32_t opcode = 0;
+    REQUIRE(Opcodes::parseOpcode("3", opcode));
+    REQUIRE(opcode == 3);
+    REQUIRE(Opcodes::parseOpcode("4294967295", opcode));
+    REQUIRE(opcode == 4294967295u);
+    REQUIRE(!Opcodes::parseOpcode("4294967296", opcode));
+    REQUIRE(!Opcodes::parseOpcode("", opcode));
+    REQUIRE(!Opcodes::parseOpcode("1a", opcode));
+    REQUIRE(!Opcodes::parseOpcode("-1", opcode));
+    REQUIRE(Opcodes::wsOpcodeFromStr("4") == +WS_OPCODE::CANDIDATE_BATCH);
+    REQUIRE(Opcodes::wsOpcodeFromStr("999") == +WS_OPCODE::TOTAL);
+  }
+
+  GIVEN("JsonMessage") {
+    const std::string offer = R"({"type":"2","payload":{"type":"offer","sdp":"v=0"}})";
+    JsonMessage message(offer);
+    REQUIRE(message.parse());
+    REQUIRE(message.isValid());
+    REQUIRE(std::string(message.getString("type")) == "2");
+    REQUIRE(message.getString("payload") == nullptr);
+    REQUIRE(std::string(message.document()["payload"]["sdp"].GetString()) == "v=0");
+    // text is serialized back from document, compact input round-trips
+    REQUIRE(message.str() == offer);
+
+    JsonMessage spacedMessage(R"({ "type" : "0", "ts" : 42 })");
+    REQUIRE(spacedMessage.parse());
+    REQUIRE(spacedMessage.str() == R"({"type":"0","ts":42})");
+
+    JsonMessage invalidMessage("[1,2");
+    REQUIRE(!invalidMessage.parse());
+    REQUIRE(invalidMessage.getString("type") == nullptr);
+  }
+
+  GIVEN("MessageCodec") {
+    using namespace gloer::net;
+    const BinaryCodec codec;
+    const std::string payload(200, 'x'); // length needs two varint bytes
+    const std::string frame = codec.encode(1, 7, payload);
+    REQUIRE(frame.size() == 2 + 2 + 2 + payload.size());
+    REQUIRE(MessageCodec::detect(frame, true) == MessageCodecType::BINARY);
+
+    DecodedMessage decoded;
+    REQUIRE(codec.decode(frame, decoded));
+    REQUIRE(decoded.opcode == 1);
+    REQUIRE(decoded.flags == 7);
+    REQUIRE(std::string(decoded.payload, decoded.payloadSize) == payload);
+    // zero-copy: payload points into frame
+    REQUIRE(decoded.payload == frame.data() + 6);
+
+    // truncated and trailing bytes are malformed
+    REQUIRE(!codec.decode(frame.substr(0, frame.size() - 1), decoded));
+    REQUIRE(!codec.decode(frame + "y", decoded));
+    REQUIRE(!codec.decode(std::string("\x01\x00\x00"), decoded));
+
+    const std::string json = R"({"type":"1","payload":"t"})";
+    REQUIRE(MessageCodec::detect(json, false) == MessageCodecType::JSON);
+    REQUIRE(MessageCodec::forType(MessageCodecType::JSON).decode(json, decoded));
+    REQUIRE(decoded.opcode == 1);
+    REQUIRE(decoded.payloadSize == json.size());
+    REQUIRE(MessageCodec::forType(MessageCodecType::JSON).encode(1, 0, json) == json);
+
+    std::string fields;
+    fields.push_back('\x05');
+    fields.append("\xff\xff\xff\xff\x0f"); // varint of uint32_t max
+    BinaryReader reader(fields.data(), fields.size());
+    uint8_t u8 = 0;
+    uint32_t varint = 0;
+    REQUIRE(reader.readU8(u8));
+    REQUIRE(u8 == 5);
+    REQUIRE(reader.readVarint(varint));
+    REQUIRE(varint == 4294967295u);
+    REQUIRE(reader.remaining() == 0);
+    REQUIRE(!reader.readU8(u8));
+  }
+
+  GIVEN("binary session reply") {
+    using namespace gloer::net;
+
+    // records frames instead of writing them to socket
+    class RecordingSession : public SessionBase<ws::SessionGUID> {
+    public:
+      RecordingSession() : SessionBase<ws::SessionGUID>(ws::SessionGUID(std::string{"rec"})) {}
+
+      void send(const std::string& ss) override { sent.push_back(ss); }
+
+      bool isExpired() const override { return false; }
+
+      std::vector<std::string> sent;
+    };
+
+    const BinaryCodec codec;
+    const std::string ping = R"({"type":"0","ts":42})";
+    const std::string request = codec.encode(0, 0, ping);
+
+    RecordingSession session;
+    REQUIRE(session.negotiateCodec(MessageCodec::detect(request, true)));
+
+    // same path as ping echo of gameserver: decode, parse payload, reply by opcode
+    DecodedMessage decoded;
+    REQUIRE(codec.decode(request, decoded));
+    JsonMessage message(decoded.payload, decoded.payloadSize);
+    REQUIRE(message.parse());
+    session.sendOperation(decoded.opcode, message.str());
+
+    REQUIRE(session.sent.size() == 1);
+    REQUIRE(session.sent[0] == request);
+    DecodedMessage reply;
+    REQUIRE(codec.decode(session.sent[0], reply));
+    REQUIRE(reply.opcode == (+gloer::algo::WS_OPCODE::PING)._to_integral());
+    REQUIRE(std::string(reply.payload, reply.payloadSize) == ping);
+
+    // JSON session sends payload as is
+    RecordingSession jsonSession;
+    REQUIRE(jsonSession.negotiateCodec(MessageCodecType::JSON));
+    jsonSession.sendOperation(decoded.opcode, ping);
+    REQUIRE(jsonSession.sent.back() == ping);
+  }
+
+  GIVEN("generated message structs") {
+    using namespace gloer::net::schema;
+    IceCandidate candidate;
+    candidate.candidate = "candidate:1 1 udp 2122260223 10.0.0.1 57339 typ host";
+    candidate.sdpMid = "0";
+    candidate.sdpMLineIndex = -1;
+
+    rapidjson::StringBuffer strbuf;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(strbuf);
+    REQUIRE(toJsonEnvelope("1", candidate, writer));
+
+    JsonMessage message(strbuf.GetString());
+    REQUIRE(message.parse());
+    IceCandidate parsed;
+    REQUIRE(fromJsonPayload(message.document(), parsed));
+    REQUIRE(parsed.candidate == candidate.candidate);
+    REQUIRE(parsed.sdpMid == "0");
+    REQUIRE(parsed.sdpMLineIndex == -1);
+
+    std::string binary;
+    binary.reserve(binarySize(candidate));
+    toBinary(candidate, binary);
+    REQUIRE(binary.size() == binarySize(candidate));
+    REQUIRE(fromBinary(binary.data(), binary.size(), parsed));
+    REQUIRE(parsed.sdpMLineIndex == -1);
+    REQUIRE(!fromBinary(binary.data(), binary.size() - 1, parsed));
+
+    // missing, mistyped and duplicate fields are rejected
+    JsonMessage missing(R"({"type":"1","payload":{"candidate":"c","sdpMid":"0"}})");
+    REQUIRE(missing.parse());
+    REQUIRE(!fromJsonPayload(missing.document(), parsed));
+    JsonMessage mistyped(R"({"type":"1","payload":{"candidate":1,"sdpMid":"0","sdpMLineIndex":0}})");
+    REQUIRE(mistyped.parse());
+    REQUIRE(!fromJsonPayload(mistyped.document(), parsed));
+    JsonMessage duplicate(
+        R"({"type":"1","payload":{"sdpMid":"0","sdpMid":"1","candidate":"c","sdpMLineIndex":0}})");
+    REQUIRE(duplicate.parse());
+    REQUIRE(!fromJsonPayload(duplicate.document(), parsed));
+  }
+
+  GIVEN("createIceCandidatesFromJson") {
+    using gloer::net::wrtc::WRTCSession;
+    const auto hostCandidate = [](const std::string& ip) {
+      return R"({"candidate":"candidate:1 1 udp 2122260223 )" + ip +
+             R"( 57339 typ host","sdpMid":"0","sdpMLineIndex":0})";
+    };
+    const std::string host1 = hostCandidate("10.0.0.1");
+    const std::string host2 = hostCandidate("10.0.0.2");
+    const std::string host3 = hostCandidate("10.0.0.3");
+
+    JsonMessage single(R"({"type":"1","payload":)" + host1 + "}");
+    REQUIRE(single.parse());
+    REQUIRE(WRTCSession::createIceCandidatesFromJson(single.document()).size() == 1);
+
+    JsonMessage batch(R"({"type":"4","payload":[)" + host1 + "," + host2 + "," + host3 + "]}");
+    REQUIRE(batch.parse());
+    const auto candidates = WRTCSession::createIceCandidatesFromJson(batch.document());
+    REQUIRE(candidates.size() == 3);
+    REQUIRE(candidates[1]->sdp_mid() == "0");
+    REQUIRE(candidates[2]->candidate().address().ipaddr().ToString() == "10.0.0.3");
+
+    JsonMessage empty(R"({"type":"4","payload":[]})");
+    REQUIRE(empty.parse());
+    REQUIRE(WRTCSession::createIceCandidatesFromJson(empty.document()).empty());
+
+    // malformed entries of batch are skipped, valid ones are kept
+    JsonMessage malformed(R"({"type":"4","payload":[)" + host1 +
+                          R"(,{"candidate":"c","sdpMid":"0"},42,)" +
+                          R"({"candidate":"bad","sdpMid":"0","sdpMLineIndex":0},)" + host3 +
+                          "]}");
+    REQUIRE(malformed.parse());
+    REQUIRE(WRTCSession::createIceCandidatesFromJson(malformed.document()).size() == 2);
+
+    JsonMessage noPayload(R"({"type":"4"})");
+    REQUIRE(noPayload.parse());
+    REQUIRE(WRTCSession::createIceCandidatesFromJson(noPayload.document()).empty());
+  }
+
+  GIVEN("SdpTemplateCache") {
+    using gloer::net::wrtc::SdpAnswerParams;
+    using gloer::net::wrtc::SdpTemplateCache;
+
+    const std::string offer = "v=0\r\n"
+                              "o=- 111 2 IN IP4 127.0.0.1\r\n"
+                              "s=-\r\n"
+                              "t=0 0\r\n"
+                              "m=application 9 UDP/DTLS/SCTP webrtc-datachannel\r\n"
+                              "c=IN IP4 0.0.0.0\r\n"
+                              "a=ice-ufrag:abcd\r\n"
+                              "a=ice-pwd:abcdefghijklmnopqrstuv\r\n"
+                              "a=fingerprint:sha-256 AA:BB\r\n"
+                              "a=setup:actpass\r\n"
+                              "a=mid:0\r\n"
+                              "a=sctp-port:5000\r\n";
+    // per-session values do not change shape
+    std::string otherOffer = offer;
+    otherOffer.replace(otherOffer.find("abcd"), 4, "efgh");
+    REQUIRE(SdpTemplateCache::offerShape(offer) == SdpTemplateCache::offerShape(otherOffer));
+    std::string otherShapeOffer = offer;
+    otherShapeOffer.replace(otherShapeOffer.find("a=mid:0"), 7, "a=mid:data");
+    REQUIRE(SdpTemplateCache::offerShape(offer) !=
+            SdpTemplateCache::offerShape(otherShapeOffer));
+
+    const std::string answer = "v=0\r\n"
+                               "o=- 222 2 IN IP4 127.0.0.1\r\n"
+                               "s=-\r\n"
+                               "t=0 0\r\n"
+                               "m=application 9 UDP/DTLS/SCTP webrtc-datachannel\r\n"
+                               "c=IN IP4 0.0.0.0\r\n"
+                               "a=candidate:1 1 udp 1 10.0.0.1 5000 typ host\r\n"
+                               "a=ice-ufrag:wxyz\r\n"
+                               "a=ice-pwd:0123456789012345678901\r\n"
+                               "a=fingerprint:sha-256 CC:DD\r\n"
+                               "a=setup:active\r\n"
+                               "a=mid:0\r\n"
+                               "a=sctp-port:5000\r\n";
+
+    SdpTemplateCache cache(1);
+    SdpAnswerParams params;
+    params.sessionId = "333";
+    params.iceUfrag = "ufrg";
+    params.icePwd = "pwdpwdpwdpwdpwdpwdpwdp";
+    params.fingerprint = "sha-256 EE:FF";
+
+    std::string rendered;
+    REQUIRE(!cache.render(SdpTemplateCache::offerShape(offer), params, rendered));
+    REQUIRE(cache.learn(SdpTemplateCache::offerShape(offer), answer));
+    REQUIRE(!cache.learn(SdpTemplateCache::offerShape(otherShapeOffer), answer)); // full
+    REQUIRE(!cache.learn(SdpTemplateCache::offerShape(offer), "v=0\r\n")); // nothing to render
+    REQUIRE(cache.size() == 1);
+
+    REQUIRE(cache.render(SdpTemplateCache::offerShape(otherOffer), params, rendered));
+    REQUIRE(SdpTemplateCache::validate(rendered, params));
+    REQUIRE(rendered.find("o=- 333 2 IN IP4 127.0.0.1\r\n") != std::string::npos);
+    REQUIRE(rendered.find("a=fingerprint:sha-256 EE:FF\r\n") != std::string::npos);
+    REQUIRE(rendered.find("a=candidate:") == std::string::npos);
+    REQUIRE(rendered.find("wxyz") == std::string::npos);
+    REQUIRE(!SdpTemplateCache::validate(answer, params));
+    REQUIRE(cache.hits() == 1);
+    REQUIRE(cache.misses() == 1);
+  }
+
+  GIVEN("EventLog") {
+    using gloer::log::EventLog;
+
+    const std::string path =
+        (::fs::path(gloer::storage::getThisBinaryDirectoryPath()) / "test.evlog").string();
+    EventLog eventLog(/* ringCapacity */ 4, /* flushIntervalMs */ 1000);
+    REQUIRE(eventLog.start(path));
+    REQUIRE(!EventLog().start(path)); // only one active event log
+
+    for (int i = 0; i < 6; i++) {
+      GLOG_EVENT(CORE, WARNING, "event {} of {}", i, std::string(300, 'x'));
+    }
+    eventLog.stop();
+    // flush thread did not run yet, ring holds 4 events
+    REQUIRE(eventLog.writtenCount() == 4);
+    REQUIRE(eventLog.droppedCount() == 2);
+
+    // stopped log ignores events
+    GLOG_EVENT(CORE, WARNING, "ignored");
+    REQUIRE(eventLog.writtenCount() == 4);
+
+    const std::string contents = getFileContents(path);
+    REQUIRE(contents.compare(0, 8, "GLEVLOG1") == 0);
+    REQUIRE(contents.find("event {} of {}") != std::string::npos);
+    ::fs::remove(path);
+  }
+
+  GIVEN("TrafficCapture") {
+    using namespace gloer::net;
+
+    const std::string path =
+        (::fs::path(gloer::storage::getThisBinaryDirectoryPath()) / "test.gcap").string();
+    TrafficCapture capture;
+    REQUIRE(capture.start(path));
+    REQUIRE(TrafficCapture::isActive());
+    REQUIRE(!TrafficCapture().start(path)); // only one active capture
+
+    const std::string binary("\x01\x00\x02", 3);
+    TrafficCapture::write(CaptureRecordKind::MESSAGE, CaptureTransport::WS, "ws1",
+                          "{\"type\":\"0\"}", false);
+    TrafficCapture::write(CaptureRecordKind::MESSAGE, CaptureTransport::WRTC, "wrtc1", binary,
+                          true);
+    TrafficCapture::write(CaptureRecordKind::CLOSE, CaptureTransport::WS, "ws1", "", false);
+    capture.stop();
+    REQUIRE(!TrafficCapture::isActive());
+    REQUIRE(capture.writtenCount() == 3);
+
+    // stopped capture ignores records
+    TrafficCapture::write(CaptureRecordKind::CLOSE, CaptureTransport::WS, "ws2", "", false);
+    REQUIRE(capture.writtenCount() == 3);
+
+    TrafficCaptureReader reader;
+    REQUIRE(reader.open(path));
+    CaptureRecord record;
+    REQUIRE(reader.next(record));
+    REQUIRE(record.kind == CaptureRecordKind::MESSAGE);
+    REQUIRE(record.transport == CaptureTransport::WS);
+    REQUIRE(record.sessId == "ws1");
+    REQUIRE(record.payload == "{\"type\":\"0\"}");
+    REQUIRE(!record.isBinary);
+    const uint64_t firstTimeNs = record.timeNs;
+    REQUIRE(reader.next(record));
+    REQUIRE(record.transport == CaptureTransport::WRTC);
+    REQUIRE(record.payload == binary);
+    REQUIRE(record.isBinary);
+    REQUIRE(record.timeNs >= firstTimeNs);
+    REQUIRE(reader.next(record));
+    REQUIRE(record.kind == CaptureRecordKind::CLOSE);
+    REQUIRE(record.payload.empty());
+    REQUIRE(!reader.next(record));
+    REQUIRE(!reader.failed());
+
+    // incomplete last record, e.g. capture of crashed server
+    ::fs::resize_file(path, ::fs::file_size(path) - 1);
+    REQUIRE(reader.open(path));
+    REQUIRE(reader.next(record));
+    REQUIRE(reader.next(record));
+    REQUIRE(!reader.next(record));
+    REQUIRE(reader.failed());
+
+    // corrupted payload size is rejected before payload is allocated
+    {
+      TrafficCapture sizeCapture;
+      REQUIRE(sizeCapture.start(path));
+      TrafficCapture::write(CaptureRecordKind::MESSAGE, CaptureTransport::WS, "ws1", "x", false);
+    }
+    REQUIRE(!TrafficCapture::isActive()); // destroyed capture is stopped
+    std::FILE* file = std::fopen(path.c_str(), "r+b");
+    REQUIRE(file);
+    // file header (12), record header (11), session id (2 + 3)
+    std::fseek(file, 12 + 11 + 2 + 3, SEEK_SET);
+    const uint32_t hugeSize = 0xFFFFFFFF;
+    std::fwrite(&hugeSize, 1, sizeof(hugeSize), file);
+    std::fclose(file);
+    REQUIRE(reader.open(path));
+    REQUIRE(!reader.next(record));
+    REQUIRE(reader.failed());
+    ::fs::remove(path);
+  }
+
+  GIVEN("MessageTracer") {
+    using namespace gloer::metrics;
+
+    MessageTracer tracer(/* capacity */ 2);
+    REQUIRE(tracer.begin("session") == 0); // disabled by default
+    tracer.setSampleRate(0.5);
+    REQUIRE(tracer.begin("session") == 0);
+    const uint64_t traceId = tracer.begin("session");
+    REQUIRE(traceId != 0);
+    tracer.record(traceId, TraceStage::DISPATCH_ENQUEUE);
+    tracer.record(traceId, TraceStage::DISPATCH_DEQUEUE);
+    REQUIRE(tracer.toChromeTraceJson().find("\"queue_wait\"") != std::string::npos);
+    REQUIRE(tracer.toChromeTraceJson().find("\"send_queue\"") == std::string::npos);
+
+    // newer traces reuse slot of |traceId|
+    tracer.setSampleRate(1.0);
+    tracer.begin("session");
+    tracer.begin("session");
+    tracer.record(traceId, TraceStage::SEND_ENQUEUE);
+    REQUIRE(tracer.toChromeTraceJson().find("\"handler_to_send\"") == std::string::npos);
+
+    // trace follows message through dispatch queue
+    MessageTracer& global = MessageTracer::instance();
+    global.setSampleRate(1.0);
+    DispatchQueue queue(std::string{"trace test queue"}, 0);
+    const uint64_t dispatchedId = global.begin("session");
+    uint64_t handledId = 0;
+    {
+      MessageTracer::Scope traceScope(dispatchedId);
+      queue.dispatch([&handledId]() { handledId = MessageTracer::current(); });
+    }
+    REQUIRE(MessageTracer::current() == 0);
+    queue.DispatchQueued();
+    REQUIRE(handledId == dispatchedId);
+    const std::string json = global.toChromeTraceJson();
+    REQUIRE(json.find("\"handler\"") != std::string::npos);
+    REQUIRE(json.find("\"read_to_dispatch\"") != std::string::npos);
+    global.setSampleRate(0.0);
+  }
+
+  GIVEN("TickManager") {
+    using namespace std::chrono_literals;
+
+    TickManager<std::chrono::milliseconds> tm(10s);
+    int ticks = 0;
+    int wakeups = 0;
+    tm.addTickHandler(TickHandler("tick", [&ticks]() { ticks++; }));
+    tm.addWakeupHandler(TickHandler("wakeup", [&wakeups]() { wakeups++; }));
+
+    // wakeup from other thread ends wait long before tick deadline
+    const auto waitStart = std::chrono::steady_clock::now();
+    std::thread waker([&tm]() {
+      std::this_thread::sleep_for(10ms);
+      tm.wakeup();
+    });
+    tm.tick();
+    waker.join();
+    REQUIRE(std::chrono::steady_clock::now() - waitStart < 5s);
+    REQUIRE(wakeups == 1);
+    REQUIRE(ticks == 0);
+
+    // deadline without wakeup runs only tick handlers
+    TickManager<std::chrono::milliseconds> fastTm(1ms);
+    fastTm.addTickHandler(TickHandler("tick", [&ticks]() { ticks++; }));
+    fastTm.addWakeupHandler(TickHandler("wakeup", [&wakeups]() { wakeups++; }));
+    fastTm.tick();
+    REQUIRE(ticks == 1);
+    REQUIRE(wakeups == 1);
+  }
+
+  GIVEN("MetricsRegistry") {
+    using namespace gloer::metrics;
+    MetricsRegistry& registry = MetricsRegistry::instance();
+
+    Counter& counter = registry.counter("test_events_total", "test counter", "kind=\"a\"");
+    REQUIRE(&counter == &registry.counter("test_events_total", "test counter", "kind=\"a\""));
+    std::thread worker([&counter]() {
+      for (int i = 0; i < 1000; i++) {
+        counter.inc();
+      }
+    });
+    for (int i = 0; i < 1000; i++) {
+      counter.inc();
+    }
+    worker.join();
+    REQUIRE(counter.value() == 2000);
+
+    // gauge is summed over shards of all writers
+    Gauge& gauge = registry.gauge("test_depth", "test gauge");
+    std::thread gaugeWorker([&gauge]() {
+      for (int i = 0; i < 1000; i++) {
+        gauge.add(2);
+      }
+    });
+    for (int i = 0; i < 1000; i++) {
+      gauge.add(-1);
+    }
+    gaugeWorker.join();
+    REQUIRE(gauge.value() == 1000);
+    gauge.set(5);
+    REQUIRE(gauge.value() == 5);
+
+    // buckets cover all values without gaps
+    for (size_t i = 1; i < Histogram::kBuckets; i++) {
+      REQUIRE(Histogram::bucketIndex(Histogram::bucketUpperBound(i - 1) + 1) == i);
+    }
+    Histogram& histogram = registry.histogram("test_latency_us", "test histogram");
+    for (uint64_t value = 1; value <= 100; value++) {
+      histogram.record(value);
+    }
+    const Histogram::Snapshot snapshot = histogram.snapshot();
+    REQUIRE(snapshot.count == 100);
+    REQUIRE(snapshot.sum == 5050);
+    // relative error of bucket is below 12.5%
+    REQUIRE(snapshot.percentile(0.5) >= 50);
+    REQUIRE(snapshot.percentile(0.5) <= 56);
+
+    const uint64_t callbackId =
+        registry.addCallbackGauge("test_callback", "test callback gauge", "", []() { return 7.0; });
+    std::string text = registry.toPrometheusText();
+    REQUIRE(text.find("# TYPE test_events_total counter") != std::string::npos);
+    REQUIRE(text.find("test_events_total{kind=\"a\"} 2000") != std::string::npos);
+    REQUIRE(text.find("test_latency_us_bucket{le=\"+Inf\"} 100") != std::string::npos);
+    REQUIRE(text.find("test_latency_us_sum 5050") != std::string::npos);
+    REQUIRE(text.find("test_callback 7") != std::string::npos);
+
+    registry.removeCallbackGauge(callbackId);
+    text = registry.toPrometheusText();
+    REQUIRE(text.find("test_callback") == std::string::npos);
   }
 }